@@ -0,0 +1,182 @@
+/**
+ * @file /check/magma/core/batch_check.c
+ *
+ * @brief Unit tests for the batch index interface.
+ */
+
+#include "magma_check.h"
+
+#define BATCH_CHECK_RECORDS 10000
+#define BATCH_CHECK_DUPLICATES 97
+
+/**
+ * @brief	Verify the records held by an index, after the keys divisible by four were deleted and the odd keys were added.
+ * @param	inx		the index being checked.
+ * @param	keys	an array large enough to hold every key that was ever inserted.
+ * @param	results	an array large enough to hold the search results.
+ * @return	true if every key was found with the correct value, or missing when it should be, and false otherwise.
+ */
+bool_t check_indexes_batch_verify(inx_t *inx, multi_t *keys, void **results) {
+
+	uint64_t expected = 0;
+
+	for (uint64_t i = 0; i < BATCH_CHECK_RECORDS * 2; i++) {
+		keys[i].val.u64 = i;
+		expected += (i % 4) ? 1 : 0;
+	}
+
+	if (inx_find_batch(inx, keys, results, BATCH_CHECK_RECORDS * 2) != expected) {
+		return false;
+	}
+
+	for (uint64_t i = 0; i < BATCH_CHECK_RECORDS * 2; i++) {
+		if (results[i] != ((i % 4) ? (void *)(i + 1) : NULL)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Check that a tree built from a batch with duplicate keys keeps the records in order.
+ * @note	Records with equal keys must be returned in the order they appeared in the batch, just as they would be if they
+ * 			had been inserted one at a time.
+ * @param	keys	an array large enough to hold the batch.
+ * @param	data	an array large enough to hold the batch values.
+ * @return	true if the cursor returned the records in the correct order, and false otherwise.
+ */
+bool_t check_indexes_batch_duplicates(multi_t *keys, void **data) {
+
+	inx_t *inx;
+	multi_t key, last;
+	bool_t result = true;
+	uint64_t count = 0, value, previous = 0;
+	inx_cursor_t *cursor;
+
+	if (!(inx = inx_alloc(M_INX_TREE, NULL))) {
+		return false;
+	}
+
+	// The keys descend, and then wrap around, so the batch has to be sorted, and each key is repeated many times.
+	for (uint64_t i = 0; i < BATCH_CHECK_RECORDS; i++) {
+		keys[i].val.u64 = (BATCH_CHECK_DUPLICATES - 1) - (i % BATCH_CHECK_DUPLICATES);
+		data[i] = (void *)(i + 1);
+	}
+
+	if (inx_insert_batch(inx, keys, data, BATCH_CHECK_RECORDS) != BATCH_CHECK_RECORDS || !(cursor = inx_cursor_alloc(inx))) {
+		inx_free(inx);
+		return false;
+	}
+
+	last = mt_get_null();
+
+	while (result && !mt_is_empty(key = inx_cursor_key_next(cursor))) {
+
+		value = (uint64_t)inx_cursor_value_active(cursor);
+
+		if (!value || value > BATCH_CHECK_RECORDS || key.val.u64 != keys[value - 1].val.u64 ||
+			(count && (key.val.u64 < last.val.u64 || (key.val.u64 == last.val.u64 && value < previous)))) {
+			result = false;
+		}
+
+		last = key;
+		previous = value;
+		count++;
+	}
+
+	inx_cursor_free(cursor);
+	inx_free(inx);
+
+	return result && count == BATCH_CHECK_RECORDS;
+}
+
+bool_t check_indexes_batch_simple(char **errmsg) {
+
+	inx_t *inx;
+	multi_t *keys;
+	void **data, **results, *swap;
+	uint64_t position, types[] = { M_INX_HASHED, M_INX_TREE, M_INX_LINKED, M_INX_HASHED | M_INX_SHARDED, M_INX_TREE | M_INX_SHARDED,
+		M_INX_HASHED | M_INX_RCU, M_INX_TREE | M_INX_RCU };
+
+	if (!(keys = mm_alloc((sizeof(multi_t) + (sizeof(void *) * 2)) * BATCH_CHECK_RECORDS * 2))) {
+		*errmsg = "batch array allocation failed";
+		return false;
+	}
+
+	data = (void **)(keys + (BATCH_CHECK_RECORDS * 2));
+	results = data + (BATCH_CHECK_RECORDS * 2);
+
+	for (uint64_t i = 0; i < BATCH_CHECK_RECORDS * 2; i++) {
+		keys[i].type = M_TYPE_UINT64;
+	}
+
+	for (uint_t type = 0; status() && type < (sizeof(types) / sizeof(uint64_t)); type++) {
+
+		if (!(inx = inx_alloc(types[type], NULL))) {
+			*errmsg = "index allocation failed";
+			break;
+		}
+
+		// Load the even keys in a random order, so the tree has to sort the batch before building itself.
+		for (uint64_t i = 0; i < BATCH_CHECK_RECORDS; i++) {
+			keys[i].val.u64 = i * 2;
+			data[i] = (void *)((i * 2) + 1);
+		}
+
+		for (uint64_t i = BATCH_CHECK_RECORDS - 1; i > 0; i--) {
+			position = rand_get_uint64() % (i + 1);
+			swap = data[i];
+			data[i] = data[position];
+			data[position] = swap;
+			keys[i].val.u64 = (uint64_t)data[i] - 1;
+			keys[position].val.u64 = (uint64_t)data[position] - 1;
+		}
+
+		if (inx_insert_batch(inx, keys, data, BATCH_CHECK_RECORDS) != BATCH_CHECK_RECORDS || inx_count(inx) != BATCH_CHECK_RECORDS) {
+			*errmsg = "batch insert operation failed";
+			inx_free(inx);
+			break;
+		}
+
+		// Delete the keys divisible by four, along with a set of keys which were never inserted.
+		for (uint64_t i = 0; i < BATCH_CHECK_RECORDS; i++) {
+			keys[i].val.u64 = (i % 2) ? (i * 4) + 1 : i * 2;
+		}
+
+		if (inx_delete_batch(inx, keys, BATCH_CHECK_RECORDS) != (BATCH_CHECK_RECORDS / 2)) {
+			*errmsg = "batch delete operation failed";
+			inx_free(inx);
+			break;
+		}
+
+		// Add the odd keys, which places the batch into an index which already holds records.
+		for (uint64_t i = 0; i < BATCH_CHECK_RECORDS; i++) {
+			keys[i].val.u64 = (i * 2) + 1;
+			data[i] = (void *)((i * 2) + 2);
+		}
+
+		if (inx_insert_batch(inx, keys, data, BATCH_CHECK_RECORDS) != BATCH_CHECK_RECORDS ||
+			inx_count(inx) != (BATCH_CHECK_RECORDS + (BATCH_CHECK_RECORDS / 2))) {
+			*errmsg = "batch insert operation failed";
+			inx_free(inx);
+			break;
+		}
+
+		if (!check_indexes_batch_verify(inx, keys, results)) {
+			*errmsg = "batch find operation returned the wrong value";
+			inx_free(inx);
+			break;
+		}
+
+		inx_free(inx);
+	}
+
+	if (!*errmsg && status() && !check_indexes_batch_duplicates(keys, data)) {
+		*errmsg = "batch insert of duplicate keys returned records out of order";
+	}
+
+	mm_free(keys);
+
+	return *errmsg == NULL;
+}
@@ -0,0 +1,217 @@
+
+/**
+ * @file /check/magma/core/cache_check.c
+ *
+ * @brief Unit tests for the size class allocator used by mm_alloc() and mm_free().
+ */
+
+#include "magma_check.h"
+
+#define CACHE_CHECK_THREADS 4
+#define CACHE_CHECK_BLOCKS 8192
+#define CACHE_CHECK_SPANS 16
+
+/**
+ * @brief	Allocate a batch of blocks of varying sizes, and verify they are zeroed and don't overlap.
+ * @note	Half of the blocks are released by the thread itself, and the other half are returned so another thread can
+ * 			release them.
+ * @param	data	the thread number.
+ * @return	NULL on failure, or an array holding the blocks which were not released.
+ */
+void * check_cache_thread(void *data) {
+
+	size_t len;
+	uchr_t **blocks;
+	uint64_t number = (uint64_t)data;
+
+	if (!(blocks = mm_alloc(sizeof(uchr_t *) * CACHE_CHECK_BLOCKS))) {
+		return NULL;
+	}
+
+	for (uint64_t i = 0; i < CACHE_CHECK_BLOCKS; i++) {
+
+		len = ((i * 37) % MM_CACHE_LIMIT) + 1;
+
+		if (!(blocks[i] = mm_alloc(len))) {
+			return NULL;
+		}
+
+		for (size_t j = 0; j < len; j++) {
+			if (blocks[i][j]) return NULL;
+		}
+
+		memset(blocks[i], (uchr_t)(number + i), len);
+	}
+
+	for (uint64_t i = 0; i < CACHE_CHECK_BLOCKS; i++) {
+
+		len = ((i * 37) % MM_CACHE_LIMIT) + 1;
+
+		for (size_t j = 0; j < len; j++) {
+			if (blocks[i][j] != (uchr_t)(number + i)) return NULL;
+		}
+
+		if (i % 2) {
+			mm_free(blocks[i]);
+			blocks[i] = NULL;
+		}
+	}
+
+	return blocks;
+}
+
+bool_t check_cache_simple(char **errmsg) {
+
+	void *block;
+	uchr_t **blocks[CACHE_CHECK_THREADS];
+	pthread_t threads[CACHE_CHECK_THREADS];
+	mm_cache_stats_t before, after;
+
+	if (!(block = mm_alloc(64)) || !mm_cache_owned(block)) {
+		*errmsg = "small blocks are not being handled by the size class allocator";
+		if (block) mm_free(block);
+		return false;
+	}
+
+	mm_free(block);
+
+	if (!(block = mm_alloc(MM_CACHE_LIMIT + 1)) || mm_cache_owned(block)) {
+		*errmsg = "large blocks are being handled by the size class allocator";
+		if (block) mm_free(block);
+		return false;
+	}
+
+	mm_free(block);
+	mm_cache_flush();
+
+	if (!mm_cache_stats(&before)) {
+		*errmsg = "unable to fetch the allocator statistics";
+		return false;
+	}
+
+	for (uint64_t i = 0; i < CACHE_CHECK_THREADS; i++) {
+		if (thread_launch(&threads[i], &check_cache_thread, (void *)i)) {
+			*errmsg = "thread launch failed";
+			return false;
+		}
+	}
+
+	for (uint64_t i = 0; i < CACHE_CHECK_THREADS; i++) {
+		if (thread_result(threads[i], (void **)&blocks[i]) || !blocks[i]) {
+			*errmsg = "a thread returned a block which wasn't zeroed, or which was overwritten";
+			return false;
+		}
+	}
+
+	// Release the remaining blocks from this thread, which didn't allocate them.
+	for (uint64_t i = 0; i < CACHE_CHECK_THREADS; i++) {
+		for (uint64_t j = 0; j < CACHE_CHECK_BLOCKS; j++) {
+			if (blocks[i][j]) mm_free(blocks[i][j]);
+		}
+		mm_free(blocks[i]);
+	}
+
+	mm_cache_flush();
+
+	if (!mm_cache_stats(&after)) {
+		*errmsg = "unable to fetch the allocator statistics";
+		return false;
+	}
+	else if (after.allocated - before.allocated != after.released - before.released ||
+		after.allocated - before.allocated < CACHE_CHECK_THREADS * CACHE_CHECK_BLOCKS) {
+		*errmsg = "the allocator statistics don't match the number of blocks allocated and released";
+		return false;
+	}
+
+	for (uint32_t i = 0; i < MM_CACHE_CLASSES; i++) {
+		if (!after.classes[i].size || after.classes[i].size > MM_CACHE_LIMIT || after.classes[i].available > after.classes[i].objects) {
+			*errmsg = "the allocator size class statistics are inconsistent";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool_t check_cache_return(char **errmsg) {
+
+	uchr_t **blocks, *low = NULL, *high = NULL;
+	mm_cache_stats_t before, after;
+	uint64_t count = (65536 / 48) * CACHE_CHECK_SPANS, reused = 0;
+
+	if (!(blocks = mm_alloc(sizeof(uchr_t *) * count)) || mm_cache_owned(blocks)) {
+		*errmsg = "block array allocation failed";
+		if (blocks) mm_free(blocks);
+		return false;
+	}
+
+	mm_cache_flush();
+
+	if (!mm_cache_stats(&before)) {
+		*errmsg = "unable to fetch the allocator statistics";
+		mm_free(blocks);
+		return false;
+	}
+
+	// Allocate enough blocks from a single size class to fill a number of spans, then release all of them, so the spans
+	// should be returned to the system once the objects make their way back to the shared list.
+	for (uint64_t i = 0; i < count; i++) {
+
+		if (!(blocks[i] = mm_alloc(48))) {
+			*errmsg = "block allocation failed";
+			for (uint64_t j = 0; j < i; j++) mm_free(blocks[j]);
+			mm_free(blocks);
+			return false;
+		}
+
+		low = !low || blocks[i] < low ? blocks[i] : low;
+		high = !high || blocks[i] > high ? blocks[i] : high;
+	}
+
+	for (uint64_t i = 0; i < count; i++) {
+		mm_free(blocks[i]);
+	}
+
+	mm_cache_flush();
+
+	if (!mm_cache_stats(&after)) {
+		*errmsg = "unable to fetch the allocator statistics";
+		mm_free(blocks);
+		return false;
+	}
+	else if (after.returned - before.returned < CACHE_CHECK_SPANS / 2 || after.spans >= before.spans + CACHE_CHECK_SPANS / 2) {
+		*errmsg = "the spans holding the released blocks weren't returned to the system";
+		mm_free(blocks);
+		return false;
+	}
+
+	// The returned spans should be reused before new spans are claimed. A few of the blocks will come from objects which
+	// were already sitting on the shared list, and may fall outside the original range.
+	for (uint64_t i = 0; i < count; i++) {
+
+		if (!(blocks[i] = mm_alloc(48))) {
+			*errmsg = "block allocation failed";
+			for (uint64_t j = 0; j < i; j++) mm_free(blocks[j]);
+			mm_free(blocks);
+			return false;
+		}
+
+		if (blocks[i] >= low && blocks[i] <= high) {
+			reused++;
+		}
+	}
+
+	for (uint64_t i = 0; i < count; i++) {
+		mm_free(blocks[i]);
+	}
+
+	mm_free(blocks);
+	mm_cache_flush();
+
+	if (reused < count / 2) {
+		*errmsg = "new spans were claimed instead of reusing the returned spans";
+		return false;
+	}
+
+	return true;
+}
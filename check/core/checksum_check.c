@@ -38,7 +38,9 @@ bool_t check_checksum_fuzz_sthread(void) {
 		hash_adler32(buffer, len);
 		hash_murmur32(buffer, len);
 		hash_murmur64(buffer, len);
+		hash_murmur64_seed(buffer, len, 0);
 		hash_fletcher32(buffer, len);
+		hash_wyhash64(buffer, len, 0);
 
 	}
 
@@ -0,0 +1,133 @@
+
+/**
+ * @file /check/magma/core/classify_check.c
+ *
+ * @brief Unit tests for the character sets and span functions.
+ */
+
+#include "magma_check.h"
+
+#define CLASSIFY_CHECK_ROUNDS 4096
+
+bool_t check_classify_span(char **errmsg) {
+
+	chr_set_t set;
+	size_t len, count, expected;
+	uchr_t block[160], members[8];
+	chr_kernels_t kernels[2] = { { &chr_span_scalar, &chr_span_reverse_scalar }, { NULL, NULL } };
+
+#ifdef __SSE2__
+	if (__builtin_cpu_supports("ssse3")) kernels[1] = (chr_kernels_t){ &chr_span_ssse3, &chr_span_reverse_ssse3 };
+#endif
+
+	for (uint32_t round = 0; round < CLASSIFY_CHECK_ROUNDS; round++) {
+
+		// Draw the members from the whole byte range, so both halves of the nibble tables are exercised, then fill the block
+		// mostly with members, so the spans run for a while before they end.
+		count = (rand_get_uint32() % 8) + 1;
+		len = rand_get_uint32() % 160;
+
+		for (size_t i = 0; i < count; i++) members[i] = rand_get_uint32() % 256;
+		for (size_t i = 0; i < len; i++) block[i] = rand_get_uint32() % 16 ? members[rand_get_uint32() % count] : rand_get_uint32() % 256;
+
+		chr_set_chars(&set, members, count);
+
+		for (uint_t c = 0; c < 256; c++) {
+			if (chr_set_member(&set, c) != chr_is_class(c, members, count)) {
+				*errmsg = "the character set membership didn't match the set members";
+				return false;
+			}
+		}
+
+		for (int_t member = 0; member < 2; member++) {
+
+			for (expected = 0; expected < len && chr_is_class(block[expected], members, count) == member; expected++);
+
+			for (int_t k = 0; k < 2; k++) {
+				if (kernels[k].span && kernels[k].span(block, len, &set, member) != expected) {
+					*errmsg = "a span kernel didn't match the reference span";
+					return false;
+				}
+			}
+
+			for (expected = 0; expected < len && chr_is_class(block[len - expected - 1], members, count) == member; expected++);
+
+			for (int_t k = 0; k < 2; k++) {
+				if (kernels[k].rspan && kernels[k].rspan(block, len, &set, member) != expected) {
+					*errmsg = "a reverse span kernel didn't match the reference span";
+					return false;
+				}
+			}
+
+			for (expected = 0; expected < len && chr_whitespace(block[expected]) == member; expected++);
+
+			if (chr_span_class(block, len, M_CHR_WHITESPACE, member) != expected) {
+				*errmsg = "a class span didn't match the reference span";
+				return false;
+			}
+
+			for (expected = 0; expected < len && chr_alphanumeric(block[len - expected - 1]) == member; expected++);
+
+			if (chr_span_class_reverse(block, len, M_CHR_ALPHANUMERIC, member) != expected) {
+				*errmsg = "a reverse class span didn't match the reference span";
+				return false;
+			}
+		}
+	}
+
+	// Every class set should hold exactly the characters in the class.
+	chr_set_class(&set, M_CHR_PUNCTUATION | M_CHR_NUMERIC);
+
+	for (uint_t c = 0; c < 256; c++) {
+		if (chr_set_member(&set, c) != (chr_punctuation(c) || chr_numeric(c))) {
+			*errmsg = "a class character set didn't match the class";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool_t check_classify_helpers(char **errmsg) {
+
+	placer_t place, value;
+	chr_t *padded = " \t\r\n  a header value, with spaces \v\r\n  ";
+
+	place = pl_trim(pl_init(padded, ns_length_get(padded)));
+
+	if (st_cmp_cs_eq(&place, PLACER("a header value, with spaces", 27))) {
+		*errmsg = "the trimmed placer didn't match the expected value";
+		return false;
+	}
+
+	if (!pl_empty(pl_trim(pl_init(" \t\r\n", 4)))) {
+		*errmsg = "trimming a placer holding only whitespace didn't leave it empty";
+		return false;
+	}
+
+	place = pl_init(padded, ns_length_get(padded));
+
+	if (!pl_skip_characters(&place, " \t\r\n", 4) || *pl_char_get(place) != 'a' ||
+		!pl_skip_to_characters(&place, ",;", 2) || *pl_char_get(place) != ',' ||
+		!pl_shrink_before_characters(&place, " \v\r\n", 4) || pl_char_get(place)[pl_length_get(place) - 1] != 's') {
+		*errmsg = "the skip and shrink functions didn't stop at the expected characters";
+		return false;
+	}
+
+	place = pl_init(padded, ns_length_get(padded));
+
+	if (pl_skip_to_characters(&place, "#", 1) || pl_char_get(place) != padded) {
+		*errmsg = "a failed skip modified the placer";
+		return false;
+	}
+
+	if (tok_get_count_bl("a,b,,c", 6, ',') != 4 || tok_get_bl("a,b,,c", 6, ',', 1, &value) != 0 || pl_length_get(value) != 1 ||
+		*pl_char_get(value) != 'b' || tok_get_bl("a,b,,c", 6, ',', 2, &value) != 0 || !pl_empty(value) ||
+		tok_get_bl("a,b,,c", 6, ',', 3, &value) != 1 || *pl_char_get(value) != 'c' || tok_get_bl("a,b,,c", 6, ',', 4, &value) != 1 ||
+		!pl_empty(value)) {
+		*errmsg = "the token functions didn't return the expected tokens";
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,158 @@
+
+/**
+ * @file /check/magma/core/contention_check.c
+ *
+ * @brief Unit tests for the spinning lock wrappers and the lock contention statistics.
+ */
+
+#include "magma_check.h"
+
+#define CONTENTION_CHECK_THREADS 4
+#define CONTENTION_CHECK_ITERATIONS 100000
+#define CONTENTION_CHECK_HOLD 20000
+
+static uint64_t check_contention_counter = 0;
+static pthread_mutex_t check_contention_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t check_contention_rwlock = PTHREAD_RWLOCK_INITIALIZER;
+
+void * check_contention_increment(void *data) {
+
+	for (uint64_t i = 0; i < CONTENTION_CHECK_ITERATIONS; i++) {
+		if (i % 2) {
+			mutex_lock(&check_contention_mutex);
+			check_contention_counter++;
+			mutex_unlock(&check_contention_mutex);
+		}
+		else {
+			rwlock_lock_write(&check_contention_rwlock);
+			check_contention_counter++;
+			rwlock_unlock(&check_contention_rwlock);
+		}
+	}
+
+	return NULL;
+}
+
+void * check_contention_waiter(void *data) {
+
+	switch ((M_CONTENTION)(uintptr_t)data) {
+		case (M_CONTENTION_MUTEX):
+			mutex_lock(&check_contention_mutex);
+			mutex_unlock(&check_contention_mutex);
+			break;
+		case (M_CONTENTION_READ):
+			rwlock_lock_read(&check_contention_rwlock);
+			rwlock_unlock(&check_contention_rwlock);
+			break;
+		case (M_CONTENTION_WRITE):
+			rwlock_lock_write(&check_contention_rwlock);
+			rwlock_unlock(&check_contention_rwlock);
+			break;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Hold a lock while another thread tries to acquire it, so the waiting thread is forced to park.
+ * @param	kind	the type of lock acquisition the waiting thread should attempt.
+ * @return	true if the waiting thread was launched and joined, or false on failure.
+ */
+bool_t check_contention_hold(M_CONTENTION kind) {
+
+	pthread_t thread;
+
+	if (kind == M_CONTENTION_MUTEX) mutex_lock(&check_contention_mutex);
+	else if (kind == M_CONTENTION_READ) rwlock_lock_write(&check_contention_rwlock);
+	else rwlock_lock_read(&check_contention_rwlock);
+
+	if (thread_launch(&thread, &check_contention_waiter, (void *)(uintptr_t)kind)) {
+		if (kind == M_CONTENTION_MUTEX) mutex_unlock(&check_contention_mutex);
+		else rwlock_unlock(&check_contention_rwlock);
+		return false;
+	}
+
+	usleep(CONTENTION_CHECK_HOLD);
+
+	if (kind == M_CONTENTION_MUTEX) mutex_unlock(&check_contention_mutex);
+	else rwlock_unlock(&check_contention_rwlock);
+
+	return !thread_join(thread);
+}
+
+bool_t check_contention_simple(char **errmsg) {
+
+	uint64_t count;
+	pthread_t threads[CONTENTION_CHECK_THREADS];
+	contention_site_t sites[16];
+	bool_t found[M_CONTENTION_WRITE + 1] = { false };
+
+	contention_reset();
+	contention_enable(true);
+
+	// Hammer both lock types from several threads, and make sure none of the increments were lost.
+	for (int_t i = 0; i < CONTENTION_CHECK_THREADS; i++) {
+		if (thread_launch(&threads[i], &check_contention_increment, NULL)) {
+			*errmsg = "thread launch failed";
+			contention_enable(false);
+			return false;
+		}
+	}
+
+	for (int_t i = 0; i < CONTENTION_CHECK_THREADS; i++) {
+		thread_join(threads[i]);
+	}
+
+	if (check_contention_counter != CONTENTION_CHECK_THREADS * CONTENTION_CHECK_ITERATIONS) {
+		*errmsg = "lost updates while incrementing a shared counter";
+		contention_enable(false);
+		return false;
+	}
+
+	// Force a wait on each lock type, so every one of them shows up in the report.
+	contention_reset();
+
+	if (!check_contention_hold(M_CONTENTION_MUTEX) || !check_contention_hold(M_CONTENTION_READ) || !check_contention_hold(M_CONTENTION_WRITE)) {
+		*errmsg = "unable to force a contended lock acquisition";
+		contention_enable(false);
+		return false;
+	}
+
+	contention_enable(false);
+
+	if (!(count = contention_report(sites, 16))) {
+		*errmsg = "the contention report is empty";
+		return false;
+	}
+
+	for (uint64_t i = 0; i < count; i++) {
+
+		if (i && sites[i - 1].nanoseconds < sites[i].nanoseconds) {
+			*errmsg = "the contention report is not sorted";
+			return false;
+		}
+		else if (sites[i].contended != sites[i].spun + sites[i].parked || sites[i].longest > sites[i].nanoseconds) {
+			*errmsg = "the contention report has inconsistent counters";
+			return false;
+		}
+		else if (sites[i].kind >= M_CONTENTION_MUTEX && sites[i].kind <= M_CONTENTION_WRITE && sites[i].parked &&
+			sites[i].longest >= (CONTENTION_CHECK_HOLD / 2) * 1000) {
+			found[sites[i].kind] = true;
+		}
+	}
+
+	if (!found[M_CONTENTION_MUTEX] || !found[M_CONTENTION_READ] || !found[M_CONTENTION_WRITE]) {
+		*errmsg = "a forced wait is missing from the contention report";
+		return false;
+	}
+
+	// Once reset, nothing should be reported until a lock is contended again.
+	contention_reset();
+
+	if (contention_report(sites, 16)) {
+		*errmsg = "the contention report is not empty after a reset";
+		return false;
+	}
+
+	return true;
+}
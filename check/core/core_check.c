@@ -108,6 +108,21 @@ START_TEST (check_inx_linked_s) {
 }
 END_TEST
 
+START_TEST (check_inx_linked_sorted_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_indexes_linked_sorted(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / INDEX / LINKED SORTED / SINGLE THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
 START_TEST (check_inx_linked_m) {
 
 	log_disable();
@@ -215,6 +230,169 @@ START_TEST (check_inx_hashed_m) {
 }
 END_TEST
 
+START_TEST (check_inx_hashed_keys_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_indexes_hashed_keys(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / INDEX / HASHED KEYS / SINGLE THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_inx_hashed_resize_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_indexes_hashed_resize(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / INDEX / HASHED RESIZE / SINGLE THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_inx_hashed_distribution_s) {
+
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	// The distribution statistics and timings for each hash function are only printed when benchmarks were requested.
+	if (!do_bench_check) log_disable();
+
+	if (!check_indexes_hashed_distribution(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / INDEX / HASHED DISTRIBUTION / SINGLE THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_inx_sharded_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_indexes_sharded_simple(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / INDEX / SHARDED / SINGLE THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_inx_sharded_m) {
+
+	log_disable();
+	bool_t outcome = true;
+	stringer_t *errmsg = NULL;
+	check_inx_opt_t *opts = NULL;
+
+	if (status() && (!(opts = mm_alloc(sizeof(check_inx_opt_t))) || !(opts->inx = inx_alloc(M_INX_HASHED | M_INX_SHARDED, &mm_free)))) {
+		outcome = false;
+		errmsg = NULLER("The check index sharded multi-threaded test failed.");
+	}
+	else if (!check_inx_mthread(opts)) {
+		outcome = false;
+		errmsg = NULLER("The check index sharded multi-threaded test failed.");
+	}
+
+	if (opts) {
+		inx_cleanup(opts->inx);
+		mm_free(opts);
+	}
+
+	log_test("CORE / INDEX / SHARDED / MULTI THREADED:", errmsg);
+	ck_assert_msg(outcome, st_char_get(errmsg));
+}
+END_TEST
+
+START_TEST (check_inx_rcu_m) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_indexes_rcu_mthread(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / INDEX / RCU / MULTI THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_executor_m) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_executor_simple(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / THREAD / EXECUTOR / MULTI THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_contention_m) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_contention_simple(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / THREAD / CONTENTION / MULTI THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_inx_batch_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_indexes_batch_simple(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / INDEX / BATCH / SINGLE THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_inx_slab_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_indexes_slab_simple(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / INDEX / SLAB / SINGLE THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
 START_TEST (check_inx_linked_cursor_s) {
 
 	log_disable();
@@ -343,12 +521,7 @@ START_TEST (check_inx_append_s) {
 	bool_t outcome = true;
 	stringer_t *errmsg = MANAGEDBUF(1024);
 
-#ifdef MAGMA_PROVIDE_TOKYO_PRIVATE_H
 	outcome = check_inx_append_sthread(M_INX_TREE, errmsg);
-#else
-	// Tree tests should fail without tree support, in which case we negate the result and wipe the error message buffer.
-	if ((outcome = !check_inx_append_sthread(M_INX_TREE, errmsg))) st_wipe(errmsg);
-#endif
 	if (outcome) outcome = check_inx_append_sthread(M_INX_HASHED, errmsg);
 	if (outcome) outcome = check_inx_append_sthread(M_INX_LINKED, errmsg);
 
@@ -363,12 +536,7 @@ START_TEST (check_inx_append_m) {
 	bool_t outcome = true;
 	stringer_t *errmsg = MANAGEDBUF(1024);
 
-#ifdef MAGMA_PROVIDE_TOKYO_PRIVATE_H
 	outcome = check_inx_append_mthread(M_INX_TREE, errmsg);
-#else
-	// Tree tests should fail without tree support, in which case we negate the result and wipe the error message buffer.
-	if ((outcome = !check_inx_append_mthread(M_INX_TREE, errmsg))) st_wipe(errmsg);
-#endif
 	if (outcome) outcome = check_inx_append_mthread(M_INX_HASHED, errmsg);
 	if (outcome) outcome = check_inx_append_mthread(M_INX_LINKED, errmsg);
 
@@ -467,6 +635,100 @@ START_TEST (check_duplication) {
 }
 END_TEST
 
+START_TEST (check_arena) {
+
+	log_disable();
+	stringer_t *errmsg = NULL;
+
+	if (!check_string_arena()) errmsg = NULLER("Arena allocation checks failed.");
+
+	log_test("CORE / STRINGS / ARENA / SINGLE THREADED:", errmsg);
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+}
+END_TEST
+
+START_TEST (check_chain) {
+
+	log_disable();
+	stringer_t *errmsg = NULL;
+
+	if (!check_string_chain()) errmsg = NULLER("Chain assembly checks failed.");
+
+	log_test("CORE / STRINGS / CHAIN / SINGLE THREADED:", errmsg);
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+}
+END_TEST
+
+START_TEST (check_replace) {
+
+	log_disable();
+	stringer_t *errmsg = NULL;
+
+	if (!check_string_replace()) errmsg = NULLER("String replacement checks failed.");
+
+	log_test("CORE / STRINGS / REPLACE / SINGLE THREADED:", errmsg);
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+}
+END_TEST
+
+START_TEST (check_search_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_search_kernels(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / STRINGS / SEARCH / SINGLE THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+// The benchmark results are printed, so unlike the other test cases the log is enabled.
+START_TEST (check_search_bench_s) {
+
+	log_enable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_search_bench(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / STRINGS / SEARCH BENCH / SINGLE THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_scan_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_search_scan(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / STRINGS / SCAN / SINGLE THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_case) {
+
+	log_disable();
+	stringer_t *errmsg = NULL;
+
+	if (!check_string_case()) errmsg = NULLER("Case insensitive comparison and case conversion checks failed.");
+
+	log_test("CORE / STRINGS / CASE / SINGLE THREADED:", errmsg);
+	ck_assert_msg(!errmsg, st_char_get(errmsg));
+}
+END_TEST
+
 START_TEST (check_merge) {
 
 	log_disable();
@@ -802,6 +1064,21 @@ START_TEST (check_classify) {
 }
 END_TEST
 
+START_TEST (check_classify_span_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_classify_span(&errmsg) || !check_classify_helpers(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / CLASSIFY / SPANS / SINGLE THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
 START_TEST (check_qp) {
 
 	log_disable();
@@ -891,6 +1168,127 @@ START_TEST (check_checksum)
 }
 END_TEST
 
+START_TEST (check_pool_m) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_pool_mthread(&errmsg) || !check_pool_timeout(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / BUCKETS / POOL / MULTI THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_stacker_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_stacker_simple(&errmsg) || !check_stacker_batches(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / BUCKETS / STACKER / SINGLE THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_stacker_m) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_stacker_mthread(&errmsg) || !check_stacker_blocking(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / BUCKETS / STACKER / MULTI THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_cache_m) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_cache_simple(&errmsg) || !check_cache_return(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / MEMORY / SIZE CLASS ALLOCATOR / MULTI THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_secure_m) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_secure_mthread(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / MEMORY / SECURE ALLOCATOR / MULTI THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_secure_grow_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_secure_grow(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / MEMORY / SECURE GROWTH / SINGLE THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+START_TEST (check_secure_wipe_s) {
+
+	log_disable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_secure_wipe(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / MEMORY / SECURE WIPE / SINGLE THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
+// The benchmark results are printed, so unlike the other test cases the log is enabled.
+START_TEST (check_secure_bench_m) {
+
+	log_enable();
+	bool_t outcome = true;
+	char *errmsg = NULL;
+
+	if (!check_secure_bench(&errmsg)) {
+		outcome = false;
+	}
+
+	log_test("CORE / MEMORY / SECURE WIPE BENCH / MULTI THREADED:", NULLER(errmsg));
+	ck_assert_msg(outcome, errmsg);
+}
+END_TEST
+
 START_TEST (check_secmem) {
 
 	log_disable();
@@ -1077,20 +1475,37 @@ Suite * suite_check_core(void) {
 	suite_check_testcase(s, "CORE", "Parsers / Time / Print", check_time_print_s);
 
 	suite_check_testcase(s, "CORE", "Classify / ASCII", check_classify);
+	suite_check_testcase(s, "CORE", "Classify / Spans/S", check_classify_span_s);
 
 	suite_check_testcase(s, "CORE", "Strings / Constants", check_constants);
 	suite_check_testcase(s, "CORE", "Strings / Allocation", check_allocation);
 	suite_check_testcase(s, "CORE", "Strings / Reallocation", check_reallocation);
 	suite_check_testcase(s, "CORE", "Strings / Duplication", check_duplication);
+	suite_check_testcase(s, "CORE", "Strings / Arena", check_arena);
+	suite_check_testcase(s, "CORE", "Strings / Chain", check_chain);
+	suite_check_testcase(s, "CORE", "Strings / Replace", check_replace);
+	suite_check_testcase(s, "CORE", "Strings / Search/S", check_search_s);
+	if (do_bench_check) suite_check_testcase(s, "CORE", "Strings / Search Bench/S", check_search_bench_s);
+	suite_check_testcase(s, "CORE", "Strings / Scan/S", check_scan_s);
 	suite_check_testcase(s, "CORE", "Strings / Merge", check_merge);
 	suite_check_testcase(s, "CORE", "Strings / Print", check_print);
 	suite_check_testcase(s, "CORE", "Strings / Write", check_write);
 	suite_check_testcase(s, "CORE", "Strings / Compare", check_compare);
+	suite_check_testcase(s, "CORE", "Strings / Case", check_case);
 	suite_check_testcase(s, "CORE", "Strings / Binary Search", check_bsearch);
 	suite_check_testcase(s, "CORE", "Strings / Bitwise Operations", check_bitwise);
 
 	suite_check_testcase(s, "CORE", "Memory / Checksum", check_checksum);
 	suite_check_testcase(s, "CORE", "Memory / Secure Address Range", check_secmem);
+	suite_check_testcase(s, "CORE", "Memory / Secure Allocator/M", check_secure_m);
+	suite_check_testcase(s, "CORE", "Memory / Secure Growth/S", check_secure_grow_s);
+	suite_check_testcase(s, "CORE", "Memory / Secure Wipe/S", check_secure_wipe_s);
+	if (do_bench_check) suite_check_testcase(s, "CORE", "Memory / Secure Wipe Bench/M", check_secure_bench_m);
+	suite_check_testcase(s, "CORE", "Memory / Size Class Allocator/M", check_cache_m);
+
+	suite_check_testcase(s, "CORE", "Buckets / Pool/M", check_pool_m);
+	suite_check_testcase(s, "CORE", "Buckets / Stacker/S", check_stacker_s);
+	suite_check_testcase(s, "CORE", "Buckets / Stacker/M", check_stacker_m);
 
 	suite_check_testcase(s, "CORE", "Host / System / Signal Names", check_signames_s);
 	suite_check_testcase(s, "CORE", "Host / System / Error Names", check_errnames_s);
@@ -1112,20 +1527,27 @@ Suite * suite_check_core(void) {
 
 	suite_check_testcase(s, "CORE", "Indexes / Linked/S", check_inx_linked_s);
 	suite_check_testcase(s, "CORE", "Indexes / Linked/M", check_inx_linked_m);
+	suite_check_testcase(s, "CORE", "Indexes / Linked Sorted/S", check_inx_linked_sorted_s);
 	suite_check_testcase(s, "CORE", "Indexes / Hashed/S", check_inx_hashed_s);
 	suite_check_testcase(s, "CORE", "Indexes / Hashed/M", check_inx_hashed_m);
-#ifdef MAGMA_PROVIDE_TOKYO_PRIVATE_H
+	suite_check_testcase(s, "CORE", "Indexes / Hashed Resize/S", check_inx_hashed_resize_s);
+	suite_check_testcase(s, "CORE", "Indexes / Hashed Keys/S", check_inx_hashed_keys_s);
+	suite_check_testcase(s, "CORE", "Indexes / Hashed Distribution/S", check_inx_hashed_distribution_s);
 	suite_check_testcase(s, "CORE", "Indexes / Tree/S", check_inx_tree_s);
 	suite_check_testcase(s, "CORE", "Indexes / Tree/M", check_inx_tree_m);
-#endif
+	suite_check_testcase(s, "CORE", "Indexes / Sharded/S", check_inx_sharded_s);
+	suite_check_testcase(s, "CORE", "Indexes / Sharded/M", check_inx_sharded_m);
+	suite_check_testcase(s, "CORE", "Indexes / RCU/M", check_inx_rcu_m);
+	suite_check_testcase(s, "CORE", "Indexes / Batch/S", check_inx_batch_s);
+	suite_check_testcase(s, "CORE", "Indexes / Slab/S", check_inx_slab_s);
+	suite_check_testcase(s, "CORE", "Threads / Executor/M", check_executor_m);
+	suite_check_testcase(s, "CORE", "Threads / Contention/M", check_contention_m);
 	suite_check_testcase(s, "CORE", "Indexes / Linked Cursor/S", check_inx_linked_cursor_s);
 	suite_check_testcase(s, "CORE", "Indexes / Linked Cursor/M", check_inx_linked_cursor_m);
 	suite_check_testcase(s, "CORE", "Indexes / Hashed Cursor/S", check_inx_hashed_cursor_s);
 	suite_check_testcase(s, "CORE", "Indexes / Hashed Cursor/M", check_inx_hashed_cursor_m);
-#ifdef MAGMA_PROVIDE_TOKYO_PRIVATE_H
 	suite_check_testcase(s, "CORE", "Indexes / Tree Cursor/S", check_inx_tree_cursor_s);
 	suite_check_testcase(s, "CORE", "Indexes / Tree Cursor/M", check_inx_tree_cursor_m);
-#endif
 	suite_check_testcase(s, "CORE", "Indexes / Append/S", check_inx_append_s);
 	suite_check_testcase(s, "CORE", "Indexes / Append/M", check_inx_append_m);
 
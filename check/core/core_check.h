@@ -20,6 +20,10 @@ struct check_mi_t {
 
 extern stringer_t *string_check_constant;
 
+/// classify_check.c
+bool_t   check_classify_helpers(char **errmsg);
+bool_t   check_classify_span(char **errmsg);
+
 /// clamp_check.c
 chr_t * check_clamp_max(void);
 chr_t * check_clamp_min(void);
@@ -29,12 +33,26 @@ chr_t * check_clamp_min_max_invalid(void);
 
 /// string_check.c
 bool_t   check_string_alloc(uint32_t check);
+bool_t   check_string_arena(void);
+bool_t   check_string_case(void);
+bool_t   check_string_chain(void);
 bool_t   check_string_dupe(uint32_t check);
 bool_t   check_string_import(void);
 bool_t   check_string_merge(void);
 bool_t   check_string_print(void);
 bool_t   check_string_write(void);
 bool_t   check_string_realloc(uint32_t check);
+bool_t   check_string_replace(void);
+stringer_t *  check_string_replace_naive(stringer_t *target, size_t count, stringer_t **patterns, stringer_t **replacements);
+
+/// search_check.c
+bool_t    check_search_bench(char **errmsg);
+uchr_t *  check_search_body(size_t len);
+bool_t    check_search_collect(void *context, size_t needle, size_t offset);
+bool_t    check_search_kernels(char **errmsg);
+int64_t   check_search_reference(const uchr_t *h, size_t hlen, const uchr_t *n, size_t nlen, bool_t insensitive);
+bool_t    check_search_scan(char **errmsg);
+bool_t    check_search_stop(void *context, size_t needle, size_t offset);
 
 /// qp_check.c
 bool_t   check_encoding_qp(void);
@@ -60,6 +78,7 @@ bool_t check_ip_localhost_sthread(stringer_t *errmsg);
 bool_t   check_indexes_linked_cursor(char **errmsg);
 bool_t   check_indexes_linked_cursor_compare(uint64_t values[], inx_cursor_t *cursor);
 bool_t   check_indexes_linked_simple(char **errmsg);
+bool_t   check_indexes_linked_sorted(char **errmsg);
 
 /// hex_check.c
 bool_t   check_encoding_hex(void);
@@ -77,8 +96,75 @@ bool_t   check_encoding_base64_mod(bool_t secure_on);
 /// hashed_check.c
 bool_t   check_indexes_hashed_cursor(char **errmsg);
 bool_t   check_indexes_hashed_cursor_compare(uint64_t values[], inx_cursor_t *cursor);
+bool_t   check_indexes_hashed_distribution(char **errmsg);
+int      check_indexes_hashed_distribution_compare(const void *one, const void *two);
+bool_t   check_indexes_hashed_distribution_measure(inx_hash_t hash, multi_t *keys, uint64_t count, double *chi, uint64_t *collisions, double *nanoseconds);
+bool_t   check_indexes_hashed_keys(char **errmsg);
+size_t   check_indexes_hashed_keys_generate(chr_t *buffer, uint64_t number);
+bool_t   check_indexes_hashed_resize(char **errmsg);
 bool_t   check_indexes_hashed_simple(char **errmsg);
 
+/// batch_check.c
+bool_t   check_indexes_batch_duplicates(multi_t *keys, void **data);
+bool_t   check_indexes_batch_simple(char **errmsg);
+bool_t   check_indexes_batch_verify(inx_t *inx, multi_t *keys, void **results);
+
+/// slab_check.c
+bool_t   check_indexes_slab_simple(char **errmsg);
+
+/// sharded_check.c
+bool_t   check_indexes_sharded_simple(char **errmsg);
+
+/// pool_check.c
+bool_t   check_pool_mthread(char **errmsg);
+void *   check_pool_thread(void *data);
+bool_t   check_pool_timeout(char **errmsg);
+
+/// stacker_check.c
+bool_t   check_stacker_batches(char **errmsg);
+bool_t   check_stacker_blocking(char **errmsg);
+void *   check_stacker_consumer(void *data);
+void *   check_stacker_delayed(void *data);
+uint64_t check_stacker_elapsed(struct timespec *start);
+void *   check_stacker_entry(uint64_t producer, uint64_t sequence);
+uint64_t check_stacker_fill(stacker_t *stack, uint64_t count);
+bool_t   check_stacker_mthread(char **errmsg);
+void *   check_stacker_producer(void *data);
+bool_t   check_stacker_simple(char **errmsg);
+bool_t   check_stacker_threaded(stacker_t *stack, char **errmsg);
+bool_t   check_stacker_waiting(stacker_t *stack, char **errmsg);
+
+/// cache_check.c
+bool_t   check_cache_return(char **errmsg);
+bool_t   check_cache_simple(char **errmsg);
+void *   check_cache_thread(void *data);
+
+/// secure_check.c
+bool_t   check_secure_bench(char **errmsg);
+void *   check_secure_bench_thread(void *data);
+bool_t   check_secure_grow(char **errmsg);
+bool_t   check_secure_mthread(char **errmsg);
+bool_t   check_secure_wipe(char **errmsg);
+void *   check_secure_thread(void *data);
+
+/// contention_check.c
+bool_t   check_contention_hold(M_CONTENTION kind);
+void *   check_contention_increment(void *data);
+bool_t   check_contention_simple(char **errmsg);
+void *   check_contention_waiter(void *data);
+
+/// executor_check.c
+void *   check_executor_double(void *data);
+void *   check_executor_increment(void *data);
+bool_t   check_executor_simple(char **errmsg);
+void     check_executor_sum(uint64_t start, uint64_t end, void *data);
+void *   check_executor_tree(void *data);
+
+/// rcu_check.c
+bool_t   check_indexes_rcu_insert(inx_t *inx, uint64_t num);
+bool_t   check_indexes_rcu_mthread(char **errmsg);
+void     check_indexes_rcu_reader(inx_t *inx);
+
 /// system_check.c
 bool_t   check_system_errnonames(void);
 bool_t   check_system_signames(void);
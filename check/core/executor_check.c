@@ -0,0 +1,134 @@
+/**
+ * @file /check/magma/core/executor_check.c
+ *
+ * @brief Unit tests for the work stealing executor.
+ */
+
+#include "magma_check.h"
+
+#define EXECUTOR_CHECK_TASKS 4096
+#define EXECUTOR_CHECK_RANGE 1000000
+#define EXECUTOR_CHECK_DEPTH 12
+#define EXECUTOR_CHECK_THREADS 4
+
+static executor_t *check_executor = NULL;
+static uint64_t check_executor_counter = 0;
+
+void * check_executor_double(void *data) {
+	return (void *)((uint64_t)data * 2);
+}
+
+void * check_executor_increment(void *data) {
+	__atomic_add_fetch(&check_executor_counter, 1, __ATOMIC_RELAXED);
+	return NULL;
+}
+
+void check_executor_sum(uint64_t start, uint64_t end, void *data) {
+
+	uint64_t total = 0;
+
+	for (uint64_t i = start; i < end; i++) {
+		total += i;
+	}
+
+	__atomic_add_fetch((uint64_t *)data, total, __ATOMIC_RELAXED);
+	return;
+}
+
+void check_executor_count(uint64_t start, uint64_t end, void *data) {
+	__atomic_add_fetch((uint64_t *)data, end - start, __ATOMIC_RELAXED);
+	return;
+}
+
+/**
+ * @brief	Count the nodes in a binary tree of the given depth, by submitting a subtask for each branch and waiting on it.
+ * @note	The waits happen inside the worker threads, so this only completes if waiting workers keep executing tasks.
+ * @param	data	the depth of the tree.
+ * @return	the number of nodes in the tree.
+ */
+void * check_executor_tree(void *data) {
+
+	uint64_t depth = (uint64_t)data, left, right;
+	future_t *future;
+
+	if (!depth) {
+		return (void *)1;
+	}
+
+	if (!(future = executor_submit(check_executor, &check_executor_tree, (void *)(depth - 1)))) {
+		return NULL;
+	}
+
+	right = (uint64_t)check_executor_tree((void *)(depth - 1));
+	left = (uint64_t)future_wait(future);
+	future_free(future);
+
+	return (void *)(left + right + 1);
+}
+
+bool_t check_executor_simple(char **errmsg) {
+
+	uint64_t total = 0;
+	future_t **futures;
+
+	if (!(check_executor = executor_alloc(EXECUTOR_CHECK_THREADS, 0)) || executor_threads(check_executor) != EXECUTOR_CHECK_THREADS) {
+		*errmsg = "executor allocation failed";
+		executor_free(check_executor);
+		return false;
+	}
+	else if (!(futures = mm_alloc(sizeof(future_t *) * EXECUTOR_CHECK_TASKS))) {
+		*errmsg = "future array allocation failed";
+		executor_free(check_executor);
+		return false;
+	}
+
+	// Submit a batch of tasks from outside the executor, and check every result.
+	for (uint64_t i = 0; i < EXECUTOR_CHECK_TASKS; i++) {
+		futures[i] = executor_submit(check_executor, &check_executor_double, (void *)i);
+	}
+
+	for (uint64_t i = 0; i < EXECUTOR_CHECK_TASKS; i++) {
+		if (!futures[i] || future_wait(futures[i]) != (void *)(i * 2) || !future_done(futures[i])) {
+			*errmsg = "future returned the wrong result";
+		}
+		future_free(futures[i]);
+	}
+
+	mm_free(futures);
+
+	// Sum a large range in parallel.
+	if (!*errmsg && (!executor_parallel_for(check_executor, 0, EXECUTOR_CHECK_RANGE, 0, &check_executor_sum, &total) ||
+		total != ((uint64_t)EXECUTOR_CHECK_RANGE * (EXECUTOR_CHECK_RANGE - 1)) / 2)) {
+		*errmsg = "parallel loop returned the wrong sum";
+	}
+
+	// A range which ends at the largest value, where claiming chunks by value would wrap around and repeat the range.
+	total = 0;
+	if (!*errmsg && (!executor_parallel_for(check_executor, UINT64_MAX - EXECUTOR_CHECK_RANGE, UINT64_MAX, 64, &check_executor_count,
+		&total) || total != EXECUTOR_CHECK_RANGE)) {
+		*errmsg = "parallel loop processed the wrong number of values at the end of the range";
+	}
+
+	// Recursive tasks which wait on their own subtasks.
+	if (!*errmsg && (uint64_t)check_executor_tree((void *)EXECUTOR_CHECK_DEPTH) != (1ull << (EXECUTOR_CHECK_DEPTH + 1)) - 1) {
+		*errmsg = "nested tasks returned the wrong result";
+	}
+
+	// Detached tasks must all run before the executor is freed.
+	check_executor_counter = 0;
+
+	for (uint64_t i = 0; !*errmsg && i < EXECUTOR_CHECK_TASKS; i++) {
+		if (!executor_spawn(check_executor, &check_executor_increment, NULL)) {
+			*errmsg = "detached task submission failed";
+		}
+	}
+
+	executor_free(check_executor);
+	check_executor = NULL;
+
+	if (!*errmsg && check_executor_counter != EXECUTOR_CHECK_TASKS) {
+		*errmsg = "executor was freed before every detached task finished";
+	}
+
+	return *errmsg == NULL;
+}
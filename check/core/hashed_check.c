@@ -210,3 +210,405 @@ bool_t check_indexes_hashed_simple(char **errmsg) {
 	return true;
 }
 
+
+bool_t check_indexes_hashed_resize(char **errmsg) {
+
+	void *val;
+	inx_t *inx;
+	multi_t key;
+	uint64_t count = 0;
+	inx_cursor_t *cursor;
+
+	// Insert enough records to force several resizes, checking that records are still found while they're being migrated.
+	if (!(inx = inx_alloc(M_INX_HASHED, NULL))) {
+		*errmsg = "index allocation failed";
+		return false;
+	}
+
+	mm_wipe(&key, sizeof(multi_t));
+	key.type = M_TYPE_UINT64;
+
+	for (uint64_t i = 0; status() && i < (HASHED_INSERTS_CHECK * 8); i++) {
+
+		key.val.u64 = i;
+
+		if (!inx_insert(inx, key, (void *)(i + 1))) {
+			*errmsg = "insert operation failed";
+			inx_free(inx);
+			return false;
+		}
+
+		key.val.u64 = i / 2;
+
+		if (inx_find(inx, key) != (void *)((i / 2) + 1)) {
+			*errmsg = "find operation failed during resize";
+			inx_free(inx);
+			return false;
+		}
+	}
+
+	// Delete every odd key, then make sure only the even keys remain.
+	for (uint64_t i = 1; status() && i < (HASHED_INSERTS_CHECK * 8); i += 2) {
+
+		key.val.u64 = i;
+
+		if (!inx_delete(inx, key)) {
+			*errmsg = "delete operation failed";
+			inx_free(inx);
+			return false;
+		}
+	}
+
+	for (uint64_t i = 0; status() && i < (HASHED_INSERTS_CHECK * 8); i++) {
+
+		key.val.u64 = i;
+
+		if ((inx_find(inx, key) != NULL) != ((i % 2) == 0)) {
+			*errmsg = "find operation failed after delete";
+			inx_free(inx);
+			return false;
+		}
+	}
+
+	if (inx_count(inx) != (HASHED_INSERTS_CHECK * 4)) {
+		*errmsg = "record count is incorrect";
+		inx_free(inx);
+		return false;
+	}
+
+	if (!(cursor = inx_cursor_alloc(inx))) {
+		*errmsg = "cursor allocation failed";
+		inx_free(inx);
+		return false;
+	}
+
+	while (status() && (val = inx_cursor_value_next(cursor))) {
+
+		key = inx_cursor_key_active(cursor);
+
+		if (key.val.u64 % 2 || val != (void *)(key.val.u64 + 1)) {
+			*errmsg = "cursor returned a deleted record";
+			inx_cursor_free(cursor);
+			inx_free(inx);
+			return false;
+		}
+
+		count++;
+	}
+
+	inx_cursor_free(cursor);
+	inx_free(inx);
+
+	if (count != (HASHED_INSERTS_CHECK * 4)) {
+		*errmsg = "cursor record count is incorrect";
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Generate a unique string key, with a length that cycles through values on both sides of the inline key limit.
+ * @param	buffer	a buffer of at least 64 bytes which will receive the null terminated key.
+ * @param	number	the number the key is derived from.
+ * @return	the length of the key.
+ */
+size_t check_indexes_hashed_keys_generate(chr_t *buffer, uint64_t number) {
+
+	size_t length = snprintf(buffer, 64, "%lu:", number), target = 4 + (number % 48);
+
+	for (; length < target; length++) {
+		buffer[length] = 'a' + ((number + length) % 26);
+	}
+
+	buffer[length] = '\0';
+	return length;
+}
+
+bool_t check_indexes_hashed_keys(char **errmsg) {
+
+	void *val;
+	inx_t *inx;
+	size_t length;
+	multi_t key, *keys = NULL;
+	uint64_t count = 0, *values = NULL;
+	chr_t buffer[64];
+	inx_cursor_t *cursor;
+
+	// Insert string keys which are short enough to be stored inline, along with keys which have to be duplicated.
+	if (!(inx = inx_alloc(M_INX_HASHED, NULL))) {
+		*errmsg = "index allocation failed";
+		return false;
+	}
+
+	for (uint64_t i = 0; status() && i < HASHED_INSERTS_CHECK; i++) {
+
+		length = check_indexes_hashed_keys_generate(buffer, i);
+		key.type = M_TYPE_STRINGER;
+		key.val.st = PLACER(buffer, length);
+
+		if (!inx_insert(inx, key, (void *)(i + 1))) {
+			*errmsg = "insert operation failed";
+			inx_free(inx);
+			return false;
+		}
+	}
+
+	// The index holds its own copy of each key, so the buffer can be reused, and null terminated probes must match managed
+	// string keys with the same value.
+	mm_wipe(buffer, sizeof(buffer));
+
+	for (uint64_t i = 0; status() && i < HASHED_INSERTS_CHECK; i++) {
+
+		check_indexes_hashed_keys_generate(buffer, i);
+		key.type = M_TYPE_NULLER;
+		key.val.ns = buffer;
+
+		if (inx_find(inx, key) != (void *)(i + 1)) {
+			*errmsg = "find operation failed";
+			inx_free(inx);
+			return false;
+		}
+
+		// Every key contains a separator, so a key missing its final byte must not match any record.
+		buffer[ns_length_get(buffer) - 1] = '\0';
+
+		if (inx_find(inx, key)) {
+			*errmsg = "find operation matched a truncated key";
+			inx_free(inx);
+			return false;
+		}
+	}
+
+	// Delete every odd key, then make sure the cursor returns the remaining keys intact.
+	for (uint64_t i = 1; status() && i < HASHED_INSERTS_CHECK; i += 2) {
+
+		length = check_indexes_hashed_keys_generate(buffer, i);
+		key.type = M_TYPE_STRINGER;
+		key.val.st = PLACER(buffer, length);
+
+		if (!inx_delete(inx, key)) {
+			*errmsg = "delete operation failed";
+			inx_free(inx);
+			return false;
+		}
+	}
+
+	if (!(cursor = inx_cursor_alloc(inx))) {
+		*errmsg = "cursor allocation failed";
+		inx_free(inx);
+		return false;
+	}
+	else if (!(keys = mm_alloc(sizeof(multi_t) * HASHED_INSERTS_CHECK)) || !(values = mm_alloc(sizeof(uint64_t) * HASHED_INSERTS_CHECK))) {
+		*errmsg = "unable to allocate the key buffers";
+		inx_cursor_free(cursor);
+		inx_free(inx);
+		mm_cleanup(keys);
+		return false;
+	}
+
+	while (status() && count < HASHED_INSERTS_CHECK && (val = inx_cursor_value_next(cursor))) {
+
+		key = inx_cursor_key_active(cursor);
+		length = check_indexes_hashed_keys_generate(buffer, (uint64_t)val - 1);
+
+		if ((uint64_t)val % 2 == 0 || key.type != M_TYPE_STRINGER || st_length_get(key.val.st) != length ||
+			mm_cmp_cs_eq(st_char_get(key.val.st), buffer, length)) {
+			*errmsg = "cursor returned the wrong key";
+			inx_cursor_free(cursor);
+			inx_free(inx);
+			mm_free(keys);
+			mm_free(values);
+			return false;
+		}
+
+		keys[count] = key;
+		values[count++] = (uint64_t)val;
+	}
+
+	inx_cursor_free(cursor);
+
+	if (count != (HASHED_INSERTS_CHECK / 2)) {
+		*errmsg = "cursor record count is incorrect";
+		inx_free(inx);
+		mm_free(keys);
+		mm_free(values);
+		return false;
+	}
+
+	// A cursor key remains valid until its record is deleted, so the keys collected above must survive the table being
+	// resized, which moves every inline key to a different slot.
+	for (uint64_t i = HASHED_INSERTS_CHECK; status() && i < HASHED_INSERTS_CHECK * 4; i++) {
+
+		length = check_indexes_hashed_keys_generate(buffer, i);
+		key.type = M_TYPE_STRINGER;
+		key.val.st = PLACER(buffer, length);
+
+		if (!inx_insert(inx, key, (void *)(i + 1))) {
+			*errmsg = "insert operation failed";
+			inx_free(inx);
+			mm_free(keys);
+			mm_free(values);
+			return false;
+		}
+	}
+
+	for (uint64_t i = 0; status() && i < count; i++) {
+
+		length = check_indexes_hashed_keys_generate(buffer, values[i] - 1);
+
+		if (st_length_get(keys[i].val.st) != length || mm_cmp_cs_eq(st_char_get(keys[i].val.st), buffer, length) ||
+			inx_find(inx, keys[i]) != (void *)values[i]) {
+			*errmsg = "a cursor key changed after the index was resized";
+			inx_free(inx);
+			mm_free(keys);
+			mm_free(values);
+			return false;
+		}
+	}
+
+	inx_free(inx);
+	mm_free(keys);
+	mm_free(values);
+
+	return true;
+}
+
+int check_indexes_hashed_distribution_compare(const void *one, const void *two) {
+	return (*(uint64_t *)one > *(uint64_t *)two) - (*(uint64_t *)one < *(uint64_t *)two);
+}
+
+/**
+ * @brief	Measure the distribution of a key set under a hash function.
+ * @note	Keys are assigned to buckets using the same bits the hashed index uses to select a probe group. The chi-squared
+ * 			statistic is normalized by the bucket count, so a uniform hash should score close to 1.0.
+ * @param	hash		the hash function being measured.
+ * @param	keys		an array of keys to be hashed.
+ * @param	count		the number of keys in the array, which must be a power of two.
+ * @param	chi			receives the normalized chi-squared statistic.
+ * @param	collisions	receives the number of keys with a 64-bit hash value identical to another key.
+ * @param	nanoseconds	receives the average time, in nanoseconds, taken to hash a key.
+ * @return	true if the measurement was completed, or false if a buffer couldn't be allocated.
+ */
+bool_t check_indexes_hashed_distribution_measure(inx_hash_t hash, multi_t *keys, uint64_t count, double *chi, uint64_t *collisions,
+	double *nanoseconds) {
+
+	double expected = 4.0;
+	uint64_t buckets = count / 4, *hashes, *loads;
+	struct timespec start, end;
+
+	if (!(hashes = mm_alloc(sizeof(uint64_t) * count)) || !(loads = mm_alloc(sizeof(uint64_t) * buckets))) {
+		mm_cleanup(hashes);
+		return false;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (uint64_t i = 0; i < count; i++) {
+		hashes[i] = hash(keys[i], 0x5eed5eed5eed5eedULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	*nanoseconds = ((((double)end.tv_sec - start.tv_sec) * 1000000000.0) + (end.tv_nsec - start.tv_nsec)) / count;
+
+	for (uint64_t i = 0; i < count; i++) {
+		loads[(hashes[i] >> 7) & (buckets - 1)]++;
+	}
+
+	*chi = 0;
+	for (uint64_t i = 0; i < buckets; i++) {
+		*chi += ((loads[i] - expected) * (loads[i] - expected)) / expected;
+	}
+	*chi /= buckets;
+
+	*collisions = 0;
+	qsort(hashes, count, sizeof(uint64_t), &check_indexes_hashed_distribution_compare);
+	for (uint64_t i = 1; i < count; i++) {
+		if (hashes[i] == hashes[i - 1]) {
+			(*collisions)++;
+		}
+	}
+
+	mm_free(hashes);
+	mm_free(loads);
+	return true;
+}
+
+bool_t check_indexes_hashed_distribution(char **errmsg) {
+
+	uint64_t collisions;
+	multi_t *keys = NULL;
+	double chi, nanoseconds;
+	bool_t result = true;
+	uint64_t count = HASHED_INSERTS_CHECK * 8;
+	chr_t *names[] = { "From", "To", "Cc", "Bcc", "Subject", "Date", "Message-ID", "In-Reply-To", "References", "Reply-To",
+		"Sender", "Received", "Return-Path", "Delivered-To", "MIME-Version", "Content-Type", "Content-Transfer-Encoding",
+		"Content-Disposition", "Content-ID", "DKIM-Signature", "Authentication-Results", "Received-SPF", "List-ID",
+		"List-Unsubscribe", "Precedence", "User-Agent", "X-Mailer", "X-Spam-Status", "X-Spam-Score", "X-Originating-IP" };
+	struct {
+		chr_t *name;
+		inx_hash_t hash;
+	} functions[] = {
+		{ "fletcher", &hashed_hash_fletcher },
+		{ "murmur", &hashed_hash_murmur },
+		{ "wyhash", &hashed_hash_wyhash }
+	};
+
+	if (!(keys = mm_alloc(sizeof(multi_t) * count))) {
+		*errmsg = "key buffer allocation failed";
+		return false;
+	}
+
+	for (uint_t set = 0; result && set < 3; set++) {
+
+		// Mailbox message numbers are handed out sequentially.
+		if (set == 0) {
+			for (uint64_t i = 0; i < count; i++) {
+				keys[i].type = M_TYPE_UINT64;
+				keys[i].val.u64 = 1000000 + i;
+			}
+		}
+		// Folder keys combine a user number with a small folder number.
+		else if (set == 1) {
+			for (uint64_t i = 0; i < count; i++) {
+				keys[i].type = M_TYPE_UINT64;
+				keys[i].val.u64 = ((1000 + (i / 16)) << 32) | (i % 16);
+			}
+		}
+		// Header names are short ASCII strings, with lots of shared prefixes.
+		else {
+			for (uint64_t i = 0; i < count; i++) {
+				keys[i].type = M_TYPE_STRINGER;
+				if (i < (sizeof(names) / sizeof(chr_t *))) {
+					keys[i].val.st = st_import(names[i], ns_length_get(names[i]));
+				}
+				else {
+					keys[i].val.st = st_aprint("X-%s-%lu", names[i % (sizeof(names) / sizeof(chr_t *))], i);
+				}
+			}
+		}
+
+		for (uint_t i = 0; result && i < (sizeof(functions) / sizeof(functions[0])); i++) {
+
+			if (!check_indexes_hashed_distribution_measure(functions[i].hash, keys, count, &chi, &collisions, &nanoseconds)) {
+				*errmsg = "hash measurement failed";
+				result = false;
+			}
+
+			log_unit("%-10.10s %-10.10s chi-squared/bucket = %6.3f, collisions = %4lu, %6.2f ns/key\n",
+				(set == 0 ? "messages" : set == 1 ? "folders" : "headers"), functions[i].name, chi, collisions, nanoseconds);
+
+			// The default hash function should never produce a lopsided distribution, or collide on these key sets.
+			if (result && functions[i].hash == &hashed_hash_wyhash && (chi > 2.0 || collisions)) {
+				*errmsg = "the default hash function produced a poor distribution";
+				result = false;
+			}
+		}
+	}
+
+	for (uint64_t i = 0; i < count; i++) {
+		mt_free(keys[i]);
+	}
+
+	mm_free(keys);
+	return result;
+}
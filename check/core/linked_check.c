@@ -167,3 +167,103 @@ bool_t check_indexes_linked_simple(char **errmsg) {
 }
 
 
+
+bool_t check_indexes_linked_sorted(char **errmsg) {
+
+	inx_t *inx;
+	multi_t key;
+	uint64_t previous = 0, count = 0;
+	inx_cursor_t *cursor;
+
+	if (!(inx = inx_alloc(M_INX_LINKED, NULL))) {
+		*errmsg = "index allocation failed";
+		return false;
+	}
+
+	mm_wipe(&key, sizeof(multi_t));
+	key.type = M_TYPE_UINT64;
+
+	// Insert the keys in a scrambled order, which should come back out of the cursor sorted.
+	for (uint64_t i = 0; status() && i < LINKED_INSERTS_CHECK; i++) {
+
+		key.val.u64 = (i * 7919) % LINKED_INSERTS_CHECK;
+
+		if (!inx_insert(inx, key, (void *)(key.val.u64 + 1))) {
+			*errmsg = "insert operation failed";
+			inx_free(inx);
+			return false;
+		}
+	}
+
+	// Delete the odd keys.
+	for (uint64_t i = 1; status() && i < LINKED_INSERTS_CHECK; i += 2) {
+
+		key.val.u64 = i;
+
+		if (!inx_delete(inx, key)) {
+			*errmsg = "delete operation failed";
+			inx_free(inx);
+			return false;
+		}
+	}
+
+	for (uint64_t i = 0; status() && i < LINKED_INSERTS_CHECK; i++) {
+
+		key.val.u64 = i;
+
+		if (inx_find(inx, key) != ((i % 2) ? NULL : (void *)(i + 1))) {
+			*errmsg = "find operation returned the wrong value";
+			inx_free(inx);
+			return false;
+		}
+	}
+
+	if (!(cursor = inx_cursor_alloc(inx))) {
+		*errmsg = "cursor allocation failed";
+		inx_free(inx);
+		return false;
+	}
+
+	while (status() && !mt_is_empty(key = inx_cursor_key_next(cursor))) {
+
+		if ((count && key.val.u64 <= previous) || key.val.u64 % 2) {
+			*errmsg = "cursor returned the records out of order";
+			inx_cursor_free(cursor);
+			inx_free(inx);
+			return false;
+		}
+
+		previous = key.val.u64;
+		count++;
+	}
+
+	inx_cursor_free(cursor);
+
+	if (count != (LINKED_INSERTS_CHECK / 2)) {
+		*errmsg = "cursor record count is incorrect";
+		inx_free(inx);
+		return false;
+	}
+
+	// Appending a key out of order is still allowed, and the list should remain searchable.
+	key.type = M_TYPE_UINT64;
+	key.val.u64 = 1;
+
+	if (!inx_append(inx, key, (void *)2) || inx_find(inx, key) != (void *)2) {
+		*errmsg = "append operation failed";
+		inx_free(inx);
+		return false;
+	}
+
+	key.val.u64 = 0;
+
+	if (inx_find(inx, key) != (void *)1) {
+		*errmsg = "find operation after an unsorted append failed";
+		inx_free(inx);
+		return false;
+	}
+
+	inx_free(inx);
+
+	return true;
+}
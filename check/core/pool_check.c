@@ -0,0 +1,175 @@
+
+/**
+ * @file /check/magma/core/pool_check.c
+ *
+ * @brief Unit tests for the object pools.
+ */
+
+#include "magma_check.h"
+
+#define POOL_CHECK_ITEMS 8
+#define POOL_CHECK_THREADS 4
+#define POOL_CHECK_ROUNDS 20000
+#define POOL_CHECK_SWAPS 64
+#define POOL_CHECK_TIMEOUT 5
+
+static pool_t *check_pool = NULL;
+static uint32_t check_pool_held[POOL_CHECK_ITEMS];
+static uint64_t check_pool_objects[POOL_CHECK_ITEMS][2];
+static volatile bool_t check_pool_finished = false;
+
+/**
+ * @brief	Repeatedly pull and release items from the shared pool.
+ * @note	Each item is counted while it's held, so an item handed to two threads at once is detected. The object behind an
+ * 			item may be swapped while the item is available, but it must never change while the item is held.
+ * @param	data	ignored.
+ * @return	NULL on failure, or a pointer to the pool if every item was handled correctly.
+ */
+void * check_pool_thread(void *data) {
+
+	void *object;
+	uint32_t item;
+
+	for (uint64_t i = 0; i < POOL_CHECK_ROUNDS || !check_pool_finished; i++) {
+
+		if (pool_pull(check_pool, &item) != PL_RESERVED || item >= POOL_CHECK_ITEMS) {
+			return NULL;
+		}
+
+		if (__atomic_add_fetch(check_pool_held + item, 1, __ATOMIC_SEQ_CST) != 1 || pool_get_status(check_pool, item) != PL_RESERVED) {
+			return NULL;
+		}
+
+		object = pool_get_obj(check_pool, item);
+
+		if (object != &check_pool_objects[item][0] && object != &check_pool_objects[item][1]) {
+			return NULL;
+		}
+
+		// Give the other threads, and any pending swap, a chance to interfere before the item is checked again.
+		if (!(i % 64)) {
+			sched_yield();
+		}
+
+		if (pool_get_obj(check_pool, item) != object) {
+			return NULL;
+		}
+
+		__atomic_sub_fetch(check_pool_held + item, 1, __ATOMIC_SEQ_CST);
+		pool_release(check_pool, item);
+	}
+
+	return check_pool;
+}
+
+bool_t check_pool_mthread(char **errmsg) {
+
+	void *outcome;
+	uint32_t launched;
+	bool_t result = true;
+	pthread_t threads[POOL_CHECK_THREADS];
+	uint32_t current[POOL_CHECK_ITEMS];
+
+	if (!(check_pool = pool_alloc(POOL_CHECK_ITEMS, POOL_CHECK_TIMEOUT))) {
+		*errmsg = "pool allocation failed";
+		return false;
+	}
+
+	for (uint32_t i = 0; i < POOL_CHECK_ITEMS; i++) {
+		check_pool_held[i] = current[i] = 0;
+		pool_set_obj(check_pool, i, &check_pool_objects[i][0]);
+	}
+
+	check_pool_finished = false;
+
+	for (launched = 0; launched < POOL_CHECK_THREADS; launched++) {
+		if (thread_launch(threads + launched, &check_pool_thread, NULL)) {
+			*errmsg = "thread launch failed";
+			result = false;
+			break;
+		}
+	}
+
+	// Swap the objects behind the items while the threads are pulling them, and make sure each swap returns the object
+	// stored by the previous one.
+	for (uint32_t i = 0; result && i < POOL_CHECK_SWAPS; i++) {
+		if (pool_swap_obj(check_pool, i % POOL_CHECK_ITEMS, &check_pool_objects[i % POOL_CHECK_ITEMS][current[i % POOL_CHECK_ITEMS] ^ 1]) !=
+			&check_pool_objects[i % POOL_CHECK_ITEMS][current[i % POOL_CHECK_ITEMS]]) {
+			*errmsg = "an object swap didn't return the previous object";
+			result = false;
+		}
+		current[i % POOL_CHECK_ITEMS] ^= 1;
+	}
+
+	check_pool_finished = true;
+
+	for (uint32_t i = 0; i < launched; i++) {
+		if (thread_result(threads[i], &outcome) || outcome != check_pool) {
+			if (result) *errmsg = "an item was handed out twice, or changed while it was held";
+			result = false;
+		}
+	}
+
+	if (result && (pool_get_available(check_pool) != POOL_CHECK_ITEMS || pool_get_failures(check_pool))) {
+		*errmsg = "the pool didn't end up with every item available";
+		result = false;
+	}
+
+	for (uint32_t i = 0; result && i < POOL_CHECK_ITEMS; i++) {
+		if (pool_get_status(check_pool, i) != PL_AVAILABLE || pool_get_obj(check_pool, i) != &check_pool_objects[i][current[i]]) {
+			*errmsg = "an item was left reserved, or holds the wrong object";
+			result = false;
+		}
+	}
+
+	pool_free(check_pool);
+	check_pool = NULL;
+
+	return result;
+}
+
+bool_t check_pool_timeout(char **errmsg) {
+
+	pool_t *pool;
+	uint32_t items[2], item;
+
+	if (!(pool = pool_alloc(2, 1))) {
+		*errmsg = "pool allocation failed";
+		return false;
+	}
+
+	// The lowest numbered items are handed out first.
+	if (pool_pull(pool, &items[0]) != PL_RESERVED || pool_pull(pool, &items[1]) != PL_RESERVED || items[0] != 0 || items[1] != 1 ||
+		pool_get_available(pool)) {
+		*errmsg = "unable to reserve every item in the pool";
+		pool_free(pool);
+		return false;
+	}
+
+	// The pool is exhausted, so the next request should wait for the timeout and then fail.
+	if (pool_pull(pool, &item) != PL_ERROR || pool_get_failures(pool) != 1) {
+		*errmsg = "a request made against an exhausted pool didn't fail";
+		pool_free(pool);
+		return false;
+	}
+
+	pool_release(pool, items[1]);
+
+	if (pool_pull(pool, &item) != PL_RESERVED || item != items[1] || pool_get_failures(pool) != 1) {
+		*errmsg = "a released item couldn't be reserved again";
+		pool_free(pool);
+		return false;
+	}
+
+	pool_release(pool, items[0]);
+	pool_release(pool, item);
+
+	if (pool_get_available(pool) != 2 || pool_get_status(pool, 0) != PL_AVAILABLE || pool_get_status(pool, 1) != PL_AVAILABLE) {
+		*errmsg = "the released items weren't made available";
+		pool_free(pool);
+		return false;
+	}
+
+	pool_free(pool);
+	return true;
+}
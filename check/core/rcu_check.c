@@ -0,0 +1,154 @@
+/**
+ * @file /check/magma/core/rcu_check.c
+ *
+ * @brief Unit tests for indexes searched without a lock.
+ */
+
+#include "magma_check.h"
+
+#define RCU_CHECK_STABLE 1024
+#define RCU_CHECK_CHURN 4096
+#define RCU_CHECK_WRITES 20000
+#define RCU_CHECK_READERS 4
+
+static volatile bool_t check_rcu_finished = false;
+
+/**
+ * @brief	Repeatedly search an index while another thread modifies it.
+ * @note	Even keys are never removed, so they must always be found, with the data intact. Odd keys are inserted and
+ * 			deleted by the writer, so they may or may not be found, but any data returned must match the key.
+ * @param	inx		the index being searched.
+ * @return	This function returns no value; the outcome is passed to pthread_exit().
+ */
+void check_indexes_rcu_reader(inx_t *inx) {
+
+	multi_t key;
+	uint64_t num;
+	void *val;
+	bool_t *result;
+
+	if (!thread_start() || !(result = mm_alloc(sizeof(bool_t)))) {
+		log_error("Unable to setup the thread context.");
+		pthread_exit(NULL);
+		return;
+	}
+
+	*result = true;
+	mm_wipe(&key, sizeof(multi_t));
+	key.type = M_TYPE_UINT64;
+
+	while (*result && !check_rcu_finished) {
+
+		// Hold a critical section while the data is inspected, so the writer can't release it underneath us.
+		epoch_enter();
+
+		key.val.u64 = (rand_get_uint64() % RCU_CHECK_STABLE) * 2;
+		if (!(val = inx_find(inx, key)) || !uint64_conv_ns(val, &num) || num != key.val.u64) {
+			*result = false;
+		}
+
+		key.val.u64 = ((rand_get_uint64() % RCU_CHECK_CHURN) * 2) + 1;
+		if ((val = inx_find(inx, key)) && (!uint64_conv_ns(val, &num) || num != key.val.u64)) {
+			*result = false;
+		}
+
+		epoch_exit();
+	}
+
+	thread_stop();
+	pthread_exit(result);
+	return;
+}
+
+bool_t check_indexes_rcu_insert(inx_t *inx, uint64_t num) {
+
+	multi_t key;
+	char snum[64];
+	chr_t *val;
+
+	snprintf(snum, 64, "%lu", num);
+
+	if (!(val = ns_dupe(snum))) {
+		return false;
+	}
+
+	mm_wipe(&key, sizeof(multi_t));
+	key.type = M_TYPE_UINT64;
+	key.val.u64 = num;
+
+	if (!inx_insert(inx, key, val)) {
+		ns_free(val);
+		return false;
+	}
+
+	return true;
+}
+
+bool_t check_indexes_rcu_mthread(char **errmsg) {
+
+	inx_t *inx;
+	multi_t key;
+	void *outcome;
+	bool_t result = true;
+	pthread_t threads[RCU_CHECK_READERS];
+	uint64_t types[] = { M_INX_HASHED, M_INX_TREE }, launched;
+
+	mm_wipe(&key, sizeof(multi_t));
+	key.type = M_TYPE_UINT64;
+
+	for (uint_t type = 0; result && status() && type < (sizeof(types) / sizeof(uint64_t)); type++) {
+
+		if (!(inx = inx_alloc(types[type] | M_INX_RCU, &ns_free))) {
+			*errmsg = "index allocation failed";
+			return false;
+		}
+
+		for (uint64_t i = 0; result && i < RCU_CHECK_STABLE; i++) {
+			if (!check_indexes_rcu_insert(inx, i * 2)) {
+				*errmsg = "insert operation failed";
+				result = false;
+			}
+		}
+
+		check_rcu_finished = false;
+
+		for (launched = 0; result && launched < RCU_CHECK_READERS; launched++) {
+			if (thread_launch(threads + launched, &check_indexes_rcu_reader, inx)) {
+				*errmsg = "reader thread launch failed";
+				result = false;
+				break;
+			}
+		}
+
+		// Churn the odd keys, which forces hashed tables to be rebuilt, and tree nodes to be split, merged and copied.
+		for (uint64_t i = 0; result && status() && i < RCU_CHECK_WRITES; i++) {
+
+			key.val.u64 = ((rand_get_uint64() % RCU_CHECK_CHURN) * 2) + 1;
+
+			if (i % 2) {
+				inx_delete(inx, key);
+			}
+			else if (!check_indexes_rcu_insert(inx, key.val.u64)) {
+				*errmsg = "insert operation failed";
+				result = false;
+			}
+		}
+
+		check_rcu_finished = true;
+
+		for (uint64_t i = 0; i < launched; i++) {
+			outcome = NULL;
+			if (thread_result(threads[i], &outcome) || !outcome || !*(bool_t *)outcome) {
+				if (result) *errmsg = "reader found missing or corrupted data";
+				result = false;
+			}
+			if (outcome) {
+				mm_free(outcome);
+			}
+		}
+
+		inx_free(inx);
+	}
+
+	return result;
+}
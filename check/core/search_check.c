@@ -0,0 +1,345 @@
+
+/**
+ * @file /check/magma/core/search_check.c
+ *
+ * @brief Unit tests and benchmarks for the substring search kernels.
+ */
+
+#include "magma_check.h"
+
+#define SEARCH_CHECK_ROUNDS 4096
+#define SEARCH_CHECK_BODY 1048576
+#define SEARCH_CHECK_ITERATIONS 64
+#define SEARCH_CHECK_NEEDLES 6
+
+typedef struct {
+	size_t reported;
+	uchr_t hits[SEARCH_CHECK_NEEDLES][256];
+} check_search_hits_t;
+
+/**
+ * @brief	Find a needle inside a buffer one offset at a time, which the search kernels are compared against.
+ * @return	-1 if the needle isn't found, or the offset of the first match.
+ */
+int64_t check_search_reference(const uchr_t *h, size_t hlen, const uchr_t *n, size_t nlen, bool_t insensitive) {
+
+	size_t j;
+
+	for (size_t i = 0; nlen <= hlen && i <= hlen - nlen; i++) {
+		for (j = 0; j < nlen && (insensitive ? lower_chr(h[i + j]) == lower_chr(n[j]) : h[i + j] == n[j]); j++);
+		if (j == nlen) return i;
+	}
+
+	return -1;
+}
+
+/**
+ * @brief	Build a message body which looks like a mail message, with a header block followed by lines of prose and a base64
+ * 			encoded attachment.
+ * @param	len		the length of the body.
+ * @return	NULL on failure, or a pointer to the body, which must be freed by the caller.
+ */
+uchr_t * check_search_body(size_t len) {
+
+	uchr_t *body;
+	size_t used = 0, chunk;
+	chr_t *lines[] = {
+		"Received: from mx.example.com (mx.example.com [192.0.2.25]) by mail.example.org with ESMTP id 4f2c9a; Tue, 4 Mar 2014 10:12:01 -0600\r\n",
+		"Subject: Re: the quarterly numbers we discussed on Friday\r\n",
+		"Thanks for sending these over. I went through the spreadsheet and most of the figures line up with what we had,\r\n",
+		"but the totals in the third column look like they were carried over from last year. Could you double check them?\r\n",
+		"> On Friday, March 1, 2014, someone wrote:\r\n> Attached are the numbers for the quarter, let me know if anything looks off.\r\n",
+		"UEsDBBQABgAIAAAAIQDfpNJsWgEAACAFAAATAAgCW0NvbnRlbnRfVHlwZXNdLnhtbCCiBAIooAACAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA\r\n"
+	};
+
+	if (!(body = mm_alloc(len))) {
+		return NULL;
+	}
+
+	for (uint32_t i = 0; used < len; i++) {
+		chunk = ns_length_get(lines[i % 6]) < len - used ? ns_length_get(lines[i % 6]) : len - used;
+		mm_copy(body + used, lines[i % 6], chunk);
+		used += chunk;
+	}
+
+	return body;
+}
+
+bool_t check_search_kernels(char **errmsg) {
+
+	int64_t expected;
+	placer_t h, n;
+	needle_t *compiled;
+	size_t location, hlen, nlen;
+	uchr_t haystack[256], needle[64];
+	const uchr_t *match;
+	bool_t insensitive, found;
+	search_kernel_t kernels[3] = { &st_search_kernel_scalar, NULL, NULL };
+
+#ifdef __SSE2__
+	kernels[1] = &st_search_kernel_sse2;
+	if (__builtin_cpu_supports("avx2")) kernels[2] = &st_search_kernel_avx2;
+#endif
+
+	for (uint32_t round = 0; round < SEARCH_CHECK_ROUNDS; round++) {
+
+		// A small alphabet which mixes the case of a few letters with bytes that only differ from a letter by the case
+		// bit, so the kernels see plenty of partial matches and nearly every kind of false candidate.
+		hlen = (rand_get_uint32() % 255) + 1;
+		nlen = (rand_get_uint32() % (round % 4 ? 4 : 40)) + 1;
+		insensitive = round % 2;
+
+		for (size_t i = 0; i < hlen; i++) haystack[i] = "aAbB@`[{\xc1\xe1"[rand_get_uint32() % 10];
+		for (size_t i = 0; i < nlen; i++) needle[i] = "aAbB@`[{\xc1\xe1"[rand_get_uint32() % 10];
+
+		// Half the time, the needle is copied out of the haystack, so matches are guaranteed.
+		if (round % 3 && nlen <= hlen) {
+			mm_copy(needle, haystack + (rand_get_uint32() % (hlen - nlen + 1)), nlen);
+		}
+
+		expected = check_search_reference(haystack, hlen, needle, nlen, insensitive);
+
+		for (int_t k = 0; k < 3; k++) {
+			if (kernels[k] && nlen <= hlen && ((match = kernels[k](haystack, hlen, needle, nlen, insensitive)) ? match - haystack : -1) != expected) {
+				*errmsg = "a search kernel result didn't match the reference search";
+				return false;
+			}
+		}
+
+		h = pl_init(haystack, hlen);
+		n = pl_init(needle, nlen);
+		found = insensitive ? st_search_ci(&h, &n, &location) : st_search_cs(&h, &n, &location);
+
+		if (found != (expected >= 0) || location != (found ? expected : 0)) {
+			*errmsg = "the string search result didn't match the reference search";
+			return false;
+		}
+
+		if (!(compiled = st_needle_alloc(&n, insensitive))) {
+			*errmsg = "unable to compile a needle";
+			return false;
+		}
+
+		found = st_needle_search(compiled, &h, &location);
+		st_needle_free(compiled);
+
+		if (found != (expected >= 0) || location != (found ? expected : 0)) {
+			*errmsg = "the compiled needle search result didn't match the reference search";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Record a match reported by a scanner.
+ * @return	true, so the scan continues.
+ */
+bool_t check_search_collect(void *context, size_t needle, size_t offset) {
+
+	check_search_hits_t *hits = context;
+
+	hits->reported++;
+	if (needle < SEARCH_CHECK_NEEDLES && offset < 256) hits->hits[needle][offset]++;
+
+	return true;
+}
+
+/**
+ * @brief	Stop a scan at the first match.
+ * @return	false, so the scan stops.
+ */
+bool_t check_search_stop(void *context, size_t needle, size_t offset) {
+
+	(*((size_t *)context))++;
+	return false;
+}
+
+bool_t check_search_scan(char **errmsg) {
+
+	needle_t *single;
+	scanner_t *scanner;
+	scan_stream_t stream;
+	stringer_t *chain, *needles[SEARCH_CHECK_NEEDLES];
+	placer_t haystack, segments[256], places[SEARCH_CHECK_NEEDLES];
+	uchr_t data[256], text[SEARCH_CHECK_NEEDLES][16];
+	check_search_hits_t expected, once, streamed, chained;
+	size_t hlen, count, len, location, from, stops;
+	bool_t insensitive;
+
+	for (uint32_t round = 0; round < SEARCH_CHECK_ROUNDS / 4; round++) {
+
+		hlen = (rand_get_uint32() % 255) + 1;
+		count = (rand_get_uint32() % SEARCH_CHECK_NEEDLES) + 1;
+		insensitive = round % 2;
+
+		for (size_t i = 0; i < hlen; i++) data[i] = "aAbBc@`"[rand_get_uint32() % 7];
+
+		// The needles are short, and drawn from the same alphabet, so they overlap each other, and some of them are duplicates.
+		for (size_t i = 0; i < count; i++) {
+			len = (rand_get_uint32() % 4) + 1;
+			for (size_t j = 0; j < len; j++) text[i][j] = "aAbBc@`"[rand_get_uint32() % 7];
+			if (i && !(rand_get_uint32() % 4)) mm_copy(text[i], text[i - 1], len = st_length_get(needles[i - 1]));
+			places[i] = pl_init(text[i], len);
+			needles[i] = &places[i];
+		}
+
+		mm_wipe(&expected, sizeof(check_search_hits_t));
+		mm_wipe(&once, sizeof(check_search_hits_t));
+		mm_wipe(&streamed, sizeof(check_search_hits_t));
+		mm_wipe(&chained, sizeof(check_search_hits_t));
+
+		for (size_t i = 0; i < count; i++) {
+			for (size_t j = 0; j < hlen; j++) {
+				if (check_search_reference(data + j, hlen - j, text[i], st_length_get(needles[i]), insensitive) == 0) {
+					expected.hits[i][j]++;
+					expected.reported++;
+				}
+			}
+		}
+
+		if (!(scanner = st_scanner_alloc(count, needles, insensitive))) {
+			*errmsg = "unable to compile a scanner";
+			return false;
+		}
+
+		haystack = pl_init(data, hlen);
+
+		// Scan the haystack all at once, then as a stream of randomly sized chunks, and then as a chain.
+		if (st_scan(scanner, &haystack, &check_search_collect, &once) != expected.reported) {
+			*errmsg = "the scanner didn't report the expected number of matches";
+			st_scanner_free(scanner);
+			return false;
+		}
+
+		st_scan_stream_init(&stream, scanner);
+
+		for (size_t i = 0; i < hlen; i += len) {
+			len = (rand_get_uint32() % 8) + 1;
+			len = len > hlen - i ? hlen - i : len;
+			st_scan_stream_data(&stream, data + i, len, &check_search_collect, &streamed);
+		}
+
+		chain = NULL;
+		for (size_t i = 0, j = 0; i < hlen; i += len, j++) {
+			len = (rand_get_uint32() % 3) + 1;
+			segments[j] = pl_init(data + i, len > hlen - i ? hlen - i : len);
+			chain = st_chain_append(chain, &segments[j]);
+		}
+
+		st_scan_stream_init(&stream, scanner);
+		st_scan_stream(&stream, chain, &check_search_collect, &chained);
+		st_free(chain);
+
+		if (mm_cmp_cs_eq(&expected, &once, sizeof(check_search_hits_t)) || mm_cmp_cs_eq(&expected, &streamed, sizeof(check_search_hits_t)) ||
+			mm_cmp_cs_eq(&expected, &chained, sizeof(check_search_hits_t))) {
+			*errmsg = "the scanner matches didn't match the reference search";
+			st_scanner_free(scanner);
+			return false;
+		}
+
+		// A callback which returns false should stop the scan, and any chunks which follow should be ignored. The haystack is
+		// fed to the stream twice, so a match could span the two copies even if the haystack alone doesn't hold one.
+		stops = 0;
+		st_scan_stream_init(&stream, scanner);
+		st_scan_stream_data(&stream, data, hlen, &check_search_stop, &stops);
+		st_scan_stream_data(&stream, data, hlen, &check_search_stop, &stops);
+		st_scanner_free(scanner);
+
+		if (stops > 1 || (expected.reported && !stops)) {
+			*errmsg = "the scanner didn't stop when the callback asked it to";
+			return false;
+		}
+
+		// Iterate through the overlapping matches of the first needle.
+		if (!(single = st_needle_alloc(needles[0], insensitive))) {
+			*errmsg = "unable to compile a needle";
+			return false;
+		}
+
+		for (from = 0, len = 0; st_needle_next(single, &haystack, from, &location); from = location + 1, len++) {
+			if (!expected.hits[0][location]) break;
+		}
+
+		st_needle_free(single);
+
+		for (size_t j = 0; j < hlen; j++) {
+			len -= expected.hits[0][j] ? 1 : 0;
+		}
+
+		if (len) {
+			*errmsg = "the needle iterator didn't find every match";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool_t check_search_bench(char **errmsg) {
+
+	int64_t expected;
+	uchr_t *body;
+	const uchr_t *match;
+	struct timespec start, end;
+	double nanoseconds[3];
+	chr_t *names[3] = { "scalar", "sse2", "avx2" };
+	search_kernel_t kernels[3] = { &st_search_kernel_scalar, NULL, NULL };
+	chr_t *needles[] = { "\r\n.\r\n", "Content-Disposition: attachment; filename=\"quarterly-numbers.xlsx\"" };
+
+#ifdef __SSE2__
+	kernels[1] = &st_search_kernel_sse2;
+	if (__builtin_cpu_supports("avx2")) kernels[2] = &st_search_kernel_avx2;
+#endif
+
+	if (!(body = check_search_body(SEARCH_CHECK_BODY))) {
+		*errmsg = "unable to allocate the message body";
+		return false;
+	}
+
+	// Plant each needle near the end of the body, so every kernel has to scan nearly the entire message.
+	mm_copy(body + SEARCH_CHECK_BODY - 256, needles[0], ns_length_get(needles[0]));
+	mm_copy(body + SEARCH_CHECK_BODY - 128, needles[1], ns_length_get(needles[1]));
+
+	for (int_t i = 0; i < 2; i++) {
+
+		for (int_t insensitive = 0; insensitive < 2; insensitive++) {
+
+			expected = check_search_reference(body, SEARCH_CHECK_BODY, (uchr_t *)needles[i], ns_length_get(needles[i]), insensitive);
+
+			for (int_t k = 0; k < 3; k++) {
+
+				if (!kernels[k]) {
+					nanoseconds[k] = 0;
+					continue;
+				}
+
+				clock_gettime(CLOCK_MONOTONIC, &start);
+				for (int_t j = 0; j < SEARCH_CHECK_ITERATIONS; j++) {
+					match = kernels[k](body, SEARCH_CHECK_BODY, (uchr_t *)needles[i], ns_length_get(needles[i]), insensitive);
+					__asm__ volatile ("" : : "r" (match) : "memory");
+				}
+				clock_gettime(CLOCK_MONOTONIC, &end);
+
+				if ((match ? match - body : -1) != expected) {
+					*errmsg = "a search kernel didn't find the needle planted in the message body";
+					mm_free(body);
+					return false;
+				}
+
+				nanoseconds[k] = ((((double)end.tv_sec - start.tv_sec) * 1000000000.0) + (end.tv_nsec - start.tv_nsec)) / SEARCH_CHECK_ITERATIONS;
+			}
+
+			for (int_t k = 0; k < 3; k++) {
+				if (kernels[k]) {
+					log_unit("%-6.6s needle, %-16.16s %-6.6s %8.3f GB/s\n", (i ? "long" : "short"), (insensitive ? "case insensitive" : "case sensitive"),
+						names[k], SEARCH_CHECK_BODY / nanoseconds[k]);
+				}
+			}
+		}
+	}
+
+	mm_free(body);
+	return true;
+}
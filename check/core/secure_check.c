@@ -0,0 +1,348 @@
+
+/**
+ * @file /check/magma/core/secure_check.c
+ *
+ * @brief Unit tests for the secure memory allocator.
+ */
+
+#include "magma_check.h"
+
+#define SECURE_CHECK_THREADS 4
+#define SECURE_CHECK_SLOTS 32
+#define SECURE_CHECK_ROUNDS 20000
+#define SECURE_CHECK_BENCH_ROUNDS 10000
+#define SECURE_CHECK_BENCH_SITES 64
+
+/**
+ * @brief	Randomly allocate and free secure blocks, verifying each block is zeroed when allocated, and that its contents
+ * 			aren't disturbed by the other threads.
+ * @param	data	the thread number, which is used as the fill pattern.
+ * @return	NULL on success, or a non-NULL value on failure.
+ */
+void * check_secure_thread(void *data) {
+
+	size_t len[SECURE_CHECK_SLOTS];
+	uchr_t *blocks[SECURE_CHECK_SLOTS], fill = (uchr_t)((uint64_t)data + 1);
+	uint32_t slot;
+
+	mm_wipe(blocks, sizeof(blocks));
+
+	for (uint32_t i = 0; i < SECURE_CHECK_ROUNDS; i++) {
+
+		slot = rand_get_uint32() % SECURE_CHECK_SLOTS;
+
+		if (blocks[slot]) {
+
+			for (size_t j = 0; j < len[slot]; j++) {
+				if (blocks[slot][j] != fill) return (void *)1;
+			}
+
+			mm_sec_free(blocks[slot]);
+			blocks[slot] = NULL;
+		}
+		else {
+
+			len[slot] = (rand_get_uint32() % 3) ? (rand_get_uint32() % 256) + 1 : (rand_get_uint32() % 1024) + 1;
+
+			// The secure memory limit may be reached, so running out of space is expected and isn't a failure.
+			if ((blocks[slot] = mm_sec_alloc(len[slot]))) {
+
+				for (size_t j = 0; j < len[slot]; j++) {
+					if (blocks[slot][j]) return (void *)1;
+				}
+
+				memset(blocks[slot], fill, len[slot]);
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < SECURE_CHECK_SLOTS; i++) {
+		if (blocks[i]) mm_sec_free(blocks[i]);
+	}
+
+	return NULL;
+}
+
+bool_t check_secure_mthread(char **errmsg) {
+
+	void *result, *block;
+	size_t total, bytes, items, outstanding;
+	pthread_t threads[SECURE_CHECK_THREADS];
+
+	if (!mm_sec_stats(&total, &bytes, &outstanding)) {
+		*errmsg = "unable to fetch the secure memory statistics";
+		return false;
+	}
+
+	for (uint64_t i = 0; i < SECURE_CHECK_THREADS; i++) {
+		if (thread_launch(&threads[i], &check_secure_thread, (void *)i)) {
+			*errmsg = "thread launch failed";
+			return false;
+		}
+	}
+
+	for (uint64_t i = 0; i < SECURE_CHECK_THREADS; i++) {
+		if (thread_result(threads[i], &result) || result) {
+			*errmsg = "a secure block wasn't zeroed when it was allocated, or its contents were overwritten";
+			return false;
+		}
+	}
+
+	// Every block has been freed, and the thread magazines were flushed on exit, so once our own magazine is flushed and
+	// any extra slabs are released the first slab should have been merged back into a single chunk.
+	mm_sec_shrink();
+
+	if (!mm_sec_stats(&total, &bytes, &items) || items != outstanding) {
+		*errmsg = "the secure memory statistics show leaked allocations after the test";
+		return false;
+	}
+	else if (!outstanding && !(block = mm_sec_alloc(total - (MM_SEC_REQUEST_ALIGNMENT * 2)))) {
+		*errmsg = "the secure memory slab wasn't merged back into a single chunk";
+		return false;
+	}
+	else if (!outstanding) {
+		mm_sec_free(block);
+		mm_sec_magazine_flush();
+	}
+
+	return true;
+}
+
+bool_t check_secure_grow(char **errmsg) {
+
+	void *blocks[4];
+	size_t total, bytes, items, base, grown;
+
+	mm_sec_shrink();
+
+	if (!mm_sec_stats(&base, &bytes, &items)) {
+		*errmsg = "unable to fetch the secure memory statistics";
+		return false;
+	}
+
+	mm_wipe(blocks, sizeof(blocks));
+
+	// Each block is larger than half the base slab, so every one of them forces another slab to be added, and the last is
+	// too large for a regular slab, so it gets a slab sized to fit.
+	for (int_t i = 0; i < 4; i++) {
+		if (!(blocks[i] = mm_sec_alloc(i == 3 ? base * 2 : (base / 2) + 1)) || !mm_sec_secured(blocks[i])) {
+			*errmsg = "unable to grow the secure memory region";
+			for (int_t j = 0; j < 4; j++) if (blocks[j]) mm_sec_free(blocks[j]);
+			return false;
+		}
+		memset(blocks[i], 0xff, i == 3 ? base * 2 : (base / 2) + 1);
+	}
+
+	if (!mm_sec_stats(&grown, &bytes, &items) || grown < base * 4) {
+		*errmsg = "the secure memory region didn't grow";
+		for (int_t i = 0; i < 4; i++) mm_sec_free(blocks[i]);
+		return false;
+	}
+
+	for (int_t i = 0; i < 4; i++) {
+		mm_sec_free(blocks[i]);
+	}
+
+	// Freeing the blocks should have released all but one of the extra slabs, and shrinking should release the rest.
+	if (!mm_sec_stats(&total, &bytes, &items) || total >= grown) {
+		*errmsg = "idle secure memory slabs weren't released";
+		return false;
+	}
+
+	mm_sec_shrink();
+
+	if (!mm_sec_stats(&total, &bytes, &items) || total != base) {
+		*errmsg = "the secure memory region didn't shrink back to its original length";
+		return false;
+	}
+
+	// Once the limit is reached, requests should fail instead of adding slabs.
+	if (!mm_sec_limit(base)) {
+		*errmsg = "unable to set the secure memory limit";
+		return false;
+	}
+	else if ((blocks[0] = mm_sec_alloc(base))) {
+		*errmsg = "the secure memory region grew beyond its limit";
+		mm_sec_free(blocks[0]);
+		mm_sec_limit(base * MM_SEC_SLABS_DEFAULT);
+		return false;
+	}
+
+	mm_sec_limit(base * MM_SEC_SLABS_DEFAULT);
+	return true;
+}
+
+bool_t check_secure_wipe(char **errmsg) {
+
+	uchr_t *block;
+	size_t lengths[] = { 1, 15, 17, 255, 4097, MM_SCRUB_STREAM + 33 };
+
+	if (!(block = mm_alloc(MM_SCRUB_STREAM + 64))) {
+		*errmsg = "unable to allocate a buffer";
+		return false;
+	}
+
+	// Scrub unaligned ranges of various lengths, so every store path is used, and make sure the bytes on either side of
+	// the range aren't touched.
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(size_t); i++) {
+
+		memset(block, 0xaa, MM_SCRUB_STREAM + 64);
+		mm_scrub(block + 3, (uchr_t)i + 1, lengths[i]);
+
+		if (block[2] != 0xaa || block[3 + lengths[i]] != 0xaa) {
+			*errmsg = "the scrub wrote beyond the requested range";
+			mm_free(block);
+			return false;
+		}
+
+		for (size_t j = 0; j < lengths[i]; j++) {
+			if (block[3 + j] != (uchr_t)i + 1) {
+				*errmsg = "the scrub didn't fill the requested range";
+				mm_free(block);
+				return false;
+			}
+		}
+	}
+
+	mm_free(block);
+
+	// Whatever the policy, freed blocks must come back zeroed.
+	for (M_SEC_WIPE policy = M_SEC_WIPE_SINGLE; policy <= M_SEC_WIPE_MULTI; policy++) {
+
+		if (!mm_sec_wipe_policy(policy)) {
+			*errmsg = "unable to set the secure memory wipe policy";
+			mm_sec_wipe_policy(M_SEC_WIPE_MULTI);
+			return false;
+		}
+
+		for (size_t len = 16; len <= 4096; len *= 4) {
+
+			if (!(block = mm_sec_alloc(len))) {
+				*errmsg = "unable to allocate a secure block";
+				mm_sec_wipe_policy(M_SEC_WIPE_MULTI);
+				return false;
+			}
+
+			memset(block, 0xff, len);
+			mm_sec_free(block);
+
+			if (!(block = mm_sec_alloc(len))) {
+				*errmsg = "unable to allocate a secure block";
+				mm_sec_wipe_policy(M_SEC_WIPE_MULTI);
+				return false;
+			}
+
+			for (size_t j = 0; j < len; j++) {
+				if (block[j]) {
+					*errmsg = "a secure block wasn't zeroed after being freed";
+					mm_sec_free(block);
+					mm_sec_wipe_policy(M_SEC_WIPE_MULTI);
+					return false;
+				}
+			}
+
+			mm_sec_free(block);
+		}
+	}
+
+	mm_sec_wipe_policy(M_SEC_WIPE_MULTI);
+	return true;
+}
+
+/**
+ * @brief	Repeatedly allocate, fill and free secure blocks of a single size, for the benchmark.
+ * @param	data	the block length.
+ * @return	NULL on success, or a non-NULL value if an allocation failed.
+ */
+void * check_secure_bench_thread(void *data) {
+
+	uchr_t *block;
+	size_t len = (size_t)data;
+
+	for (uint32_t i = 0; i < SECURE_CHECK_BENCH_ROUNDS; i++) {
+
+		if (!(block = mm_sec_alloc(len))) {
+			return (void *)1;
+		}
+
+		memset(block, 0xff, len);
+		mm_sec_free(block);
+	}
+
+	return NULL;
+}
+
+bool_t check_secure_bench(char **errmsg) {
+
+	void *result;
+	uint64_t count, waited, contended;
+	struct timespec start, end;
+	bool_t enabled = contention_enabled();
+	pthread_t threads[SECURE_CHECK_THREADS];
+	contention_site_t sites[SECURE_CHECK_BENCH_SITES];
+	size_t lengths[] = { 64, 512, 4096, 16384 };
+	chr_t *names[] = { "", "single", "multi" };
+
+	// The blocks are wiped after the slab lock is released, so the time spent waiting on the lock should stay roughly flat
+	// as the blocks get larger, even though the time spent on each operation grows with the length being wiped.
+	for (M_SEC_WIPE policy = M_SEC_WIPE_SINGLE; policy <= M_SEC_WIPE_MULTI; policy++) {
+
+		if (!mm_sec_wipe_policy(policy)) {
+			*errmsg = "unable to set the secure memory wipe policy";
+			mm_sec_wipe_policy(M_SEC_WIPE_MULTI);
+			contention_enable(enabled);
+			return false;
+		}
+
+		for (size_t i = 0; i < sizeof(lengths) / sizeof(size_t); i++) {
+
+			contention_reset();
+			contention_enable(true);
+			clock_gettime(CLOCK_MONOTONIC, &start);
+
+			for (uint64_t j = 0; j < SECURE_CHECK_THREADS; j++) {
+				if (thread_launch(&threads[j], &check_secure_bench_thread, (void *)lengths[i])) {
+					*errmsg = "thread launch failed";
+					for (uint64_t k = 0; k < j; k++) thread_result(threads[k], &result);
+					mm_sec_wipe_policy(M_SEC_WIPE_MULTI);
+					contention_enable(enabled);
+					return false;
+				}
+			}
+
+			for (uint64_t j = 0; j < SECURE_CHECK_THREADS; j++) {
+				if ((thread_result(threads[j], &result) || result) && !*errmsg) {
+					*errmsg = "unable to allocate a secure block for the benchmark";
+				}
+			}
+
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			contention_enable(false);
+
+			if (*errmsg) {
+				mm_sec_wipe_policy(M_SEC_WIPE_MULTI);
+				contention_enable(enabled);
+				return false;
+			}
+
+			// Only the benchmark threads were taking locks, so nearly all of the recorded waits belong to the slab lock.
+			waited = contended = 0;
+			count = contention_report(sites, SECURE_CHECK_BENCH_SITES);
+
+			for (uint64_t j = 0; j < count; j++) {
+				waited += sites[j].nanoseconds;
+				contended += sites[j].contended;
+			}
+
+			log_unit("%-6.6s wipe, %7zu bytes %10.1f ns per operation %10.1f ns lock wait per operation %8lu contended\n", names[policy],
+				lengths[i], ((((double)end.tv_sec - start.tv_sec) * 1000000000.0) + (end.tv_nsec - start.tv_nsec)) /
+				(SECURE_CHECK_THREADS * SECURE_CHECK_BENCH_ROUNDS), (double)waited / (SECURE_CHECK_THREADS * SECURE_CHECK_BENCH_ROUNDS), contended);
+		}
+	}
+
+	mm_sec_wipe_policy(M_SEC_WIPE_MULTI);
+	mm_sec_shrink();
+	contention_reset();
+	contention_enable(enabled);
+	return true;
+}
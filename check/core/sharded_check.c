@@ -0,0 +1,117 @@
+/**
+ * @file /check/magma/core/sharded_check.c
+ *
+ * @brief Unit tests for sharded indexes.
+ */
+
+#include "magma_check.h"
+
+bool_t check_indexes_sharded_simple(char **errmsg) {
+
+	void *val;
+	inx_t *inx;
+	multi_t key;
+	uint64_t count;
+	inx_cursor_t *cursor;
+	uint64_t types[] = { M_INX_HASHED, M_INX_TREE, M_INX_LINKED };
+
+	mm_wipe(&key, sizeof(multi_t));
+	key.type = M_TYPE_UINT64;
+
+	for (uint_t type = 0; status() && type < (sizeof(types) / sizeof(uint64_t)); type++) {
+
+		if (!(inx = inx_alloc(types[type] | M_INX_SHARDED, NULL))) {
+			*errmsg = "index allocation failed";
+			return false;
+		}
+
+		for (uint64_t i = 0; status() && i < HASHED_INSERTS_CHECK; i++) {
+
+			key.val.u64 = i;
+
+			if (!inx_insert(inx, key, (void *)(i + 1))) {
+				*errmsg = "insert operation failed";
+				inx_free(inx);
+				return false;
+			}
+		}
+
+		// Delete every odd key, and replace the value for every key divisible by four.
+		for (uint64_t i = 0; status() && i < HASHED_INSERTS_CHECK; i++) {
+
+			key.val.u64 = i;
+
+			if ((i % 2) && !inx_delete(inx, key)) {
+				*errmsg = "delete operation failed";
+				inx_free(inx);
+				return false;
+			}
+			else if ((i % 4) == 0 && !inx_replace(inx, key, (void *)(i + 2))) {
+				*errmsg = "replace operation failed";
+				inx_free(inx);
+				return false;
+			}
+		}
+
+		for (uint64_t i = 0; status() && i < HASHED_INSERTS_CHECK; i++) {
+
+			key.val.u64 = i;
+			val = inx_find(inx, key);
+
+			if ((i % 2 && val) || (!(i % 2) && val != (void *)(i + ((i % 4) ? 1 : 2)))) {
+				*errmsg = "find operation returned the wrong value";
+				inx_free(inx);
+				return false;
+			}
+		}
+
+		if (inx_count(inx) != (HASHED_INSERTS_CHECK / 2)) {
+			*errmsg = "record count is incorrect";
+			inx_free(inx);
+			return false;
+		}
+
+		// The cursor should visit every remaining record exactly once, moving from shard to shard.
+		if (!(cursor = inx_cursor_alloc(inx))) {
+			*errmsg = "cursor allocation failed";
+			inx_free(inx);
+			return false;
+		}
+
+		count = 0;
+		while (status() && !mt_is_empty(key = inx_cursor_key_next(cursor))) {
+
+			val = inx_cursor_value_active(cursor);
+
+			if (key.val.u64 % 2 || val != (void *)(key.val.u64 + ((key.val.u64 % 4) ? 1 : 2))) {
+				*errmsg = "cursor returned the wrong record";
+				inx_cursor_free(cursor);
+				inx_free(inx);
+				return false;
+			}
+
+			count++;
+		}
+
+		inx_cursor_free(cursor);
+		key.type = M_TYPE_UINT64;
+
+		if (count != (HASHED_INSERTS_CHECK / 2)) {
+			*errmsg = "cursor record count is incorrect";
+			inx_free(inx);
+			return false;
+		}
+
+		inx_truncate(inx);
+
+		if (inx_count(inx) != 0) {
+			*errmsg = "truncate operation failed";
+			inx_free(inx);
+			return false;
+		}
+
+		inx_free(inx);
+	}
+
+	return true;
+}
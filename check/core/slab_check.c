@@ -0,0 +1,115 @@
+/**
+ * @file /check/magma/core/slab_check.c
+ *
+ * @brief Unit tests for indexes which allocate their nodes from a slab.
+ */
+
+#include "magma_check.h"
+
+#define SLAB_CHECK_RECORDS 20000
+
+bool_t check_indexes_slab_simple(char **errmsg) {
+
+	inx_t *inx;
+	multi_t key;
+	inx_stats_t stats;
+	uint64_t chunks, objects, types[] = { M_INX_TREE, M_INX_LINKED, M_INX_TREE | M_INX_SHARDED, M_INX_HASHED };
+
+	mm_wipe(&key, sizeof(multi_t));
+	key.type = M_TYPE_UINT64;
+
+	for (uint_t type = 0; status() && type < (sizeof(types) / sizeof(uint64_t)); type++) {
+
+		if (!(inx = inx_alloc(types[type] | M_INX_SLAB, NULL))) {
+			*errmsg = "index allocation failed";
+			return false;
+		}
+
+		for (uint64_t i = 0; i < SLAB_CHECK_RECORDS; i++) {
+			key.val.u64 = i;
+			if (!inx_insert(inx, key, (void *)(i + 1))) {
+				*errmsg = "insert operation failed";
+				inx_free(inx);
+				return false;
+			}
+		}
+
+		if (!inx_stats(inx, &stats) || stats.records != SLAB_CHECK_RECORDS) {
+			*errmsg = "index statistics returned the wrong record count";
+			inx_free(inx);
+			return false;
+		}
+
+		// Hashed indexes don't have any nodes, so they ignore the slab option.
+		if ((types[type] & MAGMA_INDEX_TYPE) == M_INX_HASHED) {
+			if (stats.objects || stats.chunks || stats.reserved) {
+				*errmsg = "hashed index allocated memory from a slab";
+				inx_free(inx);
+				return false;
+			}
+			inx_free(inx);
+			continue;
+		}
+
+		if (!stats.objects || !stats.chunks || stats.used > stats.reserved) {
+			*errmsg = "index statistics returned an invalid slab footprint";
+			inx_free(inx);
+			return false;
+		}
+
+		chunks = stats.chunks;
+		objects = stats.objects;
+
+		// Deleting records should return objects to the slab, and inserting them again should reuse those objects.
+		for (uint64_t i = 0; i < SLAB_CHECK_RECORDS; i += 2) {
+			key.val.u64 = i;
+			if (!inx_delete(inx, key)) {
+				*errmsg = "delete operation failed";
+				inx_free(inx);
+				return false;
+			}
+		}
+
+		if (!inx_stats(inx, &stats) || stats.objects >= objects || stats.chunks != chunks) {
+			*errmsg = "deleted records weren't returned to the slab";
+			inx_free(inx);
+			return false;
+		}
+
+		for (uint64_t i = 0; i < SLAB_CHECK_RECORDS; i += 2) {
+			key.val.u64 = i;
+			if (!inx_insert(inx, key, (void *)(i + 1))) {
+				*errmsg = "insert operation failed";
+				inx_free(inx);
+				return false;
+			}
+		}
+
+		for (uint64_t i = 0; i < SLAB_CHECK_RECORDS; i++) {
+			key.val.u64 = i;
+			if (inx_find(inx, key) != (void *)(i + 1)) {
+				*errmsg = "find operation returned the wrong value";
+				inx_free(inx);
+				return false;
+			}
+		}
+
+		if (!inx_stats(inx, &stats) || stats.records != SLAB_CHECK_RECORDS || stats.chunks < chunks) {
+			*errmsg = "index statistics returned the wrong values after the records were reinserted";
+			inx_free(inx);
+			return false;
+		}
+
+		inx_truncate(inx);
+
+		if (!inx_stats(inx, &stats) || stats.records || stats.objects || stats.chunks || stats.reserved) {
+			*errmsg = "truncate operation didn't release the slab";
+			inx_free(inx);
+			return false;
+		}
+
+		inx_free(inx);
+	}
+
+	return true;
+}
@@ -0,0 +1,426 @@
+
+/**
+ * @file /check/magma/core/stacker_check.c
+ *
+ * @brief Unit tests for the stacked lists.
+ */
+
+#include "magma_check.h"
+
+#define STACKER_CHECK_PRODUCERS 4
+#define STACKER_CHECK_CONSUMERS 4
+#define STACKER_CHECK_ENTRIES 4096
+#define STACKER_CHECK_CAPACITY 256
+#define STACKER_CHECK_DELAY 50000
+#define STACKER_CHECK_TIMEOUT 50
+
+static stacker_t *check_stacker = NULL;
+static uint64_t check_stacker_consumed = 0;
+static uint32_t check_stacker_seen[STACKER_CHECK_PRODUCERS][STACKER_CHECK_ENTRIES];
+
+/**
+ * @brief	Build a stacked list entry which records the producer, and its position in the producer's sequence.
+ * @note	The sequence is offset by one, so an entry is never NULL.
+ * @param	producer	the producer number.
+ * @param	sequence	the position of the entry in the producer's sequence.
+ * @return	the value to be pushed onto the stacked list.
+ */
+void * check_stacker_entry(uint64_t producer, uint64_t sequence) {
+	return (void *)((producer << 32) | (sequence + 1));
+}
+
+/**
+ * @brief	Push a sequence of entries onto the shared stacked list, retrying whenever a bounded list is full.
+ * @param	data	the producer number.
+ * @return	NULL on failure, or a pointer to the stacked list if every entry was pushed.
+ */
+void * check_stacker_producer(void *data) {
+
+	uint64_t producer = (uint64_t)data;
+
+	for (uint64_t i = 0; i < STACKER_CHECK_ENTRIES; i++) {
+		while (!stacker_push(check_stacker, check_stacker_entry(producer, i))) {
+			if (!check_stacker->capacity) {
+				return NULL;
+			}
+			sched_yield();
+		}
+	}
+
+	return check_stacker;
+}
+
+/**
+ * @brief	Pop entries off the shared stacked list until every entry has been consumed.
+ * @note	Each entry is counted, so an entry delivered twice, or never delivered, is detected once the threads finish. A single
+ * 			consumer must also see the entries from any given producer in the order they were pushed.
+ * @param	data	ignored.
+ * @return	NULL on failure, or a pointer to the stacked list if every entry was received in order.
+ */
+void * check_stacker_consumer(void *data) {
+
+	void *entry;
+	uint64_t producer, sequence, last[STACKER_CHECK_PRODUCERS];
+
+	mm_wipe(last, sizeof(last));
+
+	while (__atomic_load_n(&check_stacker_consumed, __ATOMIC_ACQUIRE) < STACKER_CHECK_PRODUCERS * STACKER_CHECK_ENTRIES) {
+
+		if (!(entry = stacker_pop(check_stacker))) {
+			sched_yield();
+			continue;
+		}
+
+		producer = (uint64_t)entry >> 32;
+		sequence = (uint64_t)entry & 0xFFFFFFFF;
+
+		if (producer >= STACKER_CHECK_PRODUCERS || !sequence || sequence > STACKER_CHECK_ENTRIES || sequence <= last[producer]) {
+			return NULL;
+		}
+
+		last[producer] = sequence;
+		__atomic_add_fetch(&check_stacker_seen[producer][sequence - 1], 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&check_stacker_consumed, 1, __ATOMIC_RELEASE);
+	}
+
+	return check_stacker;
+}
+
+/**
+ * @brief	Run several producers and consumers against a stacked list at the same time.
+ * @param	stack	the empty stacked list to be tested, which is used by the threads and then freed.
+ * @param	errmsg	a pointer which will receive a description of the problem, if the check fails.
+ * @return	true if every entry was delivered exactly once, and in order, or false if the check failed.
+ */
+bool_t check_stacker_threaded(stacker_t *stack, char **errmsg) {
+
+	void *outcome;
+	bool_t result = true;
+	uint64_t producers = 0, consumers = 0;
+	pthread_t threads[STACKER_CHECK_PRODUCERS + STACKER_CHECK_CONSUMERS];
+
+	check_stacker = stack;
+	check_stacker_consumed = 0;
+	mm_wipe(check_stacker_seen, sizeof(check_stacker_seen));
+
+	for (; consumers < STACKER_CHECK_CONSUMERS; consumers++) {
+		if (thread_launch(threads + consumers, &check_stacker_consumer, NULL)) {
+			*errmsg = "thread launch failed";
+			result = false;
+			break;
+		}
+	}
+
+	for (; result && producers < STACKER_CHECK_PRODUCERS; producers++) {
+		if (thread_launch(threads + consumers + producers, &check_stacker_producer, (void *)producers)) {
+			*errmsg = "thread launch failed";
+			result = false;
+			break;
+		}
+	}
+
+	// If a thread couldn't be launched, the consumers won't ever see every entry, so they're told to stop.
+	if (!result) {
+		__atomic_store_n(&check_stacker_consumed, STACKER_CHECK_PRODUCERS * STACKER_CHECK_ENTRIES, __ATOMIC_RELEASE);
+	}
+
+	for (uint64_t i = 0; i < consumers + producers; i++) {
+		if (thread_result(threads[i], &outcome) || outcome != stack) {
+			if (result) *errmsg = i < consumers ? "a consumer received an entry out of order" : "a producer was unable to push an entry";
+			result = false;
+		}
+	}
+
+	for (uint64_t i = 0; result && i < STACKER_CHECK_PRODUCERS; i++) {
+		for (uint64_t j = 0; result && j < STACKER_CHECK_ENTRIES; j++) {
+			if (check_stacker_seen[i][j] != 1) {
+				*errmsg = "an entry wasn't delivered exactly once";
+				result = false;
+			}
+		}
+	}
+
+	if (result && (stacker_nodes(stack) || stacker_pop(stack))) {
+		*errmsg = "the stacked list wasn't empty after every entry was consumed";
+		result = false;
+	}
+
+	stacker_free(stack);
+	check_stacker = NULL;
+
+	return result;
+}
+
+/**
+ * @brief	Fill a stacked list from a single thread, then drain it and make sure the entries come back out in order.
+ * @param	stack	the empty stacked list to be tested.
+ * @param	count	the number of entries to push, or zero to push until a bounded list is full.
+ * @return	the number of entries pushed and popped in order, or zero if the check failed.
+ */
+uint64_t check_stacker_fill(stacker_t *stack, uint64_t count) {
+
+	void *entry;
+	uint64_t pushed = 0;
+
+	while ((!count || pushed < count) && stacker_push(stack, check_stacker_entry(0, pushed))) {
+		pushed++;
+	}
+
+	if (stacker_nodes(stack) != pushed) {
+		return 0;
+	}
+
+	for (uint64_t i = 0; i < pushed; i++) {
+		if ((entry = stacker_pop(stack)) != check_stacker_entry(0, i)) {
+			return 0;
+		}
+	}
+
+	return stacker_pop(stack) || stacker_nodes(stack) ? 0 : pushed;
+}
+
+bool_t check_stacker_simple(char **errmsg) {
+
+	stacker_t *stack;
+
+	// Fill a bounded list completely, twice, so the second lap reuses every cell in the ring.
+	if (!(stack = stacker_alloc_bounded(STACKER_CHECK_CAPACITY, NULL))) {
+		*errmsg = "bounded stacked list allocation failed";
+		return false;
+	}
+	else if (check_stacker_fill(stack, 0) != STACKER_CHECK_CAPACITY || check_stacker_fill(stack, 0) != STACKER_CHECK_CAPACITY) {
+		*errmsg = "a bounded stacked list didn't hold exactly its capacity, in order";
+		stacker_free(stack);
+		return false;
+	}
+
+	stacker_free(stack);
+
+	// Push enough entries onto an unbounded list to span several blocks.
+	if (!(stack = stacker_alloc(NULL))) {
+		*errmsg = "unbounded stacked list allocation failed";
+		return false;
+	}
+	else if (check_stacker_fill(stack, (MAGMA_CORE_STACKER_SEGMENT * 3) + 1) != (MAGMA_CORE_STACKER_SEGMENT * 3) + 1) {
+		*errmsg = "an unbounded stacked list didn't return its entries in order";
+		stacker_free(stack);
+		return false;
+	}
+
+	stacker_free(stack);
+
+	return true;
+}
+
+bool_t check_stacker_mthread(char **errmsg) {
+
+	stacker_t *stack;
+
+	// The ring is much smaller than the number of entries, so the producers will find it full over and over again.
+	if (!(stack = stacker_alloc_bounded(STACKER_CHECK_CAPACITY, NULL))) {
+		*errmsg = "bounded stacked list allocation failed";
+		return false;
+	}
+	else if (!check_stacker_threaded(stack, errmsg)) {
+		return false;
+	}
+
+	// The entries span many blocks, so the producers and consumers cross block boundaries while racing each other.
+	if (!(stack = stacker_alloc(NULL))) {
+		*errmsg = "unbounded stacked list allocation failed";
+		return false;
+	}
+	else if (!check_stacker_threaded(stack, errmsg)) {
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Push a single entry onto the shared stacked list after a short delay, so a waiting thread has to be woken up.
+ * @param	data	the entry to be pushed.
+ * @return	NULL on failure, or a pointer to the stacked list if the entry was pushed.
+ */
+void * check_stacker_delayed(void *data) {
+
+	usleep(STACKER_CHECK_DELAY);
+
+	if (!stacker_push(check_stacker, data)) {
+		return NULL;
+	}
+
+	return check_stacker;
+}
+
+/**
+ * @brief	Get the number of milliseconds since a monotonic clock reading.
+ * @param	start	the earlier clock reading.
+ * @return	the number of milliseconds which have passed.
+ */
+uint64_t check_stacker_elapsed(struct timespec *start) {
+
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (((end.tv_sec - start->tv_sec) * 1000000000) + (end.tv_nsec - start->tv_nsec)) / 1000000;
+}
+
+/**
+ * @brief	Check the blocking pop against a stacked list, first with nothing pushed, and then with a delayed push.
+ * @param	stack	the empty stacked list to be tested.
+ * @param	errmsg	a pointer which will receive a description of the problem, if the check fails.
+ * @return	true if the waits timed out and woke up as expected, or false if the check failed.
+ */
+bool_t check_stacker_waiting(stacker_t *stack, char **errmsg) {
+
+	void *outcome;
+	pthread_t thread;
+	struct timespec start;
+	uint32_t timeouts[] = { STACKER_CHECK_TIMEOUT * 100, 0 };
+
+	check_stacker = stack;
+
+	// Nothing is ever pushed, so the wait should last for the entire timeout, and then fail.
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	if (stacker_pop_wait(stack, STACKER_CHECK_TIMEOUT) || check_stacker_elapsed(&start) < STACKER_CHECK_TIMEOUT - 1) {
+		*errmsg = "waiting on an empty stacked list didn't time out";
+		return false;
+	}
+
+	// An entry is pushed while this thread is asleep, both with a timeout which is much longer than the delay, and without
+	// a timeout, so the waits only succeed if the push wakes this thread up.
+	for (uint64_t i = 0; i < sizeof(timeouts) / sizeof(uint32_t); i++) {
+
+		if (thread_launch(&thread, &check_stacker_delayed, check_stacker_entry(1, i))) {
+			*errmsg = "thread launch failed";
+			return false;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		if (stacker_pop_wait(stack, timeouts[i]) != check_stacker_entry(1, i) || (timeouts[i] && check_stacker_elapsed(&start) >= timeouts[i])) {
+			*errmsg = "a waiting thread wasn't woken up by a concurrent push";
+			thread_result(thread, &outcome);
+			return false;
+		}
+		else if (thread_result(thread, &outcome) || outcome != stack) {
+			*errmsg = "the delayed push failed";
+			return false;
+		}
+	}
+
+	check_stacker = NULL;
+
+	return true;
+}
+
+bool_t check_stacker_blocking(char **errmsg) {
+
+	bool_t result;
+	stacker_t *stack;
+
+	if (!(stack = stacker_alloc_bounded(STACKER_CHECK_CAPACITY, NULL))) {
+		*errmsg = "bounded stacked list allocation failed";
+		return false;
+	}
+
+	result = check_stacker_waiting(stack, errmsg);
+	stacker_free(stack);
+
+	if (!result) {
+		return false;
+	}
+	else if (!(stack = stacker_alloc(NULL))) {
+		*errmsg = "unbounded stacked list allocation failed";
+		return false;
+	}
+
+	result = check_stacker_waiting(stack, errmsg);
+	stacker_free(stack);
+
+	return result;
+}
+
+bool_t check_stacker_batches(char **errmsg) {
+
+	stacker_t *stack;
+	uint64_t count, total = (MAGMA_CORE_STACKER_SEGMENT * 3) + 16;
+	void **entries, **popped;
+
+	if (!(entries = mm_alloc(sizeof(void *) * total)) || !(popped = mm_alloc(sizeof(void *) * total))) {
+		*errmsg = "entry buffer allocation failed";
+		mm_cleanup(entries);
+		return false;
+	}
+
+	for (uint64_t i = 0; i < total; i++) {
+		entries[i] = check_stacker_entry(0, i);
+	}
+
+	// Push a batch which stops just short of the end of the first block, then a batch which spills over into the second,
+	// and then a batch larger than an entire block. The pops are sized so they also straddle each block boundary.
+	if (!(stack = stacker_alloc(NULL))) {
+		*errmsg = "unbounded stacked list allocation failed";
+		mm_free(popped);
+		mm_free(entries);
+		return false;
+	}
+	else if (stacker_push_many(stack, entries, MAGMA_CORE_STACKER_SEGMENT - 8) != MAGMA_CORE_STACKER_SEGMENT - 8 ||
+		stacker_push_many(stack, entries + MAGMA_CORE_STACKER_SEGMENT - 8, 16) != 16 ||
+		stacker_push_many(stack, entries + MAGMA_CORE_STACKER_SEGMENT + 8, total - MAGMA_CORE_STACKER_SEGMENT - 8) !=
+			total - MAGMA_CORE_STACKER_SEGMENT - 8 || stacker_nodes(stack) != total) {
+		*errmsg = "a batch push onto an unbounded stacked list failed";
+		stacker_free(stack);
+		mm_free(popped);
+		mm_free(entries);
+		return false;
+	}
+
+	count = stacker_pop_many(stack, popped, MAGMA_CORE_STACKER_SEGMENT - 4);
+	count += stacker_pop_many(stack, popped + count, 8);
+	count += stacker_pop_many(stack, popped + count, total);
+
+	if (count != total || memcmp(popped, entries, sizeof(void *) * total) || stacker_pop_many(stack, popped, total)) {
+		*errmsg = "a batch pop from an unbounded stacked list returned the wrong entries";
+		stacker_free(stack);
+		mm_free(popped);
+		mm_free(entries);
+		return false;
+	}
+
+	stacker_free(stack);
+
+	// A batch pushed onto a nearly full bounded list should only be partially added.
+	if (!(stack = stacker_alloc_bounded(STACKER_CHECK_CAPACITY, NULL))) {
+		*errmsg = "bounded stacked list allocation failed";
+		mm_free(popped);
+		mm_free(entries);
+		return false;
+	}
+	else if (stacker_push_many(stack, entries, STACKER_CHECK_CAPACITY - 4) != STACKER_CHECK_CAPACITY - 4 ||
+		stacker_push_many(stack, entries + STACKER_CHECK_CAPACITY - 4, 16) != 4 || stacker_push_many(stack, entries, 1) != 0 ||
+		stacker_nodes(stack) != STACKER_CHECK_CAPACITY) {
+		*errmsg = "a batch push onto a nearly full bounded stacked list didn't return a partial count";
+		stacker_free(stack);
+		mm_free(popped);
+		mm_free(entries);
+		return false;
+	}
+	else if (stacker_pop_many(stack, popped, total) != STACKER_CHECK_CAPACITY ||
+		memcmp(popped, entries, sizeof(void *) * STACKER_CHECK_CAPACITY) || stacker_pop_many(stack, popped, total)) {
+		*errmsg = "a batch pop from a bounded stacked list returned the wrong entries";
+		stacker_free(stack);
+		mm_free(popped);
+		mm_free(entries);
+		return false;
+	}
+
+	stacker_free(stack);
+	mm_free(popped);
+	mm_free(entries);
+
+	return true;
+}
@@ -313,3 +313,323 @@ bool_t check_string_write(void) {
 	return true;
 
 }
+
+bool_t check_string_arena(void) {
+
+	arena_t *arena;
+	stringer_t *s;
+	size_t total, bytes, items;
+	uint32_t types[] = { NULLER_T | CONTIGUOUS | ARENA, BLOCK_T | CONTIGUOUS | ARENA, MANAGED_T | CONTIGUOUS | ARENA,
+		NULLER_T | JOINTED | ARENA, BLOCK_T | JOINTED | ARENA, MANAGED_T | JOINTED | ARENA };
+
+	// Arena strings can't be allocated until an arena has been bound to the thread, and mapped strings can never use one.
+	if (st_alloc_opts(MANAGED_T | CONTIGUOUS | ARENA, 16) || st_valid_opts(MAPPED_T | JOINTED | ARENA) ||
+		!(arena = mm_arena_alloc(1024)) || mm_arena_bind(arena)) {
+		return false;
+	}
+
+	for (size_t i = 0; i < sizeof(types) / sizeof(uint32_t); i++) {
+		if (!check_string_alloc(types[i]) || !check_string_dupe(types[i]) || !check_string_realloc(types[i])) {
+			mm_arena_free(arena);
+			return false;
+		}
+	}
+
+	// Import enough data to overflow the chunk length, which forces a dedicated chunk.
+	if (!(s = st_import_opts(BLOCK_T | CONTIGUOUS | ARENA, st_char_get(string_check_constant), st_length_get(string_check_constant))) ||
+		st_cmp_cs_eq(s, string_check_constant) || !(s = st_alloc_opts(BLOCK_T | CONTIGUOUS | ARENA, 4096)) ||
+		!mm_arena_stats(arena, &total, &bytes, &items) || !items || bytes > total || total < 4096) {
+		mm_arena_free(arena);
+		return false;
+	}
+
+	// A reset should release everything except a single chunk, which is kept for the next request.
+	mm_arena_reset(arena);
+
+	if (!mm_arena_stats(arena, &total, &bytes, &items) || items || bytes || total > 1024 + 16 ||
+		!(s = st_import_opts(MANAGED_T | JOINTED | ARENA, st_char_get(string_check_constant), st_length_get(string_check_constant))) ||
+		st_cmp_cs_eq(s, string_check_constant)) {
+		mm_arena_free(arena);
+		return false;
+	}
+
+	mm_arena_free(arena);
+
+	return !mm_arena_current();
+}
+
+bool_t check_string_chain(void) {
+
+	placer_t place;
+	struct iovec vec[8];
+	uchr_t buffer[4096];
+	int sockets[2], written;
+	size_t offset = 0, received = 0;
+	stringer_t *chain = NULL, *parts[64], *flat = NULL, *dupe = NULL;
+
+	// Chains must be jointed, and can't live on the stack.
+	if (!st_valid_opts(CHAIN_T | JOINTED | HEAP) || st_valid_opts(CHAIN_T | CONTIGUOUS | HEAP) || st_valid_opts(CHAIN_T | JOINTED | STACK)) {
+		return false;
+	}
+
+	mm_wipe(parts, sizeof(parts));
+
+	// Assemble a chain from a mix of referenced and adopted parts, and build the same output the old fashioned way.
+	for (int_t i = 0; i < 64; i++) {
+
+		if (!(parts[i] = st_aprint("%i:%.*s;", i, i % 17, st_char_get(string_check_constant))) ||
+			!(chain = (i % 2 ? st_chain_adopt(chain, st_dupe(parts[i])) : st_chain_append(chain, parts[i]))) ||
+			!(flat = st_append(flat, parts[i]))) {
+			st_cleanup(chain, flat);
+			for (int_t j = 0; j <= i; j++) st_cleanup(parts[j]);
+			return false;
+		}
+	}
+
+	// Referenced parts must not be copied, and placers inside a segment should point at the original data, while a
+	// range spanning segments is served from the flattened copy.
+	place = st_chain_placer(chain, 0, 2);
+
+	if (((chain_t *)chain)->count != 64 || ((chain_t *)chain)->data || st_length_get(chain) != st_length_get(flat) ||
+		pl_char_get(place) != st_char_get(parts[0]) || st_chain_iovec(chain, 1, vec, 8) != 8 ||
+		vec[0].iov_base != st_char_get(parts[0]) + 1 || vec[0].iov_len != st_length_get(parts[0]) - 1 ||
+		st_cmp_cs_eq(chain, flat) || !((chain_t *)chain)->data ||
+		pl_char_get(st_chain_placer(chain, 1, st_length_get(flat) - 1)) != (chr_t *)((chain_t *)chain)->data + 1) {
+		st_cleanup(chain, flat);
+		for (int_t i = 0; i < 64; i++) st_cleanup(parts[i]);
+		return false;
+	}
+
+	// Write the chain to a socket in pieces, and make sure the reader sees the same bytes.
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets)) {
+		st_cleanup(chain, flat);
+		for (int_t i = 0; i < 64; i++) st_cleanup(parts[i]);
+		return false;
+	}
+
+	while (offset < st_length_get(chain) && (written = tcp_writev(sockets[0], chain, offset, true)) > 0) {
+		offset += written;
+	}
+
+	close(sockets[0]);
+
+	while (received < sizeof(buffer) && (written = read(sockets[1], buffer + received, sizeof(buffer) - received)) > 0) {
+		received += written;
+	}
+
+	close(sockets[1]);
+
+	if (offset != st_length_get(flat) || received != offset || memcmp(buffer, st_data_get(flat), received)) {
+		st_cleanup(chain, flat);
+		for (int_t i = 0; i < 64; i++) st_cleanup(parts[i]);
+		return false;
+	}
+
+	// Duplicating a chain should produce a contiguous managed string holding its own copy of the flattened data.
+	if (!(dupe = st_dupe(chain)) || !(*((uint32_t *)dupe) & MANAGED_T) || st_length_get(dupe) != st_length_get(flat) ||
+		st_cmp_cs_eq(dupe, flat) || st_data_get(dupe) == ((chain_t *)chain)->data) {
+		st_cleanup(chain, flat, dupe);
+		for (int_t i = 0; i < 64; i++) st_cleanup(parts[i]);
+		return false;
+	}
+
+	st_free(dupe);
+	dupe = NULL;
+	st_chain_reset(chain);
+
+	if (st_length_get(chain) || st_data_get(chain) || !st_chain_append(chain, string_check_constant) ||
+		st_cmp_cs_eq(chain, string_check_constant) || !(dupe = st_dupe(chain)) || st_cmp_cs_eq(dupe, string_check_constant)) {
+		st_cleanup(chain, flat, dupe);
+		for (int_t i = 0; i < 64; i++) st_cleanup(parts[i]);
+		return false;
+	}
+
+	st_free(dupe);
+
+	st_cleanup(chain, flat);
+	for (int_t i = 0; i < 64; i++) st_cleanup(parts[i]);
+
+	return true;
+}
+
+/**
+ * @brief	Replace the patterns in a substitution table the slow way, by checking every pattern at every offset.
+ * @return	NULL on failure, or a managed string holding the expected output.
+ */
+stringer_t * check_string_replace_naive(stringer_t *target, size_t count, stringer_t **patterns, stringer_t **replacements) {
+
+	int_t best;
+	stringer_t *output = NULL;
+
+	for (size_t i = 0; i < st_length_get(target);) {
+
+		best = -1;
+
+		for (size_t j = 0; j < count; j++) {
+			if (st_length_get(patterns[j]) <= st_length_get(target) - i && !memcmp(st_char_get(target) + i, st_char_get(patterns[j]),
+				st_length_get(patterns[j])) && (best == -1 || st_length_get(patterns[j]) > st_length_get(patterns[best]))) {
+				best = j;
+			}
+		}
+
+		if (best != -1) {
+			if (st_length_get(replacements[best]) && !(output = st_append(output, replacements[best]))) return NULL;
+			else if (!output && !(output = st_alloc_opts(MANAGED_T | JOINTED | HEAP, 1))) return NULL;
+			i += st_length_get(patterns[best]);
+		}
+		else {
+			if (!(output = st_append(output, PLACER(st_char_get(target) + i, 1)))) return NULL;
+			i++;
+		}
+	}
+
+	return output;
+}
+
+bool_t check_string_replace(void) {
+
+	replacer_t *replacer;
+	chr_t buffer[257];
+	stringer_t *target, *expected, *patterns[6], *replacements[6];
+	uint32_t types[] = { MANAGED_T | JOINTED | HEAP, MANAGED_T | CONTIGUOUS | HEAP, NULLER_T | JOINTED | HEAP };
+
+	// Shrinking a managed string happens in place, while growing it produces a new string.
+	if (!(target = st_import("a--b----c--", 11)) || st_replace(&target, PLACER("--", 2), PLACER("+", 1)) != 4 ||
+		st_cmp_cs_eq(target, PLACER("a+b++c+", 7)) || st_replace(&target, PLACER("+", 1), PLACER("<=>", 3)) != 4 ||
+		st_cmp_cs_eq(target, PLACER("a<=>b<=><=>c<=>", 15)) || st_replace(&target, PLACER("<=>", 3), PLACER("", 0)) != 4 ||
+		st_cmp_cs_eq(target, PLACER("abc", 3)) || st_replace(&target, PLACER("x", 1), PLACER("y", 1)) != 0) {
+		st_cleanup(target);
+		return false;
+	}
+
+	st_free(target);
+
+	patterns[0] = NULLER("he");
+	patterns[1] = NULLER("she");
+	patterns[2] = NULLER("his");
+	patterns[3] = NULLER("hers");
+	patterns[4] = NULLER("s");
+	patterns[5] = NULLER("he");
+	replacements[0] = NULLER("1");
+	replacements[1] = NULLER("");
+	replacements[2] = NULLER("[his]");
+	replacements[3] = NULLER("H");
+	replacements[4] = NULLER("S");
+	replacements[5] = NULLER("unused");
+
+	// Compare the single pass replacement against the naive version, using random input from a small alphabet so the
+	// patterns overlap often. The first table only shrinks, and the second also grows.
+	for (size_t table = 0; table < 2; table++) {
+
+		if (!(replacer = st_replacer_alloc(table ? 6 : 2, table ? patterns : patterns + 3, table ? replacements : replacements + 3))) {
+			return false;
+		}
+
+		for (size_t i = 0; i < 300; i++) {
+
+			for (size_t j = 0; j < sizeof(buffer) - 1; j++) {
+				buffer[j] = "hesrix"[rand_get_uint32() % 6];
+			}
+
+			expected = NULL;
+
+			if (!(target = st_import_opts(types[i % 3], buffer, (i % 256) + 1)) ||
+				!(expected = check_string_replace_naive(target, table ? 6 : 2, table ? patterns : patterns + 3, table ? replacements : replacements + 3)) ||
+				st_replace_multi(&target, replacer) < 0 || st_cmp_cs_eq(target, expected)) {
+				st_cleanup(target, expected);
+				st_replacer_free(replacer);
+				return false;
+			}
+
+			st_free(target);
+			st_free(expected);
+		}
+
+		st_replacer_free(replacer);
+	}
+
+	return !st_replacer_alloc(1, patterns, (stringer_t *[]){ NULL }) && !st_replacer_alloc(1, (stringer_t *[]){ NULLER("") }, replacements);
+}
+
+bool_t check_string_case(void) {
+
+	size_t len, at, expected;
+	int_t reference;
+	uchr_t a[128], b[128], converted[128];
+	placer_t pa, pb;
+	case_kernels_t kernels[3] = {
+		{ &case_mismatch_swar, &case_rmismatch_swar, &case_convert_swar }, { NULL, NULL, NULL }, { NULL, NULL, NULL }
+	};
+
+#ifdef __SSE2__
+	kernels[1] = (case_kernels_t){ &case_mismatch_sse2, &case_rmismatch_sse2, &case_convert_sse2 };
+	if (__builtin_cpu_supports("avx2")) kernels[2] = (case_kernels_t){ &case_mismatch_avx2, &case_rmismatch_avx2, &case_convert_avx2 };
+#endif
+
+	for (uint32_t round = 0; round < 4096; round++) {
+
+		// The alphabet includes the bytes on either side of each letter range, and bytes which only differ from a letter in
+		// the high bit, since those are the bytes a broken fold would get wrong.
+		len = rand_get_uint32() % 128;
+		for (size_t i = 0; i < len; i++) a[i] = "aAzZ@[`{\xc1\xe1\xda\xfa"[rand_get_uint32() % 12];
+
+		// Make the second buffer a copy of the first with the case of some letters flipped, and perhaps a single change.
+		for (size_t i = 0; i < len; i++) b[i] = rand_get_uint32() % 2 ? upper_chr(a[i]) : lower_chr(a[i]);
+		if (len && round % 2) b[rand_get_uint32() % len] = "aAzZ@[`{\xc1\xe1\xda\xfa"[rand_get_uint32() % 12];
+
+		for (expected = 0; expected < len && lower_chr(a[expected]) == lower_chr(b[expected]); expected++);
+		reference = expected == len ? 0 : lower_chr(a[expected]) < lower_chr(b[expected]) ? -1 : 1;
+		for (at = 0; at < len && lower_chr(a[len - at - 1]) == lower_chr(b[len - at - 1]); at++);
+
+		for (int_t k = 0; k < 3; k++) {
+
+			if (!kernels[k].mismatch) continue;
+
+			if (kernels[k].mismatch(a, b, len) != expected) {
+				return false;
+			}
+
+			if (kernels[k].rmismatch(a, b, len) != at) {
+				return false;
+			}
+
+			for (int_t upper = 0; upper < 2; upper++) {
+				mm_copy(converted, a, len);
+				kernels[k].convert(converted, len, upper);
+				for (size_t i = 0; i < len; i++) {
+					if (converted[i] != (upper ? upper_chr(a[i]) : lower_chr(a[i]))) return false;
+				}
+			}
+		}
+
+		if (!len) continue;
+
+		pa = pl_init(a, len);
+		pb = pl_init(b, len);
+		if (mm_cmp_ci_eq(a, b, len) != reference || st_cmp_ci_eq(&pa, &pb) != reference || st_cmp_ci_starts(&pa, &pb) != reference ||
+			st_cmp_ci_ends(&pa, &pb) != (at == len ? 0 : lower_chr(a[len - at - 1]) < lower_chr(b[len - at - 1]) ? -1 : 1)) {
+			return false;
+		}
+
+		mm_copy(converted, a, len);
+		pa = pl_init(converted, len);
+
+		if (!upper_st(&pa)) {
+			return false;
+		}
+
+		for (size_t i = 0; i < len; i++) {
+			if (converted[i] != upper_chr(a[i])) return false;
+		}
+
+		if (!lower_st(&pa)) {
+			return false;
+		}
+
+		for (size_t i = 0; i < len; i++) {
+			if (converted[i] != lower_chr(a[i])) return false;
+		}
+	}
+
+	return true;
+}
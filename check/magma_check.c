@@ -8,6 +8,7 @@
 #include "magma_check.h"
 
 int_t case_timeout = RUN_TEST_CASE_TIMEOUT;
+bool_t do_bench_check = false;
 
 /**
  *
@@ -125,6 +126,11 @@ int main(int argc, char *argv[]) {
 	// Setup
 	prog_start = time(NULL);
 
+	// The benchmarks are slow, and print their timings, so they're only registered when explicitly requested.
+	for (int_t i = 1; i < argc; i++) {
+		if (!st_cmp_cs_eq(NULLER(argv[i]), CONSTANT("--bench"))) do_bench_check = true;
+	}
+
 #if defined(__GNU_LIBRARY__)
 	printf("-------------------------------- VERSIONS --------------------------------\n\n" \
 		"%-10.10s %63.63s\n%-10.10s %63.63s\n%-10.10s %63.63s\n\n" \
@@ -155,6 +161,12 @@ int main(int argc, char *argv[]) {
 		exit(EXIT_FAILURE);
 	}
 
+	// Route small allocations through the size class allocator, so the entire suite exercises it.
+	if (!mm_cache_start(0)) {
+		log_unit("Size class allocator initialization failed...\n");
+		exit(EXIT_FAILURE);
+	}
+
 	// Unit Test Config
 	sr = srunner_create(suite_check_single());
 	srunner_add_suite(sr, suite_check_sample());
@@ -24,6 +24,7 @@
 #include "core/core_check.h"
 
 extern int case_timeout;
+extern bool_t do_bench_check;
 
 // Normally the START_TEST macro creates static testcase functions. Unfortunately dlsym() can't find static
 // symbols. We override the default macro with the variant below, which doesn't use the static keyword. This
@@ -43,25 +43,30 @@ typedef enum {
 
 typedef M_POOL_STATUS status_t;
 
-typedef struct __attribute__ ((packed)) {
-	void *data;
-	struct stacker_node_t *next;
-} stacker_node_t;
+/**
+ *  The number of entries held by each block of an unbounded stacked list.
+ */
+#define MAGMA_CORE_STACKER_SEGMENT 1024
 
 typedef struct __attribute__ ((packed)) {
-	uint64_t items;
-	pthread_mutex_t mutex;
-	stacker_node_t *list, *last;
+	uint64_t capacity; /* The number of entries a bounded list can hold, or zero for an unbounded list. */
+	void *ring; /* The ring buffer used by bounded lists. */
+	void *head, *tail, *spare; /* The first and last blocks of an unbounded list, and the list of retired blocks kept for reuse. */
+	pthread_mutex_t mutex; /* Mutex protecting the condition used to wake waiting threads. */
+	pthread_cond_t signal; /* Condition signaled when entries are pushed while threads are waiting. */
 	void (*free_function)(void *data);
+	uint32_t waiters; /* The number of threads blocked waiting for an entry. Kept last, so the packed layout leaves the
+		members above on 8 byte boundaries. */
 } stacker_t;
 
 typedef struct __attribute__ ((packed)) {
 	uint32_t count; /* Number of objects allocated. */
 	uint32_t timeout; /* How long to wait for an object before timing out. Zero is forever. */
 	uint64_t failures; /* Tracks the number of times a thread was forced to return empty handed. */
+	uint64_t head; /* The top of the free item stack, tagged with a modification counter in the upper 32 bits. */
 	sem_t available; /* Semaphore holding the number of objects currently available. */
-	pthread_mutex_t lock; /* Mutex for locking coordinating updates between threads. */
 	status_t *status; /* Array of booleans to indicate object availability. */
+	uint32_t *next; /* Array linking each available item to the one below it on the free item stack. */
 	void **objects; /* Array of objects. */
 } pool_t;
 
@@ -75,7 +80,6 @@ pool_t * pool_alloc(uint32_t count, uint32_t timeout);
 
 // Status interface
 status_t pool_get_status(pool_t *pool, uint32_t item);
-status_t pool_set_status(pool_t *pool, uint32_t item, status_t status);
 
 // Object interface
 void pool_release(pool_t *pool, uint32_t item);
@@ -102,8 +106,12 @@ void          ar_length_set(array_t *array, size_t used);
 /// stacked.c
 int_t stacker_push(stacker_t *stack, void *data);
 stacker_t * stacker_alloc(void *free_function);
+stacker_t * stacker_alloc_bounded(uint64_t capacity, void *free_function);
 uint64_t stacker_nodes(stacker_t *stack);
 void * stacker_pop(stacker_t *stack);
+uint64_t stacker_pop_many(stacker_t *stack, void **data, uint64_t count);
+void * stacker_pop_wait(stacker_t *stack, uint32_t timeout);
+uint64_t stacker_push_many(stacker_t *stack, void **data, uint64_t count);
 void stacker_free(stacker_t *stack);
 
 #endif
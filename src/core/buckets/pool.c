@@ -3,6 +3,14 @@
  * @file /magma/core/buckets/pool.c
  *
  * @brief	A collection of functions used to create, maintain and safely utilize collections of object pointers that are accessed by multiple threads.
+ *
+ * @note	The semaphore counts the available items, and handles the waiting and timeouts, while the available items themselves
+ * 			are kept on a lock free stack. Each item links to the item below it through the next array, and the head holds the
+ * 			top item number plus one, so zero means the stack is empty. The upper 32 bits of the head are incremented every
+ * 			time it changes, which prevents a thread that was preempted in the middle of a pop from swapping in a stale link
+ * 			after the same item has been pulled and released by other threads. A thread which gets past the semaphore is
+ * 			guaranteed to find an item on the stack, so pulling and releasing an object costs a single compare and swap in the
+ * 			common case, instead of a mutex and a scan of the status array.
  */
 
 #include "magma.h"
@@ -18,12 +26,56 @@ void pool_free(pool_t *pool) {
 	if (!pool)
 		return;
 
-	mutex_destroy(&(pool->lock));
 	sem_destroy(&(pool->available));
 	mm_free(pool);
 	return;
 }
 
+/**
+ * @brief	Push an item onto the free item stack of a pool.
+ * @note	The semaphore isn't adjusted, so items should be returned using pool_release(), which also updates the status.
+ * @param	pool	the pool which owns the item.
+ * @param	item	the identifier of the item being made available.
+ * @return	This function returns no value.
+ */
+static void pool_push(pool_t *pool, uint32_t item) {
+
+	uint64_t head = __atomic_load_n(&(pool->head), __ATOMIC_RELAXED), replacement;
+
+	do {
+		__atomic_store_n(pool->next + item, (uint32_t)head, __ATOMIC_RELAXED);
+		replacement = ((head & 0xFFFFFFFF00000000ull) + 0x100000000ull) | (item + 1);
+	} while (!__atomic_compare_exchange_n(&(pool->head), &head, replacement, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+	return;
+}
+
+/**
+ * @brief	Pop an item off the free item stack of a pool.
+ * @note	The next array is never freed while the pool is in use, so reading the link for an item that was just taken by
+ * 			another thread is harmless; the tag ensures the compare and swap will fail in that case. The semaphore isn't
+ * 			adjusted, so items should be reserved using pool_pull(), which also updates the status.
+ * @param	pool	the pool being searched.
+ * @param	item	a pointer to a number that will store the identifier of the item.
+ * @return	false if the stack was empty, or true if an item was removed.
+ */
+static bool_t pool_pop(pool_t *pool, uint32_t *item) {
+
+	uint64_t head = __atomic_load_n(&(pool->head), __ATOMIC_ACQUIRE), replacement;
+
+	do {
+		if (!(uint32_t)head) {
+			return false;
+		}
+
+		replacement = ((head & 0xFFFFFFFF00000000ull) + 0x100000000ull) |
+			__atomic_load_n(pool->next + ((uint32_t)head - 1), __ATOMIC_RELAXED);
+	} while (!__atomic_compare_exchange_n(&(pool->head), &head, replacement, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+	*item = (uint32_t)head - 1;
+	return true;
+}
+
 /**
  * @brief	Allocate a new object pool.
  * @param	count		the number of items the pool can hold.
@@ -33,7 +85,7 @@ void pool_free(pool_t *pool) {
 pool_t * pool_alloc(uint32_t count, uint32_t timeout) {
 
 	pool_t *pool;
-	size_t pool_size = sizeof(pool_t) + (sizeof(status_t) * count) + (sizeof(void *) * count);
+	size_t pool_size = sizeof(pool_t) + (sizeof(status_t) * count) + (sizeof(uint32_t) * count) + (sizeof(void *) * count);
 
 	if (count > MAGMA_CORE_POOL_OBJECTS_LIMIT) {
 		log_info("%u exceeds the maximum number of pool objects allowed.", count);
@@ -45,7 +97,7 @@ pool_t * pool_alloc(uint32_t count, uint32_t timeout) {
 		return NULL;
 	}
 
-	// Allocate enough memory for the pool structure, plus the boolean list and object array.
+	// Allocate enough memory for the pool structure, plus the boolean list, the stack links and object array.
 	if (!(pool = mm_alloc(pool_size))) {
 		log_info("Unable to allocate %zu bytes for a pool structure.", pool_size);
 		return NULL;
@@ -56,17 +108,16 @@ pool_t * pool_alloc(uint32_t count, uint32_t timeout) {
 	pool->timeout = timeout;
 
 	pool->status = (status_t *)((char *)pool + sizeof(pool_t));
-	pool->objects = (void *)((char *)pool + sizeof(pool_t) + ((sizeof(status_t) * count)));
+	pool->next = (uint32_t *)((char *)pool + sizeof(pool_t) + (sizeof(status_t) * count));
+	pool->objects = (void *)((char *)pool + sizeof(pool_t) + (sizeof(status_t) * count) + (sizeof(uint32_t) * count));
 
-	if (sem_init(&(pool->available), 0, count)) {
-		log_info("Unable to initialize the pool semaphore.");
-		mm_free(pool);
-		return NULL;
+	// Every item starts out available, and the items are stacked so the lowest numbered item is pulled first.
+	for (uint32_t i = count; i > 0; i--) {
+		pool_push(pool, i - 1);
 	}
 
-	if (mutex_init(&(pool->lock), NULL)) {
-		log_info("Unable to initialize the pool mutex.");
-		sem_destroy(&(pool->available));
+	if (sem_init(&(pool->available), 0, count)) {
+		log_info("Unable to initialize the pool semaphore.");
 		mm_free(pool);
 		return NULL;
 	}
@@ -93,7 +144,7 @@ uint32_t pool_get_count(pool_t *pool) {
  */
 uint32_t pool_get_available(pool_t *pool) {
 	int available;
-	if (!pool || !sem_getvalue(&(pool->available), &available))
+	if (!pool || sem_getvalue(&(pool->available), &available))
 		return 0;
 	return available;
 }
@@ -118,15 +169,10 @@ uint32_t pool_get_timeout(pool_t *pool) {
  */
 uint64_t pool_get_failures(pool_t *pool) {
 
-	uint64_t result;
 	if (!pool)
 		return 0;
 
-	mutex_lock(&(pool->lock));
-	result = pool->failures;
-	mutex_unlock(&(pool->lock));
-
-	return result;
+	return __atomic_load_n(&(pool->failures), __ATOMIC_RELAXED);
 }
 
 /**
@@ -145,18 +191,20 @@ status_t pool_get_status(pool_t *pool, uint32_t item) {
 
 	log_check(*(pool->status + item) != PL_AVAILABLE && *(pool->status + item) != PL_RESERVED);
 
-	return *(pool->status + item);
+	return __atomic_load_n(pool->status + item, __ATOMIC_ACQUIRE);
 }
 
 /**
  * @brief	Set the status flag for an item in a pool.
  * @note	A value of PL_AVAILABLE indicates the object is available for use,; PL_RESERVED indicates the object is in use by a worker thread.
+ * 			Only the status flag is updated, without moving the item on or off the free item stack, so this function is private
+ * 			to the pool. Callers reserve and return items using pool_pull() and pool_release().
  * @param	pool 	the pool containing the specified item.
  * @param	item	the identifier of the item to be adjusted.
  * @param	status	the new status for the item.
  * @return	PL_ERROR on failure; otherwise, the new status value of the specified item.
  */
-status_t pool_set_status(pool_t *pool, uint32_t item, status_t status) {
+static status_t pool_set_status(pool_t *pool, uint32_t item, status_t status) {
 
 	if (!pool) {
 		log_pedantic("A NULL pointer was passed in.");
@@ -165,7 +213,8 @@ status_t pool_set_status(pool_t *pool, uint32_t item, status_t status) {
 
 	log_check(status != PL_AVAILABLE && status != PL_RESERVED);
 
-	return *(pool->status + item) = status;
+	__atomic_store_n(pool->status + item, status, __ATOMIC_RELEASE);
+	return status;
 }
 
 /**
@@ -177,7 +226,8 @@ status_t pool_set_status(pool_t *pool, uint32_t item, status_t status) {
  */
 status_t pool_pull(pool_t *pool, uint32_t *item) {
 
-	status_t result = PL_ERROR;
+	uint32_t reserved;
+	status_t expected;
 	struct timespec timeout;
 
 	if (!pool || !item)
@@ -191,9 +241,7 @@ status_t pool_pull(pool_t *pool, uint32_t *item) {
 		timeout.tv_sec += pool->timeout;
 
 		if (sem_timedwait(&(pool->available), &timeout)) {
-			mutex_lock(&(pool->lock));
-			pool->failures++;
-			mutex_unlock(&(pool->lock));
+			__atomic_add_fetch(&(pool->failures), 1, __ATOMIC_RELAXED);
 			return PL_ERROR;
 		}
 
@@ -201,20 +249,20 @@ status_t pool_pull(pool_t *pool, uint32_t *item) {
 		sem_wait(&(pool->available));
 	}
 
-	mutex_lock(&(pool->lock));
-	for (uint32_t i = 0; result == PL_ERROR && i < pool->count; i++) {
-		if (pool_get_status(pool, i) == PL_AVAILABLE) {
-			result = pool_set_status(pool, i, PL_RESERVED);
-			*item = i;
-		}
+	// The semaphore guarantees an item is on the stack, unless an item was popped without going through pool_pull().
+	if (!pool_pop(pool, &reserved)) {
+		__atomic_add_fetch(&(pool->failures), 1, __ATOMIC_RELAXED);
+		sem_post(&(pool->available));
+		return PL_ERROR;
 	}
 
-	if (result == PL_ERROR)
-		pool->failures++;
-
-	mutex_unlock(&(pool->lock));
+	// The item can only be held by pool_swap_obj(), which releases it as soon as the object pointer has been replaced.
+	do {
+		expected = PL_AVAILABLE;
+	} while (!__atomic_compare_exchange_n(pool->status + reserved, &expected, PL_RESERVED, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
 
-	return result;
+	*item = reserved;
+	return PL_RESERVED;
 }
 
 /**
@@ -226,9 +274,8 @@ status_t pool_pull(pool_t *pool, uint32_t *item) {
 void pool_release(pool_t *pool, uint32_t item) {
 	if (!pool)
 		return;
-	mutex_lock(&(pool->lock));
 	pool_set_status(pool, item, PL_AVAILABLE);
-	mutex_unlock(&(pool->lock));
+	pool_push(pool, item);
 	sem_post(&(pool->available));
 }
 
@@ -245,13 +292,10 @@ void * pool_get_obj(pool_t *pool, uint32_t item) {
 	}
 
 #ifdef MAGMA_PEDANTIC
-	mutex_lock(&(pool->lock));
 	if (item >= pool_get_count(pool)) {
-		mutex_unlock(&(pool->lock));
 		log_pedantic("The item number provided (%u) is outside the valid range.", item);
 		return NULL;
 	}
-	mutex_unlock(&(pool->lock));
 #endif
 
 	return *(pool->objects + item);
@@ -271,13 +315,10 @@ void * pool_set_obj(pool_t *pool, uint32_t item, void *object) {
 	}
 
 #ifdef MAGMA_PEDANTIC
-	mutex_lock(&(pool->lock));
 	if (item >= pool_get_count(pool)) {
-		mutex_unlock(&(pool->lock));
 		log_pedantic("The item number provided (%u) is outside the valid range.", item);
 		return NULL;
 	}
-	mutex_unlock(&(pool->lock));
 #endif
 
 	return *(pool->objects + item) = object;
@@ -294,6 +335,7 @@ void * pool_swap_obj(pool_t *pool, uint32_t item, void *object) {
 
 	bool_t loop = true;
 	void *current = NULL;
+	status_t expected;
 	struct timespec delay;
 
 	if (!pool)
@@ -304,13 +346,14 @@ void * pool_swap_obj(pool_t *pool, uint32_t item, void *object) {
 	delay.tv_nsec = 10000000;
 
 	do {
-		mutex_lock(&(pool->lock));
-		if (pool_get_status(pool, item) == PL_AVAILABLE) {
+		// Reserving the item keeps a concurrent pull from handing out the object until the swap is complete.
+		expected = PL_AVAILABLE;
+		if (__atomic_compare_exchange_n(pool->status + item, &expected, PL_RESERVED, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
 			current = pool_get_obj(pool, item);
 			pool_set_obj(pool, item, object);
+			pool_set_status(pool, item, PL_AVAILABLE);
 			loop = false;
 		}
-		mutex_unlock(&(pool->lock));
 
 		/// LOW: Currently the function loops until the requested object is available. A superior implementation would hook into the release function and detect when
 		/// the desired object is available and perform the swap at that point.
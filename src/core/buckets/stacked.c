@@ -3,43 +3,489 @@
  * @file /magma/core/buckets/stacked.c
  *
  * @brief	An interface for handling FIFO stacks.
+ *
+ * @note	Stacked lists are used to hand work off between threads, so neither variant takes a lock. Bounded lists are a ring
+ * 			of cells, each stamped with a sequence number which tells producers and consumers whether the cell is ready for
+ * 			them, so a push or pop only needs to claim a position with a compare and swap. Unbounded lists are a chain of
+ * 			blocks, each holding MAGMA_CORE_STACKER_SEGMENT entries. Producers and consumers claim a position in the block at
+ * 			the end of the chain, or the block at the front of it, using an atomic increment. When a block is exhausted the
+ * 			next one is linked in, and the drained block is moved onto a recycle list. Each block counts the producers and
+ * 			consumers working on it, on the same cache line as the position they claim from, and a recycled block is only
+ * 			reused once both counts drop to zero, since a slow thread could still be looking at it. Blocks are never freed
+ * 			while the list is in use, so a thread holding a stale pointer always finds a block, even if it's no longer part
+ * 			of the chain, and the recycle list holds onto the largest number of blocks the list has needed at once. Entries
+ * 			may not be NULL, since NULL is used to mark an empty cell.
  */
 
 #include "magma.h"
 
+typedef struct stacker_cell_t {
+	uint64_t sequence;
+	void *data;
+} stacker_cell_t;
+
+// The positions are padded onto separate cache lines, so producers and consumers don't contend for the same line.
+typedef struct stacker_ring_t {
+	uint64_t enqueue;
+	chr_t padding_enqueue[56];
+	uint64_t dequeue;
+	chr_t padding_dequeue[56];
+	uint64_t mask;
+	stacker_cell_t cells[];
+} stacker_ring_t;
+
+typedef struct stacker_segment_t {
+	struct stacker_segment_t *next, *recycled;
+	chr_t padding_links[48];
+	uint64_t enqueue, pushers;
+	chr_t padding_enqueue[48];
+	uint64_t dequeue, poppers;
+	chr_t padding_dequeue[48];
+	void *cells[MAGMA_CORE_STACKER_SEGMENT];
+} stacker_segment_t;
+
+/**
+ * The value stored in a cell by a consumer which claimed it before a producer got there, so the producer knows to try again.
+ */
+static chr_t stacker_taken;
+
+/**
+ * @brief	Add a block which is no longer part of the chain to the recycle list of an unbounded stacked list.
+ * @param	stack	a pointer to the stacked list which owns the block.
+ * @param	segment	a pointer to the block being recycled.
+ * @return	This function returns no value.
+ */
+void stacker_segment_recycle(stacker_t *stack, stacker_segment_t *segment) {
+
+	segment->recycled = __atomic_load_n((stacker_segment_t **)&(stack->spare), __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n((stacker_segment_t **)&(stack->spare), &(segment->recycled), segment, true, __ATOMIC_RELEASE,
+		__ATOMIC_RELAXED));
+
+	return;
+}
+
+/**
+ * @brief	Get a block for an unbounded stacked list, reusing a recycled block if one is idle.
+ * @note	The entire recycle list is taken while it's searched, so two threads can never claim the same block, and whatever
+ * 			is left is put back afterward, along with any blocks recycled in the meantime.
+ * @param	stack	a pointer to the stacked list which will own the block.
+ * @param	data	an array of entries to be placed at the start of the block, or NULL for an empty block.
+ * @param	count	the number of entries in the array; only the first MAGMA_CORE_STACKER_SEGMENT entries will be placed.
+ * @return	NULL on failure, or a pointer to the block.
+ */
+stacker_segment_t * stacker_segment_alloc(stacker_t *stack, void **data, uint64_t count) {
+
+	stacker_segment_t *segment = NULL, *list, *added, *last, **link, *expected;
+
+	list = __atomic_exchange_n((stacker_segment_t **)&(stack->spare), NULL, __ATOMIC_ACQUIRE);
+
+	// A block is idle once every producer and consumer which found it in the chain has moved on. A thread which registers
+	// after this check will see the block has left the chain, and back off without touching it.
+	for (link = &list; *link; link = &((*link)->recycled)) {
+		if (!__atomic_load_n(&((*link)->pushers), __ATOMIC_SEQ_CST) && !__atomic_load_n(&((*link)->poppers), __ATOMIC_SEQ_CST)) {
+			segment = *link;
+			*link = segment->recycled;
+			break;
+		}
+	}
+
+	while (list) {
+		expected = NULL;
+		if (__atomic_compare_exchange_n((stacker_segment_t **)&(stack->spare), &expected, list, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+			break;
+		}
+		else if ((added = __atomic_exchange_n((stacker_segment_t **)&(stack->spare), NULL, __ATOMIC_ACQUIRE))) {
+			for (last = added; last->recycled; last = last->recycled);
+			last->recycled = list;
+			list = added;
+		}
+	}
+
+	if (segment) {
+		mm_wipe(segment->cells, sizeof(segment->cells));
+	}
+	else if (!(segment = mm_alloc(sizeof(stacker_segment_t)))) {
+		log_pedantic("Unable to allocate %zu bytes for a stacked list block.", sizeof(stacker_segment_t));
+		return NULL;
+	}
+
+	count = data ? (count < MAGMA_CORE_STACKER_SEGMENT ? count : MAGMA_CORE_STACKER_SEGMENT) : 0;
+
+	if (count) {
+		mm_copy(segment->cells, data, sizeof(void *) * count);
+	}
+
+	segment->next = segment->recycled = NULL;
+	segment->enqueue = count;
+	segment->dequeue = 0;
+
+	return segment;
+}
+
+/**
+ * @brief	Find the block at one end of an unbounded stacked list, and register the calling thread as working on it.
+ * @note	The block is checked again after registering, since it could have left the chain, and even been recycled, after its
+ * 			address was loaded. Once the thread is registered the block can't be reused until stacker_segment_leave() is called.
+ * @param	end			a pointer to either the head or tail of the stacked list.
+ * @param	producer	true if the calling thread is pushing entries, or false if it's popping them.
+ * @return	a pointer to the block at the requested end of the list.
+ */
+stacker_segment_t * stacker_segment_enter(void **end, bool_t producer) {
+
+	uint64_t *users;
+	stacker_segment_t *segment;
+
+	while (true) {
+
+		segment = __atomic_load_n((stacker_segment_t **)end, __ATOMIC_ACQUIRE);
+		users = producer ? &(segment->pushers) : &(segment->poppers);
+		__atomic_add_fetch(users, 1, __ATOMIC_SEQ_CST);
+
+		if (__atomic_load_n((stacker_segment_t **)end, __ATOMIC_SEQ_CST) == segment) {
+			return segment;
+		}
+
+		__atomic_sub_fetch(users, 1, __ATOMIC_RELEASE);
+	}
+}
+
+/**
+ * @brief	Tell an unbounded stacked list the calling thread is done with a block.
+ * @param	segment		a pointer to the block returned by stacker_segment_enter().
+ * @param	producer	true if the calling thread was pushing entries, or false if it was popping them.
+ * @return	This function returns no value.
+ */
+void stacker_segment_leave(stacker_segment_t *segment, bool_t producer) {
+
+	__atomic_sub_fetch(producer ? &(segment->pushers) : &(segment->poppers), 1, __ATOMIC_RELEASE);
+
+	return;
+}
+
+/**
+ * @brief	Push entries onto the end of a bounded stacked list.
+ * @note	The run of free cells following the enqueue position is measured first, so the entire run is claimed using a
+ * 			single compare and swap.
+ * @param	ring	a pointer to the ring buffer of the stacked list.
+ * @param	data	an array of entries to be added, in order.
+ * @param	count	the number of entries in the array.
+ * @return	the number of entries added, which is less than count if the ring filled up.
+ */
+uint64_t stacker_ring_push(stacker_ring_t *ring, void **data, uint64_t count) {
+
+	int64_t difference;
+	uint64_t position = __atomic_load_n(&(ring->enqueue), __ATOMIC_RELAXED), run;
+
+	while (true) {
+
+		// A cell is ready for a producer when its sequence matches the position, which happens once the consumer from the
+		// previous lap is finished with it.
+		for (run = 0; run < count && run <= ring->mask; run++) {
+			if (__atomic_load_n(&(ring->cells[(position + run) & ring->mask].sequence), __ATOMIC_ACQUIRE) != position + run) {
+				break;
+			}
+		}
+
+		if (run) {
+			if (__atomic_compare_exchange_n(&(ring->enqueue), &position, position + run, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		}
+		else if ((difference = (int64_t)(__atomic_load_n(&(ring->cells[position & ring->mask].sequence), __ATOMIC_ACQUIRE) - position)) < 0) {
+			return 0;
+		}
+		else if (difference > 0) {
+			position = __atomic_load_n(&(ring->enqueue), __ATOMIC_RELAXED);
+		}
+	}
+
+	for (uint64_t i = 0; i < run; i++) {
+		ring->cells[(position + i) & ring->mask].data = data[i];
+		__atomic_store_n(&(ring->cells[(position + i) & ring->mask].sequence), position + i + 1, __ATOMIC_RELEASE);
+	}
+
+	return run;
+}
+
+/**
+ * @brief	Pop entries off the front of a bounded stacked list.
+ * @param	ring	a pointer to the ring buffer of the stacked list.
+ * @param	data	an array which will receive the entries, in order.
+ * @param	count	the maximum number of entries to be removed.
+ * @return	the number of entries removed, which is zero if the ring is empty.
+ */
+uint64_t stacker_ring_pop(stacker_ring_t *ring, void **data, uint64_t count) {
+
+	int64_t difference;
+	uint64_t position = __atomic_load_n(&(ring->dequeue), __ATOMIC_RELAXED), run;
+
+	while (true) {
+
+		for (run = 0; run < count && run <= ring->mask; run++) {
+			if (__atomic_load_n(&(ring->cells[(position + run) & ring->mask].sequence), __ATOMIC_ACQUIRE) != position + run + 1) {
+				break;
+			}
+		}
+
+		if (run) {
+			if (__atomic_compare_exchange_n(&(ring->dequeue), &position, position + run, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		}
+		else if ((difference = (int64_t)(__atomic_load_n(&(ring->cells[position & ring->mask].sequence), __ATOMIC_ACQUIRE) - (position + 1))) < 0) {
+			return 0;
+		}
+		else if (difference > 0) {
+			position = __atomic_load_n(&(ring->dequeue), __ATOMIC_RELAXED);
+		}
+	}
+
+	// Stamping each cell with the position it will hold on the next lap hands it back to the producers.
+	for (uint64_t i = 0; i < run; i++) {
+		data[i] = ring->cells[(position + i) & ring->mask].data;
+		__atomic_store_n(&(ring->cells[(position + i) & ring->mask].sequence), position + i + ring->mask + 1, __ATOMIC_RELEASE);
+	}
+
+	return run;
+}
+
+/**
+ * @brief	Push entries onto the end of an unbounded stacked list.
+ * @note	A run of cells is claimed using a single atomic increment, and the entries are stored into those cells in order.
+ * 			If a consumer already gave up on one of the cells, the entry moves on to the next cell in the run, so the entries
+ * 			always come back out in the order they were pushed.
+ * @param	stack	a pointer to the stacked list to be updated.
+ * @param	data	an array of entries to be added, in order.
+ * @param	count	the number of entries in the array.
+ * @return	the number of entries added, which is less than count if a new block was needed and couldn't be allocated.
+ */
+uint64_t stacker_segment_push(stacker_t *stack, void **data, uint64_t count) {
+
+	void *expected;
+	bool_t failed = false;
+	uint64_t position, end, filled, pushed = 0;
+	stacker_segment_t *tail, *current, *next, *segment;
+
+	while (pushed < count && !failed) {
+
+		tail = stacker_segment_enter(&(stack->tail), true);
+		position = __atomic_fetch_add(&(tail->enqueue), count - pushed, __ATOMIC_RELAXED);
+		end = position + (count - pushed);
+
+		for (; position < end && position < MAGMA_CORE_STACKER_SEGMENT; position++) {
+			expected = NULL;
+			if (__atomic_compare_exchange_n(&(tail->cells[position]), &expected, data[pushed], false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+				pushed++;
+			}
+		}
+
+		// If entries are left over and the block is full, either link in a new block, or help the thread which already did.
+		// Otherwise consumers claimed some of the cells first, and another run is needed.
+		if (pushed < count && position >= MAGMA_CORE_STACKER_SEGMENT && tail == __atomic_load_n((stacker_segment_t **)&(stack->tail),
+			__ATOMIC_ACQUIRE)) {
+
+			// The tail pointer is copied, since a failed compare and swap would overwrite the block this thread registered on.
+			current = tail;
+
+			if ((next = __atomic_load_n(&(tail->next), __ATOMIC_ACQUIRE))) {
+				__atomic_compare_exchange_n((stacker_segment_t **)&(stack->tail), &current, next, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+			}
+			else if (!(segment = stacker_segment_alloc(stack, data + pushed, count - pushed))) {
+				failed = true;
+			}
+			else {
+
+				// Once the block is published other producers may start claiming cells, so the number of entries it was
+				// seeded with has to be recorded first.
+				next = NULL;
+				filled = segment->enqueue;
+
+				if (__atomic_compare_exchange_n(&(tail->next), &next, segment, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+					__atomic_compare_exchange_n((stacker_segment_t **)&(stack->tail), &current, segment, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+					pushed += filled;
+				}
+				// Another thread linked in a block first. This block was never published, so it can go straight onto the
+				// recycle list.
+				else {
+					stacker_segment_recycle(stack, segment);
+				}
+			}
+		}
+
+		stacker_segment_leave(tail, true);
+	}
+
+	return pushed;
+}
+
+/**
+ * @brief	Pop entries off the front of an unbounded stacked list.
+ * @note	The number of entries available in the first block is checked, so a run of cells can be claimed using a single
+ * 			atomic increment without claiming cells that producers haven't reached yet. A drained block is only unlinked
+ * 			once the tail has moved past it, so a producer can never find a recycled block at the end of the list.
+ * @param	stack	a pointer to the stacked list to be updated.
+ * @param	data	an array which will receive the entries, in order.
+ * @param	count	the maximum number of entries to be removed.
+ * @return	the number of entries removed, which is zero if the list is empty.
+ */
+uint64_t stacker_segment_pop(stacker_t *stack, void **data, uint64_t count) {
+
+	void *entry;
+	bool_t drained = false;
+	stacker_segment_t *head, *current, *next, *retired;
+	uint64_t position, end, enqueue, run, popped = 0;
+
+	while (popped < count && !drained) {
+
+		retired = NULL;
+		head = stacker_segment_enter(&(stack->head), false);
+		position = __atomic_load_n(&(head->dequeue), __ATOMIC_RELAXED);
+		enqueue = __atomic_load_n(&(head->enqueue), __ATOMIC_ACQUIRE);
+		enqueue = enqueue < MAGMA_CORE_STACKER_SEGMENT ? enqueue : MAGMA_CORE_STACKER_SEGMENT;
+
+		if (position < enqueue) {
+
+			run = (enqueue - position) < (count - popped) ? enqueue - position : count - popped;
+			position = __atomic_fetch_add(&(head->dequeue), run, __ATOMIC_RELAXED);
+			end = position + run;
+
+			// A NULL cell means the producer which claimed it hasn't stored its entry yet, and will have to try again.
+			for (; position < end && position < MAGMA_CORE_STACKER_SEGMENT; position++) {
+				if ((entry = __atomic_exchange_n(&(head->cells[position]), &stacker_taken, __ATOMIC_ACQUIRE))) {
+					data[popped++] = entry;
+				}
+			}
+		}
+
+		// The block has been drained, so move on to the next one, or stop if this is the last block.
+		else if (position < MAGMA_CORE_STACKER_SEGMENT || !(next = __atomic_load_n(&(head->next), __ATOMIC_ACQUIRE))) {
+			drained = true;
+		}
+		else {
+
+			// The head pointer is copied, since a failed compare and swap would overwrite the block this thread registered on.
+			current = head;
+			__atomic_compare_exchange_n((stacker_segment_t **)&(stack->tail), &current, next, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+
+			current = head;
+			if (__atomic_compare_exchange_n((stacker_segment_t **)&(stack->head), &current, next, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+				retired = head;
+			}
+		}
+
+		stacker_segment_leave(head, false);
+
+		if (retired) {
+			stacker_segment_recycle(stack, retired);
+		}
+	}
+
+	return popped;
+}
+
+/**
+ * @brief	Wake any threads waiting for entries to be pushed onto a stacked list.
+ * @note	The waiter count is incremented before a waiting thread checks the list one last time, and it's only read here
+ * 			after the entries have been published, so either the waiting thread finds the entries, or it's woken up.
+ * @param	stack	a pointer to the stacked list which received the entries.
+ * @param	count	the number of entries which were pushed.
+ * @return	This function returns no value.
+ */
+void stacker_wake(stacker_t *stack, uint64_t count) {
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&(stack->waiters), __ATOMIC_RELAXED)) {
+		mutex_lock(&(stack->mutex));
+		if (count > 1) {
+			pthread_cond_broadcast(&(stack->signal));
+		}
+		else {
+			pthread_cond_signal(&(stack->signal));
+		}
+		mutex_unlock(&(stack->mutex));
+	}
+
+	return;
+}
+
+/**
+ * @brief	Initialize the synchronization primitives used by a stacked list to wake waiting threads.
+ * @note	The condition uses the monotonic clock, so timeouts aren't affected by changes to the system time.
+ * @param	stack	a pointer to the stacked list being initialized.
+ * @return	true on success, or false on failure.
+ */
+bool_t stacker_signal_init(stacker_t *stack) {
+
+	pthread_condattr_t attributes;
+
+	if (mutex_init(&(stack->mutex), NULL) != 0) {
+		log_pedantic("Unable to initialize the mutex.");
+		return false;
+	}
+	else if (pthread_condattr_init(&attributes) != 0) {
+		log_pedantic("Unable to initialize the condition attributes.");
+		mutex_destroy(&(stack->mutex));
+		return false;
+	}
+	else if (pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC) != 0 || pthread_cond_init(&(stack->signal), &attributes) != 0) {
+		log_pedantic("Unable to initialize the condition.");
+		pthread_condattr_destroy(&attributes);
+		mutex_destroy(&(stack->mutex));
+		return false;
+	}
+
+	pthread_condattr_destroy(&attributes);
+
+	return true;
+}
+
 /**
  * @brief	Free a stacked list and all of its underlying data nodes.
+ * @note	No other thread may be using, or waiting on, the list.
  * @param	stack	a pointer to the stacked list to be freed.
  * @return	This function returns no value.
  */
 void stacker_free(stacker_t *stack) {
 
-	stacker_node_t *holder, *node;
+	void *data;
+	stacker_segment_t *segment;
 
 	if (stack == NULL) {
 		return;
 	}
-	else {
-		node = stack->list;
-	}
 
 	// Iterate through and free.
-	while (node != NULL) {
+	while ((data = stacker_pop(stack))) {
 		if (stack->free_function != NULL) {
-			stack->free_function(node->data);
+			stack->free_function(data);
+		}
+	}
+
+	if (stack->ring) {
+		mm_free(stack->ring);
+	}
+	else {
+
+		while ((segment = stack->head)) {
+			stack->head = segment->next;
+			mm_free(segment);
+		}
+
+		while ((segment = stack->spare)) {
+			stack->spare = segment->recycled;
+			mm_free(segment);
 		}
-		holder = node;
-		node = (stacker_node_t *)node->next;
-		mm_free(holder);
 	}
 
+	pthread_cond_destroy(&(stack->signal));
 	mutex_destroy(&(stack->mutex));
 	mm_free(stack);
 	return;
 }
 
 /**
- * @brief	Allocate a new instance of a stacked list.
+ * @brief	Allocate a new instance of an unbounded stacked list.
  * @param	free_function	if not NULL, a pointer to a function that will be used to free the data underlying each node in the stacked list.
  * @return	NULL on failure, or a pointer to the newly created stack list on success.
  */
@@ -51,114 +497,252 @@ stacker_t * stacker_alloc(void *free_function) {
 		log_pedantic("Unable to allocate %zu bytes for a stacked list.", sizeof(stacker_t));
 		return NULL;
 	}
+	else if (!stacker_signal_init(result)) {
+		mm_free(result);
+		return NULL;
+	}
 
-	// Initialize the mutex.
-	if (mutex_init(&(result->mutex), NULL) != 0) {
-		log_pedantic("Unable to initialize the mutex.");
+	// Start with an empty block.
+	if (!(result->head = result->tail = stacker_segment_alloc(result, NULL, 0))) {
+		pthread_cond_destroy(&(result->signal));
+		mutex_destroy(&(result->mutex));
 		mm_free(result);
 		return NULL;
 	}
 
 	// Store the free memory function pointer.
-	else if (free_function != NULL) {
-		result->free_function = free_function;
+	result->free_function = free_function;
+
+	return result;
+}
+
+/**
+ * @brief	Allocate a new instance of a stacked list which holds a fixed number of entries.
+ * @param	capacity		the number of entries the stacked list can hold, which is rounded up to a power of two.
+ * @param	free_function	if not NULL, a pointer to a function that will be used to free the data underlying each node in the stacked list.
+ * @return	NULL on failure, or a pointer to the newly created stack list on success.
+ */
+stacker_t * stacker_alloc_bounded(uint64_t capacity, void *free_function) {
+
+	size_t length;
+	stacker_t *result;
+	stacker_ring_t *ring;
+	uint64_t slots = 2;
+
+	if (!capacity || capacity > (UINT32_MAX + 1ull)) {
+		log_pedantic("Invalid stacked list capacity. { capacity = %lu }", capacity);
+		return NULL;
+	}
+
+	while (slots < capacity) {
+		slots *= 2;
+	}
+
+	length = sizeof(stacker_ring_t) + (sizeof(stacker_cell_t) * slots);
+
+	if ((result = mm_alloc(sizeof(stacker_t))) == NULL) {
+		log_pedantic("Unable to allocate %zu bytes for a stacked list.", sizeof(stacker_t));
+		return NULL;
+	}
+	else if (!(ring = mm_alloc(length))) {
+		log_pedantic("Unable to allocate %zu bytes for a stacked list ring.", length);
+		mm_free(result);
+		return NULL;
+	}
+	else if (!stacker_signal_init(result)) {
+		mm_free(ring);
+		mm_free(result);
+		return NULL;
+	}
+
+	// Each cell starts out ready for the producer which claims its position on the first lap.
+	for (uint64_t i = 0; i < slots; i++) {
+		ring->cells[i].sequence = i;
 	}
 
+	ring->mask = slots - 1;
+	result->ring = ring;
+	result->capacity = slots;
+	result->free_function = free_function;
+
 	return result;
 }
 
 /**
  * @brief	Get the number of nodes in a stacked list.
+ * @note	The count is only a snapshot, since other threads may be pushing and popping entries while it's being taken. Blocks
+ * 			are never freed while the list is in use, so the chain can be walked without registering on each block.
  * @param	stack	a pointer to the stacked list to be queried.
  * @return	the number of nodes currently held by the specified stacked list.
  */
 uint64_t stacker_nodes(stacker_t *stack) {
 
-	uint64_t result;
+	uint64_t result = 0, enqueue, dequeue;
+	stacker_ring_t *ring;
+	stacker_segment_t *segment;
 
 	if (stack == NULL) {
 		return 0;
 	}
+	else if ((ring = stack->ring)) {
+		dequeue = __atomic_load_n(&(ring->dequeue), __ATOMIC_ACQUIRE);
+		enqueue = __atomic_load_n(&(ring->enqueue), __ATOMIC_ACQUIRE);
+		return enqueue > dequeue ? enqueue - dequeue : 0;
+	}
+
+	for (segment = __atomic_load_n((stacker_segment_t **)&(stack->head), __ATOMIC_ACQUIRE); segment;
+		segment = __atomic_load_n(&(segment->next), __ATOMIC_ACQUIRE)) {
+
+		dequeue = __atomic_load_n(&(segment->dequeue), __ATOMIC_ACQUIRE);
+		enqueue = __atomic_load_n(&(segment->enqueue), __ATOMIC_ACQUIRE);
+		dequeue = dequeue > MAGMA_CORE_STACKER_SEGMENT ? MAGMA_CORE_STACKER_SEGMENT : dequeue;
+		enqueue = enqueue > MAGMA_CORE_STACKER_SEGMENT ? MAGMA_CORE_STACKER_SEGMENT : enqueue;
+		result += enqueue > dequeue ? enqueue - dequeue : 0;
+	}
 
-	mutex_lock(&(stack->mutex));
-	result = stack->items;
-	mutex_unlock(&(stack->mutex));
 	return result;
 }
 
 /**
- * @brief	Push a new entry onto the end of a stacked list.
+ * @brief	Push a batch of entries onto the end of a stacked list.
+ * @note	The batch is handed off using a single synchronization event in the common case, and any threads waiting on the
+ * 			list are woken once, after the entire batch has been added.
  * @param	stack	a pointer to the stacked list to be updated.
- * @param	data	a pointer to the data to associated with the new stacked list node.
- * @return	0 on failure or 1 on success.
+ * @param	data	an array of entries to be added, in order; none of the entries may be NULL.
+ * @param	count	the number of entries in the array.
+ * @return	the number of entries added, which is less than count if a bounded list fills up, or memory is exhausted.
  */
-// QUESTION: Shouldn't this return a boolean value?
-int_t stacker_push(stacker_t *stack, void *data) {
+uint64_t stacker_push_many(stacker_t *stack, void **data, uint64_t count) {
 
-	stacker_node_t *holder, *node;
+	uint64_t result;
 
 	if (stack == NULL || data == NULL) {
 		log_pedantic("Passed a NULL pointer.");
 		return 0;
 	}
-	else if ((node = mm_alloc(sizeof(stacker_node_t))) == NULL) {
-		log_pedantic("Unable to allocate %zu bytes for a linked node.", sizeof(stacker_node_t));
+	else if (!count) {
 		return 0;
 	}
 
-	// Store the data pointer.
-	node->data = data;
+#ifdef MAGMA_PEDANTIC
+	for (uint64_t i = 0; i < count; i++) {
+		if (!data[i]) {
+			log_pedantic("Passed a NULL entry. { entry = %lu }", i);
+			return 0;
+		}
+	}
+#endif
 
-	mutex_lock(&(stack->mutex));
+	if ((result = stack->ring ? stacker_ring_push(stack->ring, data, count) : stacker_segment_push(stack, data, count))) {
+		stacker_wake(stack, result);
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Push a new entry onto the end of a stacked list.
+ * @param	stack	a pointer to the stacked list to be updated.
+ * @param	data	a pointer to the data to associated with the new stacked list node.
+ * @return	0 on failure, which includes a bounded list being full, or 1 on success.
+ */
+// QUESTION: Shouldn't this return a boolean value?
+int_t stacker_push(stacker_t *stack, void *data) {
 
-	if (stack->list == NULL) {
-		stack->last = stack->list = node;
+	if (stack == NULL || data == NULL) {
+		log_pedantic("Passed a NULL pointer.");
+		return 0;
 	}
-	else if (stack->last != NULL) {
-		stack->last->next = (struct stacker_node_t *)node;
-		stack->last = node;
+
+	return stacker_push_many(stack, &data, 1) ? 1 : 0;
+}
+
+/**
+ * @brief	Pop a batch of entries off the front of a stacked list.
+ * @param	stack	a pointer to the stacked list to be updated.
+ * @param	data	an array which will receive the entries, in order.
+ * @param	count	the maximum number of entries to be removed.
+ * @return	the number of entries removed, which is zero if the list is empty.
+ */
+uint64_t stacker_pop_many(stacker_t *stack, void **data, uint64_t count) {
+
+	if (stack == NULL || data == NULL || !count) {
+		return 0;
 	}
-	else {
-		log_error("Last was NULL, but the list pointer wasn't. Finding the end the old fashioned way.");
-		holder = stack->list;
-		while (holder->next != NULL) {
-			holder = (stacker_node_t *)holder->next;
-		}
-		stack->last = node;
-		holder->next = (struct stacker_node_t *)node;
+	else if (stack->ring) {
+		return stacker_ring_pop(stack->ring, data, count);
 	}
-	stack->items++;
-	mutex_unlock(&(stack->mutex));
 
-	return 1;
+	return stacker_segment_pop(stack, data, count);
 }
 
 /**
- * @brief	Pop the last entry off a stacked list.
+ * @brief	Pop the first entry off a stacked list.
  * @param	stack	a pointer to the stacked list to be queried.
- * @return	NULL on failure or the value of the last node in the stacked list.
+ * @return	NULL on failure or if the list is empty, or the value of the first node in the stacked list.
  */
 void * stacker_pop(stacker_t *stack) {
 
 	void *result = NULL;
-	stacker_node_t *node;
+
+	if (!stacker_pop_many(stack, &result, 1)) {
+		return NULL;
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Pop the first entry off a stacked list, waiting for one to be pushed if the list is empty.
+ * @note	Waiting threads sleep on a condition, so they don't consume any processor time while the list is empty.
+ * @param	stack	a pointer to the stacked list to be queried.
+ * @param	timeout	the maximum number of milliseconds to wait for an entry, or zero to wait indefinitely.
+ * @return	NULL on failure or if the timeout expired, or the value of the first node in the stacked list.
+ */
+void * stacker_pop_wait(stacker_t *stack, uint32_t timeout) {
+
+	void *result;
+	struct timespec deadline;
 
 	if (stack == NULL) {
 		return NULL;
 	}
+	else if ((result = stacker_pop(stack))) {
+		return result;
+	}
+
+	if (timeout) {
+
+		if (clock_gettime(CLOCK_MONOTONIC, &deadline)) {
+			return NULL;
+		}
+
+		deadline.tv_sec += timeout / 1000;
+		deadline.tv_nsec += (timeout % 1000) * 1000000;
+
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+	}
 
+	__atomic_add_fetch(&(stack->waiters), 1, __ATOMIC_SEQ_CST);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
 	mutex_lock(&(stack->mutex));
-	if (stack->list != NULL) {
-		node = stack->list;
-		stack->list = (stacker_node_t *)node->next;
-		if (stack->list == NULL) {
-			stack->last = NULL;
+
+	// The list is checked again after announcing the wait, since the entry may have been pushed in the meantime.
+	while (!(result = stacker_pop(stack))) {
+		if (timeout && pthread_cond_timedwait(&(stack->signal), &(stack->mutex), &deadline) == ETIMEDOUT) {
+			result = stacker_pop(stack);
+			break;
+		}
+		else if (!timeout) {
+			pthread_cond_wait(&(stack->signal), &(stack->mutex));
 		}
-		result = node->data;
-		mm_free(node);
-		stack->items--;
 	}
+
 	mutex_unlock(&(stack->mutex));
+	__atomic_sub_fetch(&(stack->waiters), 1, __ATOMIC_RELAXED);
 
 	return result;
 }
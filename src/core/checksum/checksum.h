@@ -29,6 +29,8 @@ uint64_t crc64_update(void *buffer, size_t length, uint64_t crc);
 uint32_t hash_adler32(void *buffer, size_t length);
 uint32_t hash_murmur32(void *buffer, size_t length);
 uint64_t hash_murmur64(void *buffer, size_t length);
+uint64_t hash_murmur64_seed(void *buffer, size_t length, uint64_t seed);
 uint32_t hash_fletcher32(void *buffer, size_t length);
+uint64_t hash_wyhash64(void *buffer, size_t length, uint64_t seed);
 
 #endif
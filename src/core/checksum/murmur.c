@@ -70,11 +70,22 @@ uint32_t hash_murmur32(void *buffer, size_t length) {
  * @return	the 64-bit value of the Murmur hash of the specified block of data.
  */
 uint64_t hash_murmur64(void *buffer, size_t length) {
+	return hash_murmur64_seed(buffer, length, 0);
+}
+
+/**
+ * @brief	Generate a seeded 64-bit Murmur hash of a block of data.
+ * @param	buffer	a pointer to the block of data to be hashed.
+ * @param	length	the length, in bytes, of the block of data to be hashed.
+ * @param	seed	the 64-bit seed value used to initialize the hash state.
+ * @return	the 64-bit value of the Murmur hash of the specified block of data.
+ */
+uint64_t hash_murmur64_seed(void *buffer, size_t length, uint64_t seed) {
 
 	unsigned char *c;
 	const int32_t r = 47;
 	const uint64_t m = 0xc6a4a7935bd1e995;
-	uint64_t k, h = (length * m), *data = buffer, *end = data + (length/8);
+	uint64_t k, h = seed ^ (length * m), *data = buffer, *end = data + (length/8);
 
 	while (data != end) {
 		k = *data++;
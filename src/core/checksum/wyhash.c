@@ -0,0 +1,106 @@
+/**
+ * @file /magma/core/checksum/wyhash.c
+ *
+ * @brief	An x64 implementation of the seeded wyhash function.
+ *
+ * @note	Based on the public domain final version 4 reference implementation by Wang Yi. Input is consumed in 48 byte
+ * 			rounds split across three independent lanes, with each lane folded together using a 64x64->128 bit multiply.
+ */
+
+#include "magma.h"
+
+static const uint64_t wyhash_secret[4] = { 0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL };
+
+static inline void wyhash_multiply(uint64_t *a, uint64_t *b) {
+
+	__uint128_t result = *a;
+
+	result *= *b;
+	*a = (uint64_t)result;
+	*b = (uint64_t)(result >> 64);
+
+	return;
+}
+
+static inline uint64_t wyhash_mix(uint64_t a, uint64_t b) {
+	wyhash_multiply(&a, &b);
+	return a ^ b;
+}
+
+static inline uint64_t wyhash_read64(const uchr_t *p) {
+
+	uint64_t result;
+
+	memcpy(&result, p, sizeof(uint64_t));
+	return result;
+}
+
+static inline uint64_t wyhash_read32(const uchr_t *p) {
+
+	uint32_t result;
+
+	memcpy(&result, p, sizeof(uint32_t));
+	return result;
+}
+
+/**
+ * @brief	Generate a seeded 64-bit wyhash of a block of data.
+ * @note	Unlike the Murmur and Fletcher functions, the output for a given input can't be predicted without knowing the
+ * 			seed, which makes this function suitable for hash tables that are keyed by untrusted input.
+ * @param	buffer	a pointer to the block of data to be hashed.
+ * @param	length	the length, in bytes, of the block of data to be hashed.
+ * @param	seed	the 64-bit seed value used to key the hash.
+ * @return	the 64-bit value of the wyhash of the specified block of data.
+ */
+uint64_t hash_wyhash64(void *buffer, size_t length, uint64_t seed) {
+
+	uint64_t a, b, left, right;
+	size_t remaining = length;
+	const uchr_t *data = buffer;
+
+	seed ^= wyhash_mix(seed ^ wyhash_secret[0], wyhash_secret[1]);
+
+	if (length <= 16) {
+		if (length >= 4) {
+			a = (wyhash_read32(data) << 32) | wyhash_read32(data + ((length >> 3) << 2));
+			b = (wyhash_read32(data + length - 4) << 32) | wyhash_read32(data + length - 4 - ((length >> 3) << 2));
+		}
+		else if (length > 0) {
+			a = ((uint64_t)data[0] << 16) | ((uint64_t)data[length >> 1] << 8) | data[length - 1];
+			b = 0;
+		}
+		else {
+			a = b = 0;
+		}
+	}
+	else {
+
+		// Process the bulk of the input using three independent lanes, so the multiplies can be pipelined.
+		if (remaining > 48) {
+			left = right = seed;
+			do {
+				seed = wyhash_mix(wyhash_read64(data) ^ wyhash_secret[1], wyhash_read64(data + 8) ^ seed);
+				left = wyhash_mix(wyhash_read64(data + 16) ^ wyhash_secret[2], wyhash_read64(data + 24) ^ left);
+				right = wyhash_mix(wyhash_read64(data + 32) ^ wyhash_secret[3], wyhash_read64(data + 40) ^ right);
+				data += 48;
+				remaining -= 48;
+			} while (remaining > 48);
+			seed ^= left ^ right;
+		}
+
+		while (remaining > 16) {
+			seed = wyhash_mix(wyhash_read64(data) ^ wyhash_secret[1], wyhash_read64(data + 8) ^ seed);
+			data += 16;
+			remaining -= 16;
+		}
+
+		a = wyhash_read64(data + remaining - 16);
+		b = wyhash_read64(data + remaining - 8);
+	}
+
+	a ^= wyhash_secret[1];
+	b ^= seed;
+	wyhash_multiply(&a, &b);
+
+	return wyhash_mix(a ^ wyhash_secret[0] ^ length, b ^ wyhash_secret[1]);
+}
@@ -7,6 +7,28 @@
 
 #include "magma.h"
 
+/**
+ * The classes of every byte value, as a mask of M_CHR_CLASS values. Bytes above 0x7f don't belong to any class.
+ */
+const uint16_t chr_classes[256] = {
+	0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x381, 0x301, 0x301, 0x101, 0x301, 0x001, 0x001, // 0x00
+	0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001, 0x001, // 0x10
+	0x383, 0x043, 0x043, 0x043, 0x043, 0x043, 0x043, 0x043, 0x043, 0x043, 0x043, 0x043, 0x043, 0x043, 0x043, 0x043, // 0x20
+	0x027, 0x027, 0x027, 0x027, 0x027, 0x027, 0x027, 0x027, 0x027, 0x027, 0x043, 0x043, 0x043, 0x043, 0x043, 0x043, // 0x30
+	0x043, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, // 0x40
+	0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x017, 0x043, 0x043, 0x043, 0x043, 0x043, // 0x50
+	0x043, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, // 0x60
+	0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x00f, 0x043, 0x043, 0x043, 0x043, 0x001, // 0x70
+	0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, // 0x80
+	0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, // 0x90
+	0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, // 0xa0
+	0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, // 0xb0
+	0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, // 0xc0
+	0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, // 0xd0
+	0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, // 0xe0
+	0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000, 0x000 // 0xf0
+};
+
 /**
  * @brief	Determine whether a specified character is an ASCII character.
  * @param	c	the character to be verified.
@@ -14,11 +36,7 @@
  */
 bool_t chr_ascii(uchr_t c) {
 
-	if (c < 128) {
-		return true;
-	}
-
-	return false;
+	return (chr_classes[c] & M_CHR_ASCII) != 0;
 }
 
 /**
@@ -28,11 +46,7 @@ bool_t chr_ascii(uchr_t c) {
  */
 bool_t chr_printable(uchr_t c) {
 
-	if (c >= ' ' && c <= '~') {
-		return true;
-	}
-
-	return false;
+	return (chr_classes[c] & M_CHR_PRINTABLE) != 0;
 }
 
 /**
@@ -42,11 +56,7 @@ bool_t chr_printable(uchr_t c) {
  */
 bool_t chr_alphanumeric(uchr_t c) {
 
-	if ((c >= 'A' && c <= 'Z') ||	(c >= 'a' && c <= 'z') ||	(c >= '0' && c <= '9')) {
-		return true;
-	}
-
-	return false;
+	return (chr_classes[c] & M_CHR_ALPHANUMERIC) != 0;
 }
 
 /**
@@ -56,11 +66,7 @@ bool_t chr_alphanumeric(uchr_t c) {
  */
 bool_t chr_lower(uchr_t c) {
 
-	if (c >= 'a' && c <= 'z') {
-		return true;
-	}
-
-	return false;
+	return (chr_classes[c] & M_CHR_LOWER) != 0;
 }
 
 /**
@@ -70,11 +76,7 @@ bool_t chr_lower(uchr_t c) {
  */
 bool_t chr_upper(uchr_t c) {
 
-	if (c >= 'A' && c <= 'Z') {
-		return true;
-	}
-
-	return false;
+	return (chr_classes[c] & M_CHR_UPPER) != 0;
 }
 
 /**
@@ -84,11 +86,7 @@ bool_t chr_upper(uchr_t c) {
  */
 bool_t chr_numeric(uchr_t c) {
 
-	if (c >= '0' && c <= '9') {
-		return true;
-	}
-
-	return false;
+	return (chr_classes[c] & M_CHR_NUMERIC) != 0;
 }
 
 /**
@@ -98,11 +96,7 @@ bool_t chr_numeric(uchr_t c) {
  */
 bool_t chr_punctuation(uchr_t c) {
 
-	if ((c >= '!' && c <= '/') || (c >= ':' && c <= '@') || (c >= '[' && c <= '`') || (c >= '{' && c <= '~')) {
-		return true;
-	}
-
-	return false;
+	return (chr_classes[c] & M_CHR_PUNCTUATION) != 0;
 }
 
 /**
@@ -112,11 +106,7 @@ bool_t chr_punctuation(uchr_t c) {
  */
 bool_t chr_blank(uchr_t c) {
 
-	if (c == ' ' || c == '\t') {
-		return true;
-	}
-
-	return false;
+	return (chr_classes[c] & M_CHR_BLANK) != 0;
 }
 
 /**
@@ -126,11 +116,7 @@ bool_t chr_blank(uchr_t c) {
  */
 bool_t chr_whitespace(uchr_t c) {
 
-	if (c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r' || c == '\n') {
-		return true;
-	}
-
-	return false;
+	return (chr_classes[c] & M_CHR_WHITESPACE) != 0;
 }
 
 /**
@@ -142,13 +128,246 @@ bool_t chr_whitespace(uchr_t c) {
  */
 bool_t chr_is_class(uchr_t c, uchr_t *chrs, size_t chrlen) {
 
+	// The C library search is vectorized, which beats comparing the character against each member of the set in turn.
+	return chrlen && memchr(chrs, c, chrlen);
+}
+
+/**
+ * @brief	Add a character to a custom character set.
+ * @param	set		the character set being updated.
+ * @param	c		the character being added.
+ * @return	This function returns no value.
+ */
+void chr_set_add(chr_set_t *set, uchr_t c) {
+
+	set->bits[c >> 6] |= 1ULL << (c & 63);
+
+	// The nibble tables hold a row for each low nibble, with a bit for each high nibble, which is what the vector kernels
+	// use to test sixteen bytes at a time.
+	if (c < 0x80) set->low[c & 0x0f] |= 1 << (c >> 4);
+	else set->high[c & 0x0f] |= 1 << ((c >> 4) & 7);
+
+	return;
+}
+
+/**
+ * @brief	Initialize a character set, so it holds a custom collection of characters.
+ * @param	set		the character set being initialized.
+ * @param	chrs	a pointer to a buffer containing the characters in the set.
+ * @param	chrlen	the number of characters in the buffer.
+ * @return	This function returns no value.
+ */
+void chr_set_chars(chr_set_t *set, uchr_t *chrs, size_t chrlen) {
+
+	mm_wipe(set, sizeof(chr_set_t));
+
 	for (size_t i = 0; i < chrlen; i++) {
+		chr_set_add(set, chrs[i]);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Initialize a character set, so it holds every character which belongs to any of the specified classes.
+ * @param	set		the character set being initialized.
+ * @param	classes	a mask of M_CHR_CLASS values.
+ * @return	This function returns no value.
+ */
+void chr_set_class(chr_set_t *set, uint16_t classes) {
+
+	mm_wipe(set, sizeof(chr_set_t));
+
+	for (uint_t c = 0; c < 256; c++) {
+		if (chr_classes[c] & classes) chr_set_add(set, c);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Determine whether a character belongs to a character set.
+ * @param	set		the character set.
+ * @param	c		the character to be verified.
+ * @return	true if the character is in the set, or false otherwise.
+ */
+bool_t chr_set_member(chr_set_t *set, uchr_t c) {
+
+	return (set->bits[c >> 6] >> (c & 63)) & 1;
+}
+
+/**
+ * @brief	Measure the span at the start of a buffer where every byte belongs to one of the specified classes, or where none
+ * 			of the bytes do.
+ * @note	The bytes are checked one at a time against the class table, which is the fastest approach for the short spans
+ * 			found while trimming and tokenizing. Longer spans should use a character set with chr_span().
+ * @param	block	a pointer to the buffer being scanned.
+ * @param	len		the length, in bytes, of the buffer.
+ * @param	classes	a mask of M_CHR_CLASS values.
+ * @param	member	if true, the span ends at the first byte outside the classes, otherwise it ends at the first byte inside them.
+ * @return	the length of the span, which will be len if the span covers the entire buffer.
+ */
+size_t chr_span_class(const uchr_t *block, size_t len, uint16_t classes, bool_t member) {
+
+	size_t i = 0;
+
+	for (; i < len && ((chr_classes[block[i]] & classes) != 0) == member; i++);
+	return i;
+}
 
-		if (c == chrs[i]) {
-			return true;
+/**
+ * @brief	Measure the span at the end of a buffer where every byte belongs to one of the specified classes, or where none of
+ * 			the bytes do.
+ * @see		chr_span_class()
+ * @return	the length of the span, which will be len if the span covers the entire buffer.
+ */
+size_t chr_span_class_reverse(const uchr_t *block, size_t len, uint16_t classes, bool_t member) {
+
+	size_t i = 0;
+
+	for (; i < len && ((chr_classes[block[len - i - 1]] & classes) != 0) == member; i++);
+	return i;
+}
+
+/**
+ * @brief	Measure the span at the start of a buffer where every byte is in a character set, or where none of the bytes are,
+ * 			one byte at a time.
+ * @param	block	a pointer to the buffer being scanned.
+ * @param	len		the length, in bytes, of the buffer.
+ * @param	set		the character set.
+ * @param	member	if true, the span ends at the first byte outside the set, otherwise it ends at the first byte inside it.
+ * @return	the length of the span, which will be len if the span covers the entire buffer.
+ */
+size_t chr_span_scalar(const uchr_t *block, size_t len, chr_set_t *set, bool_t member) {
+
+	size_t i = 0;
+
+	for (; i < len && chr_set_member(set, block[i]) == member; i++);
+	return i;
+}
+
+/**
+ * @brief	Measure the span at the end of a buffer where every byte is in a character set, or where none of the bytes are,
+ * 			one byte at a time.
+ * @see		chr_span_scalar()
+ */
+size_t chr_span_reverse_scalar(const uchr_t *block, size_t len, chr_set_t *set, bool_t member) {
+
+	size_t i = 0;
+
+	for (; i < len && chr_set_member(set, block[len - i - 1]) == member; i++);
+	return i;
+}
+
+#ifdef __SSE2__
+/**
+ * @brief	Test sixteen bytes for membership in a character set, using SSSE3.
+ * @note	The low nibble of each byte selects a row from the nibble table for its half of the byte range, and the high nibble
+ * 			selects a bit, so any set can be tested with a pair of table lookups.
+ * @param	block	a pointer to the sixteen bytes being tested.
+ * @param	set		the character set.
+ * @return	a mask with a bit set for each byte in the set.
+ */
+__attribute__ ((target ("ssse3"))) uint32_t chr_set_mask_ssse3(const uchr_t *block, chr_set_t *set) {
+
+	__m128i bytes = _mm_loadu_si128((const __m128i *)block), nibble = _mm_set1_epi8(0x0f),
+		bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128),
+		low = _mm_and_si128(bytes, nibble), high = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble),
+		upper = _mm_cmplt_epi8(bytes, _mm_setzero_si128()),
+		rows = _mm_or_si128(_mm_andnot_si128(upper, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)set->low), low)),
+			_mm_and_si128(upper, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)set->high), low))),
+		bit = _mm_shuffle_epi8(bits, high);
+
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(rows, bit), bit));
+}
+
+/**
+ * @brief	Measure the span at the start of a buffer where every byte is in a character set, or where none of the bytes are,
+ * 			sixteen bytes at a time.
+ * @see		chr_span_scalar()
+ */
+__attribute__ ((target ("ssse3"))) size_t chr_span_ssse3(const uchr_t *block, size_t len, chr_set_t *set, bool_t member) {
+
+	size_t i = 0;
+	uint32_t mask;
+
+	for (; i + 16 <= len; i += 16) {
+		if ((mask = (chr_set_mask_ssse3(block + i, set) ^ (member ? 0xffff : 0)))) {
+			return i + __builtin_ctz(mask);
 		}
+	}
+
+	return i + chr_span_scalar(block + i, len - i, set, member);
+}
+
+/**
+ * @brief	Measure the span at the end of a buffer where every byte is in a character set, or where none of the bytes are,
+ * 			sixteen bytes at a time.
+ * @see		chr_span_reverse_scalar()
+ */
+__attribute__ ((target ("ssse3"))) size_t chr_span_reverse_ssse3(const uchr_t *block, size_t len, chr_set_t *set, bool_t member) {
+
+	size_t i = 0;
+	uint32_t mask;
 
+	for (; i + 16 <= len; i += 16) {
+		if ((mask = (chr_set_mask_ssse3(block + len - i - 16, set) ^ (member ? 0xffff : 0)))) {
+			return i + __builtin_clz(mask << 16);
+		}
 	}
 
-	return false;
+	return i + chr_span_reverse_scalar(block, len - i, set, member);
+}
+#endif
+
+/**
+ * @brief	Select the fastest span kernels supported by the processor.
+ * @note	The processor is only queried once, and the result is cached.
+ * @return	a pointer to the span kernels.
+ */
+const chr_kernels_t * chr_kernels(void) {
+
+	static const chr_kernels_t *kernels = NULL;
+	static const chr_kernels_t scalar = { &chr_span_scalar, &chr_span_reverse_scalar };
+#ifdef __SSE2__
+	static const chr_kernels_t ssse3 = { &chr_span_ssse3, &chr_span_reverse_ssse3 };
+#endif
+	const chr_kernels_t *result;
+
+	if ((result = __atomic_load_n(&kernels, __ATOMIC_RELAXED))) {
+		return result;
+	}
+
+#ifdef __SSE2__
+	__builtin_cpu_init();
+	result = __builtin_cpu_supports("ssse3") ? &ssse3 : &scalar;
+#else
+	result = &scalar;
+#endif
+
+	__atomic_store_n(&kernels, result, __ATOMIC_RELAXED);
+	return result;
+}
+
+/**
+ * @brief	Measure the span at the start of a buffer where every byte is in a character set, or where none of the bytes are.
+ * @param	block	a pointer to the buffer being scanned.
+ * @param	len		the length, in bytes, of the buffer.
+ * @param	set		the character set.
+ * @param	member	if true, the span ends at the first byte outside the set, otherwise it ends at the first byte inside it.
+ * @return	the length of the span, which will be len if the span covers the entire buffer.
+ */
+size_t chr_span(const uchr_t *block, size_t len, chr_set_t *set, bool_t member) {
+
+	return chr_kernels()->span(block, len, set, member);
+}
+
+/**
+ * @brief	Measure the span at the end of a buffer where every byte is in a character set, or where none of the bytes are.
+ * @see		chr_span()
+ * @return	the length of the span, which will be len if the span covers the entire buffer.
+ */
+size_t chr_span_reverse(const uchr_t *block, size_t len, chr_set_t *set, bool_t member) {
+
+	return chr_kernels()->rspan(block, len, set, member);
 }
@@ -8,6 +8,31 @@
 #ifndef MAGMA_CORE_CLASSIFY_H
 #define MAGMA_CORE_CLASSIFY_H
 
+typedef enum {
+	M_CHR_ASCII = 1, //!< M_CHR_ASCII
+	M_CHR_PRINTABLE = 2, //!< M_CHR_PRINTABLE
+	M_CHR_ALPHANUMERIC = 4, //!< M_CHR_ALPHANUMERIC
+	M_CHR_LOWER = 8, //!< M_CHR_LOWER
+	M_CHR_UPPER = 16, //!< M_CHR_UPPER
+	M_CHR_NUMERIC = 32, //!< M_CHR_NUMERIC
+	M_CHR_PUNCTUATION = 64, //!< M_CHR_PUNCTUATION
+	M_CHR_BLANK = 128, //!< M_CHR_BLANK
+	M_CHR_WHITESPACE = 256, //!< M_CHR_WHITESPACE
+	M_CHR_TRIM = 512 //!< M_CHR_TRIM
+} M_CHR_CLASS;
+
+typedef struct __attribute__ ((packed)) {
+	uint64_t bits[4]; /* A bit for every byte value in the set. */
+	uchr_t low[16], high[16]; /* For each low nibble, a bit for every high nibble in the set, split between the bytes below and above 0x80. */
+} chr_set_t;
+
+typedef struct {
+	size_t (*span)(const uchr_t *block, size_t len, chr_set_t *set, bool_t member); /* Measures a span from the start of a buffer. */
+	size_t (*rspan)(const uchr_t *block, size_t len, chr_set_t *set, bool_t member); /* Measures a span from the end of a buffer. */
+} chr_kernels_t;
+
+extern const uint16_t chr_classes[256];
+
 /// ascii.c
 bool_t chr_alphanumeric(uchr_t c);
 bool_t chr_ascii(uchr_t c);
@@ -20,5 +45,20 @@ bool_t chr_upper(uchr_t c);
 bool_t chr_whitespace(uchr_t c);
 bool_t chr_is_class(uchr_t c, uchr_t *chrs, size_t chrlen);
 
+const chr_kernels_t *  chr_kernels(void);
+void                   chr_set_add(chr_set_t *set, uchr_t c);
+void                   chr_set_chars(chr_set_t *set, uchr_t *chrs, size_t chrlen);
+void                   chr_set_class(chr_set_t *set, uint16_t classes);
+uint32_t               chr_set_mask_ssse3(const uchr_t *block, chr_set_t *set);
+bool_t                 chr_set_member(chr_set_t *set, uchr_t c);
+size_t                 chr_span(const uchr_t *block, size_t len, chr_set_t *set, bool_t member);
+size_t                 chr_span_class(const uchr_t *block, size_t len, uint16_t classes, bool_t member);
+size_t                 chr_span_class_reverse(const uchr_t *block, size_t len, uint16_t classes, bool_t member);
+size_t                 chr_span_reverse(const uchr_t *block, size_t len, chr_set_t *set, bool_t member);
+size_t                 chr_span_reverse_scalar(const uchr_t *block, size_t len, chr_set_t *set, bool_t member);
+size_t                 chr_span_reverse_ssse3(const uchr_t *block, size_t len, chr_set_t *set, bool_t member);
+size_t                 chr_span_scalar(const uchr_t *block, size_t len, chr_set_t *set, bool_t member);
+size_t                 chr_span_ssse3(const uchr_t *block, size_t len, chr_set_t *set, bool_t member);
+
 #endif
 
@@ -8,6 +8,19 @@
 #ifndef MAGMA_CORE_COMPARE_H
 #define MAGMA_CORE_COMPARE_H
 
+typedef struct needle_t needle_t;
+typedef const uchr_t * (*search_kernel_t)(const uchr_t *h, size_t hlen, const uchr_t *n, size_t nlen, bool_t insensitive);
+
+typedef struct scanner_t scanner_t;
+typedef bool_t (*scan_match_t)(void *context, size_t needle, size_t offset);
+
+typedef struct __attribute__ ((packed)) {
+	scanner_t *scanner; /* The compiled needles the stream is searching for. */
+	uint32_t state; /* The automaton state reached at the end of the previous chunk, as a transition table entry. */
+	size_t offset; /* The number of bytes consumed by the stream so far. */
+	bool_t stopped; /* Set once a callback asks the stream to stop. */
+} scan_stream_t;
+
 /// ends.c
 int_t st_cmp_ci_ends(stringer_t *s, stringer_t *ends);
 int_t st_cmp_cs_ends(stringer_t *s, stringer_t *ends);
@@ -18,10 +31,27 @@ int_t mm_cmp_cs_eq(void *a, void *b, size_t len);
 int_t st_cmp_ci_eq(stringer_t *a, stringer_t *b);
 int_t st_cmp_cs_eq(stringer_t *a, stringer_t *b);
 
+/// scan.c
+int64_t       st_scan(scanner_t *scanner, stringer_t *haystack, scan_match_t callback, void *context);
+int64_t       st_scan_stream(scan_stream_t *stream, stringer_t *chunk, scan_match_t callback, void *context);
+int64_t       st_scan_stream_data(scan_stream_t *stream, const uchr_t *data, size_t len, scan_match_t callback, void *context);
+void          st_scan_stream_init(scan_stream_t *stream, scanner_t *scanner);
+scanner_t *   st_scanner_alloc(size_t count, stringer_t **needles, bool_t insensitive);
+void          st_scanner_free(scanner_t *scanner);
+
 /// search.c
-bool_t st_search_ci(stringer_t *haystack, stringer_t *needle, size_t *location);
-bool_t st_search_cs(stringer_t *haystack, stringer_t *needle, size_t *location);
-bool_t st_search_chr(stringer_t *haystack, chr_t needle, size_t *location);
+needle_t *        st_needle_alloc(stringer_t *needle, bool_t insensitive);
+void              st_needle_free(needle_t *needle);
+bool_t            st_needle_next(needle_t *needle, stringer_t *haystack, size_t from, size_t *location);
+bool_t            st_needle_search(needle_t *needle, stringer_t *haystack, size_t *location);
+bool_t            st_search_ci(stringer_t *haystack, stringer_t *needle, size_t *location);
+bool_t            st_search_cs(stringer_t *haystack, stringer_t *needle, size_t *location);
+bool_t            st_search_chr(stringer_t *haystack, chr_t needle, size_t *location);
+search_kernel_t   st_search_kernel(void);
+const uchr_t *    st_search_kernel_avx2(const uchr_t *h, size_t hlen, const uchr_t *n, size_t nlen, bool_t insensitive);
+const uchr_t *    st_search_kernel_scalar(const uchr_t *h, size_t hlen, const uchr_t *n, size_t nlen, bool_t insensitive);
+const uchr_t *    st_search_kernel_sse2(const uchr_t *h, size_t hlen, const uchr_t *n, size_t nlen, bool_t insensitive);
+bool_t            st_search_verify(const uchr_t *h, const uchr_t *n, size_t len, bool_t insensitive);
 
 /// starts.c
 int_t st_cmp_ci_starts(stringer_t *s, stringer_t *starts);
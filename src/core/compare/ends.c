@@ -62,7 +62,7 @@ int_t st_cmp_ci_ends(stringer_t *s, stringer_t *ends) {
 	bool_t se, ende;
 	int_t result = 0;
 	uchr_t *sptr, *endptr;
-	size_t slen, endlen, check;
+	size_t slen, endlen, check, matched;
 
 	// Setup.
 	se = st_empty_out(s, &sptr, &slen);
@@ -73,19 +73,16 @@ int_t st_cmp_ci_ends(stringer_t *s, stringer_t *ends) {
 	else if (se) return -1;
 	else if (ende) return 1;
 
-	// Were comparing from the end of the buffers, so adjust the pointers accordingly.
-	sptr += (slen - 1);
-	endptr += (endlen - 1);
-
 	// Calculate how many bytes to compare.
 	check = (slen <= endlen ? slen : endlen);
 
-	// Break on the first non matching byte.
-	for (size_t i = 0; result == 0 && i < check; i++) {
-		if (lower_chr(*sptr) < lower_chr(*endptr)) result = -1;
-		else if (lower_chr(*sptr) > lower_chr(*endptr)) result = 1;
-		sptr--;
-		endptr--;
+	// Were comparing from the end of the buffers, so adjust the pointers accordingly.
+	sptr += (slen - check);
+	endptr += (endlen - check);
+
+	// Skip back to the last non matching byte, which the case folding kernels find several bytes at a time.
+	if ((matched = case_kernels()->rmismatch(sptr, endptr, check)) < check) {
+		result = lower_chr(sptr[check - matched - 1]) < lower_chr(endptr[check - matched - 1]) ? -1 : 1;
 	}
 
 	// If the string length is equal/greater and result is still set to 0, we have a match.
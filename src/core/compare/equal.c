@@ -51,6 +51,7 @@ int_t mm_cmp_cs_eq(void *a, void *b, size_t len) {
  */
 int_t mm_cmp_ci_eq(void *a, void *b, size_t len) {
 	bool_t ae, be;
+	size_t mismatch;
 	int_t result = 0;
 	uchr_t *aptr = a, *bptr = b;
 
@@ -65,12 +66,9 @@ int_t mm_cmp_ci_eq(void *a, void *b, size_t len) {
 		return -1;
 	else if (be) return 1;
 
-	// Break on the first non matching byte.
-	for (size_t i = 0; result == 0 && i < len; i++) {
-		if (lower_chr(*aptr) < lower_chr(*bptr)) result = -1;
-		else if (lower_chr(*aptr) > lower_chr(*bptr)) result = 1;
-		aptr++;
-		bptr++;
+	// Skip ahead to the first non matching byte, which the case folding kernels find several bytes at a time.
+	if ((mismatch = case_kernels()->mismatch(aptr, bptr, len)) < len) {
+		result = lower_chr(aptr[mismatch]) < lower_chr(bptr[mismatch]) ? -1 : 1;
 	}
 
 	return result;
@@ -128,7 +126,7 @@ int_t st_cmp_ci_eq(stringer_t *a, stringer_t *b) {
 	bool_t ae, be;
 	int_t result = 0;
 	uchr_t *aptr, *bptr;
-	size_t alen, blen, check;
+	size_t alen, blen, check, mismatch;
 
 	// Setup.
 	ae = st_empty_out(a, &aptr, &alen);
@@ -142,12 +140,9 @@ int_t st_cmp_ci_eq(stringer_t *a, stringer_t *b) {
 	// Calculate how many bytes to compare.
 	check = (alen <= blen ? alen : blen);
 
-	// Break on the first non matching byte.
-	for (size_t i = 0; result == 0 && i < check; i++) {
-		if (lower_chr(*aptr) < lower_chr(*bptr)) result = -1;
-		else if (lower_chr(*aptr) > lower_chr(*bptr)) result = 1;
-		aptr++;
-		bptr++;
+	// Skip ahead to the first non matching byte, which the case folding kernels find several bytes at a time.
+	if ((mismatch = case_kernels()->mismatch(aptr, bptr, check)) < check) {
+		result = lower_chr(aptr[mismatch]) < lower_chr(bptr[mismatch]) ? -1 : 1;
 	}
 
 	// If the strings match, then the longer string is greater
@@ -0,0 +1,345 @@
+
+/**
+ * @file /magma/core/compare/scan.c
+ *
+ * @brief	Functions used to find every occurrence of one or more needles with a single pass, including streams which arrive
+ * 			in chunks.
+ *
+ * @note	The needles are compiled into a deterministic Aho-Corasick automaton, which consumes each byte of the haystack
+ * 			exactly once, no matter how many needles there are. Since the automaton only carries its current state from one byte
+ * 			to the next, a haystack can be fed to it in chunks, and matches which span the boundary between two chunks are still
+ * 			reported, without the caller buffering the message.
+ */
+
+#include "magma.h"
+
+/**
+ * The number of chain segments scanned for each call to st_chain_iovec().
+ */
+#define SCAN_CHAIN_SEGMENTS 32
+
+/**
+ * Set on a transition which leads to a state where at least one needle ends.
+ */
+#define SCAN_EMITS 0x80000000
+
+/**
+ * The compiled form of a set of needles. Bytes which don't appear in any needle share a single class, and when the scanner
+ * is case insensitive, the upper and lower case forms of a letter share a class, so the transition table only needs a column
+ * for each distinct needle byte.
+ */
+struct scanner_t {
+	uint32_t count, states, width;
+	uchr_t classes[256];
+	uint32_t *transitions; /* The next state, indexed by state * width + class. Once compiled, each entry holds the offset of the
+		next state row, with SCAN_EMITS set if a needle ends there. */
+	int32_t *outputs; /* The first needle which ends at each state, or -1 if there isn't one. */
+	uint32_t *links; /* The nearest shorter suffix of each state with an output, or 0 if there isn't one. */
+	int32_t *duplicates; /* The next needle with the same content as each needle, or -1 if there isn't one. */
+	size_t *lengths; /* The length of each needle. */
+};
+
+/**
+ * @brief	Free a compiled set of needles.
+ * @param	scanner	the compiled needles to be freed.
+ * @return	This function returns no value.
+ */
+void st_scanner_free(scanner_t *scanner) {
+
+	if (!scanner) {
+		log_pedantic("Attempted to free a NULL scanner.");
+		return;
+	}
+
+	if (scanner->transitions) mm_free(scanner->transitions);
+	if (scanner->outputs) mm_free(scanner->outputs);
+	if (scanner->links) mm_free(scanner->links);
+	if (scanner->duplicates) mm_free(scanner->duplicates);
+	if (scanner->lengths) mm_free(scanner->lengths);
+
+	mm_free(scanner);
+	return;
+}
+
+/**
+ * @brief	Compile a set of needles, so every occurrence of every needle can be found with a single pass over a haystack.
+ * @note	The needles are copied into the automaton, so they don't need to outlive the scanner. A compiled scanner is never
+ * 			modified by a scan, so it can be shared by any number of threads and streams.
+ * @param	count		the number of needles.
+ * @param	needles		an array of managed strings holding the needles, none of which may be empty.
+ * @param	insensitive	if true, ASCII letters are matched without regard to case.
+ * @return	NULL on failure, or a pointer to the compiled scanner, which must be freed with st_scanner_free().
+ */
+scanner_t * st_scanner_alloc(size_t count, stringer_t **needles, bool_t insensitive) {
+
+	uchr_t *data, c;
+	scanner_t *scanner;
+	uint32_t state, next, *queue = NULL, *failures = NULL, head = 0, tail = 0;
+	size_t total = 1, len;
+
+	if (!count || !needles || count > INT32_MAX) {
+		log_pedantic("Invalid scanner needles.");
+		return NULL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (st_empty_out(needles[i], &data, &len)) {
+			log_pedantic("Scanners can't contain empty needles.");
+			return NULL;
+		}
+		total += len;
+	}
+
+	if (total > INT32_MAX || !(scanner = mm_alloc(sizeof(scanner_t)))) {
+		log_pedantic("Unable to allocate a scanner.");
+		return NULL;
+	}
+
+	scanner->count = count;
+	scanner->width = 1;
+
+	// Assign a class to every byte which appears in a needle. Class zero is shared by the bytes which don't.
+	for (size_t i = 0; i < count; i++) {
+		data = st_data_get(needles[i]);
+		for (size_t j = 0; j < st_length_get(needles[i]); j++) {
+			c = insensitive ? lower_chr(data[j]) : data[j];
+			if (!scanner->classes[c]) scanner->classes[c] = scanner->width++;
+		}
+	}
+
+	if (insensitive) {
+		for (c = 'a'; c <= 'z'; c++) {
+			scanner->classes[c - 32] = scanner->classes[c];
+		}
+	}
+
+	// The transition table rows are addressed with offsets, which need to leave room for the SCAN_EMITS flag.
+	if (total * scanner->width > INT32_MAX) {
+		log_pedantic("The scanner needles are too long. { total = %zu / width = %u }", total, scanner->width);
+		st_scanner_free(scanner);
+		return NULL;
+	}
+
+	if (!(scanner->transitions = mm_alloc(total * scanner->width * sizeof(uint32_t))) ||
+		!(scanner->outputs = mm_alloc(total * sizeof(int32_t))) || !(scanner->links = mm_alloc(total * sizeof(uint32_t))) ||
+		!(scanner->duplicates = mm_alloc(count * sizeof(int32_t))) || !(scanner->lengths = mm_alloc(count * sizeof(size_t)))) {
+		log_pedantic("Unable to allocate a scanner.");
+		st_scanner_free(scanner);
+		return NULL;
+	}
+
+	scanner->states = 1;
+	scanner->outputs[0] = -1;
+
+	// Build a trie from the needles. Since the root is never a child, a zero transition means there isn't a child yet. When
+	// the same needle appears more than once, the copies are chained together, so each one is reported.
+	for (size_t i = 0; i < count; i++) {
+
+		data = st_data_get(needles[i]);
+		len = st_length_get(needles[i]);
+		state = 0;
+
+		for (size_t j = 0; j < len; j++) {
+			c = scanner->classes[data[j]];
+			if (!(next = scanner->transitions[(state * scanner->width) + c])) {
+				next = scanner->states++;
+				scanner->outputs[next] = -1;
+				scanner->transitions[(state * scanner->width) + c] = next;
+			}
+			state = next;
+		}
+
+		scanner->lengths[i] = len;
+		scanner->duplicates[i] = scanner->outputs[state];
+		scanner->outputs[state] = i;
+	}
+
+	// Walk the trie breadth first, and turn it into a complete state machine by filling in every missing transition using
+	// the failure link. The failure links are only needed while the scanner is being compiled.
+	if (!(queue = mm_alloc(scanner->states * sizeof(uint32_t))) || !(failures = mm_alloc(scanner->states * sizeof(uint32_t)))) {
+		log_pedantic("Unable to allocate a scanner.");
+		if (queue) mm_free(queue);
+		st_scanner_free(scanner);
+		return NULL;
+	}
+
+	for (uint32_t k = 0; k < scanner->width; k++) {
+		if ((next = scanner->transitions[k])) {
+			queue[tail++] = next;
+		}
+	}
+
+	while (head < tail) {
+
+		state = queue[head++];
+
+		// Link each state to the longest suffix which is also a complete needle, so every needle ending at a position can be
+		// reported by following the links.
+		scanner->links[state] = scanner->outputs[failures[state]] != -1 ? failures[state] : scanner->links[failures[state]];
+
+		for (uint32_t k = 0; k < scanner->width; k++) {
+			if ((next = scanner->transitions[(state * scanner->width) + k])) {
+				failures[next] = scanner->transitions[(failures[state] * scanner->width) + k];
+				queue[tail++] = next;
+			}
+			else {
+				scanner->transitions[(state * scanner->width) + k] = scanner->transitions[(failures[state] * scanner->width) + k];
+			}
+		}
+	}
+
+	// Replace each state number with the offset of its row, so the scan loop doesn't need to multiply, and flag the states
+	// which emit a match, so the loop only needs a single load to decide whether a byte completed a needle.
+	for (size_t i = 0; i < scanner->states * scanner->width; i++) {
+		next = scanner->transitions[i];
+		scanner->transitions[i] = (next * scanner->width) | (scanner->outputs[next] != -1 || scanner->links[next] ? SCAN_EMITS : 0);
+	}
+
+	mm_free(failures);
+	mm_free(queue);
+
+	return scanner;
+}
+
+/**
+ * @brief	Prepare a stream, so a haystack can be scanned one chunk at a time.
+ * @param	stream	the stream being initialized.
+ * @param	scanner	the compiled needles the stream will search for.
+ * @return	This function returns no value.
+ */
+void st_scan_stream_init(scan_stream_t *stream, scanner_t *scanner) {
+
+	if (!stream) {
+		log_pedantic("Attempted to initialize a NULL stream.");
+		return;
+	}
+
+	stream->scanner = scanner;
+	stream->state = 0;
+	stream->offset = 0;
+	stream->stopped = false;
+
+	return;
+}
+
+/**
+ * @brief	Scan the next chunk of a stream, and report every needle which ends inside the chunk.
+ * @note	Matches are reported in the order they end, and overlapping matches are all reported. When more than one needle
+ * 			ends at the same position, the longer needles are reported first. A match which began in an earlier chunk is
+ * 			reported when the chunk holding its final byte is scanned, so the callback must not assume the match is still
+ * 			available in memory. If the callback returns false, the stream stops, and ignores any further chunks.
+ * @param	stream		the stream being scanned.
+ * @param	data		a pointer to the chunk data.
+ * @param	len			the length, in bytes, of the chunk.
+ * @param	callback	the function called for each match, with the context, the needle index, and the offset of the match within
+ * 			the stream.
+ * @param	context		an opaque pointer passed to the callback.
+ * @return	-1 on error, or the number of matches reported.
+ */
+int64_t st_scan_stream_data(scan_stream_t *stream, const uchr_t *data, size_t len, scan_match_t callback, void *context) {
+
+	int32_t needle;
+	int64_t result = 0;
+	scanner_t *scanner;
+	uint32_t row, state, next;
+
+	if (!stream || !(scanner = stream->scanner) || !callback || (len && !data)) {
+		log_pedantic("Invalid parameters were provided to the stream scanner.");
+		return -1;
+	}
+	else if (stream->stopped) {
+		return 0;
+	}
+
+	row = stream->state;
+
+	for (size_t i = 0; i < len; i++) {
+
+		if (!((row = scanner->transitions[(row & ~SCAN_EMITS) + scanner->classes[data[i]]]) & SCAN_EMITS)) {
+			continue;
+		}
+
+		state = (row & ~SCAN_EMITS) / scanner->width;
+
+		for (next = scanner->outputs[state] != -1 ? state : scanner->links[state]; next; next = scanner->links[next]) {
+			for (needle = scanner->outputs[next]; needle != -1; needle = scanner->duplicates[needle]) {
+
+				result++;
+
+				if (!callback(context, needle, stream->offset + i + 1 - scanner->lengths[needle])) {
+					stream->offset += i + 1;
+					stream->state = row;
+					stream->stopped = true;
+					return result;
+				}
+			}
+		}
+	}
+
+	stream->offset += len;
+	stream->state = row;
+	return result;
+}
+
+/**
+ * @brief	Scan the next chunk of a stream, using a managed string to hold the chunk.
+ * @see		st_scan_stream_data()
+ * @note	If the chunk is a chain, its segments are scanned directly, without flattening the chain.
+ * @param	stream		the stream being scanned.
+ * @param	chunk		the managed string holding the chunk, which may be empty.
+ * @param	callback	the function called for each match.
+ * @param	context		an opaque pointer passed to the callback.
+ * @return	-1 on error, or the number of matches reported.
+ */
+int64_t st_scan_stream(scan_stream_t *stream, stringer_t *chunk, scan_match_t callback, void *context) {
+
+	int_t segments = 0;
+	int64_t result = 0, found;
+	size_t offset = 0;
+	struct iovec vec[SCAN_CHAIN_SEGMENTS];
+
+	if (!stream || !stream->scanner || !callback) {
+		log_pedantic("Invalid parameters were provided to the stream scanner.");
+		return -1;
+	}
+	else if (st_empty(chunk)) {
+		return 0;
+	}
+	else if (!(*((uint32_t *)chunk) & CHAIN_T)) {
+		return st_scan_stream_data(stream, st_data_get(chunk), st_length_get(chunk), callback, context);
+	}
+
+	while (!stream->stopped && (segments = st_chain_iovec(chunk, offset, vec, SCAN_CHAIN_SEGMENTS)) > 0) {
+		for (int_t i = 0; i < segments; i++) {
+			if ((found = st_scan_stream_data(stream, vec[i].iov_base, vec[i].iov_len, callback, context)) < 0) {
+				return -1;
+			}
+			result += found;
+			offset += vec[i].iov_len;
+		}
+	}
+
+	return segments < 0 ? -1 : result;
+}
+
+/**
+ * @brief	Scan a haystack, and report every occurrence of every needle with a single pass.
+ * @see		st_scan_stream_data()
+ * @param	scanner		the compiled needles.
+ * @param	haystack	the managed string to be searched.
+ * @param	callback	the function called for each match, with the context, the needle index, and the offset of the match.
+ * @param	context		an opaque pointer passed to the callback.
+ * @return	-1 on error, or the number of matches reported.
+ */
+int64_t st_scan(scanner_t *scanner, stringer_t *haystack, scan_match_t callback, void *context) {
+
+	scan_stream_t stream;
+
+	if (!scanner || !callback) {
+		log_pedantic("Invalid parameters were provided to the scanner.");
+		return -1;
+	}
+
+	st_scan_stream_init(&stream, scanner);
+	return st_scan_stream(&stream, haystack, callback, context);
+}
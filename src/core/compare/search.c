@@ -7,6 +7,259 @@
 
 #include "magma.h"
 
+/**
+ * A compiled needle, which caches the search kernel along with a copy of the needle, so repeated searches skip the setup.
+ * When the search is case insensitive, the copy is folded to lowercase.
+ */
+struct needle_t {
+	size_t length;
+	bool_t insensitive;
+	search_kernel_t kernel;
+	uchr_t data[];
+};
+
+/**
+ * @brief	Compare a candidate match against the needle, ignoring case if requested.
+ * @param	h			a pointer to the candidate match in the haystack.
+ * @param	n			a pointer to the needle.
+ * @param	len			the number of bytes to compare.
+ * @param	insensitive	if true, ASCII letters are compared without regard to case.
+ * @return	true if the bytes match, or false if they don't.
+ */
+bool_t st_search_verify(const uchr_t *h, const uchr_t *n, size_t len, bool_t insensitive) {
+
+	if (!insensitive) {
+		return !memcmp(h, n, len);
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		if (lower_chr(h[i]) != lower_chr(n[i])) return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Search a buffer for a needle one offset at a time. This is the fallback used when vector instructions aren't available.
+ * @param	h			a pointer to the haystack.
+ * @param	hlen		the length, in bytes, of the haystack.
+ * @param	n			a pointer to the needle.
+ * @param	nlen		the length, in bytes, of the needle, which must be at least one byte, and no longer than the haystack.
+ * @param	insensitive	if true, ASCII letters are compared without regard to case.
+ * @return	NULL if the needle isn't found, or a pointer to the first match.
+ */
+const uchr_t * st_search_kernel_scalar(const uchr_t *h, size_t hlen, const uchr_t *n, size_t nlen, bool_t insensitive) {
+
+	uchr_t first = insensitive ? lower_chr(*n) : *n;
+
+	for (size_t i = 0; i <= hlen - nlen; i++) {
+		if ((insensitive ? lower_chr(h[i]) : h[i]) == first && st_search_verify(h + i + 1, n + 1, nlen - 1, insensitive)) {
+			return h + i;
+		}
+	}
+
+	return NULL;
+}
+
+#ifdef __SSE2__
+/**
+ * @brief	Search a buffer for a needle sixteen offsets at a time, using SSE2.
+ * @note	Each block of the haystack is compared against the first and last bytes of the needle, and only the offsets where
+ * 			both match are verified. For case insensitive searches, a needle byte which is a letter is compared against the
+ * 			haystack with the 0x20 bit set, which folds uppercase letters onto lowercase without affecting any other byte
+ * 			which could match a lowercase letter.
+ * @see		st_search_kernel_scalar()
+ */
+const uchr_t * st_search_kernel_sse2(const uchr_t *h, size_t hlen, const uchr_t *n, size_t nlen, bool_t insensitive) {
+
+	uint32_t mask;
+	size_t i = 0;
+	uchr_t first = insensitive ? lower_chr(*n) : *n, last = insensitive ? lower_chr(n[nlen - 1]) : n[nlen - 1];
+	__m128i vfirst = _mm_set1_epi8(first), vlast = _mm_set1_epi8(last),
+		ffirst = _mm_set1_epi8(insensitive && first >= 'a' && first <= 'z' ? 0x20 : 0),
+		flast = _mm_set1_epi8(insensitive && last >= 'a' && last <= 'z' ? 0x20 : 0);
+
+	for (; i + nlen - 1 + 16 <= hlen; i += 16) {
+
+		mask = _mm_movemask_epi8(_mm_and_si128(
+			_mm_cmpeq_epi8(_mm_or_si128(_mm_loadu_si128((const __m128i *)(h + i)), ffirst), vfirst),
+			_mm_cmpeq_epi8(_mm_or_si128(_mm_loadu_si128((const __m128i *)(h + i + nlen - 1)), flast), vlast)));
+
+		for (; mask; mask &= mask - 1) {
+			if (nlen <= 2 || st_search_verify(h + i + __builtin_ctz(mask) + 1, n + 1, nlen - 2, insensitive)) {
+				return h + i + __builtin_ctz(mask);
+			}
+		}
+	}
+
+	return i <= hlen - nlen ? st_search_kernel_scalar(h + i, hlen - i, n, nlen, insensitive) : NULL;
+}
+
+/**
+ * @brief	Search a buffer for a needle thirty-two offsets at a time, using AVX2.
+ * @see		st_search_kernel_sse2()
+ */
+__attribute__ ((target ("avx2"))) const uchr_t * st_search_kernel_avx2(const uchr_t *h, size_t hlen, const uchr_t *n, size_t nlen, bool_t insensitive) {
+
+	uint32_t mask;
+	size_t i = 0;
+	uchr_t first = insensitive ? lower_chr(*n) : *n, last = insensitive ? lower_chr(n[nlen - 1]) : n[nlen - 1];
+	__m256i vfirst = _mm256_set1_epi8(first), vlast = _mm256_set1_epi8(last),
+		ffirst = _mm256_set1_epi8(insensitive && first >= 'a' && first <= 'z' ? 0x20 : 0),
+		flast = _mm256_set1_epi8(insensitive && last >= 'a' && last <= 'z' ? 0x20 : 0);
+
+	for (; i + nlen - 1 + 32 <= hlen; i += 32) {
+
+		mask = _mm256_movemask_epi8(_mm256_and_si256(
+			_mm256_cmpeq_epi8(_mm256_or_si256(_mm256_loadu_si256((const __m256i *)(h + i)), ffirst), vfirst),
+			_mm256_cmpeq_epi8(_mm256_or_si256(_mm256_loadu_si256((const __m256i *)(h + i + nlen - 1)), flast), vlast)));
+
+		for (; mask; mask &= mask - 1) {
+			if (nlen <= 2 || st_search_verify(h + i + __builtin_ctz(mask) + 1, n + 1, nlen - 2, insensitive)) {
+				return h + i + __builtin_ctz(mask);
+			}
+		}
+	}
+
+	return i <= hlen - nlen ? st_search_kernel_sse2(h + i, hlen - i, n, nlen, insensitive) : NULL;
+}
+#endif
+
+/**
+ * @brief	Select the fastest search kernel supported by the processor.
+ * @note	The processor is only queried once, and the result is cached.
+ * @return	a pointer to the search kernel.
+ */
+search_kernel_t st_search_kernel(void) {
+
+	static search_kernel_t kernel = NULL;
+	search_kernel_t result;
+
+	if ((result = __atomic_load_n(&kernel, __ATOMIC_RELAXED))) {
+		return result;
+	}
+
+#ifdef __SSE2__
+	__builtin_cpu_init();
+	result = __builtin_cpu_supports("avx2") ? &st_search_kernel_avx2 : &st_search_kernel_sse2;
+#else
+	result = &st_search_kernel_scalar;
+#endif
+
+	__atomic_store_n(&kernel, result, __ATOMIC_RELAXED);
+	return result;
+}
+
+/**
+ * @brief	Compile a needle, so it can be searched for repeatedly without repeating the setup.
+ * @param	needle		the managed string to be found.
+ * @param	insensitive	if true, searches will ignore the case of ASCII letters.
+ * @return	NULL on failure, or a pointer to the compiled needle, which must be freed with st_needle_free().
+ */
+needle_t * st_needle_alloc(stringer_t *needle, bool_t insensitive) {
+
+	uchr_t *n;
+	size_t nlen;
+	needle_t *result;
+
+	if (st_empty_out(needle, &n, &nlen)) {
+		log_pedantic("Passed an empty string.");
+		return NULL;
+	}
+	else if (!(result = mm_alloc(sizeof(needle_t) + nlen))) {
+		log_pedantic("Unable to allocate a compiled needle. { length = %zu }", nlen);
+		return NULL;
+	}
+
+	result->length = nlen;
+	result->insensitive = insensitive;
+	result->kernel = st_search_kernel();
+
+	for (size_t i = 0; i < nlen; i++) {
+		result->data[i] = insensitive ? lower_chr(n[i]) : n[i];
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Free a compiled needle.
+ * @param	needle	the compiled needle to be freed.
+ * @return	This function returns no value.
+ */
+void st_needle_free(needle_t *needle) {
+
+	if (!needle) {
+		log_pedantic("Attempted to free a NULL needle.");
+		return;
+	}
+
+	mm_free(needle);
+	return;
+}
+
+/**
+ * @brief	Search a managed string for a compiled needle, and save its location.
+ * @param	needle		the compiled needle to be found.
+ * @param	haystack	the managed string to be searched.
+ * @param	location	if not NULL, a pointer to store the index of needle if found, or 0 on no match.
+ * @return	true if the needle is found or false otherwise.
+ */
+bool_t st_needle_search(needle_t *needle, stringer_t *haystack, size_t *location) {
+
+	uchr_t *h;
+	size_t hlen;
+	const uchr_t *match;
+
+	if (location) {
+		*location = 0;
+	}
+
+	if (!needle || st_empty_out(haystack, &h, &hlen)) {
+		log_pedantic("Passed an empty string.");
+		return false;
+	}
+	else if (needle->length > hlen || !(match = needle->kernel(h, hlen, needle->data, needle->length, needle->insensitive))) {
+		return false;
+	}
+
+	if (location) {
+		*location = match - h;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Search a managed string for the next occurrence of a compiled needle, starting at an offset.
+ * @note	This function is used to iterate through every occurrence of a needle, without searching the start of the haystack
+ * 			again for each match. To find overlapping matches, resume from the location plus one, otherwise resume from the
+ * 			location plus the needle length.
+ * @param	needle		the compiled needle to be found.
+ * @param	haystack	the managed string to be searched.
+ * @param	from		the offset where the search should begin.
+ * @param	location	a pointer to store the index of the needle, relative to the start of the haystack, if found.
+ * @return	true if the needle is found or false otherwise.
+ */
+bool_t st_needle_next(needle_t *needle, stringer_t *haystack, size_t from, size_t *location) {
+
+	uchr_t *h;
+	size_t hlen;
+	const uchr_t *match;
+
+	if (!needle || !location || st_empty_out(haystack, &h, &hlen)) {
+		log_pedantic("Invalid parameters were provided to the needle search.");
+		return false;
+	}
+	else if (from > hlen || needle->length > hlen - from ||
+		!(match = needle->kernel(h + from, hlen - from, needle->data, needle->length, needle->insensitive))) {
+		return false;
+	}
+
+	*location = match - h;
+	return true;
+}
+
 /**
  * @brief	Search one managed string for an occurrence of another in a case-sensitive manner, and save its location.
  * @param	haystack	the managed string to be searched.
@@ -17,14 +270,12 @@
 bool_t st_search_cs(stringer_t *haystack, stringer_t *needle, size_t *location) {
 
 	uchr_t *h, *n;
-	bool_t result = false;
-	size_t i, j, hlen, nlen;
+	size_t hlen, nlen;
+	const uchr_t *match;
 
 	if (st_empty_out(haystack, &h, &hlen) || st_empty_out(needle, &n, &nlen)) {
 		log_pedantic("Passed an empty string.");
 		return false;
-	} else if (nlen > hlen) {
-		return false;
 	}
 
 	// If a location was provided for storing the position of needle, store reset it to zero in case needle isn't found.
@@ -33,29 +284,15 @@ bool_t st_search_cs(stringer_t *haystack, stringer_t *needle, size_t *location)
 	}
 
 	// The needle will never be found if it's longer than the haystack.
-	if (nlen > hlen) {
+	if (nlen > hlen || !(match = st_search_kernel()(h, hlen, n, nlen, false))) {
 		return false;
 	}
 
-	for (i = 0; i <= hlen - nlen && !result; i++) {
-
-		for (j = 0; j < nlen && (*(h + j) == *(n + j)); j++);
-
-		// In theory, j won't ever equal nlen if a non-matching character is found.
-		if (j == nlen && location) {
-			result = true;
-			*location = i;
-		}
-		else if (j == nlen) {
-			result = true;
-		}
-		else {
-			h++;
-		}
-
+	if (location) {
+		*location = match - h;
 	}
 
-	return result;
+	return true;
 }
 
 /**
@@ -68,8 +305,8 @@ bool_t st_search_cs(stringer_t *haystack, stringer_t *needle, size_t *location)
 bool_t st_search_ci(stringer_t *haystack, stringer_t *needle, size_t *location) {
 
 	uchr_t *h, *n;
-	bool_t result = false;
-	size_t i, j, hlen, nlen;
+	size_t hlen, nlen;
+	const uchr_t *match;
 
 	if (st_empty_out(haystack, &h, &hlen) || st_empty_out(needle, &n, &nlen)) {
 		log_pedantic("Passed an empty string.");
@@ -82,29 +319,15 @@ bool_t st_search_ci(stringer_t *haystack, stringer_t *needle, size_t *location)
 	}
 
 	// The needle will never be found if it's longer than the haystack.
-	if (nlen > hlen) {
+	if (nlen > hlen || !(match = st_search_kernel()(h, hlen, n, nlen, true))) {
 		return false;
 	}
 
-	for (i = 0; i <= hlen - nlen && !result; i++) {
-
-		for (j = 0; j < nlen && (lower_chr(*(h + j)) == lower_chr(*(n + j))); j++);
-
-		// In theory, j won't ever equal nlen if a non-matching character is found.
-		if (j == nlen && location) {
-			result = true;
-			*location = i;
-		}
-		else if (j == nlen) {
-			result = true;
-		}
-		else {
-			h++;
-		}
-
+	if (location) {
+		*location = match - h;
 	}
 
-	return result;
+	return true;
 }
 
 /**
@@ -116,7 +339,7 @@ bool_t st_search_ci(stringer_t *haystack, stringer_t *needle, size_t *location)
  */
 bool_t st_search_chr(stringer_t *haystack, chr_t needle, size_t *location) {
 
-	uchr_t *h;
+	uchr_t *h, *match;
 	size_t hlen;
 
 	if (st_empty_out(haystack, &h, &hlen)) {
@@ -129,18 +352,14 @@ bool_t st_search_chr(stringer_t *haystack, chr_t needle, size_t *location) {
 		*location = 0;
 	}
 
-	for (size_t i = 0; i < hlen; i++) {
-
-		if (h[i] == needle) {
-
-			if (location) {
-				*location = i;
-			}
-
-			return true;
-		}
+	// The C library search is vectorized, so it's considerably faster than checking one byte at a time.
+	if (!(match = memchr(h, (uchr_t)needle, hlen))) {
+		return false;
+	}
 
+	if (location) {
+		*location = match - h;
 	}
 
-	return false;
+	return true;
 }
@@ -56,7 +56,7 @@ int_t st_cmp_ci_starts(stringer_t *s, stringer_t *starts) {
 	bool_t se, starte;
 	int_t result = 0;
 	uchr_t *sptr, *startptr;
-	size_t slen, startlen, check;
+	size_t slen, startlen, check, mismatch;
 
 	// Setup.
 	se = st_empty_out(s, &sptr, &slen);
@@ -70,12 +70,9 @@ int_t st_cmp_ci_starts(stringer_t *s, stringer_t *starts) {
 	// Calculate how many bytes to compare.
 	check = (slen <= startlen ? slen : startlen);
 
-	// Break on the first non matching byte.
-	for (size_t i = 0; result == 0 && i < check; i++) {
-		if (lower_chr(*sptr) < lower_chr(*startptr)) result = -1;
-		else if (lower_chr(*sptr) > lower_chr(*startptr)) result = 1;
-		sptr++;
-		startptr++;
+	// Skip ahead to the first non matching byte, which the case folding kernels find several bytes at a time.
+	if ((mismatch = case_kernels()->mismatch(sptr, startptr, check)) < check) {
+		result = lower_chr(sptr[mismatch]) < lower_chr(startptr[mismatch]) ? -1 : 1;
 	}
 
 	// If the string length is equal/greater and result is still set to 0, we have a match.
@@ -31,6 +31,11 @@
 #include <sys/mman.h>
 #include <sys/utsname.h>
 #include <sys/resource.h>
+#include <sys/uio.h>
+
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
 
 /**
  * The type definitions used by Magma that are not defined by the system headers.
@@ -181,16 +186,17 @@ char * type(M_TYPE type);
 #include "host/host.h"
 
 // Define log macros which pass through to printf for standalone compilation. For custom logging undefine these
-// macros and replace them with the custom logging logic.
+// macros and replace them with the custom logging logic. The enabled flag is loaded atomically before the mutex is taken, so
+// disabled logging doesn't serialize the callers on log_mutex, and checked again once the mutex is held.
 extern bool_t log_enabled;
 extern pthread_mutex_t log_mutex;
 
-#define log_pedantic(...) do { mutex_lock(&log_mutex); if (log_enabled) printf(__VA_ARGS__); mutex_unlock(&log_mutex); } while (0)
+#define log_pedantic(...) do { if (__atomic_load_n(&log_enabled, __ATOMIC_RELAXED)) { mutex_lock(&log_mutex); if (log_enabled) printf(__VA_ARGS__); mutex_unlock(&log_mutex); } } while (0)
 #define log_check(expr) do {} while (0)
-#define log_info(...) do { mutex_lock(&log_mutex); if (log_enabled) printf(__VA_ARGS__); mutex_unlock(&log_mutex); } while (0)
-#define log_error(...) do { mutex_lock(&log_mutex); if (log_enabled) printf(__VA_ARGS__); mutex_unlock(&log_mutex); } while (0)
-#define log_critical(...) do { mutex_lock(&log_mutex); if (log_enabled) printf(__VA_ARGS__); mutex_unlock(&log_mutex); } while (0)
-#define log_options(options, ...) do { mutex_lock(&log_mutex); if (log_enabled) printf(__VA_ARGS__); mutex_unlock(&log_mutex); } while (0)
+#define log_info(...) do { if (__atomic_load_n(&log_enabled, __ATOMIC_RELAXED)) { mutex_lock(&log_mutex); if (log_enabled) printf(__VA_ARGS__); mutex_unlock(&log_mutex); } } while (0)
+#define log_error(...) do { if (__atomic_load_n(&log_enabled, __ATOMIC_RELAXED)) { mutex_lock(&log_mutex); if (log_enabled) printf(__VA_ARGS__); mutex_unlock(&log_mutex); } } while (0)
+#define log_critical(...) do { if (__atomic_load_n(&log_enabled, __ATOMIC_RELAXED)) { mutex_lock(&log_mutex); if (log_enabled) printf(__VA_ARGS__); mutex_unlock(&log_mutex); } } while (0)
+#define log_options(options, ...) do { if (__atomic_load_n(&log_enabled, __ATOMIC_RELAXED)) { mutex_lock(&log_mutex); if (log_enabled) printf(__VA_ARGS__); mutex_unlock(&log_mutex); } } while (0)
 
 #endif
 
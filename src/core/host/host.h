@@ -52,6 +52,11 @@
 
 #define MAGMA_PROC_PATH "/proc"
 
+/**
+ * The maximum number of chain segments passed to the kernel by a single call to tcp_writev().
+ */
+#define TCP_WRITEV_SEGMENTS 64
+
 /**
  * @typedef octet_t
  */
@@ -149,6 +154,7 @@ int           tcp_read(int sockd, void *buffer, int length, bool_t block);
 int_t         tcp_status(int sockd);
 int           tcp_wait(int sockd);
 int           tcp_write(int sockd, const void *buffer, int length, bool_t block);
+int           tcp_writev(int sockd, stringer_t *s, size_t offset, bool_t block);
 
 /// host.c
 stringer_t *  host_platform(stringer_t *output);
@@ -160,6 +160,61 @@ int tcp_write(int sockd, const void *buffer, int length, bool_t block) {
 	return result;
 }
 
+/**
+ * @brief	Write a chain to an open TCP/IP network socket, using a single vectored send for as many segments as possible.
+ * @note	Like tcp_write(), a single call may only write part of the chain, so the caller should call again, passing in the
+ * 			number of bytes written so far as the offset, until the entire chain has been written. Strings which aren't chains
+ * 			are passed along to tcp_write().
+ * @param	sockd	the socket file descriptor we'll write the data to.
+ * @param	s		the chain holding the data to be written.
+ * @param	offset	the number of bytes at the start of the chain which have already been written.
+ * @param	block	a boolean to indicating whether to make a blocking write call.
+ * @return	-1 on error, or the number of bytes written to the network connection.
+ */
+int tcp_writev(int sockd, stringer_t *s, size_t offset, bool_t block) {
+
+	size_t total = 0;
+	struct iovec vec[TCP_WRITEV_SEGMENTS];
+	int result = 0, counter = 0, count = 0;
+	struct msghdr message = { .msg_iov = vec };
+
+	if (sockd < 0 || !s || offset >= st_length_get(s)) {
+		log_pedantic("Passed invalid parameters for a call to the TCP vectored write function.");
+		return 0;
+	}
+	else if (!(*((uint32_t *)s) & CHAIN_T)) {
+		return tcp_write(sockd, st_char_get(s) + offset, st_length_int(s) - offset, block);
+	}
+
+#ifdef MAGMA_PEDANTIC
+	else if (!block) {
+		log_pedantic("Non-blocking TCP write calls have not been fully implemented yet.");
+	}
+#endif
+
+	if ((count = st_chain_iovec(s, offset, vec, TCP_WRITEV_SEGMENTS)) <= 0) {
+		return 0;
+	}
+
+	// The return value is an int, so trim the vector if it describes more than INT_MAX bytes.
+	for (int i = 0; i < count; i++) {
+		if (vec[i].iov_len > INT_MAX - total) {
+			vec[i].iov_len = INT_MAX - total;
+			count = i + 1;
+		}
+		total += vec[i].iov_len;
+	}
+
+	message.msg_iovlen = count;
+
+	do {
+		errno = 0;
+		result = sendmsg(sockd, &message, (block ? 0 : MSG_DONTWAIT));
+	} while (block && counter++ < 8 && !(result = tcp_continue(sockd, result, errno)));
+
+	return result;
+}
+
 ip_t * tcp_addr_ip(int sockd, ip_t *output) {
 
 	ip_t *result = NULL;
@@ -57,7 +57,7 @@ inx_cursor_t * inx_cursor_alloc(inx_t *index) {
 		inx_auto_write(index);
 
 		if ((cursor = index->cursor_alloc(index))) {
-			index->references++;
+			__sync_add_and_fetch(&(index->references), 1);
 		}
 
 		inx_auto_unlock(index);
@@ -1,385 +1,812 @@
-
 /**
  * @file /magma/core/indexes/hashed.c
  *
- * @brief	Function declarations and types for the hashed list.
+ * @brief	An open addressing hash table index, with grouped probing and incremental resizing.
+ *
+ * @note	Records are stored in a flat slot array, with a parallel array of control bytes. Each control byte holds either
+ * 			the empty/deleted marker, or a 7-bit fingerprint taken from the hash of the key stored in that slot. Lookups
+ * 			compare the fingerprint against an entire group of control bytes at once, and only compare keys for the slots
+ * 			that match. When a table grows too full a replacement is allocated, and the records are migrated a few slots
+ * 			at a time by the write operations that follow, so no single insert pays for rehashing the entire table. Keys
+ * 			are hashed using a per-index seed, and the hash function can be swapped out while the index is empty.
+ *
+ * 			If the index was created with the M_INX_RCU option, readers search the table without holding a lock. In that
+ * 			mode a slot is never reused after it has been occupied, since a reader could be comparing against its key, so
+ * 			deleted slots are only reclaimed when the table is rebuilt. Rebuilds copy every record into a new table in one
+ * 			pass, publish the new table with an atomic store, and retire the old table.
  */
 
 #include "magma.h"
 
-#define MAGMA_HASHED_BUCKETS 1024
+#define MAGMA_HASHED_GROUP 16
+#define MAGMA_HASHED_SLOTS 64
+#define MAGMA_HASHED_MIGRATE 32
+#define MAGMA_HASHED_PREFETCH 16
+
+#define MAGMA_HASHED_EMPTY 0x80
+#define MAGMA_HASHED_DELETED 0xFE
 
 // Hashed lists.
 typedef struct __attribute__ ((packed)) {
 	void *data;
-	multi_t key;
-	struct hashed_bucket_t *next;
-} hashed_bucket_t;
+	inx_key_t key;
+} hashed_slot_t;
 
 typedef struct __attribute__ ((packed)) {
-	inx_t *inx;
-	hashed_bucket_t *bucket;
-	uint64_t serial, slot, count;
-} hashed_cursor_t;
+	uint8_t *control;
+	hashed_slot_t *slots;
+	uint64_t capacity, used, deleted, generation;
+} hashed_table_t;
 
 typedef struct __attribute__ ((packed)) {
-	uint32_t buckets;
+	inx_hash_t hash;
+	hashed_table_t *table, *previous;
+	uint64_t migrated, generation, seed;
+	pthread_mutex_t keys;
 } hashed_index_t;
 
-// TODO: Finish implementing the hashed iterators.
-// TODO: Respect dupe/lock flags.
-// TODO: Move locking calls to the inx functions.
+typedef struct __attribute__ ((packed)) {
+	inx_t *inx;
+	bool_t started;
+	uint64_t serial, slot, generation;
+} hashed_cursor_t;
+
+static uint64_t hashed_secret = 0, hashed_seeds = 0;
+static pthread_mutex_t hashed_secret_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /**
- * @brief	Get the hash bucket for a key.
- * @note	If the key is passed as a string, it will be mapped to a bucket using the Fletcher32 hash.
- * @param	buckets		the total number of buckets for grouping items.
- * @param	key			a multi-type key with the value to be looked up; numbers and strings are supported.
- * @return	the number of the hash bucket corresponding to the specified key.
+ * @brief	Generate a seed for a new hashed or sharded index.
+ * @note	Seeds are derived from a process wide secret read from /dev/urandom the first time an index is created, so
+ * 			the placement of keys can't be predicted, or targeted, by whoever supplies them.
+ * @param	owner	the index being seeded; its address is mixed into the seed.
+ * @return	the 64-bit seed value for the index.
  */
-uint32_t hashed_bucket(uint32_t buckets, multi_t key) {
+uint64_t hashed_seed(void *owner) {
 
-	uint32_t result = 0, count;
+	int_t fd;
+	uint64_t input[2];
 
-	if (mt_is_number(key)) {
-		if ((result = mt_get_number(key)) < buckets) {
+	mutex_lock(&hashed_secret_lock);
 
-			// If my math is right, the bit count should never exceed the value of result. That also means the expression should never return a negative number.
-			log_check((count = bitwise_count(result)) > result);
+	if (!hashed_seeds) {
 
-			result = (((count = bitwise_count(result)) % 2) ? result + count : result - count);
-			result = (buckets <= result ? (buckets - 1) : result);
+		// If the random device isn't available, fall back on values which are at least unlikely to be known remotely.
+		hashed_secret = time(NULL) ^ ((uint64_t)getpid() << 32) ^ (uintptr_t)&hashed_secret;
+
+		if ((fd = open("/dev/urandom", O_RDONLY)) < 0 || read(fd, &hashed_secret, sizeof(uint64_t)) != sizeof(uint64_t)) {
+			log_pedantic("Unable to read the hash table secret from the system random device.");
 		}
-		else {
-			result = (result % buckets);
+
+		if (fd >= 0) {
+			close(fd);
 		}
 	}
+
+	input[0] = hashed_seeds++;
+	input[1] = (uintptr_t)owner;
+
+	mutex_unlock(&hashed_secret_lock);
+
+	return hash_wyhash64(input, sizeof(input), hashed_secret);
+}
+
+/**
+ * @brief	Hash a key using the seeded wyhash function.
+ * @note	This is the default hash function for hashed indexes. Numeric keys are hashed using their 64-bit value, so keys
+ * 			which compare as identical always land in the same place.
+ * @param	key		a multi-type key with the value to be hashed; numbers and strings are supported.
+ * @param	seed	the seed value for the index.
+ * @return	the 64-bit hash value corresponding to the specified key.
+ */
+uint64_t hashed_hash_wyhash(multi_t key, uint64_t seed) {
+
+	uint64_t number;
+
+	if (mt_is_number(key)) {
+		number = mt_get_number(key);
+		return hash_wyhash64(&number, sizeof(uint64_t), seed);
+	}
+
+	return hash_wyhash64(mt_get_char(&key), mt_get_length(key), seed);
+}
+
+/**
+ * @brief	Hash a key using the seeded 64-bit Murmur function.
+ * @param	key		a multi-type key with the value to be hashed; numbers and strings are supported.
+ * @param	seed	the seed value for the index.
+ * @return	the 64-bit hash value corresponding to the specified key.
+ */
+uint64_t hashed_hash_murmur(multi_t key, uint64_t seed) {
+
+	uint64_t number;
+
+	if (mt_is_number(key)) {
+		number = mt_get_number(key);
+		return hash_murmur64_seed(&number, sizeof(uint64_t), seed);
+	}
+
+	return hash_murmur64_seed(mt_get_char(&key), mt_get_length(key), seed);
+}
+
+/**
+ * @brief	Hash a key using the Fletcher32 function.
+ * @note	String keys are hashed using Fletcher32, while numbers are used as is, and the result is passed through the
+ * 			MurmurHash3 finalizer. The seed is mixed in before the finalizer, which spreads the output bits but does nothing
+ * 			to prevent keys which collide under Fletcher32 from colliding here.
+ * @param	key		a multi-type key with the value to be hashed; numbers and strings are supported.
+ * @param	seed	the seed value for the index.
+ * @return	the 64-bit hash value corresponding to the specified key.
+ */
+uint64_t hashed_hash_fletcher(multi_t key, uint64_t seed) {
+
+	uint64_t result;
+
+	if (mt_is_number(key)) {
+		result = mt_get_number(key);
+	}
 	else {
-		result = hash_fletcher32(mt_get_char(&key), mt_get_length(key)) % buckets;
+		result = hash_fletcher32(mt_get_char(&key), mt_get_length(key));
 	}
 
+	result ^= seed;
+	result ^= result >> 33;
+	result *= 0xff51afd7ed558ccdULL;
+	result ^= result >> 33;
+	result *= 0xc4ceb9fe1a85ec53ULL;
+	result ^= result >> 33;
+
 	return result;
 }
 
 /**
- * @brief	Allocate and initialize hashed bucket object.
- * @param	key		a multi-type key that will be hashed on lookup.
- * @param	data	a pointer to a data buffer associated with the key.
- * @return	NULL on failure, or a pointer to the newly allocated hashed bucket object on success.
+ * @brief	Change the hash function used by a hashed index.
+ * @note	The hash function can only be changed while the index is empty, since the stored records would otherwise need
+ * 			to be rehashed.
+ * @param	inx		the hashed index to be updated.
+ * @param	hash	the new hash function, for example hashed_hash_wyhash(), hashed_hash_murmur() or hashed_hash_fletcher().
+ * @return	true if the hash function was updated, or false if the index isn't empty.
  */
-hashed_bucket_t * hashed_bucket_alloc(multi_t key, void *data) {
+bool_t hashed_hash_set(void *inx, inx_hash_t hash) {
 
-	hashed_bucket_t *bucket;
+	inx_t *index = inx;
+	hashed_index_t *hashed;
 
-	if ((bucket = mm_alloc(sizeof(hashed_bucket_t))) == NULL) {
-		//lavalog(LOG_DEBUG, LOG_FRAMEWORK, "Unable to allocate %i bytes for a hash bucket.", sizeof(hashed_bucket_t));
-		return NULL;
+	if (index == NULL || (hashed = index->index) == NULL || !hash) {
+		return false;
+	}
+	else if (index->count || hashed->previous) {
+		log_pedantic("The hash function can only be changed while the index is empty.");
+		return false;
 	}
 
-	bucket->key = mt_dupe(key);
-	bucket->data = data;
-	return bucket;
+	hashed->hash = hash;
+	return true;
 }
 
-// Gets the bucket from the list.
-hashed_bucket_t * hashed_bucket_get_ptr(hashed_index_t *hashed, uint32_t num) {
+/**
+ * @brief	Build a bit mask of the control bytes in a group that match a given value.
+ * @param	control		a pointer to the first control byte in the group.
+ * @param	value		the control byte value to be matched.
+ * @return	a bit mask with one bit set for every matching control byte in the group.
+ */
+uint32_t hashed_group_match(uint8_t *control, uint8_t value) {
 
-	hashed_bucket_t *result = NULL;
+#ifdef __SSE2__
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i *)control), _mm_set1_epi8(value)));
+#else
+	uint32_t result = 0;
 
-	if (num < hashed->buckets) {
-		result = *(hashed_bucket_t **)((chr_t *)hashed + sizeof(hashed_index_t) + (sizeof(hashed_bucket_t *) * num));
+	for (uint_t i = 0; i < MAGMA_HASHED_GROUP; i++) {
+		if (control[i] == value) {
+			result |= (1 << i);
+		}
 	}
 
-#ifdef MAGMA_PEDANTIC
-	else {
-		log_pedantic("Invalid hash bucket requested.");
-	}
+	return result;
 #endif
 
+}
+
+/**
+ * @brief	Build a bit mask of the control bytes in a group that are available for a new record.
+ * @note	Both the empty and deleted markers have the high bit set, which is never true for a fingerprint.
+ * @param	control		a pointer to the first control byte in the group.
+ * @return	a bit mask with one bit set for every empty or deleted slot in the group.
+ */
+uint32_t hashed_group_available(uint8_t *control) {
+
+#ifdef __SSE2__
+	return _mm_movemask_epi8(_mm_loadu_si128((__m128i *)control));
+#else
+	uint32_t result = 0;
+
+	for (uint_t i = 0; i < MAGMA_HASHED_GROUP; i++) {
+		if (control[i] & 0x80) {
+			result |= (1 << i);
+		}
+	}
+
 	return result;
+#endif
+
+}
+
+/**
+ * @brief	Allocate an empty hash table.
+ * @note	The control bytes and slots are stored in the same block of memory as the table header.
+ * @param	hashed		the hashed index which will own the table; used to assign the table a generation number.
+ * @param	capacity	the number of slots in the table, which must be a power of two, and a multiple of the group size.
+ * @return	NULL on failure, or a pointer to the newly allocated table on success.
+ */
+hashed_table_t * hashed_table_alloc(hashed_index_t *hashed, uint64_t capacity) {
+
+	hashed_table_t *table;
+	size_t length = sizeof(hashed_table_t) + capacity + (capacity * sizeof(hashed_slot_t));
+
+	if (!(table = mm_alloc(length))) {
+		log_pedantic("Failed to allocate %zu bytes for a hash table.", length);
+		return NULL;
+	}
+
+	table->capacity = capacity;
+	table->generation = ++(hashed->generation);
+	table->control = (uint8_t *)table + sizeof(hashed_table_t);
+	table->slots = (hashed_slot_t *)(table->control + capacity);
+	mm_set(table->control, MAGMA_HASHED_EMPTY, capacity);
+
+	return table;
 }
 
-// Sets the bucket on the list.
-void hashed_bucket_set_ptr(hashed_index_t *hashed, uint32_t num, hashed_bucket_t *bucket) {
+/**
+ * @brief	Free every record held by a hash table.
+ * @note	Tables belonging to an M_INX_RCU index may still be visible to readers, so the slots are marked deleted rather
+ * 			than empty, and the records are retired instead of being freed.
+ * @param	index		the index which owns the table; the index data free function will be called for every record.
+ * @param	table		the table to be cleared.
+ * @return	This function returns no value.
+ */
+void hashed_table_clear(inx_t *index, hashed_table_t *table) {
+
+	for (uint64_t i = 0; i < table->capacity; i++) {
+		if (!(table->control[i] & 0x80)) {
+			inx_release_data(index, table->slots[i].data);
+			inx_key_release(index, &(table->slots[i].key));
+
+			if (index->options & M_INX_RCU) {
+				__atomic_store_n(&(table->control[i]), MAGMA_HASHED_DELETED, __ATOMIC_RELEASE);
+				table->deleted++;
+			}
+		}
+	}
 
-	if (num < hashed->buckets) {
-		*(hashed_bucket_t **)((chr_t *)hashed + sizeof(hashed_index_t) + (sizeof(hashed_bucket_t *) * num)) = bucket;
+	if (!(index->options & M_INX_RCU)) {
+		mm_set(table->control, MAGMA_HASHED_EMPTY, table->capacity);
+		table->deleted = 0;
 	}
 
-#ifdef MAGMA_PEDANTIC
+	table->used = 0;
+
+	return;
+}
+
+/**
+ * @brief	Locate the first slot in a hash table holding a given key.
+ * @param	table	the table to be searched.
+ * @param	key		a multi-type key with the value to be looked up.
+ * @param	hash	the hash value of the key.
+ * @return	NULL if the key isn't found, or a pointer to the slot holding the key.
+ */
+hashed_slot_t * hashed_table_find(hashed_table_t *table, multi_t key, uint64_t hash) {
+
+	uint8_t *control;
+	uint32_t match, bit;
+	uint64_t mask = (table->capacity / MAGMA_HASHED_GROUP) - 1, group = (hash >> 7) & mask;
+
+	// The groups are visited using a triangular sequence, which is guaranteed to visit every group when the number of groups is a power of two.
+	for (uint64_t step = 1; step <= mask + 1; step++) {
+
+		control = table->control + (group * MAGMA_HASHED_GROUP);
+		match = hashed_group_match(control, hash & 0x7F);
+
+		// Pairs with the release store in hashed_table_place(), so a slot is never read before its control byte.
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		while (match) {
+			bit = __builtin_ctz(match);
+			if (inx_key_match(&(table->slots[(group * MAGMA_HASHED_GROUP) + bit].key), key, hash)) {
+				return &(table->slots[(group * MAGMA_HASHED_GROUP) + bit]);
+			}
+			match &= match - 1;
+		}
+
+		// An empty slot ends the probe sequence, since an insert would have stopped here.
+		if (hashed_group_match(control, MAGMA_HASHED_EMPTY)) {
+			return NULL;
+		}
+
+		group = (group + step) & mask;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Place a record into the first available slot along the probe sequence of its hash.
+ * @note	The caller is responsible for ensuring the table has room. Duplicate keys are not checked for. The control byte is
+ * 			written last, so a lock free reader never sees a partially written slot.
+ * @param	table	the table which will receive the record.
+ * @param	key		a pointer to the key for the record, which is copied into the slot along with its hash value; ownership of
+ * 					any key buffer passes to the table.
+ * @param	data	a pointer to the data associated with the key.
+ * @param	reuse	if true, slots marked deleted may be reused; otherwise only empty slots are considered.
+ * @return	This function returns no value.
+ */
+void hashed_table_place(hashed_table_t *table, inx_key_t *key, void *data, bool_t reuse) {
+
+	uint64_t slot;
+	uint32_t available;
+	uint8_t *control;
+	uint64_t mask = (table->capacity / MAGMA_HASHED_GROUP) - 1, group = (key->hash >> 7) & mask;
+
+	for (uint64_t step = 1;; step++) {
+		control = table->control + (group * MAGMA_HASHED_GROUP);
+		if ((available = reuse ? hashed_group_available(control) : hashed_group_match(control, MAGMA_HASHED_EMPTY))) {
+			break;
+		}
+		group = (group + step) & mask;
+	}
+
+	slot = (group * MAGMA_HASHED_GROUP) + __builtin_ctz(available);
+
+	if (table->control[slot] == MAGMA_HASHED_DELETED) {
+		table->deleted--;
+	}
+
+	table->slots[slot].key = *key;
+	table->slots[slot].data = data;
+	__atomic_store_n(&(table->control[slot]), key->hash & 0x7F, __ATOMIC_RELEASE);
+	table->used++;
+
+	return;
+}
+
+/**
+ * @brief	Remove a record from a hash table slot, without releasing the key or data.
+ * @note	If the group holding the slot already contains an empty slot then no probe sequence continues past it, and the slot
+ * 			can be marked empty. Otherwise it must be marked deleted so lookups for keys stored further along keep going.
+ * @param	table	the table holding the record.
+ * @param	slot	a pointer to the slot being removed.
+ * @param	reuse	if false, the slot is always marked deleted, so it won't be reused until the table is rebuilt.
+ * @return	This function returns no value.
+ */
+void hashed_table_remove(hashed_table_t *table, hashed_slot_t *slot, bool_t reuse) {
+
+	uint64_t position = slot - table->slots;
+
+	if (reuse && hashed_group_match(table->control + (position - (position % MAGMA_HASHED_GROUP)), MAGMA_HASHED_EMPTY)) {
+		table->control[position] = MAGMA_HASHED_EMPTY;
+	}
 	else {
-		log_pedantic("Invalid hash bucket requested.");
+		__atomic_store_n(&(table->control[position]), MAGMA_HASHED_DELETED, __ATOMIC_RELEASE);
+		table->deleted++;
 	}
-#endif
 
+	table->used--;
 	return;
 }
 
-// Tacks on a bucket at the end.
-void hashed_bucket_add(hashed_bucket_t *bucket, hashed_bucket_t *new) {
+/**
+ * @brief	Move records from the previous table into the current table.
+ * @note	Once every slot in the previous table has been processed, the previous table is freed.
+ * @param	hashed	the hashed index being resized.
+ * @param	slots	the maximum number of slots in the previous table to process.
+ * @return	This function returns no value.
+ */
+void hashed_migrate(hashed_index_t *hashed, uint64_t slots) {
+
+	hashed_table_t *previous;
 
-	if (bucket == NULL) {
-		//lavalog(LOG_DEBUG, LOG_FRAMEWORK, "Passed a NULL pointer.");
+	if (!(previous = hashed->previous)) {
 		return;
 	}
 
-	// Find the end.
-	while (bucket->next != NULL) {
-		bucket = (hashed_bucket_t *)bucket->next;
+	for (; slots && hashed->migrated < previous->capacity; slots--, hashed->migrated++) {
+		if (!(previous->control[hashed->migrated] & 0x80)) {
+			hashed_table_place(hashed->table, &(previous->slots[hashed->migrated].key), previous->slots[hashed->migrated].data, true);
+			previous->control[hashed->migrated] = MAGMA_HASHED_DELETED;
+			previous->used--;
+		}
+	}
+
+	if (hashed->migrated == previous->capacity) {
+		hashed->previous = NULL;
+		hashed->migrated = 0;
+		mm_free(previous);
 	}
 
-	bucket->next = (struct hashed_bucket_t *)new;
 	return;
 }
 
+/**
+ * @brief	Replace the current table in a single pass, for indexes being searched by lock free readers.
+ * @note	Long keys, and the heap copies made of inline keys, are shared between the old and new tables, while the inline keys
+ * 			themselves are copied, so only the old table itself is retired.
+ * @param	hashed		the hashed index being rebuilt.
+ * @param	capacity	the number of slots in the replacement table.
+ * @return	true if the table was rebuilt, or false if the replacement table couldn't be allocated.
+ */
+bool_t hashed_rebuild(hashed_index_t *hashed, uint64_t capacity) {
+
+	hashed_table_t *table = hashed->table, *replacement;
+
+	if (!(replacement = hashed_table_alloc(hashed, capacity))) {
+		return false;
+	}
+
+	for (uint64_t i = 0; i < table->capacity; i++) {
+		if (!(table->control[i] & 0x80)) {
+			hashed_table_place(replacement, &(table->slots[i].key), table->slots[i].data, true);
+		}
+	}
+
+	__atomic_store_n(&(hashed->table), replacement, __ATOMIC_RELEASE);
+	epoch_retire(table, &mm_free);
+
+	return true;
+}
+
+/**
+ * @brief	Ensure the current table has room for another record, starting a resize if necessary.
+ * @note	Tables are kept at most 7/8 full, counting deleted slots. If most of the occupied slots are deleted markers, the
+ * 			replacement table is the same size and the resize only clears them out. Otherwise the capacity is doubled.
+ * @param	hashed	the hashed index receiving a new record.
+ * @param	rcu		if true, the table is rebuilt immediately rather than migrated incrementally.
+ * @return	true if the current table has room for another record, or false if a replacement table couldn't be allocated.
+ */
+bool_t hashed_reserve(hashed_index_t *hashed, bool_t rcu) {
+
+	uint64_t capacity;
+	hashed_table_t *table = hashed->table, *replacement;
+
+	if ((table->used + table->deleted + 1) * 8 <= table->capacity * 7) {
+		return true;
+	}
+
+	// A previous resize is still in progress, so finish it before starting another.
+	if (hashed->previous) {
+		hashed_migrate(hashed, UINT64_MAX);
+		if ((table->used + table->deleted + 1) * 8 <= table->capacity * 7) {
+			return true;
+		}
+	}
+
+	capacity = ((table->used + 1) * 16 <= table->capacity * 7) ? table->capacity : table->capacity * 2;
+
+	if (rcu) {
+		return hashed_rebuild(hashed, capacity);
+	}
+	else if (!(replacement = hashed_table_alloc(hashed, capacity))) {
+		return false;
+	}
+
+	hashed->migrated = 0;
+	hashed->previous = table;
+	hashed->table = replacement;
+
+	return true;
+}
+
 // Add a data item to the list.
 bool_t hashed_insert(void *inx, multi_t key, void *data) {
 
-	uint32_t num;
+	inx_key_t copy;
 	inx_t *index = inx;
 	hashed_index_t *hashed;
-	hashed_bucket_t *bucket, *holder;
 
 	if (index == NULL || index->index == NULL) {
 		return false;
 	}
 
 	hashed = index->index;
+	hashed_migrate(hashed, MAGMA_HASHED_MIGRATE);
 
-	// Create the new bucket.
-	if ((holder = hashed_bucket_alloc(key, data)) == NULL) {
+	if (!hashed_reserve(hashed, (index->options & M_INX_RCU) == M_INX_RCU)) {
 		return false;
 	}
 
-	// Figure out the bucket number.
-	num = hashed_bucket(hashed->buckets, key);
-
-	// Get the bucket.
-	bucket = hashed_bucket_get_ptr(hashed, num);
-
-	// We need to create a bucket.
-	if (bucket == NULL) {
-		hashed_bucket_set_ptr(hashed, num, holder);
-	} else {
-		hashed_bucket_add(bucket, holder);
+	if (!inx_key_set(&copy, key, hashed->hash(key, hashed->seed))) {
+		return false;
 	}
 
+	hashed_table_place(hashed->table, &copy, data, !(index->options & M_INX_RCU));
+
 	index->count++;
 	index->serial++;
 	return true;
 }
 
-// Searches a bucket list for the key.
-void * hashed_bucket_find_key(hashed_bucket_t *bucket, multi_t key) {
+/**
+ * @brief	Insert a batch of records, after resizing the table once so it can hold all of them.
+ * @note	Without the up front resize, loading a large batch into an empty table would double the capacity over and over,
+ * 			migrating the same records each time. If the larger table can't be allocated, the records are still inserted,
+ * 			and the table grows as needed. The records are hashed a window at a time, and the groups they map to are
+ * 			prefetched before any of them are placed, so the cache misses for a window overlap instead of stalling each insert.
+ * @param	inx		the hashed index receiving the records.
+ * @param	keys	an array of keys for the new records.
+ * @param	data	an array of data pointers associated with the keys, or NULL if every record should have a NULL value.
+ * @param	count	the number of records in the batch.
+ * @return	the number of records inserted, which stops short of count if an insert fails.
+ */
+uint64_t hashed_insert_batch(void *inx, multi_t *keys, void **data, uint64_t count) {
+
+	inx_key_t copy;
+	inx_t *index = inx;
+	hashed_index_t *hashed;
+	hashed_table_t *table, *replacement;
+	uint64_t capacity, mask, window, hashes[MAGMA_HASHED_PREFETCH], inserted = 0;
+	bool_t rcu;
+
+	if (index == NULL || index->index == NULL) {
+		return 0;
+	}
+
+	hashed = index->index;
+	rcu = (index->options & M_INX_RCU) == M_INX_RCU;
+	hashed_migrate(hashed, UINT64_MAX);
+	table = hashed->table;
+
+	if ((table->used + table->deleted + count) * 8 > table->capacity * 7) {
+
+		for (capacity = table->capacity; (table->used + count) * 8 > capacity * 7; capacity *= 2);
+
+		if (rcu) {
+			hashed_rebuild(hashed, capacity);
+		}
+		else if ((replacement = hashed_table_alloc(hashed, capacity))) {
+			hashed->migrated = 0;
+			hashed->previous = table;
+			hashed->table = replacement;
+			hashed_migrate(hashed, UINT64_MAX);
+		}
+	}
+
+	while (inserted < count) {
+
+		window = (count - inserted) < MAGMA_HASHED_PREFETCH ? count - inserted : MAGMA_HASHED_PREFETCH;
+		table = hashed->table;
+		mask = (table->capacity / MAGMA_HASHED_GROUP) - 1;
+
+		for (uint64_t i = 0; i < window; i++) {
+			hashes[i] = hashed->hash(keys[inserted + i], hashed->seed);
+			__builtin_prefetch(table->control + (((hashes[i] >> 7) & mask) * MAGMA_HASHED_GROUP), 1);
+			__builtin_prefetch(table->slots + (((hashes[i] >> 7) & mask) * MAGMA_HASHED_GROUP), 1);
+		}
+
+		for (uint64_t i = 0; i < window; i++, inserted++) {
+
+			// The reserve only has work to do if the up front resize failed.
+			hashed_migrate(hashed, MAGMA_HASHED_MIGRATE);
 
-	void *data = NULL;
+			if (!hashed_reserve(hashed, rcu) || !inx_key_set(&copy, keys[inserted], hashes[i])) {
+				return inserted;
+			}
 
-	while (bucket != NULL && data == NULL) {
-		if (ident_mt_mt(bucket->key, key) == true) {
-			data = bucket->data;
+			hashed_table_place(hashed->table, &copy, data ? data[inserted] : NULL, !rcu);
+			index->count++;
+			index->serial++;
 		}
-		bucket = (hashed_bucket_t *)bucket->next;
 	}
 
-	return data;
+	return inserted;
 }
 
 // Gets a data item, or returns NULL.
 void * hashed_find(void *inx, multi_t key) {
 
-	uint32_t num;
-	void *data = NULL;
+	uint64_t hash;
 	inx_t *index = inx;
+	hashed_slot_t *slot;
 	hashed_index_t *hashed;
-	hashed_bucket_t *bucket;
 
 	if (index == NULL || index->index == NULL) {
 		return NULL;
 	}
 
 	hashed = index->index;
+	hash = hashed->hash(key, hashed->seed);
 
-	// Figure out the bucket number.
-	num = hashed_bucket(hashed->buckets, key);
-
-	// Get the bucket.
-	bucket = hashed_bucket_get_ptr(hashed, num);
-
-	// We need to search the bucket for the key.
-	if (bucket != NULL) {
-		data = hashed_bucket_find_key(bucket, key);
+	// Records which haven't been migrated yet will still be in the previous table.
+	if ((slot = hashed_table_find(__atomic_load_n(&(hashed->table), __ATOMIC_ACQUIRE), key, hash)) || (hashed->previous && (slot = hashed_table_find(hashed->previous, key, hash)))) {
+		return slot->data;
 	}
 
-	return data;
+	return NULL;
 }
 
 bool_t hashed_delete(void *inx, multi_t key) {
 
-	uint32_t num;
+	uint64_t hash;
 	inx_t *index = inx;
-	bool_t found = false;
+	hashed_slot_t *slot;
+	hashed_table_t *table;
 	hashed_index_t *hashed;
-	hashed_bucket_t *bucket, *holder = NULL;
 
 	if (index == NULL || index->index == NULL) {
 		return false;
 	}
 
 	hashed = index->index;
+	hashed_migrate(hashed, MAGMA_HASHED_MIGRATE);
+	hash = hashed->hash(key, hashed->seed);
 
-	// Figure out the bucket number.
-	num = hashed_bucket(hashed->buckets, key);
-
-	// Get the bucket.
-	bucket = hashed_bucket_get_ptr(hashed, num);
+	if (!(slot = hashed_table_find((table = hashed->table), key, hash)) && (!hashed->previous ||
+		!(slot = hashed_table_find((table = hashed->previous), key, hash)))) {
+		return false;
+	}
 
-	// There is only one bucket.
-	while (bucket && !found) {
+	inx_release_data(index, slot->data);
+	inx_key_release(index, &(slot->key));
+	hashed_table_remove(table, slot, !(index->options & M_INX_RCU));
 
-		// This is the bucket to free.
-		if ((found = ident_mt_mt(bucket->key, key)) == true) {
+	index->count--;
+	index->serial++;
 
-			// Its the first bucket.
-			if (holder == NULL) {
-				hashed_bucket_set_ptr(hashed, num, (hashed_bucket_t *)bucket->next);
-			}
-			// Takes this bucket out of the list.
-			else {
-				holder->next = (struct hashed_bucket_t *)bucket->next;
-			}
+	return true;
+}
 
-			if (bucket->data && index->data_free) {
-				index->data_free(bucket->data);
-			}
+/**
+ * @brief	Get the table a hashed cursor is positioned in.
+ * @note	Tables are identified by generation number, so the cursor can tell when its table has been freed by a resize.
+ * @param	cursor	the hashed cursor.
+ * @return	NULL if the cursor isn't positioned in a live table, or a pointer to the table.
+ */
+hashed_table_t * hashed_cursor_table(hashed_cursor_t *cursor) {
 
-			mt_free(bucket->key);
-			mm_free(bucket);
+	hashed_index_t *hashed = cursor->inx->index;
 
-		} else {
-			holder = bucket;
-			bucket = (hashed_bucket_t *)bucket->next;
-		}
+	if (hashed->table->generation == cursor->generation) {
+		return hashed->table;
 	}
-
-	if (found) {
-		index->count--;
-		index->serial++;
+	else if (hashed->previous && hashed->previous->generation == cursor->generation) {
+		return hashed->previous;
 	}
 
-	return found;
+	return NULL;
 }
 
-/// BUG: It's a little unclear what's happening, but when this function gets called, the serials don't match, and the count is greater than the number of available
-/// data buckets, because a bucket has been removed, the cursor will get stuck returning the last item endlessly (I think).
-hashed_bucket_t * hashed_cursor_active(hashed_cursor_t *cursor) {
+/**
+ * @brief	Get the slot for the record a hashed cursor is positioned on.
+ * @note	Records never move within a table, so the position remains valid after other records are inserted or deleted.
+ * @param	cursor	the hashed cursor.
+ * @return	NULL if the cursor isn't positioned on a record, or a pointer to the slot holding the record.
+ */
+hashed_slot_t * hashed_cursor_active(hashed_cursor_t *cursor) {
 
-	uint64_t count = 0;
-	hashed_bucket_t *bucket = NULL, *loop;
+	hashed_table_t *table;
 
-	// If the serial numbers match, return the bucket pointer.
-	if (cursor->serial == cursor->inx->serial) {
-		bucket = (hashed_bucket_t *)cursor->bucket;
+	if (!cursor->started || !(table = hashed_cursor_table(cursor)) || cursor->slot >= table->capacity ||
+		(table->control[cursor->slot] & 0x80)) {
+		return NULL;
 	}
 
-	// Otherwise pull the bucket pointer and count off the items till we have a match.
-	if (!bucket && cursor->slot < ((hashed_index_t *)cursor->inx->index)->buckets) {
-
-		if ((loop = hashed_bucket_get_ptr(cursor->inx->index, cursor->slot))) {
+	return &(table->slots[cursor->slot]);
+}
 
-			count++;
+/**
+ * @brief	Advance a hashed cursor to the next record.
+ * @note	If a resize is in progress, the previous table is iterated before the current table. If the index is resized while
+ * 			a cursor is active, records which were migrated behind the cursor may be returned a second time.
+ * @param	cursor	the hashed cursor.
+ * @return	NULL if there are no more records, or a pointer to the slot holding the next record.
+ */
+hashed_slot_t * hashed_cursor_next(hashed_cursor_t *cursor) {
 
-			// Advance to the active node.
-			while (loop && count != cursor->count) {
-				loop = (hashed_bucket_t *)loop->next;
-				count++;
-			}
+	uint64_t slot;
+	hashed_table_t *table;
+	hashed_index_t *hashed = cursor->inx->index;
 
-			if (loop && count == cursor->count) {
-				cursor->bucket = bucket = loop;
-				cursor->count = 1;
-			}
-		}
+	if (!cursor->started) {
+		cursor->started = true;
+		table = hashed->previous ? hashed->previous : hashed->table;
+		slot = 0;
 	}
+	// The table the cursor was positioned in has been freed, so continue with the current table.
+	else if (!(table = hashed_cursor_table(cursor))) {
+		table = hashed->table;
+		slot = 0;
+	}
+	else {
+		slot = cursor->slot + 1;
+	}
+
+	while (true) {
 
-	// The bucket above didn't contain enough items to satisfy the counter, so all we need to do is look for the next slot with a valid entry.
-	if (!bucket && cursor->slot < ((hashed_index_t *)cursor->inx->index)->buckets) {
-		for (count = cursor->slot; !bucket && count < ((hashed_index_t *)cursor->inx->index)->buckets; count++) {
-			bucket = hashed_bucket_get_ptr(cursor->inx->index, count);
+		for (; slot < table->capacity; slot++) {
+			if (!(table->control[slot] & 0x80)) {
+				cursor->slot = slot;
+				cursor->serial = cursor->inx->serial;
+				cursor->generation = table->generation;
+				return &(table->slots[slot]);
+			}
 		}
 
-		if (bucket) {
-			cursor->count = 1;
-			cursor->slot = count - 1;
-			cursor->bucket = bucket;
-			cursor->serial = cursor->inx->serial;
+		if (table != hashed->previous) {
+			break;
 		}
 
+		table = hashed->table;
+		slot = 0;
 	}
 
-	return bucket;
+	// Park the cursor at the end of the current table.
+	cursor->slot = table->capacity;
+	cursor->serial = cursor->inx->serial;
+	cursor->generation = table->generation;
+
+	return NULL;
 }
 
-hashed_bucket_t * hashed_cursor_next(hashed_cursor_t *cursor) {
+void * hashed_cursor_value_next(hashed_cursor_t *cursor) {
 
-	hashed_bucket_t *bucket = NULL;
+	hashed_slot_t *slot;
 
-	// If the serials match up, see if the bucket pointer will lead us to the next entry.
-	if (cursor->serial == cursor->inx->serial && cursor->bucket && (bucket = (hashed_bucket_t *)(cursor->bucket->next))) {
-		cursor->count++;
-		cursor->bucket = bucket;
-	}
-	// Otherwise if the serials match, advance the slot number.
-	else if (!bucket && cursor->serial == cursor->inx->serial) {
-		cursor->slot++;
-		cursor->count = 0;
-		cursor->bucket = NULL;
-		bucket = hashed_cursor_active(cursor);
-	}
-	// The serials don't match so we'll be counting out the items in the current bucket. So we just need to increase our counter.
-	else if (cursor->slot < ((hashed_index_t *)cursor->inx->index)->buckets){
-		bucket = hashed_cursor_active(cursor);
+	if ((slot = hashed_cursor_next(cursor))) {
+		return slot->data;
 	}
+	return NULL;
 
-	return bucket;
 }
 
-void * hashed_cursor_value_next(hashed_cursor_t *cursor) {
+void * hashed_cursor_value_active(hashed_cursor_t *cursor) {
 
-	hashed_bucket_t *bucket;
+	hashed_slot_t *slot;
 
-	if ((bucket = hashed_cursor_next(cursor))) {
-		return bucket->data;
+	if ((slot = hashed_cursor_active(cursor))) {
+		return slot->data;
 	}
 	return NULL;
-
 }
 
-void * hashed_cursor_value_active(hashed_cursor_t *cursor) {
+/**
+ * @brief	Get the key for a record in a hashed index, in a form that remains valid until the record is deleted.
+ * @note	Cursors only hold a read lock, so several of them could be making a heap copy of the same inline key at once. The
+ * 			index keeps a separate mutex to serialize them, which is only used while handing out keys.
+ * @param	cursor	the hashed cursor.
+ * @param	slot	the slot holding the record.
+ * @return	a multi-type value holding the key of the record.
+ */
+multi_t hashed_cursor_key(hashed_cursor_t *cursor, hashed_slot_t *slot) {
 
-	hashed_bucket_t *bucket;
+	multi_t key;
+	hashed_index_t *hashed = cursor->inx->index;
 
-	if ((bucket = hashed_cursor_active(cursor))) {
-		return bucket->data;
+	if (slot->key.length == MAGMA_INX_KEY_MULTI) {
+		return slot->key.val.multi;
 	}
-	return NULL;
+
+	mutex_lock(&(hashed->keys));
+	key = inx_key_get(&(slot->key));
+	mutex_unlock(&(hashed->keys));
+
+	return key;
 }
 
 multi_t hashed_cursor_key_next(hashed_cursor_t *cursor) {
 
-	hashed_bucket_t *bucket;
+	hashed_slot_t *slot;
 
-	if ((bucket = hashed_cursor_next(cursor))) {
-		return bucket->key;
+	if ((slot = hashed_cursor_next(cursor))) {
+		return hashed_cursor_key(cursor, slot);
 	}
 	return mt_get_null();
 }
 
 multi_t hashed_cursor_key_active(hashed_cursor_t *cursor) {
 
-	hashed_bucket_t *bucket;
+	hashed_slot_t *slot;
 
-	if ((bucket = hashed_cursor_active(cursor))) {
-		return bucket->key;
+	if ((slot = hashed_cursor_active(cursor))) {
+		return hashed_cursor_key(cursor, slot);
 	}
 	return mt_get_null();
 }
@@ -387,8 +814,8 @@ multi_t hashed_cursor_key_active(hashed_cursor_t *cursor) {
 void hashed_cursor_reset(hashed_cursor_t *cursor) {
 
 	if (cursor) {
-		cursor->bucket = NULL;
-		cursor->serial = cursor->count = cursor->slot = 0;
+		cursor->started = false;
+		cursor->serial = cursor->slot = cursor->generation = 0;
 	}
 
 	return;
@@ -419,10 +846,8 @@ void * hashed_cursor_alloc(inx_t *inx) {
 
 void hashed_free(void *inx) {
 
-	uint32_t num;
 	inx_t *index = inx;
 	hashed_index_t *hashed;
-	hashed_bucket_t *bucket, *holder;
 
 	if (index == NULL || index->index == NULL) {
 		return;
@@ -430,21 +855,15 @@ void hashed_free(void *inx) {
 
 	hashed = index->index;
 
-	for (num = 0; num < hashed->buckets; num++) {
-
-		bucket = hashed_bucket_get_ptr(hashed, num);
-		while (bucket) {
-			holder = bucket;
-			bucket = (hashed_bucket_t *)holder->next;
-			if (holder->data && index->data_free) {
-				index->data_free(holder->data);
-			}
-			mt_free(holder->key);
-			mm_free(holder);
-		}
-
+	if (hashed->previous) {
+		hashed_table_clear(index, hashed->previous);
+		mm_free(hashed->previous);
 	}
 
+	hashed_table_clear(index, hashed->table);
+	mm_free(hashed->table);
+
+	mutex_destroy(&(hashed->keys));
 	mm_free(index->index);
 	index->index = NULL;
 	return;
@@ -452,10 +871,8 @@ void hashed_free(void *inx) {
 
 void hashed_truncate(void *inx) {
 
-	uint32_t num;
 	inx_t *index = inx;
 	hashed_index_t *hashed;
-	hashed_bucket_t *bucket, *holder;
 
 	if (index == NULL || index->index == NULL) {
 		return;
@@ -463,21 +880,16 @@ void hashed_truncate(void *inx) {
 
 	hashed = index->index;
 
-	for (num = 0; num < hashed->buckets; num++) {
-		if ((bucket = hashed_bucket_get_ptr(hashed, num))) {
-			while (bucket) {
-				holder = bucket;
-				bucket = (hashed_bucket_t *)holder->next;
-				if (holder->data && index->data_free) {
-					index->data_free(holder->data);
-				}
-				mt_free(holder->key);
-				mm_free(holder);
-			}
-			hashed_bucket_set_ptr(hashed, num, NULL);
-		}
+	// Any resize in progress is abandoned, and the current table is kept for reuse.
+	if (hashed->previous) {
+		hashed_table_clear(index, hashed->previous);
+		mm_free(hashed->previous);
+		hashed->previous = NULL;
+		hashed->migrated = 0;
 	}
 
+	hashed_table_clear(index, hashed->table);
+
 	index->count = 0;
 	index->serial++;
 
@@ -496,14 +908,26 @@ void hashed_truncate(void *inx) {
 inx_t * hashed_alloc(uint64_t options, void *data_free) {
 
 	inx_t *result;
+	hashed_index_t *hashed;
 
 	if ((result = mm_alloc(sizeof(inx_t))) == NULL) {
 		return NULL;
 	}
-	else if (!(result->index = mm_alloc(sizeof(hashed_index_t) + (sizeof(hashed_bucket_t *) * MAGMA_HASHED_BUCKETS)))) {
+	else if (!(result->index = hashed = mm_alloc(sizeof(hashed_index_t)))) {
 		mm_free(result);
 		return NULL;
 	}
+	else if (!(hashed->table = hashed_table_alloc(hashed, MAGMA_HASHED_SLOTS))) {
+		mm_free(hashed);
+		mm_free(result);
+		return NULL;
+	}
+
+	mutex_init(&(hashed->keys), NULL);
+
+	// Every index gets its own seed, so a set of keys which collide in one index won't collide in another.
+	hashed->seed = hashed_seed(hashed);
+	hashed->hash = hashed_hash_wyhash;
 
 	// The last variable is only applicable to linked lists.
 	result->last = NULL;
@@ -512,7 +936,6 @@ inx_t * hashed_alloc(uint64_t options, void *data_free) {
 	result->data_free = data_free;
 	result->index_free = hashed_free;
 	result->index_truncate = hashed_truncate;
-	((hashed_index_t *)(result->index))->buckets = MAGMA_HASHED_BUCKETS;
 
 	result->find = hashed_find;
 	result->append = hashed_insert;
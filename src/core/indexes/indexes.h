@@ -13,11 +13,14 @@
  * Index types and options.
  */
 typedef enum {
-	M_INX_TREE = 1, //!< M_INX_BTREE
+	M_INX_TREE = 1, //!< M_INX_TREE
 	M_INX_HASHED = 2, //!< M_INX_HASHED
 	M_INX_LINKED = 4, //!< M_INX_LINKED
 	//M_INX_ALLOW_DUPE = 8, //!< M_INX_ALLOW_DUPE
 	M_INX_LOCK_MANUAL = 16, //!< M_INX_LOCK_MANUAL
+	M_INX_SHARDED = 32, //!< M_INX_SHARDED
+	M_INX_RCU = 64, //!< M_INX_RCU
+	M_INX_SLAB = 128, //!< M_INX_SLAB
 
 } MAGMA_INDEX;
 
@@ -31,10 +34,25 @@ typedef enum {
  */
 #define MAGMA_INDEX_OPTION (M_INX_INDEX_LOCK)
 
+/**
+ * The longest string key which is stored inline by an index key, rather than being duplicated onto the heap.
+ */
+#define MAGMA_INX_KEY_INLINE 23
+
+/**
+ * The length value used by index keys which hold a multi-type value instead of an inline string.
+ */
+#define MAGMA_INX_KEY_MULTI UINT8_MAX
+
+/**
+ * The signature for functions used to hash the keys stored in a hashed index.
+ */
+typedef uint64_t (*inx_hash_t)(multi_t key, uint64_t seed);
+
 typedef struct __attribute__ ((packed)) {
 
 	// Data and record count
-	void *index, *last;
+	void *index, *last, *slab;
 	pthread_rwlock_t lock;
 	uint64_t count, serial, automatic, options, references;
 
@@ -65,6 +83,32 @@ typedef struct __attribute__ ((packed)) {
 	inx_t *inx;
 } inx_cursor_t;
 
+/**
+ * A key stored by an index. Short strings are copied inline, along with a terminating NUL, while numbers and longer strings
+ * are held as a multi-type value. The hash is assigned by the index which owns the key. Inline keys are only copied onto the
+ * heap if a cursor hands them out, so the caller gets a key which stays put until the record is deleted.
+ */
+typedef struct __attribute__ ((packed)) {
+	union {
+		multi_t multi;
+		chr_t chars[MAGMA_INX_KEY_INLINE + 1];
+	} val;
+	void *copy;
+	uint64_t hash;
+	uint8_t length, type;
+} inx_key_t;
+
+/**
+ * The memory footprint of an index. The slab values are only populated for indexes created with the M_INX_SLAB option.
+ */
+typedef struct __attribute__ ((packed)) {
+	uint64_t records; //!< The number of records held by the index.
+	uint64_t objects; //!< The number of nodes and records allocated from the slab.
+	uint64_t used; //!< The number of slab bytes occupied by those objects.
+	uint64_t reserved; //!< The number of bytes held by the slab chunks, including free space.
+	uint64_t chunks; //!< The number of chunks held by the slab.
+} inx_stats_t;
+
 /// cursors.c
 inx_cursor_t *  inx_cursor_alloc(inx_t *index);
 void            inx_cursor_free(inx_cursor_t *cursor);
@@ -83,21 +127,62 @@ void       inx_auto_write(inx_t *inx);
 void       inx_cleanup(inx_t *inx);
 uint64_t   inx_count(inx_t *inx);
 bool_t     inx_delete(inx_t *inx, multi_t key);
+uint64_t   inx_delete_batch(inx_t *inx, multi_t *keys, uint64_t count);
 void *     inx_find(inx_t *inx, multi_t key);
+uint64_t   inx_find_batch(inx_t *inx, multi_t *keys, void **results, uint64_t count);
 void       inx_free(inx_t *inx);
+bool_t     inx_hash_set(inx_t *inx, inx_hash_t hash);
 bool_t     inx_insert(inx_t *inx, multi_t key, void *data);
+uint64_t   inx_insert_batch(inx_t *inx, multi_t *keys, void **data, uint64_t count);
 void       inx_lock_read(inx_t *inx);
 void       inx_lock_write(inx_t *inx);
 uint64_t   inx_options(inx_t *inx);
+void       inx_release_data(inx_t *inx, void *data);
+void       inx_release_key(inx_t *inx, multi_t key);
 bool_t     inx_replace(inx_t *inx, multi_t key, void *data);
 uint64_t   inx_serial(inx_t *inx);
+bool_t     inx_stats(inx_t *inx, inx_stats_t *stats);
 void       inx_truncate(inx_t *inx);
 void       inx_unlock(inx_t *inx);
 
+/// keys.c
+multi_t   inx_key_get(inx_key_t *key);
+bool_t    inx_key_match(inx_key_t *key, multi_t multi, uint64_t hash);
+void      inx_key_release(inx_t *inx, inx_key_t *key);
+bool_t    inx_key_set(inx_key_t *key, multi_t multi, uint64_t hash);
+
 /// linked.c
-inx_t * linked_alloc(uint64_t options, void *data_free);
+inx_t *  linked_alloc(uint64_t options, void *data_free);
+bool_t   linked_append(void *inx, multi_t key, void *data);
+bool_t   linked_insert(void *inx, multi_t key, void *data);
 
 /// hashed.c
-inx_t * hashed_alloc(uint64_t options, void *data_free);
+inx_t *    hashed_alloc(uint64_t options, void *data_free);
+uint64_t   hashed_hash_fletcher(multi_t key, uint64_t seed);
+uint64_t   hashed_hash_murmur(multi_t key, uint64_t seed);
+bool_t     hashed_hash_set(void *inx, inx_hash_t hash);
+uint64_t   hashed_hash_wyhash(multi_t key, uint64_t seed);
+uint64_t   hashed_insert_batch(void *inx, multi_t *keys, void **data, uint64_t count);
+uint64_t   hashed_seed(void *owner);
+
+/// sharded.c
+inx_t *    sharded_alloc(uint64_t options, void *data_free);
+uint64_t   sharded_insert_batch(inx_t *inx, multi_t *keys, void **data, uint64_t count);
+bool_t     sharded_replace(void *inx, multi_t key, void *data);
+inx_t *    sharded_shard(inx_t *inx, multi_t key);
+void       sharded_stats(inx_t *inx, inx_stats_t *stats);
+
+/// slab.c
+void *   slab_alloc(void);
+void     slab_free(void *slab);
+void *   slab_get(void *slab, size_t size);
+void     slab_put(void *slab, void *object, size_t size);
+void     slab_stats(void *slab, inx_stats_t *stats);
+void     slab_truncate(void *slab);
+
+/// tree.c
+inx_t *    tree_alloc(uint64_t options, void *data_free);
+uint64_t   tree_insert_batch(void *inx, multi_t *keys, void **data, uint64_t count);
+int_t      tree_key_compare(multi_t one, multi_t two);
 
 #endif
@@ -19,8 +19,14 @@ void inx_unlock(inx_t *inx) {
 	return;
 }
 
+/**
+ * @brief	Release the lock acquired automatically for an index operation.
+ * @note	Sharded indexes lock the individual shards instead, so the automatic locking functions ignore them.
+ * @param	inx		a pointer to the inx object to be unlocked.
+ * @return	This function returns no value.
+ */
 void inx_auto_unlock(inx_t *inx) {
-	if (inx->automatic) {
+	if (inx->automatic && !(inx->options & M_INX_SHARDED)) {
 		rwlock_unlock(&(inx->lock));
 	}
 	return;
@@ -39,7 +45,7 @@ void inx_lock_read(inx_t *inx) {
 }
 
 void inx_auto_read(inx_t *inx) {
-	if (inx->automatic) {
+	if (inx->automatic && !(inx->options & M_INX_SHARDED)) {
 		rwlock_lock_read(&(inx->lock));
 	}
 	return;
@@ -58,7 +64,7 @@ void inx_lock_write(inx_t *inx) {
 }
 
 void inx_auto_write(inx_t *inx) {
-	if (inx->automatic) {
+	if (inx->automatic && !(inx->options & M_INX_SHARDED)) {
 		rwlock_lock_write(&(inx->lock));
 	}
 	return;
@@ -87,6 +93,37 @@ uint64_t inx_options(inx_t *inx) {
 	return options;
 }
 
+/**
+ * @brief	Change the function used to hash the keys of an inx object.
+ * @note	Only hashed indexes support this operation, and only while they are empty. Sharded indexes always route keys
+ * 			using their own seeded hash, so they don't support it either.
+ * @param	inx		a pointer to the inx object to be updated.
+ * @param	hash	a pointer to the new hash function.
+ * @return	true if the hash function was updated, or false on failure.
+ */
+bool_t inx_hash_set(inx_t *inx, inx_hash_t hash) {
+
+	bool_t result;
+
+#ifdef MAGMA_PEDANTIC
+	if (!inx || !hash) {
+		log_pedantic("An invalid index or hash function pointer was passed in.");
+		return false;
+	}
+#endif
+
+	if ((inx->options & (MAGMA_INDEX_TYPE | M_INX_SHARDED)) != M_INX_HASHED) {
+		log_pedantic("Only unsharded hashed indexes support custom hash functions.");
+		return false;
+	}
+
+	inx_auto_write(inx);
+	result = hashed_hash_set(inx, hash);
+	inx_auto_unlock(inx);
+
+	return result;
+}
+
 /**
  * @brief	Return the total number of items held by an inx object.
  * @param	inx		a pointer to the inx object to be examined.
@@ -128,6 +165,38 @@ uint64_t inx_serial(inx_t *inx) {
 	return serial;
 }
 
+/**
+ * @brief	Report the memory footprint of an inx object.
+ * @note	The slab values are only populated for indexes created with the M_INX_SLAB option. For sharded indexes the values
+ * 			are summed across the shards, which are examined one at a time.
+ * @param	inx		a pointer to the inx object to be examined.
+ * @param	stats	a pointer to a statistics object which will receive the values.
+ * @return	true on success, or false if an invalid parameter was passed in.
+ */
+bool_t inx_stats(inx_t *inx, inx_stats_t *stats) {
+
+#ifdef MAGMA_PEDANTIC
+	if (!inx || !stats) {
+		log_pedantic("An invalid index or statistics pointer was passed in.");
+		return false;
+	}
+#endif
+
+	mm_wipe(stats, sizeof(inx_stats_t));
+
+	if (inx->options & M_INX_SHARDED) {
+		sharded_stats(inx, stats);
+		return true;
+	}
+
+	inx_auto_read(inx);
+	stats->records = inx->count;
+	slab_stats(inx->slab, stats);
+	inx_auto_unlock(inx);
+
+	return true;
+}
+
 /**
  * @brief	Append a new record onto an inx holder.
  * @note	This function only provides benefits for some inx types (like linked lists). For other index types, it simply
@@ -152,6 +221,10 @@ bool_t inx_append(inx_t *inx, multi_t key, void *data) {
 	result = inx->append(inx, key, data);
 	inx_auto_unlock(inx);
 
+	if (inx->options & M_INX_RCU) {
+		epoch_advance();
+	}
+
 	return result;
 }
 
@@ -177,6 +250,66 @@ bool_t inx_insert(inx_t *inx, multi_t key, void *data) {
 	result = inx->insert(inx, key, data);
 	inx_auto_unlock(inx);
 
+	if (inx->options & M_INX_RCU) {
+		epoch_advance();
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Insert a batch of records into an inx holder, while only acquiring the lock once.
+ * @note	Hashed indexes are resized once to fit the entire batch, and an empty tree is built bottom up from the sorted keys,
+ * 			rather than through a series of inserts and splits. Other index types insert the records one at a time. If an
+ * 			insert fails, the remaining records are skipped, so the records which were inserted are always a prefix of the
+ * 			batch. The exception is sharded indexes, where each shard is loaded independently.
+ * @param	inx		a pointer to the inx object that will hold the records.
+ * @param	keys	an array of multi-type values specifying the identifiers of the records to be inserted.
+ * @param	data	an array of pointers to the data associated with each key, or NULL if every record should have a NULL value.
+ * @param	count	the number of records in the batch.
+ * @return	the number of records inserted successfully.
+ */
+uint64_t inx_insert_batch(inx_t *inx, multi_t *keys, void **data, uint64_t count) {
+
+	uint64_t result = 0;
+
+#ifdef MAGMA_PEDANTIC
+	if (!inx || !(inx->insert) || (count && !keys)) {
+		log_pedantic("Invalid index, function or key array pointer.");
+		return 0;
+	}
+#endif
+
+	if (!count) {
+		return 0;
+	}
+	// Sharded indexes group the records, and then lock each shard once.
+	else if (inx->options & M_INX_SHARDED) {
+		return sharded_insert_batch(inx, keys, data, count);
+	}
+
+	inx_auto_write(inx);
+
+	switch (inx->options & MAGMA_INDEX_TYPE) {
+	case M_INX_TREE:
+		result = tree_insert_batch(inx, keys, data, count);
+		break;
+	case M_INX_HASHED:
+		result = hashed_insert_batch(inx, keys, data, count);
+		break;
+	default:
+		while (result < count && inx->insert(inx, keys[result], data ? data[result] : NULL)) {
+			result++;
+		}
+		break;
+	}
+
+	inx_auto_unlock(inx);
+
+	if (inx->options & M_INX_RCU) {
+		epoch_advance();
+	}
+
 	return result;
 }
 
@@ -198,6 +331,11 @@ bool_t inx_replace(inx_t *inx, multi_t key, void *data) {
 	}
 #endif
 
+	// Sharded indexes only lock the shard holding the key.
+	if (inx->options & M_INX_SHARDED) {
+		return sharded_replace(inx, key, data);
+	}
+
 	inx_auto_write(inx);
 	// Delete the existing record, if there is one.
 	inx->delete(inx, key);
@@ -205,6 +343,10 @@ bool_t inx_replace(inx_t *inx, multi_t key, void *data) {
 	result = inx->insert(inx, key, data);
 	inx_auto_unlock(inx);
 
+	if (inx->options & M_INX_RCU) {
+		epoch_advance();
+	}
+
 	return result;
 
 }
@@ -230,11 +372,96 @@ bool_t inx_delete(inx_t *inx, multi_t key) {
 	result = inx->delete(inx, key);
 	inx_auto_unlock(inx);
 
+	if (inx->options & M_INX_RCU) {
+		epoch_advance();
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Delete a batch of keys from an inx object, while only acquiring the lock once.
+ * @note	Sharded indexes lock the shard holding each key individually.
+ * @param	inx		a pointer to the inx object to be searched.
+ * @param	keys	an array of keys identifying the records to be deleted.
+ * @param	count	the number of keys in the array.
+ * @return	the number of records deleted.
+ */
+uint64_t inx_delete_batch(inx_t *inx, multi_t *keys, uint64_t count) {
+
+	uint64_t result = 0;
+
+#ifdef MAGMA_PEDANTIC
+	if (!inx || !(inx->delete) || (count && !keys)) {
+		log_pedantic("Invalid index, function or key array pointer.");
+		return 0;
+	}
+#endif
+
+	inx_auto_write(inx);
+	for (uint64_t i = 0; i < count; i++) {
+		if (inx->delete(inx, keys[i])) {
+			result++;
+		}
+	}
+	inx_auto_unlock(inx);
+
+	if (inx->options & M_INX_RCU) {
+		epoch_advance();
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Find the values associated with a batch of keys, while only acquiring the lock once.
+ * @note	Indexes created with the M_INX_RCU option are searched inside a single epoch critical section instead. The same
+ * 			caveat as inx_find() applies: the results are only guaranteed to remain valid while a concurrent writer deletes
+ * 			the records if the caller holds its own critical section.
+ * @param	inx		a pointer to the inx object to be searched.
+ * @param	keys	an array of keys to be found.
+ * @param	results	an array which will receive the value associated with each key, or NULL if the key wasn't found.
+ * @param	count	the number of keys in the array.
+ * @return	the number of keys which were found, not counting any records with a NULL value.
+ */
+uint64_t inx_find_batch(inx_t *inx, multi_t *keys, void **results, uint64_t count) {
+
+	bool_t rcu;
+	uint64_t result = 0;
+
+#ifdef MAGMA_PEDANTIC
+	if (!inx || !(inx->find) || (count && (!keys || !results))) {
+		log_pedantic("Invalid index, function, key or result array pointer.");
+		return 0;
+	}
+#endif
+
+	if (!(rcu = (inx->options & M_INX_RCU) && epoch_enter())) {
+		inx_auto_read(inx);
+	}
+
+	for (uint64_t i = 0; i < count; i++) {
+		if ((results[i] = inx->find(inx, keys[i]))) {
+			result++;
+		}
+	}
+
+	if (rcu) {
+		epoch_exit();
+	}
+	else {
+		inx_auto_unlock(inx);
+	}
+
 	return result;
 }
 
 /**
  * @brief	Find the value associated with a particular key within the children of an inx object.
+ * @note	Indexes created with the M_INX_RCU option are searched without acquiring the index lock. The search is performed
+ * 			inside an epoch critical section instead, which keeps any records removed by a concurrent writer alive until
+ * 			the search is complete. A caller which needs the returned data to remain valid while a concurrent writer deletes
+ * 			the record should wrap the call, and its use of the result, inside its own epoch_enter() and epoch_exit() pair.
  * @param	inx		a pointer to the inx object to be searched.
  * @param	key		the target key to be found.
  * @return	NULL on failure, or the value associated with the requested key on success.
@@ -250,6 +477,13 @@ void * inx_find(inx_t *inx, multi_t key) {
 	}
 #endif
 
+	// If the calling thread can't be registered as a reader, fall back to the lock.
+	if ((inx->options & M_INX_RCU) && epoch_enter()) {
+		result = inx->find(inx, key);
+		epoch_exit();
+		return result;
+	}
+
 	inx_auto_read(inx);
 	result = inx->find(inx, key);
 	inx_auto_unlock(inx);
@@ -257,6 +491,52 @@ void * inx_find(inx_t *inx, multi_t key) {
 	return result;
 }
 
+/**
+ * @brief	Release a key which has been removed from an index.
+ * @note	If the index was created with the M_INX_RCU option, the key buffer is retired instead, since a lock free reader
+ * 			may still be comparing against it.
+ * @param	inx		a pointer to the inx object which held the key.
+ * @param	key		the key to be released.
+ * @return	This function returns no value.
+ */
+void inx_release_key(inx_t *inx, multi_t key) {
+
+	if (!(inx->options & M_INX_RCU)) {
+		mt_free(key);
+	}
+	else if (key.type == M_TYPE_STRINGER) {
+		epoch_retire(key.val.st, (void (*)(void *))&st_free);
+	}
+	else if (key.type == M_TYPE_NULLER) {
+		epoch_retire(key.val.ns, (void (*)(void *))&ns_free);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Release the data associated with a record which has been removed from an index.
+ * @note	If the index was created with the M_INX_RCU option, the data is retired instead, since a lock free reader may
+ * 			have just returned it.
+ * @param	inx		a pointer to the inx object which held the record.
+ * @param	data	a pointer to the record data to be released.
+ * @return	This function returns no value.
+ */
+void inx_release_data(inx_t *inx, void *data) {
+
+	if (!data || !inx->data_free) {
+		return;
+	}
+	else if (inx->options & M_INX_RCU) {
+		epoch_retire(data, inx->data_free);
+	}
+	else {
+		inx->data_free(data);
+	}
+
+	return;
+}
+
 void inx_free(inx_t *inx) {
 
 	uint64_t refs;
@@ -268,13 +548,20 @@ void inx_free(inx_t *inx) {
 	}
 #endif
 
+	// The reference count is updated atomically, since sharded indexes don't acquire the index lock.
 	inx_auto_write(inx);
-	inx->references--;
-	refs = inx->references;
+	refs = __sync_sub_and_fetch(&(inx->references), 1);
 	inx_auto_unlock(inx);
 
 	if (!refs) {
 		inx->index_free(inx);
+
+		// Hand off any records retired while the index was being freed.
+		if (inx->options & M_INX_RCU) {
+			epoch_advance();
+		}
+
+		slab_free(inx->slab);
 		rwlock_destroy(&(inx->lock));
 		mm_free(inx);
 	}
@@ -295,6 +582,10 @@ void inx_truncate(inx_t *inx) {
 	inx->index_truncate(inx);
 	inx_auto_unlock(inx);
 
+	if (inx->options & M_INX_RCU) {
+		epoch_advance();
+	}
+
 	return;
 }
 
@@ -312,7 +603,10 @@ void inx_cleanup(inx_t *inx) {
 
 /**
  * @brief	Allocate a new inx instance.
- * @param	options	 	a value indicating the inx type. Can be M_INX_TREE for a binary tree, M_INX_LINKED for a linked list, or M_INX_HASHED for a hash tree.
+ * @param	options	 	a value indicating the inx type. Can be M_INX_TREE for a B+tree, M_INX_LINKED for a linked list, or M_INX_HASHED for a hash tree.
+ * 						The M_INX_SHARDED flag spreads the records across several independently locked indexes of the chosen type.
+ * 						The M_INX_RCU flag allows hashed and tree indexes to be searched without acquiring a lock.
+ * 						The M_INX_SLAB flag allocates the nodes of linked and tree indexes from a slab owned by the index.
  * @param	data_free	a function pointer to a routine to free the data associated with an inx record.
  * @return	NULL on failure or a pointer to the newly created inx object on success.
  */
@@ -320,23 +614,42 @@ inx_t * inx_alloc(uint64_t options, void *data_free) {
 
 	inx_t *inx = NULL;
 
+	// Linked lists are walked in place by their writers, so they can't be searched without a lock.
+	if ((options & M_INX_RCU) && (options & MAGMA_INDEX_TYPE) == M_INX_LINKED) {
+		log_pedantic("Linked indexes don't support lock free reads. The M_INX_RCU option will be ignored.");
+		options &= ~M_INX_RCU;
+	}
+
+	// Nodes retired by a lock free index are released by whichever thread reclaims them, which can't be done safely
+	// using a slab that is only protected by the index lock. Hashed indexes store their records inline, so they don't
+	// have any nodes which could be allocated from a slab.
+	if ((options & M_INX_SLAB) && ((options & M_INX_RCU) || (options & MAGMA_INDEX_TYPE) == M_INX_HASHED)) {
+		log_pedantic("Only linked and tree indexes without lock free reads support slab allocation. The M_INX_SLAB option will be ignored.");
+		options &= ~M_INX_SLAB;
+	}
+
 	switch (options & MAGMA_INDEX_TYPE) {
-#ifdef MAGMA_PROVIDE_TOKYO_PRIVATE_H
 	case M_INX_TREE:
-		inx = tree_alloc(options, data_free);
+		inx = (options & M_INX_SHARDED) ? sharded_alloc(options, data_free) : tree_alloc(options, data_free);
 		break;
-#endif
 	case M_INX_LINKED:
-		inx = linked_alloc(options, data_free);
+		inx = (options & M_INX_SHARDED) ? sharded_alloc(options, data_free) : linked_alloc(options, data_free);
 		break;
 	case M_INX_HASHED:
-		inx = hashed_alloc(options, data_free);
+		inx = (options & M_INX_SHARDED) ? sharded_alloc(options, data_free) : hashed_alloc(options, data_free);
 		break;
 	default:
 		log_options(M_LOG_ERROR | M_LOG_STACK_TRACE, "Unsupported index type detected. {type = %lu}", options & MAGMA_INDEX_TYPE);
 		break;
 	};
 
+	// The shards of a sharded index each get their own slab.
+	if (inx && (options & M_INX_SLAB) && !(options & M_INX_SHARDED) && !(inx->slab = slab_alloc())) {
+		inx->index_free(inx);
+		mm_free(inx);
+		return NULL;
+	}
+
 	if (inx) {
 		inx->automatic = options & M_INX_LOCK_MANUAL ? 0 : 1;
 		rwlock_init(&(inx->lock), NULL);
@@ -0,0 +1,136 @@
+/**
+ * @file /magma/core/indexes/keys.c
+ *
+ * @brief	Index keys, which store short strings inline instead of duplicating them onto the heap.
+ *
+ * @note	Most of the string keys stored by an index, like header names and user names, are only a few bytes long. Rather
+ * 			than making a heap copy of every one of them, strings of up to MAGMA_INX_KEY_INLINE bytes are copied directly into
+ * 			the key, alongside their length and the hash assigned by the index. Comparing a probe against an inline key then
+ * 			only requires checking the hash and length, followed by a short memory comparison, without following a pointer.
+ * 			Longer strings, and numeric keys, are held as a regular multi-type value. Inline keys are currently only used by the
+ * 			hashed index, while the linked and tree indexes still hold a duplicated multi-type value for every key. A heap
+ * 			copy of an inline key is only made if a cursor returns it, since callers expect a cursor key to stay valid until
+ * 			its record is deleted.
+ */
+
+#include "magma.h"
+
+/**
+ * @brief	Store a copy of a key.
+ * @param	key		a pointer to the index key which will receive the copy.
+ * @param	multi	the multi-type key to be copied.
+ * @param	hash	the hash value assigned to the key by the index.
+ * @return	true on success, or false if a long string key couldn't be duplicated.
+ */
+bool_t inx_key_set(inx_key_t *key, multi_t multi, uint64_t hash) {
+
+	chr_t *data;
+	size_t length;
+
+	key->hash = hash;
+	key->type = multi.type;
+
+	if ((multi.type == M_TYPE_STRINGER || multi.type == M_TYPE_NULLER) && (data = mt_get_char(&multi)) &&
+		(length = mt_get_length(multi)) <= MAGMA_INX_KEY_INLINE) {
+
+		// The unused bytes are cleared, so the inline value is always terminated.
+		mm_wipe(key->val.chars, sizeof(key->val.chars));
+		mm_copy(key->val.chars, data, length);
+		key->length = length;
+		key->copy = NULL;
+
+		return true;
+	}
+
+	key->copy = NULL;
+	key->length = MAGMA_INX_KEY_MULTI;
+	key->val.multi = mt_dupe(multi);
+
+	if ((multi.type == M_TYPE_STRINGER && !key->val.multi.val.st) || (multi.type == M_TYPE_NULLER && !key->val.multi.val.ns) ||
+		(key->val.multi.type == M_TYPE_EMPTY && multi.type != M_TYPE_EMPTY)) {
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Get a multi-type value holding an index key, which remains valid until the key is released.
+ * @note	Inline keys move along with their slot when a hashed index is resized, so the first request for an inline key makes
+ * 			a heap copy, which is kept alongside the key and released with it. Callers must ensure only one thread requests
+ * 			a given key at a time.
+ * @param	key		a pointer to the index key.
+ * @return	a multi-type value holding the key, or a null multi-type value if the heap copy couldn't be made.
+ */
+multi_t inx_key_get(inx_key_t *key) {
+
+	multi_t result;
+
+	if (key->length == MAGMA_INX_KEY_MULTI) {
+		return key->val.multi;
+	}
+	else if (!key->copy && !(key->copy = (key->type == M_TYPE_STRINGER ? (void *)st_import(key->val.chars, key->length) :
+		(void *)ns_import(key->val.chars, key->length)))) {
+		log_pedantic("Unable to copy an inline index key. { length = %hhu }", key->length);
+		return mt_get_null();
+	}
+
+	result.type = key->type;
+
+	if (key->type == M_TYPE_STRINGER) {
+		result.val.st = key->copy;
+	}
+	else {
+		result.val.ns = key->copy;
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Check whether an index key holds the same value as a multi-type key.
+ * @note	Strings short enough to be stored inline are always stored inline, so a longer probe can never match an inline key,
+ * 			and a shorter probe can never match a key held as a multi-type value.
+ * @param	key		a pointer to the index key.
+ * @param	multi	the multi-type key being searched for.
+ * @param	hash	the hash value of the multi-type key, which was generated using the same function as the index key's hash.
+ * @return	true if the keys are identical, or false if they aren't.
+ */
+bool_t inx_key_match(inx_key_t *key, multi_t multi, uint64_t hash) {
+
+	chr_t *data;
+
+	if (key->hash != hash) {
+		return false;
+	}
+	else if (key->length == MAGMA_INX_KEY_MULTI) {
+		return ident_mt_mt(key->val.multi, multi);
+	}
+	else if ((multi.type != M_TYPE_STRINGER && multi.type != M_TYPE_NULLER) || !(data = mt_get_char(&multi)) ||
+		mt_get_length(multi) != key->length) {
+		return false;
+	}
+
+	return !memcmp(key->val.chars, data, key->length);
+}
+
+/**
+ * @brief	Release a key which has been removed from an index.
+ * @note	Inline keys only own memory if a heap copy was made for a cursor, so only that copy, or a key held as a multi-type
+ * 			value, is passed along to inx_release_key().
+ * @param	inx		a pointer to the inx object which held the key.
+ * @param	key		a pointer to the index key being released.
+ * @return	This function returns no value.
+ */
+void inx_key_release(inx_t *inx, inx_key_t *key) {
+
+	if (key->length == MAGMA_INX_KEY_MULTI) {
+		inx_release_key(inx, key->val.multi);
+	}
+	else if (key->copy) {
+		inx_release_key(inx, inx_key_get(key));
+		key->copy = NULL;
+	}
+
+	return;
+}
@@ -7,6 +7,11 @@
 
 #include "magma.h"
 
+/**
+ * The maximum height of a skip list tower. Each level holds roughly a quarter of the nodes found on the level below it.
+ */
+#define MAGMA_LINKED_LEVELS 16
+
 // Linked lists.
 typedef struct __attribute__ ((packed)) {
 	multi_t key;
@@ -14,17 +19,167 @@ typedef struct __attribute__ ((packed)) {
 	uint64_t size, count;
 } linked_record_t;
 
+// The next and prev pointers form the bottom level of the skip list, which holds every node in order. The forward array
+// holds the pointers for the upper levels of the node's tower, so a node with a height of one doesn't have any. The height
+// is stored as a 64-bit value to keep the forward array aligned.
 typedef struct __attribute__ ((packed)) {
 	linked_record_t *record;
 	struct linked_node_t *next, *prev;
+	uint64_t height;
+	struct linked_node_t *forward[];
 } linked_node_t;
 
+// The tower array holds the first node on each level of the skip list, which means the first element is the head of the list.
+typedef struct __attribute__ ((packed)) {
+	linked_node_t *tower[MAGMA_LINKED_LEVELS];
+	uint64_t random;
+	uint32_t levels;
+	bool_t unsorted;
+} linked_list_t;
+
 typedef struct __attribute__ ((packed)) {
 	inx_t *inx;
 	linked_node_t *node;
 	uint64_t serial, count, position;
 } linked_cursor_t;
 
+/**
+ * @brief	Get the first node of a linked list.
+ * @param	index	a pointer to the linked list.
+ * @return	NULL if the list is empty, or a pointer to the first node.
+ */
+linked_node_t * linked_first(inx_t *index) {
+	return index->index ? ((linked_list_t *)index->index)->tower[0] : NULL;
+}
+
+/**
+ * @brief	Get the location of a forward pointer on one level of the skip list.
+ * @param	list	a pointer to the linked list.
+ * @param	node	a pointer to the node which owns the forward pointer, or NULL for the head of the list.
+ * @param	level	the skip list level, where level zero is the bottom level holding every node.
+ * @return	a pointer to the forward pointer.
+ */
+linked_node_t ** linked_forward(linked_list_t *list, linked_node_t *node, uint32_t level) {
+
+	if (!node) {
+		return &(list->tower[level]);
+	}
+
+	return level ? (linked_node_t **)&(node->forward[level - 1]) : (linked_node_t **)&(node->next);
+}
+
+/**
+ * @brief	Pick the tower height for a new skip list node.
+ * @note	Heights follow a geometric distribution with a ratio of one quarter, generated using a per list xorshift state.
+ * @param	list	a pointer to the linked list receiving the node.
+ * @return	the tower height, between one and MAGMA_LINKED_LEVELS.
+ */
+uint32_t linked_height(linked_list_t *list) {
+
+	uint64_t bits;
+	uint32_t height = 1;
+
+	list->random ^= list->random << 13;
+	list->random ^= list->random >> 7;
+	list->random ^= list->random << 17;
+
+	for (bits = list->random; height < MAGMA_LINKED_LEVELS && !(bits & 3); bits >>= 2) {
+		height++;
+	}
+
+	return height;
+}
+
+/**
+ * @brief	Descend the skip list looking for the position of a key.
+ * @param	list	a pointer to the linked list, which must be sorted.
+ * @param	key		the multi-type key being searched for.
+ * @param	upper	if true, find the first node with a key greater than the search key, otherwise the first node with a key
+ * 					greater than or equal to the search key.
+ * @param	update	if not NULL, an array which receives the last node before that position on every level, with NULL
+ * 					representing the head of the list.
+ * @return	NULL if every key is smaller, or a pointer to the first node at or beyond the position of the key.
+ */
+linked_node_t * linked_search(linked_list_t *list, multi_t key, bool_t upper, linked_node_t **update) {
+
+	int_t result;
+	linked_node_t *node = NULL, *next;
+
+	for (uint32_t level = list->levels; level-- > 0;) {
+
+		while ((next = *linked_forward(list, node, level)) && ((result = tree_key_compare(next->record->key, key)) < 0 ||
+			(upper && result == 0))) {
+			node = next;
+		}
+
+		if (update) {
+			update[level] = node;
+		}
+	}
+
+	return *linked_forward(list, node, 0);
+}
+
+/**
+ * @brief	Give up on keeping a linked list sorted.
+ * @note	This happens when a record is appended out of order. The upper levels of the skip list are discarded, and the
+ * 			list is searched sequentially until it has been emptied.
+ * @param	list	a pointer to the linked list.
+ * @return	This function returns no value.
+ */
+void linked_unsort(linked_list_t *list) {
+
+	for (uint32_t level = 1; level < MAGMA_LINKED_LEVELS; level++) {
+		list->tower[level] = NULL;
+	}
+
+	list->levels = 1;
+	list->unsorted = true;
+
+	return;
+}
+
+/**
+ * @brief	Unlink a node from every level of a linked list.
+ * @param	index	a pointer to the linked list.
+ * @param	node	a pointer to the node being removed.
+ * @param	update	the array of nodes which precede the node's key on every level, as returned by linked_search(), or NULL
+ * 					if the list is unsorted and only the bottom level needs to be updated.
+ * @return	This function returns no value.
+ */
+void linked_unlink(inx_t *index, linked_node_t *node, linked_node_t **update) {
+
+	linked_node_t *previous, *next;
+	linked_list_t *list = index->index;
+
+	// A run of equal keys means the node may sit further along than the nodes found by the search, so we walk forward.
+	for (uint32_t level = 1; update && level < node->height; level++) {
+		for (previous = update[level]; (next = *linked_forward(list, previous, level)) != node; previous = next);
+		*linked_forward(list, previous, level) = (linked_node_t *)node->forward[level - 1];
+	}
+
+	*linked_forward(list, (linked_node_t *)node->prev, 0) = (linked_node_t *)node->next;
+
+	if (node->next) {
+		((linked_node_t *)node->next)->prev = node->prev;
+	}
+	else {
+		index->last = node->prev;
+	}
+
+	while (list->levels > 1 && !list->tower[list->levels - 1]) {
+		list->levels--;
+	}
+
+	// Once the list is empty, it can be kept sorted again.
+	if (!list->tower[0]) {
+		list->levels = 1;
+		list->unsorted = false;
+	}
+
+	return;
+}
+
 /**
  * @brief	Get the data associated with a linked list record.
  * @param	record		a pointer to the linked list record to be queried.
@@ -75,21 +230,22 @@ void linked_record_free(inx_t *index, linked_record_t *record) {
 	if (!record) return;
 	if (index && index->data_free) index->data_free(record->data);
 	mt_free(record->key);
-	mm_free(record);
+	slab_put(index ? index->slab : NULL, record, sizeof(linked_record_t));
 	return;
 }
 
 /**
  * @brief	Create a new linked list record object.
+ * @param	index	a pointer to the linked list which will hold the record.
  * @param	key		the multi-type key value of the record to be used for data searches.
  * @param	data	a pointer to the data to be associated with the record.
  * @return	a pointer to the newly allocated and initialized linked record object.
  */
-linked_record_t * linked_record_alloc(multi_t key, void *data) {
+linked_record_t * linked_record_alloc(inx_t *index, multi_t key, void *data) {
 
 	linked_record_t *record;
 
-	if ((record = mm_alloc(sizeof(linked_record_t))) == NULL) return NULL;
+	if ((record = slab_get(index->slab, sizeof(linked_record_t))) == NULL) return NULL;
 
 	record->key = mt_dupe(key);
 	record->data = data;
@@ -98,8 +254,83 @@ linked_record_t * linked_record_alloc(multi_t key, void *data) {
 	return record;
 }
 
+/**
+ * @brief	Allocate a linked list node, along with its record.
+ * @param	index	a pointer to the linked list which will hold the node.
+ * @param	key		the multi-type key value of the record.
+ * @param	data	a pointer to the data to be associated with the record.
+ * @param	height	the height of the node's skip list tower.
+ * @return	NULL on failure, or a pointer to the newly allocated node on success.
+ */
+linked_node_t * linked_node_alloc(inx_t *index, multi_t key, void *data, uint32_t height) {
+
+	linked_node_t *node;
+	size_t length = sizeof(linked_node_t) + (sizeof(linked_node_t *) * (height - 1));
+
+	if ((node = slab_get(index->slab, length)) == NULL) {
+		log_info("Unable to allocate %zu bytes for a linked node.", length);
+		return NULL;
+	}
+	else if ((node->record = linked_record_alloc(index, key, data)) == NULL) {
+		log_info("Unable to allocate an index record.");
+		slab_put(index->slab, node, length);
+		return NULL;
+	}
+
+	node->height = height;
+	return node;
+}
+
+/**
+ * @brief	Free a linked list node, along with its record and the underlying data.
+ * @param	index	a pointer to the linked list which held the node.
+ * @param	node	a pointer to the node being freed, which must already be unlinked.
+ * @return	This function returns no value.
+ */
+void linked_node_free(inx_t *index, linked_node_t *node) {
+
+	linked_record_free(index, node->record);
+	slab_put(index->slab, node, sizeof(linked_node_t) + (sizeof(linked_node_t *) * (node->height - 1)));
+
+	return;
+}
+
+/**
+ * @brief	Find the first node in a linked list with a given key.
+ * @param	index	a pointer to the linked list to be searched.
+ * @param	key		the multi-type key being searched for.
+ * @param	update	if not NULL, an array which receives the nodes preceding the key on every level of a sorted list.
+ * @return	NULL if the key isn't found, or a pointer to the first node holding the key.
+ */
+linked_node_t * linked_locate(inx_t *index, multi_t key, linked_node_t **update) {
+
+	linked_node_t *node;
+	linked_list_t *list = index->index;
+
+	// If the list isn't sorted we have to fall back on a sequential search.
+	if (list->unsorted) {
+		node = list->tower[0];
+		while (node != NULL && node->record != NULL && ident_mt_mt(node->record->key, key) != true) {
+			node = (linked_node_t *)node->next;
+		}
+		return node;
+	}
+
+	node = linked_search(list, key, false, update);
+
+	while (node && !tree_key_compare(node->record->key, key)) {
+		if (ident_mt_mt(node->record->key, key)) {
+			return node;
+		}
+		node = (linked_node_t *)node->next;
+	}
+
+	return NULL;
+}
+
 /**
  * @brief	Find a record in a linked list by key.
+ * @note	Sorted lists are searched using the skip list, so the search takes logarithmic time.
  * @param	inx		a pointer to the linked list to be searched.
  * @param	key		a multi-type key value to be searched against the contents of the inx object.
  * @return	NULL on failure or if the record cannot be found, or a pointer to the data of the matching record on success.
@@ -113,14 +344,8 @@ void * linked_find(void *inx, multi_t key) {
 		return NULL;
 	}
 
-	node = index->index;
-
-	while (node != NULL && node->record != NULL && ident_mt_mt(node->record->key, key) != true) {
-		node = (linked_node_t *)node->next;
-	}
-
 	// We didn't find the correct node, or the index is corrupted.
-	if (node == NULL || node->record == NULL) {
+	if ((node = linked_locate(index, key, NULL)) == NULL || node->record == NULL) {
 		return NULL;
 	}
 
@@ -136,54 +361,30 @@ void * linked_find(void *inx, multi_t key) {
 bool_t linked_delete(void *inx, multi_t key) {
 
 	inx_t *index = inx;
-	linked_node_t *node = NULL;
+	linked_node_t *node = NULL, *update[MAGMA_LINKED_LEVELS];
 
 	if (index == NULL || index->index == NULL || index->count == 0) {
 		return false;
 	}
 
-	node = index->index;
-
-	while (node != NULL && node->record != NULL && ident_mt_mt(node->record->key, key) != true) {
-		node = (linked_node_t *)node->next;
-	}
-
 	// We didn't find the correct node, or the index is corrupted.
-	if (node == NULL || node->record == NULL) {
+	if ((node = linked_locate(index, key, update)) == NULL || node->record == NULL) {
 //		log_pedantic("Couldn't find the node.");
 		return false;
 	}
 
-	// Handle the special case where this is the first node.
-	if (index->index == node) {
-		index->index = node->next;
-	}
-
-	// Handle the special case where this is the last node.
-	if (index->last == node) {
-		index->last = node->prev;
-	}
-
-	// Handle situations where this node is in the middle of a list, by connecting the previous node with the next node.
-	if (node && node->prev) {
-		((linked_node_t *)node->prev)->next = node->next;
-	}
-
-	// And the next node with the previous node.
-	if (node && node->next) {
-		((linked_node_t *)node->next)->prev = node->prev;
-	}
+	linked_unlink(index, node, ((linked_list_t *)index->index)->unsorted ? NULL : update);
 
-	linked_record_free(index, node->record);
-	mm_free(node);
+	linked_node_free(index, node);
 	index->count--;
 	index->serial++;
 	return true;
 }
 
 /**
- * @brief	Create and append a new record to the end of a linked list.
- * @note	note	In the future this should be updated so the key value is used to insert the record in the correct spot.
+ * @brief	Create a new record and insert it into a linked list, in key order.
+ * @note	Records with duplicate keys are placed after any existing records with the same key. If the list is no longer
+ * 			sorted, because a record was appended out of order, the new record is simply appended to the end of the list.
  * @param	inx		a pointer to the linked list that will store the new record.
  * @param	key		a multi-type key value that will be associated with the newly created record.
  * @param	data	a pointer to the data that will be associated with the new record.
@@ -191,41 +392,40 @@ bool_t linked_delete(void *inx, multi_t key) {
  */
 bool_t linked_insert(void *inx, multi_t key, void *data) {
 
+	uint32_t height;
 	inx_t *index = inx;
-	linked_node_t *holder, *node;
+	linked_list_t *list;
+	linked_node_t *node, *update[MAGMA_LINKED_LEVELS];
 
-	if ((node = mm_alloc(sizeof(linked_node_t))) == NULL) {
-		log_info("Unable to allocate %zu bytes for a linked node.", sizeof(linked_node_t));
+	if (index == NULL || (list = index->index) == NULL) {
 		return false;
 	}
-	else if ((node->record = linked_record_alloc(key, data)) == NULL) {
-		log_info("Unable to allocate an index record.");
-		mm_free(node);
+	else if (list->unsorted) {
+		return linked_append(inx, key, data);
+	}
+	else if ((node = linked_node_alloc(index, key, data, (height = linked_height(list)))) == NULL) {
 		return false;
 	}
 
-	// In this situation the first node is also the last node.
-	if (index->index == NULL) {
-		index->index = index->last = node;
-	}
-	else {
+	linked_search(list, key, true, update);
 
-		// Grab the first record in the linked list.
-		holder = index->index;
+	// A taller node grows the list, and the head of the list precedes it on the new levels.
+	for (; list->levels < height; list->levels++) {
+		update[list->levels] = NULL;
+	}
 
-		/// TODO: We are simply looking for the end. The append variation handles this use case. Insert should be using the
-		/// key value to find the appropriate place to insert the record.
-		// Iterate through the list until we reach the end.
-		while (holder->next != NULL) {
-			holder = (linked_node_t *)holder->next;
-		}
+	for (uint32_t level = 0; level < height; level++) {
+		*linked_forward(list, node, level) = *linked_forward(list, update[level], level);
+		*linked_forward(list, update[level], level) = node;
+	}
 
-		node->prev = (struct linked_node_t *)holder;
-		holder->next = (struct linked_node_t *)node;
+	node->prev = (struct linked_node_t *)update[0];
 
-		/// TODO: When the logic is altered to do a comparison, and insert nodes in the proper place this assignment will
-		/// need to become a conditional.
-		index->last = (struct linked_node_t *)node;
+	if (node->next) {
+		((linked_node_t *)node->next)->prev = (struct linked_node_t *)node;
+	}
+	else {
+		index->last = node;
 	}
 
 	index->count++;
@@ -235,7 +435,9 @@ bool_t linked_insert(void *inx, multi_t key, void *data) {
 
 /**
  * @brief	Create and append a new record to the end of a linked list.
- * @note	This function deppends on the inx layer to track the list ending via the last variable.
+ * @note	This function deppends on the inx layer to track the list ending via the last variable. If the new key sorts before
+ * 			the last key in the list, the list stops being sorted, and searches fall back to a sequential scan until the list
+ * 			has been emptied.
  * @param	inx		a pointer to the linked list that will store the new record.
  * @param	key		a multi-type key value that will be associated with the newly created record.
  * @param	data	a pointer to the data that will be associated with the new record.
@@ -244,21 +446,28 @@ bool_t linked_insert(void *inx, multi_t key, void *data) {
 bool_t linked_append(void *inx, multi_t key, void *data) {
 
 	inx_t *index = inx;
+	linked_list_t *list;
 	linked_node_t *holder, *node;
 
-	if ((node = mm_alloc(sizeof(linked_node_t))) == NULL) {
-		log_info("Unable to allocate %zu bytes for a linked node.", sizeof(linked_node_t));
+	if (index == NULL || (list = index->index) == NULL) {
 		return false;
 	}
-	else if ((node->record = linked_record_alloc(key, data)) == NULL) {
-		log_info("Unable to allocate an index record.");
-		mm_free(node);
+
+	// If the key doesn't sort before the last key, then a sorted insert will place it at the end of the list anyway.
+	if (!list->unsorted) {
+		if (!index->last || tree_key_compare(((linked_node_t *)index->last)->record->key, key) <= 0) {
+			return linked_insert(inx, key, data);
+		}
+		linked_unsort(list);
+	}
+
+	if ((node = linked_node_alloc(index, key, data, 1)) == NULL) {
 		return false;
 	}
 
 	// In this situation the first node is also the last node.
-	if (index->index == NULL) {
-		index->index = index->last = node;
+	if (list->tower[0] == NULL) {
+		list->tower[0] = index->last = node;
 	}
 	else {
 
@@ -298,7 +507,7 @@ linked_node_t * linked_cursor_active(linked_cursor_t *cursor) {
 	}
 
 	if (cursor->node) {
-		node = cursor->inx->index;
+		node = linked_first(cursor->inx);
 		while (node && node != cursor->node) {
 			node = (linked_node_t *)node->next;
 			position++;
@@ -324,7 +533,7 @@ linked_node_t * linked_cursor_active(linked_cursor_t *cursor) {
 	}
 
 	// Use the counter to find our place if the data pointer wasn't found above.
-	node = cursor->inx->index;
+	node = linked_first(cursor->inx);
 	position = cursor->position;
 	while (node && position--) {
 		node = (linked_node_t *)node->next;
@@ -356,7 +565,7 @@ linked_node_t * linked_cursor_next(linked_cursor_t *cursor) {
 		}
 	}
 	else {
-			cursor->node = node = cursor->inx->index;
+			cursor->node = node = linked_first(cursor->inx);
 	}
 
 	return node;
@@ -480,22 +689,29 @@ void * linked_cursor_alloc(inx_t *inx) {
 void linked_truncate(void *inx) {
 
 	inx_t *index = inx;
+	linked_list_t *list;
 	linked_node_t *node, *next;
 
-	if (index == NULL || index->index == NULL) {
+	if (index == NULL || (list = index->index) == NULL) {
 		return;
 	}
 
-	node = index->index;
+	node = list->tower[0];
 
 	while (node != NULL) {
 		next = (linked_node_t *)node->next;
-		linked_record_free(index, node->record);
-		mm_free(node);
+		linked_node_free(index, node);
 		node = next;
 	}
 
-	index->index = index->last = NULL;
+	// Any chunks held by the slab can now be returned to the system in bulk.
+	slab_truncate(index->slab);
+
+	mm_wipe(list->tower, sizeof(list->tower));
+	list->levels = 1;
+	list->unsorted = false;
+
+	index->last = NULL;
 	index->count = 0;
 	index->serial++;
 
@@ -516,14 +732,18 @@ void linked_free(void *inx) {
 		return;
 	}
 
-	// For linked lists truncation involves the same steps as free.
+	// For linked lists truncation involves the same steps as free, except the list header is also released.
 	linked_truncate(inx);
 
+	mm_free(index->index);
+	index->index = NULL;
 	return;
 }
 
 /**
  * @brief	Allocate a new linked list instance.
+ * @note	Records added using insert are kept in key order, using a skip list so searches take logarithmic time. Records
+ * 			added using append are always placed at the end of the list.
  * @param	options		an options value for the newly created linked list object.
  * @param	data_free	a pointer to a function used to free linked list items.
  * @return	NULL on failure or a pointer to the newly allocated linked list object on success.
@@ -531,11 +751,21 @@ void linked_free(void *inx) {
 inx_t * linked_alloc(uint64_t options, void *data_free) {
 
 	inx_t *result;
+	linked_list_t *list;
+
+	if ((result = mm_alloc(sizeof(inx_t))) == NULL) {
+		return NULL;
+	}
+	else if ((result->index = list = mm_alloc(sizeof(linked_list_t))) == NULL) {
+		mm_free(result);
+		return NULL;
+	}
 
-	if ((result = mm_alloc(sizeof(inx_t))) == NULL) return NULL;
+	// The xorshift state used to pick tower heights must never be zero.
+	list->random = hashed_seed(list) | 1;
+	list->levels = 1;
 
 	result->last = NULL;
-	result->index = NULL;
 
 	result->options = options;
 	result->data_free = data_free;
@@ -0,0 +1,445 @@
+/**
+ * @file /magma/core/indexes/sharded.c
+ *
+ * @brief	A sharded index, which spreads records across several independently locked indexes of the same type.
+ *
+ * @note	Keys are routed to a shard using a seeded hash, so writers operating on different keys will usually contend for
+ * 			different locks. The index wide record count and serial number are maintained using atomic operations, which
+ * 			means the generic interface never needs to acquire the lock for the sharded index itself. Cursors iterate
+ * 			through the shards one at a time, so a sharded tree only returns keys in order within each shard.
+ */
+
+#include "magma.h"
+
+#define MAGMA_SHARDED_MIN 8
+#define MAGMA_SHARDED_MAX 256
+
+typedef struct __attribute__ ((packed)) {
+	inx_t **shards;
+	uint64_t seed, count;
+} sharded_index_t;
+
+typedef struct __attribute__ ((packed)) {
+	inx_t *inx;
+	uint64_t shard;
+	inx_cursor_t *cursor;
+} sharded_cursor_t;
+
+/**
+ * @brief	Get the position of the shard responsible for a key.
+ * @param	sharded	the sharded index data.
+ * @param	key		a multi-type key; numbers and strings are supported.
+ * @return	the position of the shard in the shard array.
+ */
+uint64_t sharded_position(sharded_index_t *sharded, multi_t key) {
+	// The high bits are used for routing, since hashed shards use the low bits to select a probe group.
+	return (hashed_hash_wyhash(key, sharded->seed) >> 32) & (sharded->count - 1);
+}
+
+/**
+ * @brief	Get the shard responsible for a key.
+ * @param	inx		the sharded index.
+ * @param	key		a multi-type key; numbers and strings are supported.
+ * @return	a pointer to the shard which holds records with the specified key.
+ */
+inx_t * sharded_shard(inx_t *inx, multi_t key) {
+
+	sharded_index_t *sharded = inx->index;
+
+	return sharded->shards[sharded_position(sharded, key)];
+}
+
+bool_t sharded_insert(void *inx, multi_t key, void *data) {
+
+	inx_t *index = inx;
+
+	if (index == NULL || index->index == NULL || !inx_insert(sharded_shard(index, key), key, data)) {
+		return false;
+	}
+
+	__sync_add_and_fetch(&(index->count), 1);
+	__sync_add_and_fetch(&(index->serial), 1);
+	return true;
+}
+
+/**
+ * @brief	Insert a batch of records into a sharded index.
+ * @note	The records are grouped by shard, and each group is inserted as a batch, so every shard is only locked once. If
+ * 			the grouping arrays can't be allocated, the records are inserted one at a time.
+ * @param	inx		a pointer to the sharded index.
+ * @param	keys	an array of keys for the new records.
+ * @param	data	an array of data pointers associated with the keys, or NULL if every record should have a NULL value.
+ * @param	count	the number of records in the batch.
+ * @return	the number of records inserted. If an insert fails, the remaining records bound for the same shard are skipped,
+ * 			but the other shards are still loaded.
+ */
+uint64_t sharded_insert_batch(inx_t *inx, multi_t *keys, void **data, uint64_t count) {
+
+	size_t length;
+	multi_t *grouped;
+	void **values;
+	uint64_t *positions, *offsets, inserted = 0;
+	sharded_index_t *sharded;
+
+	if (inx == NULL || (sharded = inx->index) == NULL) {
+		return 0;
+	}
+
+	length = (sizeof(uint64_t) * (count + sharded->count + 1)) + ((sizeof(multi_t) + sizeof(void *)) * count);
+
+	if (!(positions = mm_alloc(length))) {
+		log_pedantic("Failed to allocate %zu bytes for grouping a sharded index batch.", length);
+		while (inserted < count && sharded_insert(inx, keys[inserted], data ? data[inserted] : NULL)) {
+			inserted++;
+		}
+		return inserted;
+	}
+
+	offsets = positions + count;
+	grouped = (multi_t *)(offsets + sharded->count + 1);
+	values = (void **)(grouped + count);
+
+	// Count the records bound for each shard, then turn the counts into offsets, and scatter the records into groups.
+	for (uint64_t i = 0; i < count; i++) {
+		positions[i] = sharded_position(sharded, keys[i]);
+		offsets[positions[i] + 1]++;
+	}
+
+	for (uint64_t i = 1; i <= sharded->count; i++) {
+		offsets[i] += offsets[i - 1];
+	}
+
+	for (uint64_t i = 0; i < count; i++) {
+		grouped[offsets[positions[i]]] = keys[i];
+		values[offsets[positions[i]]++] = data ? data[i] : NULL;
+	}
+
+	// The scatter advanced each offset to the end of its group, which is where the next group begins.
+	for (uint64_t i = 0, start = 0; i < sharded->count; start = offsets[i++]) {
+		if (offsets[i] > start) {
+			inserted += inx_insert_batch(sharded->shards[i], grouped + start, values + start, offsets[i] - start);
+		}
+	}
+
+	mm_free(positions);
+
+	__sync_add_and_fetch(&(inx->count), inserted);
+	__sync_add_and_fetch(&(inx->serial), 1);
+	return inserted;
+}
+
+bool_t sharded_append(void *inx, multi_t key, void *data) {
+
+	inx_t *index = inx;
+
+	if (index == NULL || index->index == NULL || !inx_append(sharded_shard(index, key), key, data)) {
+		return false;
+	}
+
+	__sync_add_and_fetch(&(index->count), 1);
+	__sync_add_and_fetch(&(index->serial), 1);
+	return true;
+}
+
+bool_t sharded_delete(void *inx, multi_t key) {
+
+	inx_t *index = inx;
+
+	if (index == NULL || index->index == NULL || !inx_delete(sharded_shard(index, key), key)) {
+		return false;
+	}
+
+	__sync_sub_and_fetch(&(index->count), 1);
+	__sync_add_and_fetch(&(index->serial), 1);
+	return true;
+}
+
+void * sharded_find(void *inx, multi_t key) {
+
+	inx_t *index = inx;
+
+	if (index == NULL || index->index == NULL) {
+		return NULL;
+	}
+
+	return inx_find(sharded_shard(index, key), key);
+}
+
+/**
+ * @brief	Replace the value of a key in a sharded index.
+ * @note	The delete and insert are performed while holding the lock for the shard, so other threads never see the key
+ * 			missing. Only the shard holding the key is locked.
+ * @param	inx		a pointer to the sharded index.
+ * @param	key		a multi-type value specifying the identifier of the record to be replaced.
+ * @param	data	a pointer to the new data to be associated with the specified key.
+ * @return	true if the specified key's value was replaced successfully, or false on failure.
+ */
+bool_t sharded_replace(void *inx, multi_t key, void *data) {
+
+	inx_t *index = inx, *shard;
+	bool_t deleted, result;
+
+	if (index == NULL || index->index == NULL) {
+		return false;
+	}
+
+	shard = sharded_shard(index, key);
+
+	inx_auto_write(shard);
+	deleted = shard->delete(shard, key);
+	result = shard->insert(shard, key, data);
+	inx_auto_unlock(shard);
+
+	if (deleted && !result) {
+		__sync_sub_and_fetch(&(index->count), 1);
+	}
+	else if (!deleted && result) {
+		__sync_add_and_fetch(&(index->count), 1);
+	}
+
+	__sync_add_and_fetch(&(index->serial), 1);
+
+	return result;
+}
+
+/**
+ * @brief	Add up the memory footprint of every shard in a sharded index.
+ * @param	inx		a pointer to the sharded index.
+ * @param	stats	a pointer to the statistics object which will accumulate the values, which must already be zeroed.
+ * @return	This function returns no value.
+ */
+void sharded_stats(inx_t *inx, inx_stats_t *stats) {
+
+	inx_stats_t shard;
+	sharded_index_t *sharded;
+
+	if (inx == NULL || (sharded = inx->index) == NULL) {
+		return;
+	}
+
+	for (uint64_t i = 0; i < sharded->count; i++) {
+		if (inx_stats(sharded->shards[i], &shard)) {
+			stats->records += shard.records;
+			stats->objects += shard.objects;
+			stats->used += shard.used;
+			stats->reserved += shard.reserved;
+			stats->chunks += shard.chunks;
+		}
+	}
+
+	return;
+}
+
+void sharded_truncate(void *inx) {
+
+	inx_t *index = inx, *shard;
+	uint64_t removed;
+	sharded_index_t *sharded;
+
+	if (index == NULL || (sharded = index->index) == NULL) {
+		return;
+	}
+
+	// Each shard is truncated individually, so records inserted into a shard after it has been cleared will survive.
+	for (uint64_t i = 0; i < sharded->count; i++) {
+
+		shard = sharded->shards[i];
+
+		inx_auto_write(shard);
+		removed = shard->count;
+		shard->index_truncate(shard);
+		inx_auto_unlock(shard);
+
+		__sync_sub_and_fetch(&(index->count), removed);
+	}
+
+	__sync_add_and_fetch(&(index->serial), 1);
+
+	return;
+}
+
+void sharded_free(void *inx) {
+
+	inx_t *index = inx;
+	sharded_index_t *sharded;
+
+	if (index == NULL || (sharded = index->index) == NULL) {
+		return;
+	}
+
+	for (uint64_t i = 0; i < sharded->count; i++) {
+		inx_cleanup(sharded->shards[i]);
+	}
+
+	mm_free(sharded);
+	index->index = NULL;
+	return;
+}
+
+/**
+ * @brief	Get the cursor for the shard currently being iterated, advancing to the next shard if necessary.
+ * @param	cursor	the sharded cursor.
+ * @param	advance	if true, the shard cursor is released so iteration continues with the next shard.
+ * @return	NULL if every shard has been iterated, or a pointer to the cursor for the current shard.
+ */
+inx_cursor_t * sharded_cursor_shard(sharded_cursor_t *cursor, bool_t advance) {
+
+	sharded_index_t *sharded = cursor->inx->index;
+
+	if (advance && cursor->cursor) {
+		inx_cursor_free(cursor->cursor);
+		cursor->cursor = NULL;
+		cursor->shard++;
+	}
+
+	if (!cursor->cursor && cursor->shard < sharded->count && !(cursor->cursor = inx_cursor_alloc(sharded->shards[cursor->shard]))) {
+		log_pedantic("Unable to allocate a cursor for index shard %lu.", cursor->shard);
+	}
+
+	return cursor->cursor;
+}
+
+void * sharded_cursor_value_next(sharded_cursor_t *cursor) {
+
+	void *value = NULL;
+	inx_cursor_t *shard;
+
+	for (shard = sharded_cursor_shard(cursor, false); shard && !(value = inx_cursor_value_next(shard)); shard = sharded_cursor_shard(cursor, true));
+
+	return value;
+}
+
+void * sharded_cursor_value_active(sharded_cursor_t *cursor) {
+
+	if (!cursor->cursor) {
+		return NULL;
+	}
+
+	return inx_cursor_value_active(cursor->cursor);
+}
+
+multi_t sharded_cursor_key_next(sharded_cursor_t *cursor) {
+
+	inx_cursor_t *shard;
+	multi_t key = mt_get_null();
+
+	for (shard = sharded_cursor_shard(cursor, false); shard && mt_is_empty(key = inx_cursor_key_next(shard)); shard = sharded_cursor_shard(cursor, true));
+
+	return key;
+}
+
+multi_t sharded_cursor_key_active(sharded_cursor_t *cursor) {
+
+	if (!cursor->cursor) {
+		return mt_get_null();
+	}
+
+	return inx_cursor_key_active(cursor->cursor);
+}
+
+void sharded_cursor_reset(sharded_cursor_t *cursor) {
+
+	if (cursor) {
+		if (cursor->cursor) {
+			inx_cursor_free(cursor->cursor);
+		}
+		cursor->cursor = NULL;
+		cursor->shard = 0;
+	}
+
+	return;
+}
+
+void sharded_cursor_free(sharded_cursor_t *cursor) {
+
+	if (cursor) {
+		if (cursor->cursor) {
+			inx_cursor_free(cursor->cursor);
+		}
+		mm_free(cursor);
+	}
+
+	return;
+}
+
+void * sharded_cursor_alloc(inx_t *inx) {
+
+	sharded_cursor_t *cursor;
+
+	if (!(cursor = mm_alloc(sizeof(sharded_cursor_t)))) {
+		log_pedantic("Failed to allocate %zu bytes for a sharded index cursor.", sizeof(sharded_cursor_t));
+		return NULL;
+	}
+
+	cursor->inx = inx;
+
+	return cursor;
+}
+
+/**
+ * @brief	Allocate a new sharded index.
+ * @note	The number of shards is the smallest power of two which is at least twice the number of online processors,
+ * 			bounded by MAGMA_SHARDED_MIN and MAGMA_SHARDED_MAX. Every shard is allocated using the same options, minus the
+ * 			M_INX_SHARDED flag, and inherits the manual locking setting.
+ * @param	options		the options for the index, including the type of index used for the shards.
+ * @param	data_free	a pointer to the function used to free the data associated with a record.
+ * @return	NULL on failure, or a pointer to the newly allocated sharded index on success.
+ */
+inx_t * sharded_alloc(uint64_t options, void *data_free) {
+
+	inx_t *result;
+	long processors;
+	sharded_index_t *sharded;
+	uint64_t count = MAGMA_SHARDED_MIN;
+
+	if ((processors = sysconf(_SC_NPROCESSORS_ONLN)) > 0) {
+		while (count < MAGMA_SHARDED_MAX && count < (uint64_t)(processors * 2)) {
+			count *= 2;
+		}
+	}
+
+	if (!(result = mm_alloc(sizeof(inx_t)))) {
+		return NULL;
+	}
+	else if (!(result->index = sharded = mm_alloc(sizeof(sharded_index_t) + (sizeof(inx_t *) * count)))) {
+		mm_free(result);
+		return NULL;
+	}
+
+	sharded->count = count;
+	sharded->seed = hashed_seed(sharded);
+	sharded->shards = (inx_t **)((chr_t *)sharded + sizeof(sharded_index_t));
+
+	for (uint64_t i = 0; i < count; i++) {
+		if (!(sharded->shards[i] = inx_alloc(options & ~M_INX_SHARDED, data_free))) {
+			sharded_free(result);
+			mm_free(result);
+			return NULL;
+		}
+	}
+
+	// The last variable is only applicable to linked lists.
+	result->last = NULL;
+
+	result->options = options;
+	result->data_free = data_free;
+	result->index_free = sharded_free;
+	result->index_truncate = sharded_truncate;
+
+	result->find = sharded_find;
+	result->append = sharded_append;
+	result->insert = sharded_insert;
+	result->delete = sharded_delete;
+
+	result->cursor_free = (void (*)(void *))&sharded_cursor_free;
+	result->cursor_reset = (void (*)(void *))&sharded_cursor_reset;
+	result->cursor_alloc = (void * (*)(void *))&sharded_cursor_alloc;
+
+	result->cursor_key_next = (multi_t (*)(void *))&sharded_cursor_key_next;
+	result->cursor_key_active = (multi_t (*)(void *))&sharded_cursor_key_active;
+
+	result->cursor_value_next = (void * (*)(void *))&sharded_cursor_value_next;
+	result->cursor_value_active = (void * (*)(void *))&sharded_cursor_value_active;
+
+	return result;
+}
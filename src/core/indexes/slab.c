@@ -0,0 +1,241 @@
+/**
+ * @file /magma/core/indexes/slab.c
+ *
+ * @brief	A slab allocator for the fixed size nodes and records used by an index.
+ *
+ * @note	Objects are carved out of large chunks, and released objects are kept on a free list for their size, so inserting
+ * 			a record doesn't require a trip through the system allocator, and the nodes belonging to an index are packed
+ * 			together in memory. The chunks are only returned to the system when the slab is truncated, which happens when
+ * 			the index is truncated or freed. A slab is owned by a single index and is only used while the caller holds the
+ * 			index write lock, so it doesn't provide any locking of its own. Every function accepts a NULL slab, in which case
+ * 			the requests are passed straight through to mm_alloc() and mm_free().
+ */
+
+#include "magma.h"
+
+/**
+ * The number of distinct object sizes a single slab will manage. Requests for any other size are passed through to the
+ * system allocator.
+ */
+#define MAGMA_SLAB_CLASSES 32
+
+/**
+ * The minimum size of a chunk. Chunks for large objects are sized to hold at least MAGMA_SLAB_OBJECTS of them.
+ */
+#define MAGMA_SLAB_CHUNK 65536
+#define MAGMA_SLAB_OBJECTS 16
+
+typedef struct slab_object_t {
+	struct slab_object_t *next;
+} slab_object_t;
+
+// Each chunk begins with a header linking it to the chunk allocated before it, which keeps the objects 16 byte aligned.
+typedef struct slab_chunk_t {
+	struct slab_chunk_t *next;
+	uint64_t length;
+} slab_chunk_t;
+
+typedef struct __attribute__ ((packed)) {
+	size_t size;
+	chr_t *cursor, *end;
+	slab_object_t *available;
+	uint64_t objects;
+} slab_class_t;
+
+typedef struct __attribute__ ((packed)) {
+	slab_chunk_t *chunks;
+	uint64_t count, reserved;
+	uint32_t used;
+	slab_class_t classes[MAGMA_SLAB_CLASSES];
+} slab_t;
+
+/**
+ * @brief	Find the size class for objects of a given size, creating it if necessary.
+ * @param	slab	the slab being searched.
+ * @param	size	the object size, which must already be rounded up to a multiple of the alignment.
+ * @return	NULL if every size class is already in use, or a pointer to the size class.
+ */
+slab_class_t * slab_class(slab_t *slab, size_t size) {
+
+	for (uint32_t i = 0; i < slab->used; i++) {
+		if (slab->classes[i].size == size) {
+			return &(slab->classes[i]);
+		}
+	}
+
+	if (slab->used == MAGMA_SLAB_CLASSES) {
+		return NULL;
+	}
+
+	slab->classes[slab->used].size = size;
+	return &(slab->classes[slab->used++]);
+}
+
+/**
+ * @brief	Allocate a zeroed object.
+ * @param	slab	the slab which will provide the object, or NULL to use the system allocator.
+ * @param	size	the size of the object in bytes.
+ * @return	NULL on failure, or a pointer to the newly allocated object.
+ */
+void * slab_get(void *slab, size_t size) {
+
+	void *result;
+	uint64_t length;
+	slab_chunk_t *chunk;
+	slab_class_t *class;
+
+	if (!slab || !size || !(class = slab_class(slab, (size + 15) & ~((size_t)15)))) {
+		return mm_alloc(size);
+	}
+
+	if ((result = class->available)) {
+		class->available = class->available->next;
+	}
+	else {
+
+		// The current chunk is exhausted, so another one is carved up. Whatever space is left at the end of the old chunk
+		// is wasted, but it's always smaller than a single object.
+		if (!class->cursor || (size_t)(class->end - class->cursor) < class->size) {
+
+			length = sizeof(slab_chunk_t) + (class->size * MAGMA_SLAB_OBJECTS);
+			length = length < MAGMA_SLAB_CHUNK ? MAGMA_SLAB_CHUNK : length;
+
+			if (!(chunk = malloc(length))) {
+				log_pedantic("Unable to allocate a slab chunk of %lu bytes.", length);
+				return NULL;
+			}
+
+			chunk->length = length;
+			chunk->next = ((slab_t *)slab)->chunks;
+			((slab_t *)slab)->chunks = chunk;
+			((slab_t *)slab)->reserved += length;
+			((slab_t *)slab)->count++;
+
+			class->cursor = (chr_t *)chunk + sizeof(slab_chunk_t);
+			class->end = (chr_t *)chunk + length;
+		}
+
+		result = class->cursor;
+		class->cursor += class->size;
+	}
+
+	class->objects++;
+	mm_set(result, 0, size);
+
+	return result;
+}
+
+/**
+ * @brief	Release an object allocated using slab_get().
+ * @note	The object is placed on the free list for its size, and the memory is only returned to the system once the slab
+ * 			is truncated.
+ * @param	slab	the slab which provided the object, or NULL if it came from the system allocator.
+ * @param	object	a pointer to the object being released.
+ * @param	size	the size of the object in bytes, which must match the size passed to slab_get().
+ * @return	This function returns no value.
+ */
+void slab_put(void *slab, void *object, size_t size) {
+
+	slab_class_t *class;
+
+	if (!object) {
+		return;
+	}
+	else if (!slab || !size || !(class = slab_class(slab, (size + 15) & ~((size_t)15)))) {
+		mm_free(object);
+		return;
+	}
+
+	((slab_object_t *)object)->next = class->available;
+	class->available = object;
+	class->objects--;
+
+	return;
+}
+
+/**
+ * @brief	Return every chunk held by a slab to the system.
+ * @note	Any objects still in use are released along with their chunks, so the caller must be finished with them.
+ * @param	slab	the slab being truncated.
+ * @return	This function returns no value.
+ */
+void slab_truncate(void *slab) {
+
+	slab_t *holder = slab;
+	slab_chunk_t *chunk;
+
+	if (!holder) {
+		return;
+	}
+
+	while ((chunk = holder->chunks)) {
+		holder->chunks = chunk->next;
+		free(chunk);
+	}
+
+	for (uint32_t i = 0; i < holder->used; i++) {
+		holder->classes[i].cursor = holder->classes[i].end = NULL;
+		holder->classes[i].available = NULL;
+		holder->classes[i].objects = 0;
+	}
+
+	holder->count = holder->reserved = 0;
+
+	return;
+}
+
+/**
+ * @brief	Free a slab, along with every chunk it holds.
+ * @param	slab	the slab being freed.
+ * @return	This function returns no value.
+ */
+void slab_free(void *slab) {
+
+	if (slab) {
+		slab_truncate(slab);
+		mm_free(slab);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Add the memory footprint of a slab to a set of index statistics.
+ * @param	slab	the slab being examined.
+ * @param	stats	a pointer to the statistics being accumulated.
+ * @return	This function returns no value.
+ */
+void slab_stats(void *slab, inx_stats_t *stats) {
+
+	slab_t *holder = slab;
+
+	if (!holder) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < holder->used; i++) {
+		stats->objects += holder->classes[i].objects;
+		stats->used += holder->classes[i].objects * holder->classes[i].size;
+	}
+
+	stats->chunks += holder->count;
+	stats->reserved += holder->reserved;
+
+	return;
+}
+
+/**
+ * @brief	Allocate an empty slab.
+ * @return	NULL on failure, or a pointer to the newly allocated slab.
+ */
+void * slab_alloc(void) {
+
+	slab_t *result;
+
+	if (!(result = mm_alloc(sizeof(slab_t)))) {
+		log_pedantic("Unable to allocate %zu bytes for an index slab.", sizeof(slab_t));
+		return NULL;
+	}
+
+	return result;
+}
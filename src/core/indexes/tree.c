@@ -0,0 +1,1305 @@
+/**
+ * @file /magma/core/indexes/tree.c
+ *
+ * @brief	The B+tree implementation functions utilized by the generic index interface.
+ *
+ * @note	If the index was created with the M_INX_RCU option, lookups descend the tree without holding a lock. Writers never
+ * 			modify a node which might be visible to those readers. Instead every node along the path being modified is copied,
+ * 			the copies are updated, and the new root is published with an atomic store once the operation is complete. The
+ * 			replaced nodes, along with any keys and data which were removed, are retired and released once every reader that
+ * 			could still see them has finished. Lookups never follow the leaf chain, so the only field written in place is the
+ * 			next pointer of a leaf bordering a copied leaf, and that pointer is only read by cursors, which still hold the
+ * 			read lock.
+ */
+
+#include "magma.h"
+
+/**
+ * The maximum number of keys held by a single tree node. Wide nodes keep the tree shallow, so a lookup only
+ * touches a handful of nodes, and the binary search inside each node runs over a contiguous array of keys.
+ */
+#define MAGMA_TREE_NODE_KEYS 32
+
+/**
+ * Every node, except for the root, must hold at least this many keys after a delete operation.
+ */
+#define MAGMA_TREE_NODE_MIN (MAGMA_TREE_NODE_KEYS / 2)
+
+// Tree nodes. The key and slot arrays are one element larger than the node capacity, which allows a node to overflow
+// temporarily during an insert, before being split in half. Leaf nodes use the slots to hold data pointers, while branch
+// nodes use them to hold their child node pointers. The keys stored in a branch node are separators, which are private
+// copies of a key greater than or equal to every key in the subtree to their left, and less than or equal to every key in
+// the subtree to their right. Duplicate keys are allowed, which means a run of equal keys may span several leaves.
+typedef struct __attribute__ ((packed)) {
+	multi_t keys[MAGMA_TREE_NODE_KEYS + 1];
+	void *slots[MAGMA_TREE_NODE_KEYS + 2];
+	struct tree_node_t *next;
+	uint32_t count;
+	bool_t leaf, shadow;
+} tree_node_t;
+
+typedef struct __attribute__ ((packed)) {
+	inx_t *inx;
+	multi_t key;
+	void *data;
+	tree_node_t *node;
+	uint64_t serial, slot;
+	bool_t finished;
+} tree_cursor_t;
+
+// The records passed to a bulk load, along with their original position in the batch, which keeps the sort stable.
+typedef struct __attribute__ ((packed)) {
+	multi_t key;
+	void *data;
+	uint64_t position;
+} tree_batch_t;
+
+/**
+ * @brief	Compare two tree keys.
+ * @note	Numeric keys of the same type are compared directly, and all other combinations of key types are passed along
+ * 			to cmp_mt_mt(). Mismatched non-string types are ordered by their type value so the ordering remains total.
+ * @param	one		the first multi-type key to be compared.
+ * @param	two		the second multi-type key to be compared.
+ * @return	-1 if one < two, 1 if one > two, or 0 if the two keys are equal.
+ */
+int_t tree_key_compare(multi_t one, multi_t two) {
+
+	if (one.type == M_TYPE_UINT64 && two.type == M_TYPE_UINT64) {
+		return (one.val.u64 < two.val.u64) ? -1 : one.val.u64 > two.val.u64;
+	}
+	else if (one.type == M_TYPE_INT64 && two.type == M_TYPE_INT64) {
+		return (one.val.i64 < two.val.i64) ? -1 : one.val.i64 > two.val.i64;
+	}
+	else if (one.type != two.type && !((one.type == M_TYPE_STRINGER || one.type == M_TYPE_NULLER) &&
+		(two.type == M_TYPE_STRINGER || two.type == M_TYPE_NULLER))) {
+		return (one.type < two.type) ? -1 : 1;
+	}
+
+	return cmp_mt_mt(one, two);
+}
+
+/**
+ * @brief	Create a private copy of a tree key.
+ * @param	key		the multi-type key to be duplicated.
+ * @param	output	a pointer to the multi-type object which will receive the copy.
+ * @return	true on success, or false if the key buffer could not be duplicated.
+ */
+bool_t tree_key_dupe(multi_t key, multi_t *output) {
+
+	*output = mt_dupe(key);
+
+	if ((output->type == M_TYPE_STRINGER && !output->val.st) || (output->type == M_TYPE_NULLER && !output->val.ns) ||
+		(output->type == M_TYPE_EMPTY && key.type != M_TYPE_EMPTY)) {
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Perform a binary search for a key inside a tree node.
+ * @param	node	a pointer to the tree node to be searched.
+ * @param	key		the multi-type key to be located.
+ * @param	upper	if true, return the position of the first key greater than the search key, otherwise the position of the
+ * 					first key greater than or equal to the search key.
+ * @return	the array position inside the node, which will equal the node count if all of the keys are smaller.
+ */
+uint32_t tree_node_search(tree_node_t *node, multi_t key, bool_t upper) {
+
+	int_t result;
+	uint32_t low = 0, high = node->count, middle;
+
+	while (low < high) {
+		middle = low + ((high - low) / 2);
+		result = tree_key_compare(node->keys[middle], key);
+		if (result < 0 || (upper && result == 0)) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+
+	return low;
+}
+
+/**
+ * @brief	Allocate an empty tree node.
+ * @note	New nodes are marked as shadow nodes, since they aren't visible to readers until the tree is published.
+ * @param	index	a pointer to the tree index which will own the node.
+ * @param	leaf	true if the node will be a leaf, or false for a branch node.
+ * @return	NULL on failure, or a pointer to the newly allocated tree node on success.
+ */
+tree_node_t * tree_node_alloc(inx_t *index, bool_t leaf) {
+
+	tree_node_t *node;
+
+	if (!(node = slab_get(index->slab, sizeof(tree_node_t)))) {
+		log_pedantic("Failed to allocate %zu bytes for a tree index node.", sizeof(tree_node_t));
+		return NULL;
+	}
+
+	node->leaf = leaf;
+	node->shadow = true;
+	return node;
+}
+
+/**
+ * @brief	Release a node which has been removed from a tree, without touching its keys or children.
+ * @note	Published nodes belonging to an M_INX_RCU index may still be in use by a reader, so they are retired instead.
+ * @param	index	a pointer to the tree index which owns the node.
+ * @param	node	a pointer to the tree node to be released.
+ * @return	This function returns no value.
+ */
+void tree_node_discard(inx_t *index, tree_node_t *node) {
+
+	if ((index->options & M_INX_RCU) && !node->shadow) {
+		epoch_retire(node, &mm_free);
+	}
+	else {
+		slab_put(index->slab, node, sizeof(tree_node_t));
+	}
+
+	return;
+}
+
+/**
+ * @brief	Get a version of a node which can be modified by a writer.
+ * @note	Unless the index was created with the M_INX_RCU option, nodes are always modified in place. Otherwise a published
+ * 			node is copied, the link pointing at it is updated to point at the copy, and the original node is retired. The
+ * 			keys are shared with the original node, so the link must belong to a node which has already been copied.
+ * @param	index	a pointer to the tree index which owns the node.
+ * @param	link	a pointer to the location which holds the node pointer, which is updated if the node is copied.
+ * @return	NULL if the node couldn't be copied, or a pointer to the writable version of the node.
+ */
+tree_node_t * tree_node_writable(inx_t *index, tree_node_t **link) {
+
+	tree_node_t *node = *link, *copy;
+
+	if (!(index->options & M_INX_RCU) || node->shadow) {
+		return node;
+	}
+	else if (!(copy = slab_get(index->slab, sizeof(tree_node_t)))) {
+		log_pedantic("Failed to allocate %zu bytes for a tree index node.", sizeof(tree_node_t));
+		return NULL;
+	}
+
+	mm_copy(copy, node, sizeof(tree_node_t));
+	copy->shadow = true;
+	tree_node_discard(index, node);
+	*link = copy;
+
+	return copy;
+}
+
+/**
+ * @brief	Free a tree node, along with all of its children, keys and data.
+ * @param	index	a pointer to the tree index which owns the node.
+ * @param	node	a pointer to the tree node to be freed.
+ * @return	This function returns no value.
+ */
+void tree_node_free(inx_t *index, tree_node_t *node) {
+
+	if (!node) return;
+
+	for (uint32_t i = 0; i < node->count; i++) {
+		if (node->leaf && node->slots[i] && index->data_free) {
+			index->data_free(node->slots[i]);
+		}
+		mt_free(node->keys[i]);
+	}
+
+	if (!node->leaf) {
+		for (uint32_t i = 0; i <= node->count; i++) {
+			tree_node_free(index, node->slots[i]);
+		}
+	}
+
+	slab_put(index->slab, node, sizeof(tree_node_t));
+	return;
+}
+
+/**
+ * @brief	Descend from the root of a tree to the leaf node which would hold a specified key.
+ * @param	node	a pointer to the root node of the tree.
+ * @param	key		the multi-type key being searched for.
+ * @param	upper	if true, find the leaf which would hold keys greater than the search key, otherwise find the left most leaf
+ * 					which could hold a key equal to the search key.
+ * @return	NULL if the tree is empty, or a pointer to the leaf node which would contain the key.
+ */
+tree_node_t * tree_leaf_find(tree_node_t *node, multi_t key, bool_t upper) {
+
+	while (node && !node->leaf) {
+		node = node->slots[tree_node_search(node, key, upper)];
+	}
+
+	return node;
+}
+
+/**
+ * @brief	Step over the end of a leaf node, onto the first record of the following leaf.
+ * @param	node	a pointer to the leaf node pointer, which will be updated.
+ * @param	slot	a pointer to the record position inside the leaf, which will be updated.
+ * @return	This function returns no value.
+ */
+void tree_leaf_normalize(tree_node_t **node, uint64_t *slot) {
+
+	while (*node && *slot >= (*node)->count) {
+		*node = (tree_node_t *)(*node)->next;
+		*slot = 0;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Find the left most leaf node in a tree.
+ * @param	node	a pointer to the root node of the tree.
+ * @return	NULL if the tree is empty, or a pointer to the first leaf node.
+ */
+tree_node_t * tree_leaf_first(tree_node_t *node) {
+
+	while (node && !node->leaf) {
+		node = node->slots[0];
+	}
+
+	return node;
+}
+
+/**
+ * @brief	Find the right most leaf node in a tree.
+ * @param	node	a pointer to the root node of the tree.
+ * @return	NULL if the tree is empty, or a pointer to the last leaf node.
+ */
+tree_node_t * tree_leaf_last(tree_node_t *node) {
+
+	while (node && !node->leaf) {
+		node = node->slots[node->count];
+	}
+
+	return node;
+}
+
+/**
+ * @brief	Recursively locate the first record in a subtree with a given key.
+ * @note	The leaf chain isn't used, since the next pointers aren't safe to follow without a lock. Instead the search
+ * 			continues into the next child whenever the separator between them matches the key, the same way a delete does.
+ * @param	node		a pointer to the root node of the subtree.
+ * @param	key			the multi-type key being searched for.
+ * @param	position	a pointer which will receive the position of the record inside the returned leaf.
+ * @return	NULL if the key isn't found, or a pointer to the leaf node holding the first matching record.
+ */
+tree_node_t * tree_node_locate(tree_node_t *node, multi_t key, uint32_t *position) {
+
+	uint32_t slot;
+	tree_node_t *result;
+
+	if (node->leaf) {
+
+		slot = tree_node_search(node, key, false);
+
+		if (slot >= node->count || tree_key_compare(node->keys[slot], key)) {
+			return NULL;
+		}
+
+		*position = slot;
+		return node;
+	}
+
+	for (slot = tree_node_search(node, key, false); slot <= node->count; slot++) {
+
+		if ((result = tree_node_locate(node->slots[slot], key, position))) {
+			return result;
+		}
+		else if (slot == node->count || tree_key_compare(node->keys[slot], key)) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Find a record in a tree by key.
+ * @param	inx		a pointer to the tree index to be searched.
+ * @param	key		a multi-type key value to be searched against the contents of the inx object.
+ * @return	NULL on failure or if the record cannot be found, or a pointer to the data of the matching record on success.
+ */
+void * tree_find(void *inx, multi_t key) {
+
+	uint32_t slot;
+	inx_t *index = inx;
+	tree_node_t *node;
+
+	// The root is loaded atomically, since a lock free reader may be racing a writer publishing a new version of the tree.
+	if (index == NULL || !(node = __atomic_load_n(&(index->index), __ATOMIC_ACQUIRE)) || !(node = tree_node_locate(node, key, &slot))) {
+		return NULL;
+	}
+
+	return node->slots[slot];
+}
+
+/**
+ * @brief	Repair the leaf chain after a writer has copied part of a tree, and clear the shadow marker on the copied nodes.
+ * @note	Only the shadow nodes are visited. Subtrees which weren't copied are skipped, since the links between their own
+ * 			leaves are still valid, and only the leaves on either side of a copied leaf are updated.
+ * @param	node	a pointer to the shadow node at the root of the subtree being repaired.
+ * @param	last	a pointer to the leaf, or untouched subtree, which precedes the subtree in key order, which will be updated.
+ * @param	copied	a pointer to a flag which records whether the preceding node is a copied leaf, which will be updated.
+ * @return	This function returns no value.
+ */
+void tree_node_relink(tree_node_t *node, tree_node_t **last, bool_t *copied) {
+
+	tree_node_t *child, *previous;
+
+	if (node->leaf) {
+		if (*last && (previous = tree_leaf_last(*last))->next != (struct tree_node_t *)node) {
+			previous->next = (struct tree_node_t *)node;
+		}
+		*last = node;
+		*copied = true;
+	}
+	else {
+		for (uint32_t i = 0; i <= node->count; i++) {
+
+			if ((child = node->slots[i])->shadow) {
+				tree_node_relink(child, last, copied);
+			}
+			else {
+				// A copied leaf followed by an untouched subtree needs to point at the first leaf of that subtree.
+				if (*copied) {
+					(*last)->next = (struct tree_node_t *)tree_leaf_first(child);
+				}
+				*last = child;
+				*copied = false;
+			}
+		}
+	}
+
+	node->shadow = false;
+	return;
+}
+
+/**
+ * @brief	Make a new version of a tree visible.
+ * @note	An empty leaf at the root is released, since an empty tree is represented by a NULL root.
+ * @param	index	a pointer to the tree index being updated.
+ * @param	root	a pointer to the new root node of the tree.
+ * @return	This function returns no value.
+ */
+void tree_publish(inx_t *index, tree_node_t *root) {
+
+	bool_t copied = false;
+	tree_node_t *last = NULL;
+
+	if (root && root->leaf && !root->count) {
+		tree_node_discard(index, root);
+		root = NULL;
+	}
+
+	if (index->options & M_INX_RCU) {
+		if (root && root->shadow) {
+			tree_node_relink(root, &last, &copied);
+		}
+		__atomic_store_n(&(index->index), root, __ATOMIC_RELEASE);
+	}
+	else {
+		index->index = root;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Split an overflowing tree node in half.
+ * @note	Leaf nodes hand a private copy of the first key in the new right hand node to their parent, while branch nodes
+ * 			promote their middle separator.
+ * @param	node		a pointer to the overflowing tree node.
+ * @param	right		a pointer to an empty tree node which will receive the upper half of the keys.
+ * @param	separator	a pointer to a multi-type object which will receive the separator key for the new node.
+ * @return	true on success, or false if the separator key couldn't be duplicated.
+ */
+bool_t tree_node_split(tree_node_t *node, tree_node_t *right, multi_t *separator) {
+
+	uint32_t half = (node->count + 1) / 2;
+
+	right->leaf = node->leaf;
+
+	if (node->leaf) {
+
+		if (!tree_key_dupe(node->keys[half], separator)) {
+			return false;
+		}
+
+		right->count = node->count - half;
+		mm_copy(right->keys, node->keys + half, sizeof(multi_t) * right->count);
+		mm_copy(right->slots, node->slots + half, sizeof(void *) * right->count);
+
+		right->next = node->next;
+		node->next = (struct tree_node_t *)right;
+		node->count = half;
+	}
+	else {
+
+		// The middle separator moves up into the parent, so the node keeps the keys to the left of it, and the new node
+		// receives the keys to the right of it, along with the matching children.
+		half = node->count / 2;
+		*separator = node->keys[half];
+
+		right->count = node->count - half - 1;
+		mm_copy(right->keys, node->keys + half + 1, sizeof(multi_t) * right->count);
+		mm_copy(right->slots, node->slots + half + 1, sizeof(void *) * (right->count + 1));
+
+		node->count = half;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Recursively insert a record into a subtree, splitting any nodes which overflow on the way back up.
+ * @note	The node needed for a split is allocated before the subtree is modified, so an allocation failure leaves the
+ * 			tree untouched, apart from any nodes which were copied on the way down.
+ * @param	index		a pointer to the tree index which owns the subtree.
+ * @param	node		a pointer to the root node of the subtree, which must be writable.
+ * @param	key			the multi-type key for the new record.
+ * @param	data		a pointer to the data associated with the new record.
+ * @param	separator	a pointer to a multi-type object which will receive the separator key if the node was split.
+ * @param	split		a pointer which will receive the new right hand node, if the node was split.
+ * @return	-1 on failure, 0 on success, or 1 if the node was split.
+ */
+int_t tree_node_insert(inx_t *index, tree_node_t *node, multi_t key, void *data, multi_t *separator, tree_node_t **split) {
+
+	int_t result;
+	uint32_t slot;
+	multi_t promoted;
+	tree_node_t *child = NULL, *right = NULL;
+
+	if (node->leaf) {
+
+		// Records with duplicate keys are placed after any existing records with the same key.
+		slot = tree_node_search(node, key, true);
+
+		if (node->count == MAGMA_TREE_NODE_KEYS && !(right = tree_node_alloc(index, true))) {
+			return -1;
+		}
+
+		mm_move(node->keys + slot + 1, node->keys + slot, sizeof(multi_t) * (node->count - slot));
+		mm_move(node->slots + slot + 1, node->slots + slot, sizeof(void *) * (node->count - slot));
+
+		if (!tree_key_dupe(key, &(node->keys[slot]))) {
+			mm_move(node->keys + slot, node->keys + slot + 1, sizeof(multi_t) * (node->count - slot));
+			mm_move(node->slots + slot, node->slots + slot + 1, sizeof(void *) * (node->count - slot));
+			if (right) tree_node_discard(index, right);
+			return -1;
+		}
+
+		node->slots[slot] = data;
+		node->count++;
+
+		if (node->count <= MAGMA_TREE_NODE_KEYS) {
+			return 0;
+		}
+		else if (!tree_node_split(node, right, separator)) {
+
+			// We couldn't split the node, so we undo the insert to keep the node within its capacity.
+			mt_free(node->keys[slot]);
+			node->count--;
+			mm_move(node->keys + slot, node->keys + slot + 1, sizeof(multi_t) * (node->count - slot));
+			mm_move(node->slots + slot, node->slots + slot + 1, sizeof(void *) * (node->count - slot));
+			tree_node_discard(index, right);
+			return -1;
+		}
+
+		*split = right;
+		return 1;
+	}
+
+	if (node->count == MAGMA_TREE_NODE_KEYS && !(right = tree_node_alloc(index, false))) {
+		return -1;
+	}
+
+	slot = tree_node_search(node, key, true);
+
+	if (!tree_node_writable(index, (tree_node_t **)&(node->slots[slot]))) {
+		if (right) tree_node_discard(index, right);
+		return -1;
+	}
+	else if ((result = tree_node_insert(index, node->slots[slot], key, data, &promoted, &child)) != 1) {
+		if (right) tree_node_discard(index, right);
+		return result;
+	}
+
+	// The child was split, so we add the separator and the new child to this node.
+	mm_move(node->keys + slot + 1, node->keys + slot, sizeof(multi_t) * (node->count - slot));
+	mm_move(node->slots + slot + 2, node->slots + slot + 1, sizeof(void *) * (node->count - slot));
+	node->keys[slot] = promoted;
+	node->slots[slot + 1] = child;
+	node->count++;
+
+	if (node->count <= MAGMA_TREE_NODE_KEYS) {
+		return 0;
+	}
+
+	tree_node_split(node, right, separator);
+	*split = right;
+	return 1;
+}
+
+/**
+ * @brief	Insert a new record into a tree.
+ * @param	inx		a pointer to the tree index that will store the new record.
+ * @param	key		a multi-type key value that will be associated with the newly created record.
+ * @param	data	a pointer to the data that will be associated with the new record.
+ * @return	true on success or false on failure.
+ */
+bool_t tree_insert(void *inx, multi_t key, void *data) {
+
+	int_t result;
+	inx_t *index = inx;
+	multi_t separator;
+	tree_node_t *root, *grown = NULL, *split = NULL;
+
+	if (index == NULL) {
+		return false;
+	}
+	else if (!(root = index->index) && !(root = tree_node_alloc(index, true))) {
+		return false;
+	}
+	else if (!tree_node_writable(index, &root)) {
+		return false;
+	}
+	// If the root is full, we allocate the new root up front, in case the tree needs to grow by one level.
+	else if (root->count == MAGMA_TREE_NODE_KEYS && !(grown = tree_node_alloc(index, false))) {
+		tree_publish(index, root);
+		return false;
+	}
+
+	// Even if the insert fails, any nodes which were copied have already replaced the originals, so the root is published.
+	if ((result = tree_node_insert(index, root, key, data, &separator, &split)) < 0) {
+		if (grown) tree_node_discard(index, grown);
+		tree_publish(index, root);
+		return false;
+	}
+	else if (result == 1) {
+		grown->count = 1;
+		grown->keys[0] = separator;
+		grown->slots[0] = root;
+		grown->slots[1] = split;
+		root = grown;
+	}
+	else if (grown) {
+		tree_node_discard(index, grown);
+	}
+
+	tree_publish(index, root);
+
+	index->count++;
+	index->serial++;
+	return true;
+}
+
+/**
+ * @brief	Compare two batch records, ordering records with equal keys by their position in the batch.
+ * @param	one		a pointer to the first tree_batch_t record.
+ * @param	two		a pointer to the second tree_batch_t record.
+ * @return	-1 if one < two, 1 if one > two, or 0 if the two records are the same.
+ */
+int tree_batch_compare(const void *one, const void *two) {
+
+	int_t result;
+	const tree_batch_t *first = one, *second = two;
+
+	if ((result = tree_key_compare(first->key, second->key))) {
+		return result;
+	}
+
+	return (first->position < second->position) ? -1 : first->position > second->position;
+}
+
+/**
+ * @brief	Release the nodes allocated by a bulk load which couldn't be completed.
+ * @note	Only the keys are freed, since the data still belongs to the caller, and the children of each branch are freed
+ * 			through the list rather than recursively, since the last branch may be incomplete.
+ * @param	index	a pointer to the tree index which owns the nodes.
+ * @param	nodes	an array of pointers to every node allocated so far.
+ * @param	count	the number of nodes in the array.
+ * @return	This function always returns NULL.
+ */
+tree_node_t * tree_build_abort(inx_t *index, tree_node_t **nodes, uint64_t count) {
+
+	for (uint64_t i = 0; i < count; i++) {
+		for (uint32_t j = 0; j < nodes[i]->count; j++) {
+			mt_free(nodes[i]->keys[j]);
+		}
+		slab_put(index->slab, nodes[i], sizeof(tree_node_t));
+	}
+
+	mm_free(nodes);
+	return NULL;
+}
+
+/**
+ * @brief	Build a tree from a sorted array of records, one level at a time, starting with the leaves.
+ * @note	The records are spread evenly across the nodes on each level, so every node holds at least half of its capacity.
+ * 			The separator between two children is a private copy of the first key in the right hand subtree.
+ * @param	index	a pointer to the tree index which will own the nodes.
+ * @param	records	an array of records sorted by key.
+ * @param	count	the number of records in the array, which must be greater than zero.
+ * @return	NULL on failure, or a pointer to the root node of the new tree.
+ */
+tree_node_t * tree_build(inx_t *index, tree_batch_t *records, uint64_t count) {
+
+	tree_node_t **nodes, **level, *node;
+	multi_t *lows;
+	size_t length;
+	uint64_t width, groups, used = 0, consumed = 0, size;
+
+	width = (count + MAGMA_TREE_NODE_KEYS - 1) / MAGMA_TREE_NODE_KEYS;
+
+	// Every node is recorded in a single list, so a failure can be unwound without walking a partially built tree. The
+	// list is followed by the current level of the tree, and the lowest key held by each node on that level.
+	length = (sizeof(tree_node_t *) * ((width * 3) + 64)) + (sizeof(multi_t) * width);
+
+	if (!(nodes = mm_alloc(length))) {
+		log_pedantic("Failed to allocate %zu bytes for a tree bulk load.", length);
+		return NULL;
+	}
+
+	level = nodes + (width * 2) + 64;
+	lows = (multi_t *)(level + width);
+
+	for (uint64_t i = 0; i < width; i++) {
+
+		if (!(node = nodes[used++] = tree_node_alloc(index, true))) {
+			return tree_build_abort(index, nodes, used - 1);
+		}
+
+		size = (count / width) + (i < (count % width) ? 1 : 0);
+
+		for (; node->count < size; node->count++, consumed++) {
+			if (!tree_key_dupe(records[consumed].key, &(node->keys[node->count]))) {
+				return tree_build_abort(index, nodes, used);
+			}
+			node->slots[node->count] = records[consumed].data;
+		}
+
+		if (i) {
+			level[i - 1]->next = (struct tree_node_t *)node;
+		}
+
+		level[i] = node;
+		lows[i] = node->keys[0];
+	}
+
+	// Each pass groups the nodes on the current level under a new level of branches, until a single root remains. The
+	// branches are written over the front of the level, which never overtakes the children still waiting to be grouped.
+	while (width > 1) {
+
+		groups = (width + MAGMA_TREE_NODE_KEYS) / (MAGMA_TREE_NODE_KEYS + 1);
+		consumed = 0;
+
+		for (uint64_t i = 0; i < groups; i++) {
+
+			if (!(node = nodes[used++] = tree_node_alloc(index, false))) {
+				return tree_build_abort(index, nodes, used - 1);
+			}
+
+			size = (width / groups) + (i < (width % groups) ? 1 : 0);
+			node->slots[0] = level[consumed];
+			lows[i] = lows[consumed];
+
+			for (uint64_t j = 1; j < size; j++) {
+				if (!tree_key_dupe(lows[consumed + j], &(node->keys[node->count]))) {
+					return tree_build_abort(index, nodes, used);
+				}
+				node->slots[++node->count] = level[consumed + j];
+			}
+
+			consumed += size;
+			level[i] = node;
+		}
+
+		width = groups;
+	}
+
+	node = level[0];
+	mm_free(nodes);
+
+	return node;
+}
+
+/**
+ * @brief	Insert a batch of records into a tree.
+ * @note	An empty tree is built bottom up from the sorted records, instead of through a series of inserts and splits. The
+ * 			batch is sorted first if necessary, and records with equal keys keep their relative order, just as they would if
+ * 			inserted one at a time. Records are inserted individually if the tree already holds records, or the bulk load
+ * 			fails.
+ * @param	inx		a pointer to the tree index that will store the new records.
+ * @param	keys	an array of keys for the new records.
+ * @param	data	an array of data pointers associated with the keys, or NULL if every record should have a NULL value.
+ * @param	count	the number of records in the batch.
+ * @return	the number of records inserted, which stops short of count if an insert fails.
+ */
+uint64_t tree_insert_batch(void *inx, multi_t *keys, void **data, uint64_t count) {
+
+	inx_t *index = inx;
+	bool_t sorted = true;
+	tree_node_t *root = NULL;
+	tree_batch_t *records;
+	uint64_t inserted = 0;
+
+	if (index == NULL) {
+		return 0;
+	}
+
+	if (!index->index && count > MAGMA_TREE_NODE_KEYS && (records = mm_alloc(sizeof(tree_batch_t) * count))) {
+
+		for (uint64_t i = 0; i < count; i++) {
+			records[i].key = keys[i];
+			records[i].data = data ? data[i] : NULL;
+			records[i].position = i;
+			if (sorted && i && tree_key_compare(keys[i - 1], keys[i]) > 0) {
+				sorted = false;
+			}
+		}
+
+		if (!sorted) {
+			qsort(records, count, sizeof(tree_batch_t), &tree_batch_compare);
+		}
+
+		root = tree_build(index, records, count);
+		mm_free(records);
+	}
+
+	if (root) {
+		tree_publish(index, root);
+		index->count += count;
+		index->serial++;
+		return count;
+	}
+
+	while (inserted < count && tree_insert(index, keys[inserted], data ? data[inserted] : NULL)) {
+		inserted++;
+	}
+
+	return inserted;
+}
+
+/**
+ * @brief	Merge a child node with its right hand sibling, and remove the sibling from the parent node.
+ * @param	index	a pointer to the tree index which owns the nodes.
+ * @param	parent	a pointer to the parent node.
+ * @param	slot	the position of the left hand child inside the parent node, which must be writable.
+ * @return	This function returns no value.
+ */
+void tree_node_merge(inx_t *index, tree_node_t *parent, uint32_t slot) {
+
+	tree_node_t *left = parent->slots[slot], *right = parent->slots[slot + 1];
+
+	if (left->leaf) {
+		mm_copy(left->keys + left->count, right->keys, sizeof(multi_t) * right->count);
+		mm_copy(left->slots + left->count, right->slots, sizeof(void *) * right->count);
+		left->count += right->count;
+		left->next = right->next;
+		inx_release_key(index, parent->keys[slot]);
+	}
+	else {
+		left->keys[left->count] = parent->keys[slot];
+		mm_copy(left->keys + left->count + 1, right->keys, sizeof(multi_t) * right->count);
+		mm_copy(left->slots + left->count + 1, right->slots, sizeof(void *) * (right->count + 1));
+		left->count += right->count + 1;
+	}
+
+	parent->count--;
+	mm_move(parent->keys + slot, parent->keys + slot + 1, sizeof(multi_t) * (parent->count - slot));
+	mm_move(parent->slots + slot + 1, parent->slots + slot + 2, sizeof(void *) * (parent->count - slot));
+
+	tree_node_discard(index, right);
+	return;
+}
+
+/**
+ * @brief	Restore the minimum fill level of an underflowing child, by borrowing a key from a sibling, or merging with it.
+ * @note	If a separator key can't be duplicated, or a sibling can't be copied, the child is simply left underfilled, which
+ * 			doesn't affect correctness.
+ * @param	index	a pointer to the tree index which owns the nodes.
+ * @param	parent	a pointer to the parent node.
+ * @param	slot	the position of the underflowing child inside the parent node, which must be writable.
+ * @return	This function returns no value.
+ */
+void tree_node_rebalance(inx_t *index, tree_node_t *parent, uint32_t slot) {
+
+	multi_t separator;
+	tree_node_t *child = parent->slots[slot], *left = NULL, *right = NULL;
+
+	if (slot > 0) left = parent->slots[slot - 1];
+	if (slot < parent->count) right = parent->slots[slot + 1];
+
+	// The sibling which gives up a key, or absorbs the child, has to be writable. A right hand sibling which is merged into
+	// the child is only read, and then discarded.
+	if (left && (left->count > MAGMA_TREE_NODE_MIN || !right || right->count <= MAGMA_TREE_NODE_MIN) &&
+		!(left = tree_node_writable(index, (tree_node_t **)&(parent->slots[slot - 1])))) {
+		return;
+	}
+	else if (right && right->count > MAGMA_TREE_NODE_MIN && !(left && left->count > MAGMA_TREE_NODE_MIN) &&
+		!(right = tree_node_writable(index, (tree_node_t **)&(parent->slots[slot + 1])))) {
+		return;
+	}
+
+	// Borrow the last key from the left hand sibling.
+	if (left && left->count > MAGMA_TREE_NODE_MIN) {
+
+		if (child->leaf && !tree_key_dupe(left->keys[left->count - 1], &separator)) {
+			return;
+		}
+
+		mm_move(child->keys + 1, child->keys, sizeof(multi_t) * child->count);
+		mm_move(child->slots + 1, child->slots, sizeof(void *) * (child->count + (child->leaf ? 0 : 1)));
+
+		if (child->leaf) {
+			child->keys[0] = left->keys[left->count - 1];
+			child->slots[0] = left->slots[left->count - 1];
+			inx_release_key(index, parent->keys[slot - 1]);
+			parent->keys[slot - 1] = separator;
+		}
+		else {
+			child->keys[0] = parent->keys[slot - 1];
+			child->slots[0] = left->slots[left->count];
+			parent->keys[slot - 1] = left->keys[left->count - 1];
+		}
+
+		child->count++;
+		left->count--;
+	}
+
+	// Borrow the first key from the right hand sibling.
+	else if (right && right->count > MAGMA_TREE_NODE_MIN) {
+
+		if (child->leaf && !tree_key_dupe(right->keys[1], &separator)) {
+			return;
+		}
+
+		if (child->leaf) {
+			child->keys[child->count] = right->keys[0];
+			child->slots[child->count] = right->slots[0];
+			inx_release_key(index, parent->keys[slot]);
+			parent->keys[slot] = separator;
+		}
+		else {
+			child->keys[child->count] = parent->keys[slot];
+			child->slots[child->count + 1] = right->slots[0];
+			parent->keys[slot] = right->keys[0];
+		}
+
+		child->count++;
+		right->count--;
+
+		mm_move(right->keys, right->keys + 1, sizeof(multi_t) * right->count);
+		mm_move(right->slots, right->slots + 1, sizeof(void *) * (right->count + (right->leaf ? 0 : 1)));
+	}
+
+	// Neither sibling has a key to spare, so we merge with one of them.
+	else if (left) {
+		tree_node_merge(index, parent, slot - 1);
+	}
+	else if (right) {
+		tree_node_merge(index, parent, slot);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Recursively remove a record from a subtree, rebalancing any nodes which underflow on the way back up.
+ * @note	If the key is duplicated, the first matching record is removed. Since a run of equal keys may span several
+ * 			children, the search continues into the next child whenever the separator between them matches the key.
+ * @param	index	a pointer to the tree index which owns the subtree.
+ * @param	node	a pointer to the root node of the subtree, which must be writable.
+ * @param	key		the multi-type key of the record to be removed.
+ * @return	true if the record was found and removed, or false otherwise.
+ */
+bool_t tree_node_delete(inx_t *index, tree_node_t *node, multi_t key) {
+
+	uint32_t slot;
+
+	if (node->leaf) {
+
+		slot = tree_node_search(node, key, false);
+
+		if (slot >= node->count || tree_key_compare(node->keys[slot], key)) {
+			return false;
+		}
+
+		inx_release_data(index, node->slots[slot]);
+		inx_release_key(index, node->keys[slot]);
+		node->count--;
+		mm_move(node->keys + slot, node->keys + slot + 1, sizeof(multi_t) * (node->count - slot));
+		mm_move(node->slots + slot, node->slots + slot + 1, sizeof(void *) * (node->count - slot));
+		return true;
+	}
+
+	for (slot = tree_node_search(node, key, false); slot <= node->count; slot++) {
+
+		if (!tree_node_writable(index, (tree_node_t **)&(node->slots[slot]))) {
+			return false;
+		}
+		else if (tree_node_delete(index, node->slots[slot], key)) {
+			if (((tree_node_t *)node->slots[slot])->count < MAGMA_TREE_NODE_MIN) {
+				tree_node_rebalance(index, node, slot);
+			}
+			return true;
+		}
+		else if (slot == node->count || tree_key_compare(node->keys[slot], key)) {
+			break;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief	Remove a record from a tree and free it and its underlying data.
+ * @param	inx		a pointer to the tree index to be searched for the specified key.
+ * @param	key		a multi-type key value to lookup the record that will be deleted from the tree.
+ * @return	true on success or false on failure.
+ */
+bool_t tree_delete(void *inx, multi_t key) {
+
+	uint32_t slot;
+	bool_t result;
+	inx_t *index = inx;
+	tree_node_t *root, *child;
+
+	if (index == NULL || (root = index->index) == NULL || index->count == 0) {
+		return false;
+	}
+	// Avoid copying the path to a key which isn't there, since the copies would have to be published anyway.
+	else if ((index->options & M_INX_RCU) && !tree_node_locate(root, key, &slot)) {
+		return false;
+	}
+	else if (!tree_node_writable(index, &root)) {
+		return false;
+	}
+
+	result = tree_node_delete(index, root, key);
+
+	// Shrink the tree if the root is left without any keys. An empty leaf is released when the tree is published.
+	if (!root->leaf && !root->count) {
+		child = root->slots[0];
+		tree_node_discard(index, root);
+		root = child;
+	}
+
+	tree_publish(index, root);
+
+	if (!result) {
+		return false;
+	}
+
+	index->count--;
+	index->serial++;
+	return true;
+}
+
+/**
+ * @brief	Find the active record of a tree cursor again, using its saved key and data pointer, after the index was modified.
+ * @param	cursor	a pointer to the tree cursor to be positioned.
+ * @return	This function returns no value.
+ */
+void tree_cursor_locate(tree_cursor_t *cursor) {
+
+	tree_node_t *node;
+	uint64_t slot = 0;
+
+	if ((node = tree_leaf_find(cursor->inx->index, cursor->key, false))) {
+		slot = tree_node_search(node, cursor->key, false);
+		tree_leaf_normalize(&node, &slot);
+	}
+
+	// Walk the run of matching keys, looking for the record we were positioned on.
+	while (node && !tree_key_compare(node->keys[slot], cursor->key) && node->slots[slot] != cursor->data) {
+		slot++;
+		tree_leaf_normalize(&node, &slot);
+	}
+
+	if (node && tree_key_compare(node->keys[slot], cursor->key)) {
+		node = NULL;
+	}
+
+	cursor->node = node;
+	cursor->slot = slot;
+	cursor->serial = cursor->inx->serial;
+
+	return;
+}
+
+/**
+ * @brief	Get the current node pointed to by a tree cursor.
+ * @note	If the index was modified, the cursor uses its saved key to find its place again. If the active record was removed,
+ * 			then NULL is returned, and the next call will advance to the first record with a larger key.
+ * @param	cursor	a pointer to the tree cursor to be queried.
+ * @return	NULL if the cursor isn't positioned on a record, or a pointer to the leaf node holding the active record.
+ */
+tree_node_t * tree_cursor_active(tree_cursor_t *cursor) {
+
+	if (cursor->key.type == M_TYPE_EMPTY) {
+		return NULL;
+	}
+	else if (cursor->serial != cursor->inx->serial) {
+		tree_cursor_locate(cursor);
+	}
+
+	return cursor->node;
+}
+
+/**
+ * @brief	Advance a tree cursor to the next record, in key order.
+ * @param	cursor	a pointer to the tree cursor to be advanced.
+ * @return	NULL if the end of the tree has been reached, or a pointer to the leaf node holding the next record.
+ */
+tree_node_t * tree_cursor_next(tree_cursor_t *cursor) {
+
+	if (cursor->finished) {
+		return NULL;
+	}
+	else if (cursor->key.type == M_TYPE_EMPTY) {
+		cursor->node = tree_leaf_first(cursor->inx->index);
+		cursor->slot = 0;
+	}
+	else if (tree_cursor_active(cursor)) {
+		cursor->slot++;
+	}
+
+	// The active record was removed, so we skip ahead to the first record with a larger key.
+	else if ((cursor->node = tree_leaf_find(cursor->inx->index, cursor->key, true))) {
+		cursor->slot = tree_node_search(cursor->node, cursor->key, true);
+	}
+
+	tree_leaf_normalize(&(cursor->node), &(cursor->slot));
+
+	mt_free(cursor->key);
+	cursor->key = mt_get_null();
+	cursor->serial = cursor->inx->serial;
+
+	// Keep a private copy of the active key, so we can find our place again if the index is modified.
+	if (!cursor->node || !tree_key_dupe(cursor->node->keys[cursor->slot], &(cursor->key))) {
+		cursor->finished = true;
+		cursor->node = NULL;
+		cursor->data = NULL;
+		cursor->key = mt_get_null();
+	}
+	else {
+		cursor->data = cursor->node->slots[cursor->slot];
+	}
+
+	return cursor->node;
+}
+
+/**
+ * @brief	Get the data of a tree cursor's next record, and update the cursor.
+ * @param	cursor	a pointer to the tree cursor to be queried.
+ * @return	NULL on failure, or the data of the tree cursor's next record on success.
+ */
+void * tree_cursor_value_next(tree_cursor_t *cursor) {
+
+	tree_node_t *node;
+
+	if ((node = tree_cursor_next(cursor))) {
+		return node->slots[cursor->slot];
+	}
+	return NULL;
+}
+
+/**
+ * @brief	Get the data of a tree cursor's current record.
+ * @param	cursor	a pointer to the tree cursor to be queried.
+ * @return	NULL on failure, or a pointer to the data of the tree cursor's current record.
+ */
+void * tree_cursor_value_active(tree_cursor_t *cursor) {
+
+	tree_node_t *node;
+
+	if ((node = tree_cursor_active(cursor))) {
+		return node->slots[cursor->slot];
+	}
+	return NULL;
+}
+
+/**
+ * @brief	Get the multi-type key value of a tree cursor's next record, and update the cursor.
+ * @param	cursor	a pointer to the tree cursor to be queried.
+ * @return	an empty multi-type key on failure, or the tree cursor's next record key on success.
+ */
+multi_t tree_cursor_key_next(tree_cursor_t *cursor) {
+
+	tree_node_t *node;
+
+	if ((node = tree_cursor_next(cursor))) {
+		return node->keys[cursor->slot];
+	}
+
+	return mt_get_null();
+}
+
+/**
+ * @brief	Get the multi-type key value at the current tree cursor position.
+ * @param	cursor	a pointer to the tree cursor to be queried.
+ * @return	an empty multi-type key on failure, or the current tree cursor's record key on success.
+ */
+multi_t tree_cursor_key_active(tree_cursor_t *cursor) {
+
+	tree_node_t *node;
+
+	if ((node = tree_cursor_active(cursor))) {
+		return node->keys[cursor->slot];
+	}
+
+	return mt_get_null();
+}
+
+/**
+ * @brief	Reset the position of a tree cursor.
+ * @param	cursor	a pointer to the tree cursor object to be reset.
+ * @return	This function returns no value.
+ */
+void tree_cursor_reset(tree_cursor_t *cursor) {
+
+	if (cursor) {
+		mt_free(cursor->key);
+		cursor->node = NULL;
+		cursor->data = NULL;
+		cursor->finished = false;
+		cursor->key = mt_get_null();
+		cursor->serial = cursor->slot = 0;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Free a tree cursor.
+ * @param	cursor	a pointer to the tree cursor object to be freed.
+ * @return	This function returns no value.
+ */
+void tree_cursor_free(tree_cursor_t *cursor) {
+
+	if (cursor) {
+		mt_free(cursor->key);
+		mm_free(cursor);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Allocate a cursor to traverse a tree in key order.
+ * @param	inx		a pointer the tree index object to be traversed by the cursor.
+ * @return	NULL on failure, or a cursor positioned before the first record of the tree on success.
+ */
+void * tree_cursor_alloc(inx_t *inx) {
+
+	tree_cursor_t *cursor;
+
+	if (!(cursor = mm_alloc(sizeof(tree_cursor_t)))) {
+		log_pedantic("Failed to allocate %zu bytes for a tree index cursor.", sizeof(tree_cursor_t));
+		return NULL;
+	}
+
+	cursor->inx = inx;
+	cursor->key = mt_get_null();
+
+	return cursor;
+}
+
+/**
+ * @brief	Truncate all the records in a tree, but do not free it.
+ * @param	inx		a pointer to the tree index object to have all of its records truncated.
+ * @return	This function returns no value.
+ */
+void tree_truncate(void *inx) {
+
+	inx_t *index = inx;
+	tree_node_t *root;
+
+	if (index == NULL || (root = index->index) == NULL) {
+		return;
+	}
+
+	// Lock free readers may still be walking the old tree, so we wait for them to finish before it's freed.
+	if (index->options & M_INX_RCU) {
+		__atomic_store_n(&(index->index), NULL, __ATOMIC_RELEASE);
+		epoch_synchronize();
+	}
+
+	tree_node_free(index, root);
+
+	// Any chunks held by the slab can now be returned to the system in bulk.
+	slab_truncate(index->slab);
+
+	index->index = NULL;
+	index->count = 0;
+	index->serial++;
+
+	return;
+}
+
+/**
+ * @brief	Free a tree index object and all of its records.
+ * @see		tree_truncate()
+ * @param	inx		a pointer to the tree index object to be freed.
+ * @return	This function returns no value.
+ */
+void tree_free(void *inx) {
+
+	inx_t *index = inx;
+
+	if (index == NULL || index->index == NULL) {
+		return;
+	}
+
+	// For trees truncation involves the same steps as free.
+	tree_truncate(inx);
+
+	return;
+}
+
+/**
+ * @brief	Allocate a new B+tree index instance.
+ * @note	Tree indexes keep their records sorted by key. Records with duplicate keys are kept in insertion order.
+ * @param	options		an options value for the newly created tree object.
+ * @param	data_free	a pointer to a function used to free tree records.
+ * @return	NULL on failure or a pointer to the newly allocated tree index object on success.
+ */
+inx_t * tree_alloc(uint64_t options, void *data_free) {
+
+	inx_t *result;
+
+	if ((result = mm_alloc(sizeof(inx_t))) == NULL) return NULL;
+
+	// The root node is allocated lazily by the first insert, and the last variable is only applicable to linked lists.
+	result->last = NULL;
+	result->index = NULL;
+
+	result->options = options;
+	result->data_free = data_free;
+	result->index_free = tree_free;
+	result->index_truncate = tree_truncate;
+
+	result->find = tree_find;
+	result->append = tree_insert;
+	result->insert = tree_insert;
+	result->delete = tree_delete;
+
+	result->cursor_free = (void (*)(void *))&tree_cursor_free;
+	result->cursor_reset = (void (*)(void *))&tree_cursor_reset;
+	result->cursor_alloc = (void * (*)(void *))&tree_cursor_alloc;
+
+	result->cursor_key_next = (multi_t (*)(void *))&tree_cursor_key_next;
+	result->cursor_key_active = (multi_t (*)(void *))&tree_cursor_key_active;
+
+	result->cursor_value_next = (void * (*)(void *))&tree_cursor_value_next;
+	result->cursor_value_active = (void * (*)(void *))&tree_cursor_value_active;
+
+	return result;
+}
@@ -0,0 +1,231 @@
+
+/**
+ * @file /magma/core/memory/arena.c
+ *
+ * @brief	A region allocator for short lived, request scoped blocks.
+ *
+ * @note	Blocks are carved out of large chunks by bumping a cursor, and are never released individually. Instead the
+ * 			entire region is released at once, when the arena is reset or freed, so a request which allocates dozens of
+ * 			short lived buffers pays for a handful of chunk allocations instead of a trip through the allocator for every
+ * 			buffer, and nothing at all to free them.
+ *
+ * 			Since the stringer functions only accept an options mask, the arena is bound to the calling thread with
+ * 			mm_arena_bind(), and any stringer allocated with the ARENA option is carved from the bound arena. An arena isn't
+ * 			thread safe, and should only be used by the thread it's bound to.
+ */
+
+#include "magma.h"
+
+/**
+ * The default chunk length. Requests larger than a quarter of the chunk length get a chunk of their own.
+ */
+#define MM_ARENA_CHUNK 16384
+
+// Each chunk begins with a header linking it to the chunk allocated before it, which keeps the blocks 16 byte aligned.
+typedef struct arena_chunk_t {
+	struct arena_chunk_t *next;
+	uint64_t length;
+} arena_chunk_t;
+
+struct arena_t {
+	arena_chunk_t *chunks;
+	chr_t *cursor, *end;
+	size_t chunk;
+	uint64_t items, used, reserved;
+};
+
+static __thread arena_t *arena_local = NULL;
+
+/**
+ * @brief	Create an arena.
+ * @param	chunk	the length of the chunks carved up by the arena, or 0 to use the default.
+ * @return	NULL on failure, or a pointer to the new arena.
+ */
+arena_t * mm_arena_alloc(size_t chunk) {
+
+	arena_t *arena;
+
+	if (!(arena = mm_alloc(sizeof(arena_t)))) {
+		log_pedantic("Unable to allocate an arena.");
+		return NULL;
+	}
+
+	arena->chunk = chunk ? (chunk + 15) & ~((size_t)15) : MM_ARENA_CHUNK;
+	return arena;
+}
+
+/**
+ * @brief	Release every chunk held by an arena, except for the most recent one, which is kept for reuse.
+ * @note	Every block carved from the arena is invalidated, so the caller must be finished with them.
+ * @param	arena	the arena being reset.
+ * @return	This function returns no value.
+ */
+void mm_arena_reset(arena_t *arena) {
+
+	arena_chunk_t *chunk;
+
+	if (!arena) {
+		log_pedantic("Attempted to reset a NULL arena.");
+		return;
+	}
+
+	while (arena->chunks && (chunk = arena->chunks->next)) {
+		arena->chunks->next = chunk->next;
+		arena->reserved -= chunk->length;
+		free(chunk);
+	}
+
+	// Dedicated chunks are sized for a single request, so one of those isn't worth keeping.
+	if ((chunk = arena->chunks) && chunk->length != arena->chunk + sizeof(arena_chunk_t)) {
+		arena->chunks = NULL;
+		arena->reserved -= chunk->length;
+		free(chunk);
+	}
+
+	arena->cursor = arena->chunks ? (chr_t *)arena->chunks + sizeof(arena_chunk_t) : NULL;
+	arena->end = arena->chunks ? (chr_t *)arena->chunks + arena->chunks->length : NULL;
+	arena->items = arena->used = 0;
+
+	return;
+}
+
+/**
+ * @brief	Free an arena, along with every block carved from it.
+ * @note	If the arena is bound to the calling thread, it's unbound as well.
+ * @param	arena	the arena being freed.
+ * @return	This function returns no value.
+ */
+void mm_arena_free(arena_t *arena) {
+
+	arena_chunk_t *chunk;
+
+	if (!arena) {
+		log_pedantic("Attempted to free a NULL arena.");
+		return;
+	}
+
+	while ((chunk = arena->chunks)) {
+		arena->chunks = chunk->next;
+		free(chunk);
+	}
+
+	if (arena_local == arena) {
+		arena_local = NULL;
+	}
+
+	mm_free(arena);
+	return;
+}
+
+/**
+ * @brief	Bind an arena to the calling thread, so it will be used to satisfy requests for ARENA stringers.
+ * @param	arena	the arena to bind, or NULL to leave the thread without an arena.
+ * @return	the arena which was previously bound to the thread, or NULL if there wasn't one.
+ */
+arena_t * mm_arena_bind(arena_t *arena) {
+
+	arena_t *previous = arena_local;
+
+	arena_local = arena;
+	return previous;
+}
+
+/**
+ * @brief	Get the arena bound to the calling thread.
+ * @return	the bound arena, or NULL if there isn't one.
+ */
+arena_t * mm_arena_current(void) {
+	return arena_local;
+}
+
+/**
+ * @brief	Carve a zeroed block out of the arena bound to the calling thread.
+ * @param	len	the length of the block, in bytes.
+ * @return	NULL on failure, or if no arena is bound to the thread, otherwise a pointer to the block.
+ */
+void * mm_arena_get(size_t len) {
+
+	chr_t *result;
+	uint64_t length;
+	arena_chunk_t *chunk;
+	arena_t *arena = arena_local;
+
+	if (!len) {
+		log_pedantic("Attempted to allocate a zero length block.");
+		return NULL;
+	}
+	else if (!arena) {
+		log_pedantic("Attempted to allocate an arena block without binding an arena to the thread.");
+		return NULL;
+	}
+
+	len = (len + 15) & ~((size_t)15);
+
+	if (!arena->cursor || (size_t)(arena->end - arena->cursor) < len) {
+
+		// Large requests get a dedicated chunk, which is linked in behind the current chunk, so the space remaining in the
+		// current chunk isn't wasted.
+		length = sizeof(arena_chunk_t) + (len > arena->chunk / 4 ? len : arena->chunk);
+
+		if (!(chunk = malloc(length))) {
+			log_pedantic("Unable to allocate an arena chunk of %lu bytes.", length);
+			return NULL;
+		}
+
+		chunk->length = length;
+		arena->reserved += length;
+
+		if (len > arena->chunk / 4 && arena->chunks) {
+			chunk->next = arena->chunks->next;
+			arena->chunks->next = chunk;
+			result = (chr_t *)chunk + sizeof(arena_chunk_t);
+			arena->used += len;
+			arena->items++;
+			return memset(result, 0, len);
+		}
+
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+		arena->cursor = (chr_t *)chunk + sizeof(arena_chunk_t);
+		arena->end = (chr_t *)chunk + length;
+	}
+
+	result = arena->cursor;
+	arena->cursor += len;
+	arena->used += len;
+	arena->items++;
+
+	return memset(result, 0, len);
+}
+
+/**
+ * @brief	Release a block carved from an arena.
+ * @note	Blocks are only returned to the system when the arena is reset or freed, so this function does nothing. It exists
+ * 			so arena blocks can be released through the same function pointer as heap and secure blocks.
+ * @param	block	a pointer to the block being released.
+ * @return	This function returns no value.
+ */
+void mm_arena_release(void *block) {
+	return;
+}
+
+/**
+ * @brief	Get the collected statistics for an arena.
+ * @param	arena	the arena being queried.
+ * @param	total	a pointer to a size_t variable that will store the number of bytes held by the arena chunks.
+ * @param	bytes	a pointer to a size_t variable that will store the number of bytes carved out of the chunks.
+ * @param	items	a pointer to a size_t variable that will store the number of blocks carved out of the chunks.
+ * @return	true on success or false on failure.
+ */
+bool_t mm_arena_stats(arena_t *arena, size_t *total, size_t *bytes, size_t *items) {
+
+	if (!arena || !total || !bytes || !items) {
+		return false;
+	}
+
+	*total = arena->reserved;
+	*bytes = arena->used;
+	*items = arena->items;
+
+	return true;
+}
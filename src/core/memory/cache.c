@@ -0,0 +1,536 @@
+
+/**
+ * @file /magma/core/memory/cache.c
+ *
+ * @brief	A size class allocator with thread local caches, used by mm_alloc() and mm_free() for small blocks.
+ *
+ * @note	A single range of address space is reserved when the allocator is started, and carved into fixed size spans as
+ * 			they are needed. Every span holds objects from a single size class, so the class of any block can be found by
+ * 			looking up the span it falls inside, and mm_free() can tell our blocks apart from system allocations with a
+ * 			simple range check. The size classes are spaced 16 bytes apart up to 256 bytes, which covers the stringer
+ * 			headers, index nodes and multi_t keys we allocate most often, and then four classes per power of two.
+ *
+ * 			Each thread keeps a free list per size class, so allocations and releases normally don't touch any shared
+ * 			state. An empty list is refilled with a batch of objects taken from the shared list for its class, and a list
+ * 			which grows past two batches returns one batch to the shared list, so memory released by one thread can be
+ * 			reused by another. The thread caches are returned to the shared lists when the thread exits.
+ *
+ * 			Once the objects on a shared list add up to MM_CACHE_TRIM spans, the list is checked for spans whose objects are
+ * 			all free. Those objects are pulled off the list, and the span's pages are handed back to the system using
+ * 			madvise(), so the process footprint shrinks after a burst of allocations. The span stays inside the reserved
+ * 			range, since it's never unmapped, and it's reused, possibly for another size class, before any new span is
+ * 			claimed. The objects held by the thread caches keep their spans alive, so only memory which has made its way
+ * 			back to the shared lists can be returned.
+ */
+
+#include "magma.h"
+
+/**
+ * The length of a span, which must be a power of two. Spans are allocated inside the reserved range, one at a time.
+ */
+#define MM_CACHE_SPAN 65536
+
+/**
+ * The amount of address space reserved if the caller doesn't provide a value. Pages are only committed as they're used.
+ */
+#define MM_CACHE_RESERVE 4294967296UL
+
+/**
+ * The number of bytes moved between a thread cache and the shared lists in a single batch. The number of objects is
+ * clamped to the range below.
+ */
+#define MM_CACHE_BATCH 16384
+#define MM_CACHE_BATCH_MIN 8
+#define MM_CACHE_BATCH_MAX 128
+
+/**
+ * The number of spans worth of objects which can pile up on a shared list before the list is checked for spans that can
+ * be returned to the system.
+ */
+#define MM_CACHE_TRIM 4
+
+typedef struct cache_object_t {
+	struct cache_object_t *next;
+} cache_object_t;
+
+typedef struct {
+	pthread_mutex_t lock;
+	cache_object_t *available;
+	chr_t *cursor, *end;
+	uint64_t count, objects, watermark;
+} __attribute__ ((aligned (64))) cache_central_t;
+
+typedef struct {
+	cache_object_t *available;
+	uint32_t count;
+} cache_list_t;
+
+typedef struct {
+	cache_list_t lists[MM_CACHE_CLASSES];
+	uint64_t allocated, released;
+	bool_t registered, closed;
+} cache_local_t;
+
+static struct {
+
+	struct {
+		chr_t *data;
+		size_t length;
+		uint64_t used, idle;
+		uint8_t *classes;
+		uint16_t *counts;
+		uint32_t *returned;
+		pthread_mutex_t lock;
+	} spans;
+
+	struct {
+		uint64_t allocated, released, refills, flushes, fallbacks, returned;
+	} counters;
+
+	uint32_t sizes[MM_CACHE_CLASSES], batches[MM_CACHE_CLASSES];
+	uint8_t lookup[(MM_CACHE_LIMIT >> 4) + 1];
+	cache_central_t central[MM_CACHE_CLASSES];
+	pthread_key_t key;
+	bool_t enabled;
+
+} cache = {
+
+	.spans = {
+		.data = NULL,
+		.length = 0,
+		.used = 0,
+		.idle = 0,
+		.classes = NULL,
+		.counts = NULL,
+		.returned = NULL,
+		.lock = PTHREAD_MUTEX_INITIALIZER
+	},
+
+	.enabled = false
+};
+
+static __thread cache_local_t cache_local;
+
+/**
+ * @brief	Determine whether a block was allocated by the size class allocator.
+ * @param	block	the block pointer to be tested.
+ * @return	true if the block falls inside the range reserved by the allocator, or false otherwise.
+ */
+bool_t mm_cache_owned(void *block) {
+	return cache.spans.data && (chr_t *)block >= cache.spans.data && (chr_t *)block < cache.spans.data + cache.spans.length;
+}
+
+/**
+ * @brief	Add the object counters for the calling thread to the allocator totals.
+ * @return	This function returns no value.
+ */
+void mm_cache_count(void) {
+
+	if (cache_local.allocated) {
+		__atomic_add_fetch(&(cache.counters.allocated), cache_local.allocated, __ATOMIC_RELAXED);
+		cache_local.allocated = 0;
+	}
+
+	if (cache_local.released) {
+		__atomic_add_fetch(&(cache.counters.released), cache_local.released, __ATOMIC_RELAXED);
+		cache_local.released = 0;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Return the spans whose objects are all sitting on the shared list for a size class to the system.
+ * @note	The caller must hold the lock for the shared list. Every object is in exactly one place, either in use, in a thread
+ * 			cache or on the shared list, so a span with all of its objects on the shared list isn't referenced anywhere else.
+ * 			The span currently being carved never qualifies, since some of its objects haven't been handed out yet.
+ * @param	class	the size class of the shared list being trimmed.
+ * @return	This function returns no value.
+ */
+void mm_cache_trim(uint32_t class) {
+
+	uint64_t span;
+	cache_object_t **link, *object;
+	cache_central_t *central = &(cache.central[class]);
+	uint16_t objects = MM_CACHE_SPAN / cache.sizes[class];
+
+	// Count the free objects on each span. The counters are only touched for spans owned by this class, so they can be shared
+	// with the other classes.
+	for (object = central->available; object; object = object->next) {
+		cache.spans.counts[((chr_t *)object - cache.spans.data) / MM_CACHE_SPAN]++;
+	}
+
+	// Unlink the objects which belong to a completely free span. The first time one turns up, its counter is bumped above the
+	// number of objects a span holds, and then counted back down, so the rest of its objects are still recognized. Once the
+	// last one is unlinked nothing refers to the span, so its pages are released, and it's queued for reuse.
+	for (link = &(central->available); (object = *link);) {
+
+		span = ((chr_t *)object - cache.spans.data) / MM_CACHE_SPAN;
+
+		if (cache.spans.counts[span] < objects) {
+			link = &(object->next);
+			continue;
+		}
+		else if (cache.spans.counts[span] == objects) {
+			cache.spans.counts[span] = objects * 2;
+		}
+
+		*link = object->next;
+		central->count--;
+		central->objects--;
+
+		if (--cache.spans.counts[span] == objects) {
+
+			cache.spans.counts[span] = 0;
+			madvise(cache.spans.data + (span * MM_CACHE_SPAN), MM_CACHE_SPAN, MADV_DONTNEED);
+
+			mutex_lock(&(cache.spans.lock));
+			cache.spans.returned[cache.spans.idle++] = span;
+			mutex_unlock(&(cache.spans.lock));
+
+			__atomic_add_fetch(&(cache.counters.returned), 1, __ATOMIC_RELAXED);
+		}
+	}
+
+	// Reset the counters for the spans which are still partially in use.
+	for (object = central->available; object; object = object->next) {
+		cache.spans.counts[((chr_t *)object - cache.spans.data) / MM_CACHE_SPAN] = 0;
+	}
+
+	// If the remaining objects are spread across partially used spans, walking the list again right away would be wasted
+	// effort, so the next check waits until the list has doubled in size.
+	central->watermark = central->count * 2 > objects * MM_CACHE_TRIM ? central->count * 2 : objects * MM_CACHE_TRIM;
+
+	return;
+}
+
+/**
+ * @brief	Move a batch of objects from a thread cache to the shared list for their size class.
+ * @param	class	the size class of the list being trimmed.
+ * @param	count	the number of objects to move, which must not exceed the number of objects in the list.
+ * @return	This function returns no value.
+ */
+void mm_cache_release(uint32_t class, uint32_t count) {
+
+	cache_object_t *head, *tail;
+	cache_list_t *list = &(cache_local.lists[class]);
+
+	if (!count) {
+		return;
+	}
+
+	head = tail = list->available;
+	for (uint32_t i = 1; i < count; i++) {
+		tail = tail->next;
+	}
+
+	list->available = tail->next;
+	list->count -= count;
+
+	mutex_lock(&(cache.central[class].lock));
+	tail->next = cache.central[class].available;
+	cache.central[class].available = head;
+	cache.central[class].count += count;
+
+	if (cache.central[class].count >= cache.central[class].watermark) {
+		mm_cache_trim(class);
+	}
+
+	mutex_unlock(&(cache.central[class].lock));
+
+	__atomic_add_fetch(&(cache.counters.flushes), 1, __ATOMIC_RELAXED);
+	mm_cache_count();
+
+	return;
+}
+
+/**
+ * @brief	Refill an empty thread cache with a batch of objects, taken from the shared list or carved from a span.
+ * @param	class	the size class of the list being refilled.
+ * @return	true if at least one object was added to the thread cache, or false if the reserved range is exhausted.
+ */
+bool_t mm_cache_refill(uint32_t class) {
+
+	uint64_t span;
+	cache_object_t *object;
+	uint32_t size = cache.sizes[class], count = 0;
+	cache_central_t *central = &(cache.central[class]);
+	cache_list_t *list = &(cache_local.lists[class]);
+
+	mutex_lock(&(central->lock));
+
+	while (count < cache.batches[class] && (object = central->available)) {
+		central->available = object->next;
+		object->next = list->available;
+		list->available = object;
+		central->count--;
+		count++;
+	}
+
+	// Let the trim threshold fall again as the list drains, so the spans used by a later burst can still be returned.
+	if (central->watermark > (MM_CACHE_SPAN / size) * MM_CACHE_TRIM && central->count * 4 < central->watermark) {
+		central->watermark /= 2;
+	}
+
+	while (count < cache.batches[class]) {
+
+		// The current span is exhausted, so another one is claimed. The space left at the end of the old span is wasted,
+		// but it's always smaller than a single object.
+		if (!central->cursor || (size_t)(central->end - central->cursor) < size) {
+
+			// Spans which were returned to the system are reused before a new span is claimed.
+			mutex_lock(&(cache.spans.lock));
+			span = cache.spans.idle ? cache.spans.returned[--cache.spans.idle] : UINT64_MAX;
+			mutex_unlock(&(cache.spans.lock));
+
+			if (span == UINT64_MAX && (span = __atomic_fetch_add(&(cache.spans.used), 1, __ATOMIC_RELAXED)) >= cache.spans.length / MM_CACHE_SPAN) {
+				break;
+			}
+
+			cache.spans.classes[span] = class;
+			central->cursor = cache.spans.data + (span * MM_CACHE_SPAN);
+			central->end = central->cursor + ((MM_CACHE_SPAN / size) * size);
+		}
+
+		object = (cache_object_t *)central->cursor;
+		central->cursor += size;
+		central->objects++;
+
+		object->next = list->available;
+		list->available = object;
+		count++;
+	}
+
+	mutex_unlock(&(central->lock));
+
+	list->count += count;
+	__atomic_add_fetch(&(cache.counters.refills), 1, __ATOMIC_RELAXED);
+	mm_cache_count();
+
+	return count ? true : false;
+}
+
+/**
+ * @brief	Return every object held by the calling thread's cache to the shared lists.
+ * @return	This function returns no value.
+ */
+void mm_cache_flush(void) {
+
+	for (uint32_t i = 0; i < MM_CACHE_CLASSES; i++) {
+		mm_cache_release(i, cache_local.lists[i].count);
+	}
+
+	mm_cache_count();
+	return;
+}
+
+/**
+ * @brief	Flush the cache belonging to a thread which is exiting.
+ * @note	Blocks released after this point, by other thread specific destructors, go straight to the shared lists.
+ * @param	local	a pointer to the cache of the exiting thread.
+ * @return	This function returns no value.
+ */
+void mm_cache_exit(void *local) {
+	mm_cache_flush();
+	cache_local.closed = true;
+	return;
+}
+
+/**
+ * @brief	Register the calling thread's cache, so it will be flushed when the thread exits.
+ * @return	This function returns no value.
+ */
+void mm_cache_register(void) {
+	cache_local.registered = true;
+	pthread_setspecific(cache.key, &cache_local);
+	return;
+}
+
+/**
+ * @brief	Allocate a block from the size class allocator.
+ * @note	The block isn't zeroed, mm_alloc() takes care of that.
+ * @param	len	the length of the block, in bytes.
+ * @return	NULL if the allocator is disabled, the length is too large, or the reserved range is exhausted, otherwise a
+ * 			pointer to the block.
+ */
+void * mm_cache_alloc(size_t len) {
+
+	uint32_t class;
+	cache_list_t *list;
+	cache_object_t *object;
+
+	if (!len || len > MM_CACHE_LIMIT || !cache.enabled || cache_local.closed) {
+		return NULL;
+	}
+	else if (!cache_local.registered) {
+		mm_cache_register();
+	}
+
+	class = cache.lookup[(len + 15) >> 4];
+	list = &(cache_local.lists[class]);
+
+	if (!list->available && !mm_cache_refill(class)) {
+		__atomic_add_fetch(&(cache.counters.fallbacks), 1, __ATOMIC_RELAXED);
+		return NULL;
+	}
+
+	object = list->available;
+	list->available = object->next;
+	list->count--;
+	cache_local.allocated++;
+
+	return object;
+}
+
+/**
+ * @brief	Release a block allocated by the size class allocator.
+ * @param	block	a pointer to the block, which must be inside the range reserved by the allocator.
+ * @return	This function returns no value.
+ */
+void mm_cache_free(void *block) {
+
+	uint32_t class = cache.spans.classes[((chr_t *)block - cache.spans.data) / MM_CACHE_SPAN];
+	cache_list_t *list = &(cache_local.lists[class]);
+	cache_object_t *object = block;
+
+	if (!cache_local.registered) {
+		mm_cache_register();
+	}
+
+	object->next = list->available;
+	list->available = object;
+	list->count++;
+	cache_local.released++;
+
+	// Once the thread has exited, or the list has grown too long, objects are handed back to the shared list.
+	if (cache_local.closed) {
+		mm_cache_flush();
+	}
+	else if (list->count > cache.batches[class] * 2) {
+		mm_cache_release(class, cache.batches[class]);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Get statistics for the size class allocator.
+ * @note	The object counters for a thread are only added to the totals when the thread exchanges a batch of objects with
+ * 			the shared lists, flushes its cache or exits, so they may lag behind slightly.
+ * @param	stats	a pointer to the structure which will receive the statistics.
+ * @return	true on success, or false if the allocator hasn't been started.
+ */
+bool_t mm_cache_stats(mm_cache_stats_t *stats) {
+
+	if (!stats || !cache.spans.data) {
+		return false;
+	}
+
+	mm_wipe(stats, sizeof(mm_cache_stats_t));
+
+	stats->reserved = cache.spans.length;
+	stats->spans = __atomic_load_n(&(cache.spans.used), __ATOMIC_RELAXED);
+	stats->spans = stats->spans < cache.spans.length / MM_CACHE_SPAN ? stats->spans : cache.spans.length / MM_CACHE_SPAN;
+	mutex_lock(&(cache.spans.lock));
+	stats->spans -= cache.spans.idle;
+	mutex_unlock(&(cache.spans.lock));
+
+	stats->returned = __atomic_load_n(&(cache.counters.returned), __ATOMIC_RELAXED);
+	stats->allocated = __atomic_load_n(&(cache.counters.allocated), __ATOMIC_RELAXED);
+	stats->released = __atomic_load_n(&(cache.counters.released), __ATOMIC_RELAXED);
+	stats->refills = __atomic_load_n(&(cache.counters.refills), __ATOMIC_RELAXED);
+	stats->flushes = __atomic_load_n(&(cache.counters.flushes), __ATOMIC_RELAXED);
+	stats->fallbacks = __atomic_load_n(&(cache.counters.fallbacks), __ATOMIC_RELAXED);
+
+	for (uint32_t i = 0; i < MM_CACHE_CLASSES; i++) {
+		mutex_lock(&(cache.central[i].lock));
+		stats->classes[i].size = cache.sizes[i];
+		stats->classes[i].objects = cache.central[i].objects;
+		stats->classes[i].available = cache.central[i].count;
+		mutex_unlock(&(cache.central[i].lock));
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Start the size class allocator, so mm_alloc() will use it for small blocks.
+ * @note	Restarting a stopped allocator reuses the range reserved the first time around.
+ * @param	reserve	the amount of address space to reserve, or 0 to use the default.
+ * @return	true on success, or false on failure.
+ */
+bool_t mm_cache_start(size_t reserve) {
+
+	chr_t *data;
+	uint32_t size = 16, class = 0;
+
+	if (cache.spans.data) {
+		cache.enabled = true;
+		return true;
+	}
+
+	reserve = reserve ? (reserve + MM_CACHE_SPAN - 1) & ~((size_t)MM_CACHE_SPAN - 1) : MM_CACHE_RESERVE;
+
+	if (!(cache.spans.classes = mm_alloc(reserve / MM_CACHE_SPAN)) || !(cache.spans.counts = mm_alloc((reserve / MM_CACHE_SPAN) * sizeof(uint16_t))) ||
+		!(cache.spans.returned = mm_alloc((reserve / MM_CACHE_SPAN) * sizeof(uint32_t)))) {
+		log_pedantic("Unable to allocate the span maps. { spans = %zu }", reserve / MM_CACHE_SPAN);
+		mm_cleanup(cache.spans.classes, cache.spans.counts);
+		cache.spans.classes = NULL;
+		cache.spans.counts = NULL;
+		return false;
+	}
+	else if ((data = mmap(NULL, reserve, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)) == MAP_FAILED) {
+		log_pedantic("Unable to reserve address space for the size class allocator. { reserve = %zu / error = %s }",
+			reserve, errno_string(errno, MEMORYBUF(1024), 1024));
+		mm_cleanup(cache.spans.classes, cache.spans.counts, cache.spans.returned);
+		cache.spans.classes = NULL;
+		cache.spans.counts = NULL;
+		cache.spans.returned = NULL;
+		return false;
+	}
+	else if (pthread_key_create(&(cache.key), &mm_cache_exit)) {
+		log_pedantic("Unable to create the thread cache key.");
+		munmap(data, reserve);
+		mm_cleanup(cache.spans.classes, cache.spans.counts, cache.spans.returned);
+		cache.spans.classes = NULL;
+		cache.spans.counts = NULL;
+		cache.spans.returned = NULL;
+		return false;
+	}
+
+	// The classes are 16 bytes apart up to 256 bytes, and then each power of two is split into four classes.
+	for (uint32_t len = 0; len <= MM_CACHE_LIMIT; len += 16) {
+
+		if (len > size) {
+			size += size < 256 ? 16 : (1U << (31 - __builtin_clz(size))) / 4;
+			class++;
+		}
+
+		cache.lookup[len >> 4] = class;
+		cache.sizes[class] = size;
+	}
+
+	for (uint32_t i = 0; i < MM_CACHE_CLASSES; i++) {
+		cache.batches[i] = MM_CACHE_BATCH / cache.sizes[i];
+		cache.batches[i] = cache.batches[i] < MM_CACHE_BATCH_MIN ? MM_CACHE_BATCH_MIN : cache.batches[i] > MM_CACHE_BATCH_MAX ? MM_CACHE_BATCH_MAX : cache.batches[i];
+		cache.central[i].watermark = (MM_CACHE_SPAN / cache.sizes[i]) * MM_CACHE_TRIM;
+		mutex_init(&(cache.central[i].lock), NULL);
+	}
+
+	cache.spans.length = reserve;
+	cache.spans.data = data;
+	cache.enabled = true;
+
+	return true;
+}
+
+/**
+ * @brief	Stop using the size class allocator for new blocks.
+ * @note	The reserved range stays mapped, since blocks allocated before the allocator was stopped may still be released.
+ * @return	This function returns no value.
+ */
+void mm_cache_stop(void) {
+	cache.enabled = false;
+	if (cache.spans.data) mm_cache_flush();
+	return;
+}
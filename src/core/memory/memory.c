@@ -98,6 +98,55 @@ void * mm_set(void *block, uint8_t set, size_t len) {
 	return block;
 }
 
+/**
+ * @brief	Sets a block of memory to a specified value, using vector stores which the compiler can't elide.
+ * @note	Unlike mm_set(), the stores aren't volatile, so when SSE2 is available the block is filled sixteen bytes at a time.
+ * 			Blocks of at least MM_SCRUB_STREAM bytes are filled using non-temporal stores, which bypass the cache, so wiping a
+ * 			large buffer doesn't evict data which is still in use. The empty assembly statement which follows the stores tells
+ * 			the compiler the block is read, so the stores can't be discarded as dead, even if the block is freed afterward.
+ * @param	block	the block of memory to be set.
+ * @param	set		the byte value to be written to block.
+ * @param	len		the number of times to write the value of the byte repeatedly to block.
+ * @return	a pointer to the block of memory passed to the function.
+ */
+void * mm_scrub(void *block, uint8_t set, size_t len) {
+
+	uchr_t *ptr = block;
+
+#ifdef __SSE2__
+	__m128i value = _mm_set1_epi8((char)set);
+
+	for (; len && ((uintptr_t)ptr & 15); len--) {
+		*ptr++ = set;
+	}
+
+	if (len >= MM_SCRUB_STREAM) {
+
+		for (; len >= 64; ptr += 64, len -= 64) {
+			_mm_stream_si128((__m128i *)ptr, value);
+			_mm_stream_si128((__m128i *)(ptr + 16), value);
+			_mm_stream_si128((__m128i *)(ptr + 32), value);
+			_mm_stream_si128((__m128i *)(ptr + 48), value);
+		}
+
+		// Non-temporal stores are weakly ordered, so they must be fenced before the block is handed to another thread.
+		_mm_sfence();
+	}
+
+	for (; len >= 16; ptr += 16, len -= 16) {
+		_mm_store_si128((__m128i *)ptr, value);
+	}
+#endif
+
+	while (len--) {
+		*ptr++ = set;
+	}
+
+	asm volatile ("" : : "r" (block) : "memory");
+
+	return block;
+}
+
 /**
  * @brief	Zero out a block of memory.
  * @note Uses the 'optimize (0)' and 'noinline' function attributes to prevent compiler optimization from removing logic it might consider unnecessary.
@@ -137,7 +186,10 @@ void mm_free(void *block) {
 	}
 #endif
 
-	if (block) {
+	if (block && mm_cache_owned(block)) {
+		mm_cache_free(block);
+	}
+	else if (block) {
 		free(block);
 	}
 
@@ -172,7 +224,9 @@ void * mm_dupe(void *block, size_t len) {
 
 /**
  *
- * @brief	Allocate a chunk of memory with the system allocator and zero-wipe it.
+ * @brief	Allocate a chunk of memory and zero-wipe it.
+ * @note	Small blocks come from the size class allocator when it has been started, and everything else comes from the
+ * 			system allocator.
  * @note	Uses the 'malloc' function attribute to indicate any non-NULL return value is not an alias for any other valid pointer.
  * @note	The buffer length must be non-zero.
  * @see		http://gcc.gnu.org/onlinedocs/gcc-4.4.4/gcc/Function-Attributes.html
@@ -187,10 +241,10 @@ void * mm_alloc(size_t len) {
 		log_pedantic("Attempted to allocate a zero length string.");
 		return NULL;
 	}
-	else if ((result = malloc(len))) {
-		mm_set(result, 0, len);
+	else if ((result = mm_cache_alloc(len))) {
+		memset(result, 0, len);
 	}
-	else {
+	else if (!(result = calloc(1, len))) {
 		log_pedantic("Unable to allocate a block of %zu bytes.", len);
 	}
 
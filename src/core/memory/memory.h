@@ -8,9 +8,52 @@
 #ifndef MAGMA_CORE_MEMORY_H
 #define MAGMA_CORE_MEMORY_H
 
+/**
+ * The largest block which will be handled by the size class allocator, and the number of size classes needed to cover it.
+ */
+#define MM_CACHE_LIMIT 2048
+#define MM_CACHE_CLASSES 28
+
+/**
+ * Blocks at least this long are scrubbed using non-temporal stores. Smaller blocks are likely to be reused while they're
+ * still cached, so they're scrubbed using regular stores.
+ */
+#define MM_SCRUB_STREAM 1048576
+
+typedef enum {
+	M_SEC_WIPE_SINGLE = 1, //!< M_SEC_WIPE_SINGLE
+	M_SEC_WIPE_MULTI = 2 //!< M_SEC_WIPE_MULTI
+} M_SEC_WIPE;
+
+typedef struct __attribute__ ((packed)) {
+	uint64_t reserved; /* The number of bytes of address space reserved for the allocator. */
+	uint64_t spans; /* The number of spans currently carved into objects, not counting spans returned to the system. */
+	uint64_t allocated, released; /* The number of objects allocated and released through the thread caches. */
+	uint64_t refills, flushes; /* The number of batches moved into and out of the thread caches. */
+	uint64_t fallbacks; /* The number of requests passed to the system allocator because the reserved range was full. */
+	uint64_t returned; /* The number of times a span was returned to the system because all of its objects were free. */
+	struct {
+		uint64_t size; /* The object size for the class. */
+		uint64_t objects; /* The number of objects carved out of spans for the class. */
+		uint64_t available; /* The number of objects sitting on the shared list for the class. */
+	} classes[MM_CACHE_CLASSES];
+} mm_cache_stats_t;
+
+typedef struct arena_t arena_t;
+
 /// align.c
 size_t align(size_t alignment, size_t len);
 
+/// arena.c
+arena_t *  mm_arena_alloc(size_t chunk);
+arena_t *  mm_arena_bind(arena_t *arena);
+arena_t *  mm_arena_current(void);
+void       mm_arena_free(arena_t *arena);
+void *     mm_arena_get(size_t len);
+void       mm_arena_release(void *block);
+void       mm_arena_reset(arena_t *arena);
+bool_t     mm_arena_stats(arena_t *arena, size_t *total, size_t *bytes, size_t *items);
+
 /// bitwise.c
 uint_t bitwise_count(uint64_t value);
 uchr_t bitwise_or(uchr_t a, uchr_t b);
@@ -21,12 +64,32 @@ uchr_t bitwise_and(uchr_t a, uchr_t b);
 void mm_sec_stop(void);
 bool_t mm_sec_start(void);
 void mm_sec_free(void *block);
+bool_t mm_sec_limit(size_t limit);
+void mm_sec_magazine_flush(void);
+void mm_sec_shrink(void);
+void mm_sec_wipe(void *block, size_t len);
+bool_t mm_sec_wipe_policy(M_SEC_WIPE policy);
 void mm_sec_cleanup(void *block);
 bool_t mm_sec_secured(void *block);
 void * mm_sec_alloc(size_t len);
 void * mm_sec_realloc(void *orig, size_t len);
 bool_t mm_sec_stats(size_t *total, size_t *bytes, size_t *items);
 
+/// cache.c
+void *   mm_cache_alloc(size_t len);
+void     mm_cache_count(void);
+void     mm_cache_exit(void *local);
+void     mm_cache_flush(void);
+void     mm_cache_free(void *block);
+bool_t   mm_cache_owned(void *block);
+bool_t   mm_cache_refill(uint32_t class);
+void     mm_cache_register(void);
+void     mm_cache_release(uint32_t class, uint32_t count);
+bool_t   mm_cache_start(size_t reserve);
+bool_t   mm_cache_stats(mm_cache_stats_t *stats);
+void     mm_cache_stop(void);
+void     mm_cache_trim(uint32_t class);
+
 /// memory.c
 void *   mm_alloc(size_t len);
 void     mm_cleanup_variadic(ssize_t len, ...);
@@ -35,11 +98,12 @@ void *   mm_dupe(void *block, size_t len);
 bool_t   mm_empty(void *block, size_t len);
 void     mm_free(void *block);
 void *   mm_move(void *dst, void *src, size_t len);
+void *   mm_scrub(void *block, uint8_t set, size_t len);
 void *   mm_set(void *block, uint8_t set, size_t len);
 void *   mm_wipe(void *block, size_t len);
 
-// Allocation requests are aligned to 12 bytes, which is also the length of the secured_t.
-#define MM_SEC_REQUEST_ALIGNMENT 12
+// Allocation requests are aligned to 16 bytes, which is also the length of the secured_t.
+#define MM_SEC_REQUEST_ALIGNMENT 16
 
 // The page size should be at least one kilobyte.
 #define MM_SEC_PAGE_ALIGNMENT_MIN 1024
@@ -47,6 +111,10 @@ void *   mm_wipe(void *block, size_t len);
 // The minimum secure memory block length.
 #define MM_SEC_POOL_LENGTH_MIN 4096
 
+// The maximum number of secure memory slabs, and the default limit on their combined length, as a multiple of the slab length.
+#define MM_SEC_SLABS_LIMIT 64
+#define MM_SEC_SLABS_DEFAULT 16
+
 // Usage: void *buffer = MEMORYBUF(length);
 #define MEMORYBUF(l) (void *)&((chr_t []){ [ 0 ... l ] = 0 })
 
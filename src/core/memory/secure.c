@@ -7,39 +7,93 @@
 
 #include "magma.h"
 
+/**
+ * The number of second level size classes per power of two, expressed as a power of two, and the number of first level
+ * size classes, each of which covers a power of two. The first class covers every request below 128 bytes.
+ */
+#define MM_SEC_CLASSES_SECOND_SHIFT 3
+#define MM_SEC_CLASSES_SECOND (1 << MM_SEC_CLASSES_SECOND_SHIFT)
+#define MM_SEC_CLASSES_FIRST 40
+
+/**
+ * The largest chunk which can be held by a thread magazine, the number of chunks of each size a magazine can hold, and the
+ * maximum number of bytes a single magazine can hold. The byte limit is also capped at 1/64th of the slab.
+ */
+#define MM_SEC_MAGAZINE_LIMIT 256
+#define MM_SEC_MAGAZINE_DEPTH 8
+#define MM_SEC_MAGAZINE_BYTES 4096
+
 enum {
 	MM_SEC_CHUNK_AVAILABLE = 0,
 	MM_SEC_CHUNK_ALLOCATED = 1
 };
 
+// Every chunk is preceded by a boundary tag which records the length of the chunk before it, so both neighbors of a chunk
+// can be found in constant time. The slab ends with a zero length tag which is always flagged as allocated.
 typedef struct __attribute__ ((packed)) {
 	uint32_t flags;
+	uint32_t prior; /* The length of the preceding chunk divided by MM_SEC_REQUEST_ALIGNMENT, or zero for the first chunk. */
 	size_t length;
 } secured_t;
 
+// Available chunks use the start of their data segment to link themselves into the free list for their size class.
+typedef struct secured_link_t {
+	secured_t *next, *prev;
+} secured_link_t;
+
+typedef struct {
+	void *data_true;
+	void *data;
+	size_t length;
+	size_t length_true;
+} secured_slab_t;
+
+typedef struct {
+	secured_t *chunks[MM_SEC_MAGAZINE_LIMIT / MM_SEC_REQUEST_ALIGNMENT][MM_SEC_MAGAZINE_DEPTH];
+	uint32_t counts[MM_SEC_MAGAZINE_LIMIT / MM_SEC_REQUEST_ALIGNMENT];
+	uint64_t generation;
+	size_t bytes;
+	bool_t registered, closed;
+} secured_magazine_t;
+
 static struct {
 
 	struct {
-		void *data_true;
-		void *data;
-		size_t length;
-		size_t length_true;
+		secured_slab_t list[MM_SEC_SLABS_LIMIT];
+		uint32_t count; /* One more than the highest slot in use. */
+		size_t total, limit, length, page;
+		uintptr_t low, high; /* The bounds of every slab which has ever been mapped, so most pointers can be rejected quickly. */
 		pthread_mutex_t lock;
-	} slab;
+	} slabs;
+
+	struct {
+		uint64_t first;
+		uint8_t second[MM_SEC_CLASSES_FIRST];
+		secured_t *heads[MM_SEC_CLASSES_FIRST][MM_SEC_CLASSES_SECOND];
+	} available;
 
 	struct {
 		size_t items;
 		size_t bytes;
 	} allocated;
 
+	struct {
+		pthread_key_t key;
+		uint64_t generation;
+		size_t limit;
+		bool_t keyed;
+	} magazines;
+
+	M_SEC_WIPE wipe;
 	bool_t enabled;
 
 } secure = {
 
-	.slab = {
-	.data = NULL,
-	.length = 0,
-	.lock = PTHREAD_MUTEX_INITIALIZER
+	.slabs = {
+		.count = 0,
+		.total = 0,
+		.limit = 0,
+		.lock = PTHREAD_MUTEX_INITIALIZER
 	},
 
 	.allocated = {
@@ -47,156 +101,564 @@ static struct {
 		.bytes = 0
 	},
 
+	.magazines = {
+		.generation = 1,
+		.limit = 0,
+		.keyed = false
+	},
+
+	.wipe = M_SEC_WIPE_MULTI,
 	.enabled = false
 };
 
+static __thread secured_magazine_t secure_magazine;
+
 /**
  * @brief	Get the collected secure memory statistics for the caller.
- * @param	total	a pointer to a size_t variable that will store the secure memory region length, in bytes.
+ * @note	Chunks held by the thread magazines are counted as available.
+ * @param	total	a pointer to a size_t variable that will store the combined length of the secure memory slabs, in bytes.
  * @param	bytes	a pointer to a size_t variable that will store the number of secure bytes allocated by magma.
  * @param	items	a pointer to a size_t variable that will store the number of secure memory allocations requested by magma.
  * @return	true on success or false on failure.
  */
 bool_t mm_sec_stats(size_t *total, size_t *bytes, size_t *items) {
 
-	if (!secure.enabled || !secure.slab.data || !total || !bytes || !items) {
+	if (!secure.enabled || !secure.slabs.count || !total || !bytes || !items) {
 		return false;
 	}
 
-	mutex_lock(&secure.slab.lock);
-	*total = secure.slab.length;
-	*bytes = secure.allocated.bytes;
-	*items = secure.allocated.items;
-	mutex_unlock(&secure.slab.lock);
+	*total = __atomic_load_n(&secure.slabs.total, __ATOMIC_RELAXED);
+	*bytes = __atomic_load_n(&secure.allocated.bytes, __ATOMIC_RELAXED);
+	*items = __atomic_load_n(&secure.allocated.items, __ATOMIC_RELAXED);
 
 	return true;
 }
 
 /**
- * @brief	Determine whether the data pointer falls within the secure memory block.
+ * @brief	Determine whether the data pointer falls within one of the secure memory slabs.
  * @param	block	the data pointer to be tested.
  * @return	true if block points to secure data; false if not, or if block is invalid or secure memory is disabled.
  */
 bool_t mm_sec_secured(void *block) {
 
-	size_t input, slab;
+	uchr_t *data;
+	uint32_t count;
+	uintptr_t input = (uintptr_t)block;
 
-	if (!block || !secure.enabled || !secure.slab.data) {
+	if (!block || !secure.enabled || input < __atomic_load_n(&secure.slabs.low, __ATOMIC_RELAXED) ||
+		input >= __atomic_load_n(&secure.slabs.high, __ATOMIC_RELAXED)) {
 		return false;
 	}
 
-	// Cast the provided pointer and the start of the secure memory slab into arithmetic operations on numbers are universal while arithmetic operations on pointers
-	// are vary across platforms.
-	input = (size_t)block;
-	slab = (size_t)secure.slab.data;
+	count = __atomic_load_n(&secure.slabs.count, __ATOMIC_ACQUIRE);
 
-	// If the value of input falls within the range of our secure memory slab we let our customer know by returning a value of true.
-	return input >= slab && input < (slab + secure.slab.length) ? true : false;
+	// Slabs are published by storing their data pointer last, so a non-NULL pointer always comes with a valid length.
+	for (uint32_t i = 0; i < count; i++) {
+		if ((data = __atomic_load_n(&(secure.slabs.list[i].data), __ATOMIC_ACQUIRE)) && (uchr_t *)block >= data &&
+			(uchr_t *)block < data + secure.slabs.list[i].length) {
+			return true;
+		}
+	}
+
+	return false;
 }
 
 /**
- * @brief	Get the next chunk of secure memory.
+ * @brief	Get the chunk which follows a chunk of secure memory.
  * @param	chunk	the input secure chunk.
- * @return	a pointer to the next chunk of secure memory, or NULL on failure or if the end of the slab is reached.
+ * @return	a pointer to the next chunk, which is the zero length boundary tag if the input is the last chunk in the slab.
  */
 secured_t * mm_sec_chunk_next(secured_t *chunk) {
+	return (secured_t *)((chr_t *)chunk + sizeof(secured_t) + chunk->length);
+}
 
-	secured_t *next;
+/**
+ * @brief	Get the chunk which precedes a chunk of secure memory.
+ * @param	chunk	the input secure chunk.
+ * @return	a pointer to the previous chunk of secure memory, or NULL if the input is the first chunk in the slab.
+ */
+secured_t * mm_sec_chunk_prev(secured_t *chunk) {
 
-	next = (secured_t *)((chr_t *)chunk + sizeof(secured_t) + chunk->length);
-	if (!mm_sec_secured(next)) next = NULL;
+	if (!chunk->prior) {
+		return NULL;
+	}
 
-	return next;
+	return (secured_t *)((chr_t *)chunk - sizeof(secured_t) - ((size_t)chunk->prior * MM_SEC_REQUEST_ALIGNMENT));
 }
 
 /**
- * @brief	Get the previous chunk of secure memory.
- * @param	chunk	the input secure chunk.
- * @return	a pointer to the previous chunk of secure memory, or NULL on failure or if the beginning of the slab is reached.
+ * @brief	Find the size class which holds available chunks of a given length.
+ * @param	length	the chunk length, which must be a multiple of MM_SEC_REQUEST_ALIGNMENT.
+ * @param	first	a pointer to the variable which will receive the first level class.
+ * @param	second	a pointer to the variable which will receive the second level class.
+ * @return	This function returns no value.
  */
-secured_t * mm_sec_chunk_prev(secured_t *chunk) {
+void mm_sec_chunk_class(size_t length, uint32_t *first, uint32_t *second) {
 
-	secured_t *prev, *next;
+	uint32_t order;
+
+	if (length < (MM_SEC_REQUEST_ALIGNMENT << MM_SEC_CLASSES_SECOND_SHIFT)) {
+		*first = 0;
+		*second = length / MM_SEC_REQUEST_ALIGNMENT;
+		return;
+	}
+
+	order = 63 - __builtin_clzll(length);
+	*first = order - (__builtin_ctz(MM_SEC_REQUEST_ALIGNMENT) + MM_SEC_CLASSES_SECOND_SHIFT) + 1;
+	*second = (length >> (order - MM_SEC_CLASSES_SECOND_SHIFT)) & (MM_SEC_CLASSES_SECOND - 1);
 
-	if (chunk == secure.slab.data) {
-		prev = NULL;
+	// Anything too large for the last class is placed in it anyway. The linear search at the end of mm_sec_chunk_take() will
+	// still find it.
+	if (*first >= MM_SEC_CLASSES_FIRST) {
+		*first = MM_SEC_CLASSES_FIRST - 1;
+		*second = MM_SEC_CLASSES_SECOND - 1;
+	}
+
+	return;
+}
+
+/**
+ * @brief	Add an available chunk to the free list for its size class.
+ * @note	The caller must hold the slab lock.
+ * @param	chunk	the chunk being added.
+ * @return	This function returns no value.
+ */
+void mm_sec_chunk_insert(secured_t *chunk) {
+
+	uint32_t first, second;
+	secured_link_t *link = (secured_link_t *)(chunk + 1);
+
+	mm_sec_chunk_class(chunk->length, &first, &second);
+
+	chunk->flags = MM_SEC_CHUNK_AVAILABLE;
+	link->prev = NULL;
+	link->next = secure.available.heads[first][second];
+
+	if (link->next) {
+		((secured_link_t *)(link->next + 1))->prev = chunk;
+	}
+
+	secure.available.heads[first][second] = chunk;
+	secure.available.second[first] |= (1 << second);
+	secure.available.first |= (1UL << first);
+
+	return;
+}
+
+/**
+ * @brief	Remove an available chunk from the free list for its size class.
+ * @note	The caller must hold the slab lock.
+ * @param	chunk	the chunk being removed.
+ * @return	This function returns no value.
+ */
+void mm_sec_chunk_remove(secured_t *chunk) {
+
+	uint32_t first, second;
+	secured_link_t *link = (secured_link_t *)(chunk + 1);
+
+	mm_sec_chunk_class(chunk->length, &first, &second);
+
+	if (link->prev) {
+		((secured_link_t *)(link->prev + 1))->next = link->next;
 	}
 	else {
-		prev = (secured_t *)secure.slab.data;
-		while ((next = mm_sec_chunk_next(prev)) && next != chunk) prev = next;
+		secure.available.heads[first][second] = link->next;
+	}
+
+	if (link->next) {
+		((secured_link_t *)(link->next + 1))->prev = link->prev;
 	}
 
-	return prev;
+	if (!secure.available.heads[first][second] && !(secure.available.second[first] &= ~(1 << second))) {
+		secure.available.first &= ~(1UL << first);
+	}
+
+	chunk->flags = MM_SEC_CHUNK_ALLOCATED;
+	return;
 }
 
 /**
- * @brief  If an adjacent region is available, merge them together.
+ * @brief	Release a chunk back to the slab, merging it with any available neighbors.
+ * @note	The caller must hold the slab lock.
+ * @param	chunk	the chunk being released.
+ * @return	a pointer to the available chunk, after it has been merged with its neighbors.
  */
-void mm_sec_chunk_merge(secured_t *chunk) {
+secured_t * mm_sec_chunk_merge(secured_t *chunk) {
 
 	secured_t *prev, *next;
 
-	prev = mm_sec_chunk_prev(chunk);
 	next = mm_sec_chunk_next(chunk);
 
-	if (prev && (!(prev->flags & MM_SEC_CHUNK_ALLOCATED))) {
+	if (!(next->flags & MM_SEC_CHUNK_ALLOCATED)) {
+		mm_sec_chunk_remove(next);
+		chunk->length += sizeof(secured_t) + next->length;
+	}
+
+	if ((prev = mm_sec_chunk_prev(chunk)) && !(prev->flags & MM_SEC_CHUNK_ALLOCATED)) {
+		mm_sec_chunk_remove(prev);
 		prev->length += sizeof(secured_t) + chunk->length;
 		chunk = prev;
 	}
 
-	if (next && (!(next->flags & MM_SEC_CHUNK_ALLOCATED))) {
-		chunk->length += sizeof(secured_t) + next->length;
+	mm_sec_chunk_next(chunk)->prior = chunk->length / MM_SEC_REQUEST_ALIGNMENT;
+	mm_sec_chunk_insert(chunk);
+
+	return chunk;
+}
+
+/**
+ * @brief	Locates a properly sized chunk of memory and reserves it.
+ * @note	The caller must hold the slab lock. The request is rounded up to the next size class, so the first chunk in any
+ * 			nonempty class at or above it is guaranteed to fit. If that fails, the class holding the request is searched.
+ * @param	size	the length of the chunk, which must be a multiple of MM_SEC_REQUEST_ALIGNMENT.
+ * @return	NULL if there isn't an available chunk large enough, or a pointer to the reserved chunk.
+ */
+secured_t * mm_sec_chunk_take(size_t size) {
+
+	uint64_t map;
+	secured_t *chunk = NULL, *split;
+	uint32_t first, second, order;
+	size_t rounded = size;
+
+	if (size >= (MM_SEC_REQUEST_ALIGNMENT << MM_SEC_CLASSES_SECOND_SHIFT)) {
+		order = 63 - __builtin_clzll(size);
+		rounded += (1UL << (order - MM_SEC_CLASSES_SECOND_SHIFT)) - 1;
+	}
+
+	mm_sec_chunk_class(rounded, &first, &second);
+
+	if ((map = secure.available.second[first] & (~0U << second))) {
+		chunk = secure.available.heads[first][__builtin_ctz(map)];
+	}
+	else if (first + 1 < MM_SEC_CLASSES_FIRST && (map = secure.available.first & (~0UL << (first + 1)))) {
+		first = __builtin_ctzll(map);
+		chunk = secure.available.heads[first][__builtin_ctz(secure.available.second[first])];
+	}
+
+	// The rounding skips over chunks in the same class as the request which are large enough, so check them before failing.
+	if (!chunk) {
+		mm_sec_chunk_class(size, &first, &second);
+		for (chunk = secure.available.heads[first][second]; chunk && chunk->length < size; chunk = ((secured_link_t *)(chunk + 1))->next);
+	}
+
+	if (!chunk) {
+		return NULL;
+	}
+
+	mm_sec_chunk_remove(chunk);
+
+	// If splitting the chunk would leave enough room for another chunk, the remainder is returned to the free lists.
+	if (chunk->length - size >= sizeof(secured_t) + sizeof(secured_link_t)) {
+		split = (secured_t *)(((chr_t *)chunk) + sizeof(secured_t) + size);
+		split->length = chunk->length - size - sizeof(secured_t);
+		split->prior = size / MM_SEC_REQUEST_ALIGNMENT;
+		chunk->length = size;
+		mm_sec_chunk_next(split)->prior = split->length / MM_SEC_REQUEST_ALIGNMENT;
+		mm_sec_chunk_insert(split);
+	}
+
+	return chunk;
+}
+
+/**
+ * @brief	Map a new secure memory slab, lock it into memory, and add its space to the free lists.
+ * @note	The caller must hold the slab lock, unless the secure memory system is being started. The slab is surrounded by
+ * 			guard pages with empty permissions to protect against underflows and overflows.
+ * @param	length	the usable length of the slab, which must be a multiple of the page length.
+ * @return	true if the slab was added, or false on failure.
+ */
+bool_t mm_sec_slab_add(size_t length) {
+
+	uint32_t slot;
+	uchr_t *bndptr;
+	secured_t *chunk;
+	secured_slab_t *slab;
+
+	for (slot = 0; slot < MM_SEC_SLABS_LIMIT && secure.slabs.list[slot].data; slot++);
+
+	if (slot == MM_SEC_SLABS_LIMIT) {
+		log_pedantic("The maximum number of secure memory slabs are already mapped. { limit = %i }", MM_SEC_SLABS_LIMIT);
+		return false;
+	}
+	else if (secure.slabs.total + length > secure.slabs.limit) {
+		log_pedantic("Adding another slab would exceed the secure memory limit. { total = %zu / length = %zu / limit = %zu }",
+			secure.slabs.total, length, secure.slabs.limit);
+		return false;
 	}
 
+	slab = &(secure.slabs.list[slot]);
+	slab->length = length;
+	slab->length_true = length + (secure.slabs.page * 2);
+
+	// Request an anonymous memory mapping that is aligned according to the system page size. Were asking the kernel to lock returned block into memory.
+	if ((slab->data_true = mmap64(NULL, slab->length_true, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_LOCKED, -1, 0)) == MAP_FAILED) {
+		log_pedantic("Unable to memory map an anonymous file. { error = %s }", errno_string(errno, MEMORYBUF(1024), 1024));
+		slab->data_true = NULL;
+		return false;
+	}
+
+	bndptr = slab->data_true;
+
+	if (mprotect(bndptr, secure.slabs.page, PROT_NONE) || mprotect(bndptr + secure.slabs.page + length, secure.slabs.page, PROT_NONE)) {
+		log_pedantic("Unable to set protections on the secure memory boundary chunks.");
+		munmap(slab->data_true, slab->length_true);
+		slab->data_true = NULL;
+		return false;
+	}
+
+	// We also request the address range assigned be locked into memory using the mlock call.
+	else if (mlock(bndptr + secure.slabs.page, length)) {
+		log_pedantic("Unable to lock the address space reserved for sensitive data in memory.");
+		munmap(slab->data_true, slab->length_true);
+		slab->data_true = NULL;
+		return false;
+	}
+
+	bndptr += secure.slabs.page;
+	mm_wipe(bndptr, length);
+
+	// The slab starts out as a single available chunk, followed by the zero length boundary tag which marks the end.
+	chunk = (secured_t *)bndptr;
+	chunk->length = length - (sizeof(secured_t) * 2);
+	chunk->prior = 0;
+
+	mm_sec_chunk_next(chunk)->flags = MM_SEC_CHUNK_ALLOCATED;
+	mm_sec_chunk_next(chunk)->prior = chunk->length / MM_SEC_REQUEST_ALIGNMENT;
+	mm_sec_chunk_next(chunk)->length = 0;
+
+	mm_sec_chunk_insert(chunk);
+
+	// Widen the bounds before publishing the slab, so mm_sec_secured() never rejects a pointer into it.
+	if (!secure.slabs.low || (uintptr_t)bndptr < secure.slabs.low) __atomic_store_n(&secure.slabs.low, (uintptr_t)bndptr, __ATOMIC_RELAXED);
+	if ((uintptr_t)bndptr + length > secure.slabs.high) __atomic_store_n(&secure.slabs.high, (uintptr_t)bndptr + length, __ATOMIC_RELAXED);
+
+	__atomic_store_n(&(slab->data), bndptr, __ATOMIC_RELEASE);
+	__atomic_add_fetch(&secure.slabs.total, length, __ATOMIC_RELAXED);
+
+	if (slot >= secure.slabs.count) {
+		__atomic_store_n(&secure.slabs.count, slot + 1, __ATOMIC_RELEASE);
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Remove a secure memory slab from the slab table, so it can be wiped and returned to the system.
+ * @note	The caller must hold the slab lock, and the slab must not hold any allocated chunks. The slab is copied into
+ * 			detached, so it can be released by mm_sec_slab_release() after the lock has been dropped.
+ * @param	slot		the slot holding the slab to be detached.
+ * @param	detached	a pointer to a slab structure which will receive a copy of the detached slab.
+ * @return	true if the slot held a slab, or false if it was empty.
+ */
+bool_t mm_sec_slab_detach(uint32_t slot, secured_slab_t *detached) {
+
+	secured_slab_t *slab = &(secure.slabs.list[slot]);
+
+	if (!slab->data) {
+		return false;
+	}
+
+	*detached = *slab;
+
+	__atomic_store_n(&(slab->data), NULL, __ATOMIC_RELEASE);
+	__atomic_sub_fetch(&secure.slabs.total, slab->length, __ATOMIC_RELAXED);
+
+	slab->data_true = NULL;
+	slab->length = slab->length_true = 0;
+
+	return true;
+}
+
+/**
+ * @brief	Wipe a detached secure memory slab and return it to the system.
+ * @note	The slab lock isn't needed, since the slab was removed from the slab table by mm_sec_slab_detach().
+ * @param	slab	a pointer to the detached slab.
+ * @return	This function returns no value.
+ */
+void mm_sec_slab_release(secured_slab_t *slab) {
+
+	mm_sec_wipe(slab->data, slab->length);
+	munlock(slab->data, slab->length);
+	munmap(slab->data_true, slab->length_true);
+
 	return;
 }
 
 /**
- * @brief  Locates a properly sized chunk of memory and reserves it.
+ * @brief	Determine whether a slab is idle, which means it consists of a single available chunk.
+ * @note	The caller must hold the slab lock.
+ * @param	slot	the slot holding the slab to be checked.
+ * @return	true if the slab is mapped and idle, or false otherwise.
  */
-secured_t * mm_sec_chunk_new(secured_t *block, size_t size) {
+bool_t mm_sec_slab_idle(uint32_t slot) {
+
+	secured_t *chunk = secure.slabs.list[slot].data;
+
+	return chunk && !(chunk->flags & MM_SEC_CHUNK_ALLOCATED) && !mm_sec_chunk_next(chunk)->length;
+}
 
-	bool_t loop = true;
-	secured_t *chunk, *split;
+/**
+ * @brief	Release an idle slab back to the system, unless it's the only idle slab.
+ * @note	The caller must hold the slab lock. The first slab is never released, and a single idle slab is kept in reserve
+ * 			so a workload hovering around a slab boundary doesn't map and unmap a slab on every request.
+ * @param	chunk		an available chunk which spans the entire slab.
+ * @param	detached	a pointer to a slab structure which will receive the slab, if it was detached.
+ * @return	true if the slab was detached, and should be released once the lock is dropped, or false otherwise.
+ */
+bool_t mm_sec_slab_trim(secured_t *chunk, secured_slab_t *detached) {
 
-	chunk = block;
-	while(loop && mm_sec_secured(chunk)) {
+	uint32_t slot, spare;
 
-		if (!(chunk->flags & MM_SEC_CHUNK_ALLOCATED) && chunk->length >= size) {
+	for (slot = 1; slot < secure.slabs.count && secure.slabs.list[slot].data != (void *)chunk; slot++);
+	for (spare = 1; spare < secure.slabs.count && (spare == slot || !mm_sec_slab_idle(spare)); spare++);
 
-			// Flag the chunk as allocated.
-			chunk->flags |= MM_SEC_CHUNK_ALLOCATED;
+	if (slot < secure.slabs.count && spare < secure.slabs.count) {
+		mm_sec_chunk_remove(chunk);
+		return mm_sec_slab_detach(slot, detached);
+	}
 
-			// If splitting the chunk would yield any bytes beyond the overhead.
-			if ((chunk->length - size) > sizeof(secured_t)) {
-				split = (secured_t *)(((chr_t *)chunk) + sizeof(secured_t) + size);
-				split->length = chunk->length - size - sizeof(secured_t);
-				split->flags = 0;
-				chunk->length = size;
-				mm_sec_chunk_merge(split);
-			}
+	return false;
+}
+
+/**
+ * @brief	Release every idle secure memory slab back to the system, except for the first one.
+ * @note	The calling thread's magazine is flushed first, since the chunks it holds would otherwise keep their slabs busy.
+ * @return	This function returns no value.
+ */
+void mm_sec_shrink(void) {
+
+	uint32_t count = 0;
+	secured_slab_t detached[MM_SEC_SLABS_LIMIT];
+
+	if (!secure.enabled || !secure.slabs.count) {
+		return;
+	}
+
+	mm_sec_magazine_flush();
+	mutex_lock(&secure.slabs.lock);
 
-			loop = false;
+	for (uint32_t i = 1; i < secure.slabs.count; i++) {
+		if (mm_sec_slab_idle(i)) {
+			mm_sec_chunk_remove(secure.slabs.list[i].data);
+			count += mm_sec_slab_detach(i, &detached[count]);
 		}
-		else {
-			chunk = mm_sec_chunk_next(chunk);
+	}
+
+	mutex_unlock(&secure.slabs.lock);
+
+	for (uint32_t i = 0; i < count; i++) {
+		mm_sec_slab_release(&detached[i]);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Wipe a block of secure memory according to the wipe policy.
+ * @note	The multi-pass policy overwrites the block with alternating bit patterns before zeroing it. Either way, the final
+ * 			pass always writes zeros, since the allocator relies on freed chunks being zeroed.
+ * @param	block	the block of memory to be wiped.
+ * @param	len		the length of the block, in bytes.
+ * @return	This function returns no value.
+ */
+void mm_sec_wipe(void *block, size_t len) {
+
+	if (__atomic_load_n(&secure.wipe, __ATOMIC_RELAXED) == M_SEC_WIPE_MULTI) {
+		mm_scrub(block, 255, len);
+		mm_scrub(block, 128, len);
+	}
+
+	mm_scrub(block, 0, len);
+	return;
+}
+
+/**
+ * @brief	Set the policy used to wipe secure memory when it's freed.
+ * @param	policy	M_SEC_WIPE_SINGLE to zero blocks with a single pass, or M_SEC_WIPE_MULTI to use three passes.
+ * @return	true if the policy was set, or false if it was invalid.
+ */
+bool_t mm_sec_wipe_policy(M_SEC_WIPE policy) {
+
+	if (policy != M_SEC_WIPE_SINGLE && policy != M_SEC_WIPE_MULTI) {
+		log_pedantic("Invalid secure memory wipe policy. { policy = %i }", policy);
+		return false;
+	}
+
+	__atomic_store_n(&secure.wipe, policy, __ATOMIC_RELAXED);
+	return true;
+}
+
+/**
+ * @brief	Set the limit on the combined length of the secure memory slabs.
+ * @note	Lowering the limit doesn't release any slabs, it only prevents new slabs from being added.
+ * @param	limit	the new limit, in bytes, which must be at least as large as the configured slab length.
+ * @return	true if the limit was set, or false if it was invalid.
+ */
+bool_t mm_sec_limit(size_t limit) {
+
+	if (!secure.enabled || !secure.slabs.count || limit < secure.slabs.length) {
+		log_pedantic("Invalid secure memory limit. { limit = %zu / length = %zu }", limit, secure.slabs.length);
+		return false;
+	}
+
+	mutex_lock(&secure.slabs.lock);
+	secure.slabs.limit = limit;
+	mutex_unlock(&secure.slabs.lock);
+
+	return true;
+}
+
+/**
+ * @brief	Return every chunk held by the calling thread's magazine to the slab.
+ * @note	Magazines left over from before the secure memory system was restarted are simply discarded.
+ * @return	This function returns no value.
+ */
+void mm_sec_magazine_flush(void) {
+
+	if (secure_magazine.bytes && secure_magazine.generation == secure.magazines.generation) {
+
+		mutex_lock(&secure.slabs.lock);
+
+		for (uint32_t i = 0; i < MM_SEC_MAGAZINE_LIMIT / MM_SEC_REQUEST_ALIGNMENT; i++) {
+			while (secure_magazine.counts[i]) {
+				mm_sec_chunk_merge(secure_magazine.chunks[i][--secure_magazine.counts[i]]);
+			}
 		}
+
+		mutex_unlock(&secure.slabs.lock);
 	}
 
-	// If we end up reaching the end of the secure address space, return NULL.
-	if (!mm_sec_secured(chunk))	chunk = NULL;
+	mm_wipe(secure_magazine.counts, sizeof(secure_magazine.counts));
+	secure_magazine.generation = secure.magazines.generation;
+	secure_magazine.bytes = 0;
 
-	return chunk;
+	return;
+}
+
+/**
+ * @brief	Flush the magazine belonging to a thread which is exiting.
+ * @param	magazine	a pointer to the magazine of the exiting thread.
+ * @return	This function returns no value.
+ */
+void mm_sec_magazine_exit(void *magazine) {
+	mm_sec_magazine_flush();
+	secure_magazine.closed = true;
+	return;
 }
 
 /**
  * @brief	Free a secure memory block and perform a multi-pass wipe of its contents.
+ * @note	Small chunks are held in a magazine belonging to the calling thread once they've been wiped, so they can be reused
+ * 			without taking the slab lock.
  * @return	This function returns no value.
  */
 void mm_sec_free(void *block) {
 
 	size_t len;
+	uint32_t class;
 	secured_t *chunk;
+	secured_slab_t detached;
+	bool_t trimmed = false;
 
 #ifdef MAGMA_PEDANTIC
 	if (!mm_sec_secured(block)) {
@@ -208,20 +670,43 @@ void mm_sec_free(void *block) {
 		chunk = (secured_t *)((chr_t *)block - sizeof(secured_t));
 		len = chunk->length;
 
-		// Wipe the data segment three times to ensure sensitive information isn't leaked.
-		mm_set(block, 255, len);
-		mm_set(block, 128, len);
-		mm_set(block, 0, len);
+		// Wipe the data segment before taking the lock, so the slab isn't held while we scrub a large block.
+		mm_sec_wipe(block, len);
+
+		__atomic_sub_fetch(&secure.allocated.items, 1, __ATOMIC_RELAXED);
+		__atomic_sub_fetch(&secure.allocated.bytes, len, __ATOMIC_RELAXED);
+
+		if (secure_magazine.generation != secure.magazines.generation) {
+			mm_sec_magazine_flush();
+		}
+
+		if (!secure_magazine.registered && secure.magazines.keyed) {
+			secure_magazine.registered = true;
+			pthread_setspecific(secure.magazines.key, &secure_magazine);
+		}
+
+		class = (len / MM_SEC_REQUEST_ALIGNMENT) - 1;
+
+		// The chunk stays flagged as allocated while it sits in the magazine, so its neighbors won't try to merge with it.
+		if (!secure_magazine.closed && len <= MM_SEC_MAGAZINE_LIMIT && secure_magazine.counts[class] < MM_SEC_MAGAZINE_DEPTH &&
+			secure_magazine.bytes + len <= secure.magazines.limit) {
+			secure_magazine.chunks[class][secure_magazine.counts[class]++] = chunk;
+			secure_magazine.bytes += len;
+			return;
+		}
 
-		mutex_lock(&secure.slab.lock);
+		mutex_lock(&secure.slabs.lock);
 
-		secure.allocated.items--;
-		secure.allocated.bytes -= len;
+		// If the chunk now spans an entire slab, the slab is idle, and may be returned to the system.
+		if (!(chunk = mm_sec_chunk_merge(chunk))->prior && !mm_sec_chunk_next(chunk)->length) {
+			trimmed = mm_sec_slab_trim(chunk, &detached);
+		}
 
-		chunk->flags &= ~MM_SEC_CHUNK_ALLOCATED;
-		mm_sec_chunk_merge(chunk);
+		mutex_unlock(&secure.slabs.lock);
 
-		mutex_unlock(&secure.slab.lock);
+		if (trimmed) {
+			mm_sec_slab_release(&detached);
+		}
 	}
 
 	return;
@@ -244,34 +729,68 @@ void mm_sec_cleanup(void *block) {
 
 /**
  * @brief	Allocate a chunk of memory from the secure memory slab
- * @see		mm_sec_chunk_new()
+ * @see		mm_sec_chunk_take()
  * @param	len		the length, in bytes, of the secure memory chunk to be allocated.
  * @return	NULL on failure, or a pointer to the freshly allocated chunk of secure memory on success.
  */
 void * mm_sec_alloc(size_t len) {
 
-	secured_t *chunk;
+	uint32_t class;
+	secured_t *chunk = NULL;
 	void *result = NULL;
 
-	if (!secure.enabled || !secure.slab.data || !len) {
+	if (!secure.enabled || !secure.slabs.count || !len) {
 		return NULL;
 	}
 
-	// Align allocations to a length of 12 bytes, which is the size of our secured_t structure.
-	len = align(16, len);
+	// Align allocations to a length of 16 bytes, which is the size of our secured_t structure.
+	len = align(MM_SEC_REQUEST_ALIGNMENT, len);
+	class = (len / MM_SEC_REQUEST_ALIGNMENT) - 1;
 
-	mutex_lock(&secure.slab.lock);
+	if (secure_magazine.generation != secure.magazines.generation) {
+		mm_sec_magazine_flush();
+	}
 
-	if ((chunk = mm_sec_chunk_new(secure.slab.data, len))) {
-		secure.allocated.items++;
-		secure.allocated.bytes += len;
+	// Chunks in the magazine were zeroed by the final wipe pass when they were freed.
+	if (len <= MM_SEC_MAGAZINE_LIMIT && secure_magazine.counts[class]) {
+		chunk = secure_magazine.chunks[class][--secure_magazine.counts[class]];
+		secure_magazine.bytes -= chunk->length;
+		result = ((chr_t *)chunk + sizeof(secured_t));
 	}
+	else {
 
-	mutex_unlock(&secure.slab.lock);
+		mutex_lock(&secure.slabs.lock);
+		chunk = mm_sec_chunk_take(len);
+		mutex_unlock(&secure.slabs.lock);
+
+		// The memory we need may be sitting in our own magazine, so flush it and try again.
+		if (!chunk && secure_magazine.bytes) {
+			mm_sec_magazine_flush();
+			mutex_lock(&secure.slabs.lock);
+			chunk = mm_sec_chunk_take(len);
+			mutex_unlock(&secure.slabs.lock);
+		}
+
+		// Otherwise grow the secure memory region by adding another slab, which is made large enough to hold the request
+		// if it wouldn't fit inside a regular slab.
+		if (!chunk) {
+			mutex_lock(&secure.slabs.lock);
+			if (!(chunk = mm_sec_chunk_take(len)) && mm_sec_slab_add(len + (sizeof(secured_t) * 2) > secure.slabs.length ?
+				align(secure.slabs.page, len + (sizeof(secured_t) * 2)) : secure.slabs.length)) {
+				chunk = mm_sec_chunk_take(len);
+			}
+			mutex_unlock(&secure.slabs.lock);
+		}
+
+		if (chunk) {
+			result = ((chr_t *)chunk + sizeof(secured_t));
+			memset(result, 0, chunk->length);
+		}
+	}
 
 	if (chunk) {
-		result = ((chr_t *)chunk + sizeof(secured_t));
-		mm_wipe(result, len);
+		__atomic_add_fetch(&secure.allocated.items, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&secure.allocated.bytes, chunk->length, __ATOMIC_RELAXED);
 	}
 
 #ifdef MAGMA_PEDANTIC
@@ -280,9 +799,6 @@ void * mm_sec_alloc(size_t len) {
 		size_t total, bytes, items;
 		mm_sec_stats(&total, &bytes, &items);
 		log_pedantic("secmem usage: %lu/%lu bytes in %lu chunks\n",	bytes, total, items);
-
-		//log_pedantic("Secure memory allocation failed. {len = %zu}", len);
-
 	}
 #endif
 
@@ -299,7 +815,7 @@ void * mm_sec_realloc(void *orig, size_t len) {
 	void *result;
 	secured_t *chunk;
 
-	if (!secure.enabled || !secure.slab.data || !orig || !len) {
+	if (!secure.enabled || !secure.slabs.count || !orig || !len) {
 #ifdef MAGMA_PEDANTIC
 		if (!len) log_pedantic("Secure reallocation request is for a zero length block! {len = %zu}", len);
 #endif
@@ -310,7 +826,7 @@ void * mm_sec_realloc(void *orig, size_t len) {
 	olen = chunk->length;
 
 	// Requests that would shrink the chunk by less than 256 bytes probably aren't worth the overhead to process.
-	if (len <= olen && (olen - len) >= 256) {
+	if (len <= olen && (olen - len) < 256) {
 		result = orig;
 	}
 	else if ((result = mm_sec_alloc(len))) {
@@ -322,43 +838,50 @@ void * mm_sec_realloc(void *orig, size_t len) {
 }
 
 /**
- * @brief	Deallocate and perform a multi-stage secure wipe of the secure memory region.
+ * @brief	Deallocate and perform a multi-stage secure wipe of the secure memory slabs.
  * @return	This function returns no value.
  */
 void mm_sec_stop(void) {
 
-	if (secure.enabled && secure.slab.data) {
+	uint32_t count = 0;
+	secured_slab_t detached[MM_SEC_SLABS_LIMIT];
+
+	if (secure.enabled && secure.slabs.count) {
 
-		mm_set(secure.slab.data, 255, secure.slab.length);
-		mm_set(secure.slab.data, 128, secure.slab.length);
-		mm_set(secure.slab.data, 64, secure.slab.length);
-		mm_set(secure.slab.data, 32, secure.slab.length);
-		mm_set(secure.slab.data, 0, secure.slab.length);
+		mutex_lock(&secure.slabs.lock);
 
-		munlock(secure.slab.data, secure.slab.length);
+		for (uint32_t i = 0; i < secure.slabs.count; i++) {
+			count += mm_sec_slab_detach(i, &detached[count]);
+		}
 
-		//BUG: Need to add in calculations
-		munmap(secure.slab.data_true, secure.slab.length_true);
+		__atomic_store_n(&secure.slabs.count, 0, __ATOMIC_RELEASE);
 
-		secure.slab.data = secure.slab.data_true = NULL;
-		secure.slab.length = secure.slab.length_true = 0;
+		// Any chunks still sitting in the thread magazines pointed into the slabs we just released.
+		__atomic_add_fetch(&secure.magazines.generation, 1, __ATOMIC_RELAXED);
+		mm_wipe(&secure.available, sizeof(secure.available));
+		secure.allocated.items = secure.allocated.bytes = 0;
 
+		mutex_unlock(&secure.slabs.lock);
+
+		for (uint32_t i = 0; i < count; i++) {
+			mm_sec_slab_release(&detached[i]);
+		}
 	}
 
 	return;
 }
 
 /**
- * @brief	If enabled, allocate and initialize the secure memory slab.
- * @note	This function will mmap a page-aligned secure memory slab (defaults to 32768 bytes long), mlock() it into memory, and zero-wipe it.
- * 			Guard pages with empty permissions are created on the boundaries of the slab to prevent memory bungling.
+ * @brief	If enabled, allocate and initialize the first secure memory slab.
+ * @note	This function will mmap a page-aligned secure memory slab (defaults to 65536 bytes long), mlock() it into memory, and zero-wipe it.
+ * 			Guard pages with empty permissions are created on the boundaries of the slab to prevent memory bungling. Further
+ * 			slabs of the same length are added on demand, until the combined length reaches the limit, which defaults to
+ * 			MM_SEC_SLABS_DEFAULT slabs, and can be changed using mm_sec_limit().
  * @return	true if the secure memory slab has been initialized, or false if the process fails.
  */
 bool_t mm_sec_start(void) {
 
-	uchr_t *bndptr;
 	size_t alignment;
-	secured_t *chunk;
 
 #ifdef  MAGMA_ENGINE_CONFIG_GLOBAL_H
 	if (!(secure.enabled = magma.secure.memory.enable)) {
@@ -383,84 +906,42 @@ bool_t mm_sec_start(void) {
 	}
 #endif
 
+	// Guard pages must cover entire pages, so they use the real page length.
+	secure.slabs.page = alignment;
+
 	// If the page length is smaller than MM_SEC_PAGE_ALIGNMENT_MIN bytes, replace it with an aligned value of at least
 	// MM_SEC_PAGE_ALIGNMENT_MIN.
-	else if (alignment < MM_SEC_PAGE_ALIGNMENT_MIN) {
+	if (alignment < MM_SEC_PAGE_ALIGNMENT_MIN) {
 		 alignment = (MM_SEC_PAGE_ALIGNMENT_MIN + alignment - 1) & ~(alignment - 1);
 	}
 
 	// Ensure the default length for secure memory slabs is greater than zero and is aligned by the page table size.
 #ifdef  MAGMA_ENGINE_CONFIG_GLOBAL_H
-	if ((secure.slab.length = (magma.secure.memory.length + alignment - 1) & ~(alignment - 1)) < MM_SEC_POOL_LENGTH_MIN) {
-		log_pedantic("The secure memory pool size is too small. { length = %zu / min = %i }", secure.slab.length, MM_SEC_POOL_LENGTH_MIN);
+	if ((secure.slabs.length = (magma.secure.memory.length + alignment - 1) & ~(alignment - 1)) < MM_SEC_POOL_LENGTH_MIN) {
+		log_pedantic("The secure memory pool size is too small. { length = %zu / min = %i }", secure.slabs.length, MM_SEC_POOL_LENGTH_MIN);
 		return false;
 	}
 #else
-	if ((secure.slab.length = (CORE_SECURE_MEMORY_LENGTH + alignment - 1) & ~(alignment - 1)) < MM_SEC_POOL_LENGTH_MIN) {
-	log_pedantic("The secure memory pool size is too small. { length = %zu / min = %i }", secure.slab.length, MM_SEC_POOL_LENGTH_MIN);
+	if ((secure.slabs.length = (CORE_SECURE_MEMORY_LENGTH + alignment - 1) & ~(alignment - 1)) < MM_SEC_POOL_LENGTH_MIN) {
+		log_pedantic("The secure memory pool size is too small. { length = %zu / min = %i }", secure.slabs.length, MM_SEC_POOL_LENGTH_MIN);
 		return false;
 	}
 #endif
 
-	// Allocate secured boundary pages around the secure slab to prevent against memory underflows and overflows.
-#ifdef  MAGMA_ENGINE_CONFIG_GLOBAL_H
-	secure.slab.length_true = secure.slab.length + (magma.page_length * 2);
-#else
-	secure.slab.length_true = secure.slab.length + (CORE_PAGE_LENGTH * 2);
-#endif
-
-	// Request an anonymous memory mapping that is aligned according to the system page size. Were asking the kernel to lock returned block into memory.
-	if ((secure.slab.data_true = mmap64(NULL, secure.slab.length_true, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_LOCKED, -1, 0)) == MAP_FAILED) {
-		log_pedantic("Unable to memory map an anonymous file. { error = %s }", errno_string(errno, MEMORYBUF(1024), 1024));
-		return false;
+	if (!secure.slabs.limit || secure.slabs.limit < secure.slabs.length) {
+		secure.slabs.limit = secure.slabs.length * MM_SEC_SLABS_DEFAULT;
 	}
 
-	bndptr = secure.slab.data_true;
-
-#ifdef  MAGMA_ENGINE_CONFIG_GLOBAL_H
-	if (mprotect(bndptr, magma.page_length, PROT_NONE)) {
-		log_pedantic("Unable to set protections on lower secure memory boundary chunk.");
+	if (!mm_sec_slab_add(secure.slabs.length)) {
 		return false;
 	}
 
-	bndptr += magma.page_length;
-	secure.slab.data = bndptr;
-	bndptr += secure.slab.length;
+	// Magazines are limited to a small fraction of a slab, so the memory parked in them can't starve other threads.
+	secure.magazines.limit = secure.slabs.length / 64 < MM_SEC_MAGAZINE_BYTES ? secure.slabs.length / 64 : MM_SEC_MAGAZINE_BYTES;
 
-	if (mprotect(bndptr, magma.page_length, PROT_NONE)) {
-		log_pedantic("Unable to set protections on upper secure memory boundary chunk.");
-		return false;
-	}
-#else
-	if (mprotect(bndptr, CORE_PAGE_LENGTH, PROT_NONE)) {
-		log_pedantic("Unable to set protections on lower secure memory boundary chunk.");
-		return false;
-	}
-
-	bndptr += CORE_PAGE_LENGTH;
-	secure.slab.data = bndptr;
-	bndptr += secure.slab.length;
-
-	if (mprotect(bndptr, CORE_PAGE_LENGTH, PROT_NONE)) {
-		log_pedantic("Unable to set protections on upper secure memory boundary chunk.");
-		return false;
+	if (!secure.magazines.keyed && !pthread_key_create(&secure.magazines.key, &mm_sec_magazine_exit)) {
+		secure.magazines.keyed = true;
 	}
-#endif
-
-	// We also request the address range assigned be locked into memory using the mlock call.
-	if (mlock(secure.slab.data, secure.slab.length)) {
-		log_pedantic("Unable to lock the address space reserved for sensitive data in memory.");
-		// BUG: Need to add in calculations
-		munmap(secure.slab.data_true, secure.slab.length_true);
-		secure.slab.data = secure.slab.data_true = NULL;
-		return false;
-	}
-
-	mm_wipe(secure.slab.data, secure.slab.length);
-
-	chunk = (secured_t *)secure.slab.data;
-	chunk->length = secure.slab.length - sizeof(secured_t);
-	chunk->flags = 0;
 
 	return true;
 }
@@ -27,6 +27,277 @@ uchr_t lower_chr(uchr_t c) {
 	return c;
 }
 
+/**
+ * @brief	Fold every ASCII letter in a word to a single case, eight bytes at a time.
+ * @note	A byte is a letter in the source case if its low seven bits are at least the first letter, not beyond the last
+ * 			letter, and its high bit is clear. Each test leaves its answer in the high bit of the byte, and the additions can't
+ * 			carry into the next byte, since the low seven bits never add up to more than 0xff. Shifting the surviving high bits
+ * 			down two places yields the 0x20 case bit for each letter, which is then flipped.
+ * @param	word	the word being folded.
+ * @param	upper	if true, lowercase letters are converted to uppercase, otherwise uppercase letters are converted to lowercase.
+ * @return	the folded word.
+ */
+uint64_t case_fold_word(uint64_t word, bool_t upper) {
+
+	uint64_t low = word & 0x7f7f7f7f7f7f7f7fULL,
+		above = low + (0x7fULL - (upper ? 'z' : 'Z')) * 0x0101010101010101ULL,
+		inside = low + (0x80ULL - (upper ? 'a' : 'A')) * 0x0101010101010101ULL;
+
+	return word ^ (((inside & ~above & ~word) & 0x8080808080808080ULL) >> 2);
+}
+
+/**
+ * @brief	Find the first byte where two buffers differ, ignoring the case of ASCII letters, eight bytes at a time.
+ * @param	a	a pointer to the first buffer.
+ * @param	b	a pointer to the second buffer.
+ * @param	len	the number of bytes to compare.
+ * @return	the offset of the first byte which differs, or len if the buffers match.
+ */
+size_t case_mismatch_swar(const uchr_t *a, const uchr_t *b, size_t len) {
+
+	size_t i = 0;
+	uint64_t x, y, diff;
+
+	for (; i + 8 <= len; i += 8) {
+		memcpy(&x, a + i, 8);
+		memcpy(&y, b + i, 8);
+		if ((diff = case_fold_word(x, false) ^ case_fold_word(y, false))) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+			return i + (__builtin_ctzll(diff) / 8);
+#else
+			return i + (__builtin_clzll(diff) / 8);
+#endif
+		}
+	}
+
+	for (; i < len && lower_chr(a[i]) == lower_chr(b[i]); i++);
+	return i;
+}
+
+/**
+ * @brief	Count the bytes at the end of two buffers which match, ignoring the case of ASCII letters, eight bytes at a time.
+ * @param	a	a pointer to the start of the first buffer.
+ * @param	b	a pointer to the start of the second buffer.
+ * @param	len	the number of bytes to compare, working backwards from the end of each buffer.
+ * @return	the number of trailing bytes which match, which will be len if the buffers match.
+ */
+size_t case_rmismatch_swar(const uchr_t *a, const uchr_t *b, size_t len) {
+
+	size_t i = 0;
+	uint64_t x, y, diff;
+
+	for (; i + 8 <= len; i += 8) {
+		memcpy(&x, a + len - i - 8, 8);
+		memcpy(&y, b + len - i - 8, 8);
+		if ((diff = case_fold_word(x, false) ^ case_fold_word(y, false))) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+			return i + (__builtin_clzll(diff) / 8);
+#else
+			return i + (__builtin_ctzll(diff) / 8);
+#endif
+		}
+	}
+
+	for (; i < len && lower_chr(a[len - i - 1]) == lower_chr(b[len - i - 1]); i++);
+	return i;
+}
+
+/**
+ * @brief	Convert the ASCII letters in a buffer to a single case, eight bytes at a time.
+ * @param	block	a pointer to the buffer being converted.
+ * @param	len		the length, in bytes, of the buffer.
+ * @param	upper	if true, the letters are converted to uppercase, otherwise they're converted to lowercase.
+ * @return	This function returns no value.
+ */
+void case_convert_swar(uchr_t *block, size_t len, bool_t upper) {
+
+	size_t i = 0;
+	uint64_t word;
+
+	for (; i + 8 <= len; i += 8) {
+		memcpy(&word, block + i, 8);
+		word = case_fold_word(word, upper);
+		memcpy(block + i, &word, 8);
+	}
+
+	for (; i < len; i++) {
+		block[i] = upper ? upper_chr(block[i]) : lower_chr(block[i]);
+	}
+
+	return;
+}
+
+#ifdef __SSE2__
+/**
+ * @brief	Find the first byte where two buffers differ, ignoring the case of ASCII letters, sixteen bytes at a time.
+ * @note	The bytes are shifted so the uppercase letters land at the bottom of the signed range, which lets a single signed
+ * 			comparison pick them out, and the case bit is then set on just those bytes.
+ * @see		case_mismatch_swar()
+ */
+size_t case_mismatch_sse2(const uchr_t *a, const uchr_t *b, size_t len) {
+
+	size_t i = 0;
+	uint32_t mask;
+	__m128i x, y, shift = _mm_set1_epi8(0x80 - 'A'), limit = _mm_set1_epi8(-128 + 26), bit = _mm_set1_epi8(0x20);
+
+	for (; i + 16 <= len; i += 16) {
+		x = _mm_loadu_si128((const __m128i *)(a + i));
+		y = _mm_loadu_si128((const __m128i *)(b + i));
+		x = _mm_or_si128(x, _mm_and_si128(_mm_cmplt_epi8(_mm_add_epi8(x, shift), limit), bit));
+		y = _mm_or_si128(y, _mm_and_si128(_mm_cmplt_epi8(_mm_add_epi8(y, shift), limit), bit));
+		if ((mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y))) != 0xffff) {
+			return i + __builtin_ctz(~mask);
+		}
+	}
+
+	return i + case_mismatch_swar(a + i, b + i, len - i);
+}
+
+/**
+ * @brief	Count the bytes at the end of two buffers which match, ignoring the case of ASCII letters, sixteen bytes at a time.
+ * @see		case_rmismatch_swar()
+ */
+size_t case_rmismatch_sse2(const uchr_t *a, const uchr_t *b, size_t len) {
+
+	size_t i = 0;
+	uint32_t mask;
+	__m128i x, y, shift = _mm_set1_epi8(0x80 - 'A'), limit = _mm_set1_epi8(-128 + 26), bit = _mm_set1_epi8(0x20);
+
+	for (; i + 16 <= len; i += 16) {
+		x = _mm_loadu_si128((const __m128i *)(a + len - i - 16));
+		y = _mm_loadu_si128((const __m128i *)(b + len - i - 16));
+		x = _mm_or_si128(x, _mm_and_si128(_mm_cmplt_epi8(_mm_add_epi8(x, shift), limit), bit));
+		y = _mm_or_si128(y, _mm_and_si128(_mm_cmplt_epi8(_mm_add_epi8(y, shift), limit), bit));
+		if ((mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, y))) != 0xffff) {
+			return i + __builtin_clz(~mask << 16);
+		}
+	}
+
+	return i + case_rmismatch_swar(a, b, len - i);
+}
+
+/**
+ * @brief	Convert the ASCII letters in a buffer to a single case, sixteen bytes at a time.
+ * @see		case_convert_swar()
+ */
+void case_convert_sse2(uchr_t *block, size_t len, bool_t upper) {
+
+	size_t i = 0;
+	__m128i x, shift = _mm_set1_epi8(0x80 - (upper ? 'a' : 'A')), limit = _mm_set1_epi8(-128 + 26), bit = _mm_set1_epi8(0x20);
+
+	for (; i + 16 <= len; i += 16) {
+		x = _mm_loadu_si128((const __m128i *)(block + i));
+		x = _mm_xor_si128(x, _mm_and_si128(_mm_cmplt_epi8(_mm_add_epi8(x, shift), limit), bit));
+		_mm_storeu_si128((__m128i *)(block + i), x);
+	}
+
+	case_convert_swar(block + i, len - i, upper);
+	return;
+}
+
+/**
+ * @brief	Find the first byte where two buffers differ, ignoring the case of ASCII letters, thirty-two bytes at a time.
+ * @note	AVX2 only has a signed greater than comparison, so the limit is compared against the shifted bytes.
+ * @see		case_mismatch_sse2()
+ */
+__attribute__ ((target ("avx2"))) size_t case_mismatch_avx2(const uchr_t *a, const uchr_t *b, size_t len) {
+
+	size_t i = 0;
+	uint32_t mask;
+	__m256i x, y, shift = _mm256_set1_epi8(0x80 - 'A'), limit = _mm256_set1_epi8(-128 + 26), bit = _mm256_set1_epi8(0x20);
+
+	for (; i + 32 <= len; i += 32) {
+		x = _mm256_loadu_si256((const __m256i *)(a + i));
+		y = _mm256_loadu_si256((const __m256i *)(b + i));
+		x = _mm256_or_si256(x, _mm256_and_si256(_mm256_cmpgt_epi8(limit, _mm256_add_epi8(x, shift)), bit));
+		y = _mm256_or_si256(y, _mm256_and_si256(_mm256_cmpgt_epi8(limit, _mm256_add_epi8(y, shift)), bit));
+		if ((mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y))) != 0xffffffff) {
+			return i + __builtin_ctz(~mask);
+		}
+	}
+
+	// Clear the upper halves of the vector registers before handing the tail to the SSE2 kernel, or the processor pays a
+	// penalty for mixing the two instruction encodings.
+	_mm256_zeroupper();
+	return i + case_mismatch_sse2(a + i, b + i, len - i);
+}
+
+/**
+ * @brief	Count the bytes at the end of two buffers which match, ignoring the case of ASCII letters, thirty-two bytes at a time.
+ * @see		case_rmismatch_sse2()
+ */
+__attribute__ ((target ("avx2"))) size_t case_rmismatch_avx2(const uchr_t *a, const uchr_t *b, size_t len) {
+
+	size_t i = 0;
+	uint32_t mask;
+	__m256i x, y, shift = _mm256_set1_epi8(0x80 - 'A'), limit = _mm256_set1_epi8(-128 + 26), bit = _mm256_set1_epi8(0x20);
+
+	for (; i + 32 <= len; i += 32) {
+		x = _mm256_loadu_si256((const __m256i *)(a + len - i - 32));
+		y = _mm256_loadu_si256((const __m256i *)(b + len - i - 32));
+		x = _mm256_or_si256(x, _mm256_and_si256(_mm256_cmpgt_epi8(limit, _mm256_add_epi8(x, shift)), bit));
+		y = _mm256_or_si256(y, _mm256_and_si256(_mm256_cmpgt_epi8(limit, _mm256_add_epi8(y, shift)), bit));
+		if ((mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y))) != 0xffffffff) {
+			return i + __builtin_clz(~mask);
+		}
+	}
+
+	_mm256_zeroupper();
+	return i + case_rmismatch_sse2(a, b, len - i);
+}
+
+/**
+ * @brief	Convert the ASCII letters in a buffer to a single case, thirty-two bytes at a time.
+ * @see		case_convert_sse2()
+ */
+__attribute__ ((target ("avx2"))) void case_convert_avx2(uchr_t *block, size_t len, bool_t upper) {
+
+	size_t i = 0;
+	__m256i x, shift = _mm256_set1_epi8(0x80 - (upper ? 'a' : 'A')), limit = _mm256_set1_epi8(-128 + 26), bit = _mm256_set1_epi8(0x20);
+
+	for (; i + 32 <= len; i += 32) {
+		x = _mm256_loadu_si256((const __m256i *)(block + i));
+		x = _mm256_xor_si256(x, _mm256_and_si256(_mm256_cmpgt_epi8(limit, _mm256_add_epi8(x, shift)), bit));
+		_mm256_storeu_si256((__m256i *)(block + i), x);
+	}
+
+	_mm256_zeroupper();
+	case_convert_sse2(block + i, len - i, upper);
+	return;
+}
+#endif
+
+/**
+ * @brief	Select the fastest case folding kernels supported by the processor.
+ * @note	The processor is only queried once, and the result is cached.
+ * @return	a pointer to the case folding kernels.
+ */
+const case_kernels_t * case_kernels(void) {
+
+	static const case_kernels_t *kernels = NULL;
+#ifdef __SSE2__
+	static const case_kernels_t sse2 = { &case_mismatch_sse2, &case_rmismatch_sse2, &case_convert_sse2 };
+	static const case_kernels_t avx2 = { &case_mismatch_avx2, &case_rmismatch_avx2, &case_convert_avx2 };
+#else
+	static const case_kernels_t swar = { &case_mismatch_swar, &case_rmismatch_swar, &case_convert_swar };
+#endif
+	const case_kernels_t *result;
+
+	if ((result = __atomic_load_n(&kernels, __ATOMIC_RELAXED))) {
+		return result;
+	}
+
+#ifdef __SSE2__
+	__builtin_cpu_init();
+	result = __builtin_cpu_supports("avx2") ? &avx2 : &sse2;
+#else
+	result = &swar;
+#endif
+
+	__atomic_store_n(&kernels, result, __ATOMIC_RELAXED);
+	return result;
+}
+
 /**
  * @brief	Transform a managed string (in-place) into uppercase.
  * @param	s	the managed string to be modified.
@@ -42,10 +313,7 @@ stringer_t * upper_st(stringer_t *s) {
 		return NULL;
 	}
 
-	for (size_t i = 0; i < len; i++) {
-		if (*ptr >= 'a' && *ptr <= 'z') *ptr -= 32;
-		ptr++;
-	}
+	case_kernels()->convert(ptr, len, true);
 
 	return s;
 }
@@ -65,10 +333,7 @@ stringer_t * lower_st(stringer_t *s) {
 		return NULL;
 	}
 
-	for (size_t i = 0; i < len; i++) {
-		if (*ptr >= 'A' && *ptr <= 'Z') *ptr += 32;
-		ptr++;
-	}
+	case_kernels()->convert(ptr, len, false);
 
 	return s;
 }
@@ -14,12 +14,31 @@ typedef struct {
 	size_t length, remaining;
 } tok_state_t;
 
+typedef struct {
+	size_t (*mismatch)(const uchr_t *a, const uchr_t *b, size_t len); /* Finds the first byte which differs, ignoring case. */
+	size_t (*rmismatch)(const uchr_t *a, const uchr_t *b, size_t len); /* Counts the trailing bytes which match, ignoring case. */
+	void (*convert)(uchr_t *block, size_t len, bool_t upper); /* Converts the letters in a buffer to a single case. */
+} case_kernels_t;
+
 /// time.c
 uint64_t      time_datestamp(void);
 stringer_t *  time_print_gmt(stringer_t *s, chr_t *format, time_t moment);
 stringer_t *  time_print_local(stringer_t *s, chr_t *format, time_t moment);
 uint64_t      time_till_midnight(void);
 
+/// case.c
+void                     case_convert_avx2(uchr_t *block, size_t len, bool_t upper);
+void                     case_convert_sse2(uchr_t *block, size_t len, bool_t upper);
+void                     case_convert_swar(uchr_t *block, size_t len, bool_t upper);
+uint64_t                 case_fold_word(uint64_t word, bool_t upper);
+const case_kernels_t *   case_kernels(void);
+size_t                   case_mismatch_avx2(const uchr_t *a, const uchr_t *b, size_t len);
+size_t                   case_mismatch_sse2(const uchr_t *a, const uchr_t *b, size_t len);
+size_t                   case_mismatch_swar(const uchr_t *a, const uchr_t *b, size_t len);
+size_t                   case_rmismatch_avx2(const uchr_t *a, const uchr_t *b, size_t len);
+size_t                   case_rmismatch_sse2(const uchr_t *a, const uchr_t *b, size_t len);
+size_t                   case_rmismatch_swar(const uchr_t *a, const uchr_t *b, size_t len);
+
 // Lowercase
 uchr_t lower_chr(uchr_t c);
 stringer_t * lower_st(stringer_t *s);
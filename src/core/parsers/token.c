@@ -17,6 +17,7 @@
 uint64_t tok_get_count_bl(void *block, size_t length, char token) {
 
 	uint64_t count = 1;
+	chr_t *next, *end = (chr_t *)block + length;
 
 #ifdef MAGMA_PEDANTIC
 	if (!block) log_pedantic("Attempted a token count on a NULL string buffer.");
@@ -28,12 +29,10 @@ uint64_t tok_get_count_bl(void *block, size_t length, char token) {
 		return 0;
 	}
 
-	for (uint64_t i = 0; i < length; i++) {
-
-		if (*(char *)(block++) == token && i != length) {
-			count++;
-		}
-
+	// Jump from one token to the next with the C library search, which scans several bytes at a time.
+	while (block != end && (next = memchr(block, token, end - (chr_t *)block))) {
+		block = next + 1;
+		count++;
 	}
 
 	return count;
@@ -62,7 +61,7 @@ uint64_t tok_get_count_st(stringer_t *string, char token) {
  */
 int tok_get_ns(char *string, size_t length, char token, uint64_t fragment, placer_t *value) {
 
-	char *start;
+	char *start, *next;
 
 #ifdef MAGMA_PEDANTIC
 	if (!string) log_pedantic("Attempted token extraction from a NULL string buffer.");
@@ -79,12 +78,15 @@ int tok_get_ns(char *string, size_t length, char token, uint64_t fragment, place
 		return -1;
 	}
 
-	while (fragment && length--) {
+	while (fragment && length) {
 
-		if (*string++ == token) {
-			fragment--;
+		if (!(next = memchr(string, token, length))) {
+			break;
 		}
 
+		length -= next + 1 - string;
+		string = next + 1;
+		fragment--;
 	}
 
 	if (fragment) {
@@ -94,9 +96,13 @@ int tok_get_ns(char *string, size_t length, char token, uint64_t fragment, place
 
 	start = string;
 
-	while (length && *string != token) {
-		string++;
-		length--;
+	if ((next = memchr(string, token, length))) {
+		length -= next - string;
+		string = next;
+	}
+	else {
+		string += length;
+		length = 0;
 	}
 
 	// If we hit the token on the first character, return NULL
@@ -187,7 +193,7 @@ void tok_pop_init_st(tok_state_t *state, stringer_t *string, char token) {
  */
 int tok_pop(tok_state_t *state, placer_t *value) {
 
-	char *startPosition;
+	char *startPosition, *next;
 
 	// We can't search NULL pointers or empty strings.
 	if (!value || !state || !state->position) {
@@ -222,9 +228,13 @@ int tok_pop(tok_state_t *state, placer_t *value) {
 
 	startPosition = state->position;
 
-	while (*(state->position) != state->token && (state->remaining)) {
-		(state->position)++;
-		(state->remaining)--;
+	if ((next = memchr(state->position, state->token, state->remaining))) {
+		state->remaining -= next - state->position;
+		state->position = next;
+	}
+	else {
+		state->position += state->remaining;
+		state->remaining = 0;
 	}
 
 	// If we hit the token on the first character, return NULL
@@ -335,31 +345,23 @@ int str_tok_get_bl(char *block, size_t length, chr_t *token, size_t toklen, uint
  */
 bool_t pl_skip_characters (placer_t *place, char *skipchars, size_t nchars) {
 
-	char *ptr = pl_char_get(*place);
+	size_t span;
+	chr_set_t set;
 
 	if (pl_empty(*place)) {
 		return false;
 	}
 
-	for (int i = 0; i < place->length; i++, ptr++) {
-
-		for (int j = 0; j <= nchars; j++) {
-
-			// We went through all the skip characters without finding something... so this is where we return.
-			if (j == nchars) {
-				place->data = (char *) place->data + i;
-				place->length -= i;
-				return true;
-			}
-
-			if (*ptr == skipchars[j])
-				break;
-
-		}
+	chr_set_chars(&set, (uchr_t *)skipchars, nchars);
 
+	// If every character is a skip character, the placer is left alone.
+	if ((span = chr_span(pl_data_get(*place), pl_length_get(*place), &set, true)) == pl_length_get(*place)) {
+		return false;
 	}
 
-	return false;
+	place->data = (char *) place->data + span;
+	place->length -= span;
+	return true;
 }
 
 /**
@@ -371,28 +373,23 @@ bool_t pl_skip_characters (placer_t *place, char *skipchars, size_t nchars) {
  */
 bool_t pl_skip_to_characters (placer_t *place, char *skiptochars, size_t nchars) {
 
-	char *ptr = pl_char_get(*place);
+	size_t span;
+	chr_set_t set;
 
 	if (pl_empty(*place)) {
 		return false;
 	}
 
-	for (int i = 0; i < place->length; i++, ptr++) {
-
-		for (int j = 0; j < nchars; j++) {
-
-			// We went through all the skip characters without finding something... so this is where we return.
-			if (*ptr == skiptochars[j]) {
-				place->data = (char *) place->data + i;
-				place->length -= i;
-				return true;
-			}
-
-		}
+	chr_set_chars(&set, (uchr_t *)skiptochars, nchars);
 
+	// If none of the characters were found, the placer is left alone.
+	if ((span = chr_span(pl_data_get(*place), pl_length_get(*place), &set, false)) == pl_length_get(*place)) {
+		return false;
 	}
 
-	return false;
+	place->data = (char *) place->data + span;
+	place->length -= span;
+	return true;
 }
 
 /**
@@ -404,30 +401,22 @@ bool_t pl_skip_to_characters (placer_t *place, char *skiptochars, size_t nchars)
  */
 bool_t pl_shrink_before_characters (placer_t *place, char *shrinkchars, size_t nchars) {
 
-	char *ptr = pl_char_get(*place) + pl_length_get(*place) - 1;
+	size_t span;
+	chr_set_t set;
 
 	if (pl_empty(*place)) {
 		return false;
 	}
 
-	for (int i = 0; i < place->length; i++, ptr--) {
-
-		for (int j = 0; j <= nchars; j++) {
-
-				// We went through all the skip characters without finding something... so this is where we return.
-				if (j == nchars) {
-					place->length -= i;
-					return true;
-				}
-
-				if (*ptr == shrinkchars[j])
-					break;
-
-		}
+	chr_set_chars(&set, (uchr_t *)shrinkchars, nchars);
 
+	// If every character is a shrink character, the placer is left alone.
+	if ((span = chr_span_reverse(pl_data_get(*place), pl_length_get(*place), &set, true)) == pl_length_get(*place)) {
+		return false;
 	}
 
-	return false;
+	place->length -= span;
+	return true;
 }
 
 /**
@@ -7,10 +7,6 @@
 
 #include "magma.h"
 
-static bool_t is_trim(char c) {
-	return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v';
-}
-
 // Removes any starting/ending whitespace from a stringer. Since the trimmed string cannot ever become longer, it is returned inside the existing buffer.
 void st_trim(stringer_t *string) {
 
@@ -19,13 +15,8 @@ void st_trim(stringer_t *string) {
 	start = st_char_get(string);
 	end = start + st_length_get(string);
 
-	while (start != end && is_trim(*start)) {
-			start++;
-		}
-
-	while (end != start && is_trim(end[-1])) {
-			end--;
-		}
+	start += chr_span_class((uchr_t *)start, end - start, M_CHR_TRIM, true);
+	end -= chr_span_class_reverse((uchr_t *)start, end - start, M_CHR_TRIM, true);
 
 	if (start == end) {
 		st_length_set(string, 0);
@@ -46,12 +37,8 @@ placer_t pl_trim(placer_t place) {
 	start = pl_char_get(place);
 	end = start + pl_length_get(place);
 
-	while (start != end && is_trim(*start)) {
-			start++;
-		}
-	while (end != start && is_trim(end[-1])) {
-			end--;
-		}
+	start += chr_span_class((uchr_t *)start, end - start, M_CHR_TRIM, true);
+	end -= chr_span_class_reverse((uchr_t *)start, end - start, M_CHR_TRIM, true);
 
 	if (start == end)
 		return pl_null();
@@ -71,9 +58,7 @@ placer_t pl_trim_start(placer_t place) {
 	start = pl_char_get(place);
 	end = start + pl_length_get(place);
 
-	while (start != end && is_trim(*start)) {
-			start++;
-		}
+	start += chr_span_class((uchr_t *)start, end - start, M_CHR_TRIM, true);
 
 	if (start == end)
 		return pl_null();
@@ -88,9 +73,7 @@ placer_t pl_trim_end(placer_t place) {
 	start = pl_char_get(place);
 	end = start + pl_length_get(place);
 
-	while (end != start && is_trim(end[-1])) {
-			end--;
-		}
+	end -= chr_span_class_reverse((uchr_t *)start, end - start, M_CHR_TRIM, true);
 
 	if (start == end)
 		return pl_null();
@@ -19,6 +19,7 @@
  * 			Jointed block:		Free header and underlying data
  * 			Jointed managed:	Free header and underlying data
  * 			Jointed mapped:		Free the header and (munmap) underlying data
+ * 			Jointed chain:		Free header, segments, adopted strings and the flattened copy
  * 			Contiguous nuller:	Free header (this includes the underlying data because they are already merged)
  * 			Contiguous block:	Free header (this includes the underlying data because they are already merged)
  * 			Contiguous managed:	Free header (this includes the underlying data because they are already merged)
@@ -29,7 +30,7 @@
 void st_free(stringer_t *s) {
 
 	uint32_t opts = *((uint32_t *)s);
-	void (*release)(void *buffer) = opts & SECURE ? &mm_sec_free : &mm_free;
+	void (*release)(void *buffer) = opts & SECURE ? &mm_sec_free : opts & ARENA ? &mm_arena_release : &mm_free;
 
 #ifdef MAGMA_PEDANTIC
 	if (!st_valid_free(opts)) {
@@ -44,10 +45,10 @@ void st_free(stringer_t *s) {
 
 	/// Do we need to differentiate between stack structures, and heap data blocks needing to be freed, or not?
 
-	switch (opts & (NULLER_T | PLACER_T | BLOCK_T | MANAGED_T | MAPPED_T | CONTIGUOUS | JOINTED)) {
+	switch (opts & (NULLER_T | PLACER_T | BLOCK_T | MANAGED_T | MAPPED_T | CHAIN_T | CONTIGUOUS | JOINTED)) {
 		case (PLACER_T | JOINTED):
 			if (!(opts & FOREIGNDATA)) release(((placer_t *)s)->data);
-			if (opts & (HEAP | SECURE)) release(s);
+			if (opts & (HEAP | SECURE | ARENA)) release(s);
 			break;
 		case (NULLER_T | JOINTED):
 			release(((nuller_t *)s)->data);
@@ -77,6 +78,10 @@ void st_free(stringer_t *s) {
 			//int_t midstate, ret2 = pthread_setcancelstate(oldstate, &midstate);
 			release(s);
 			break;
+		case (CHAIN_T | JOINTED):
+			st_chain_reset(s);
+			release(s);
+			break;
 		default:
 			log_pedantic("Invalid string options.");
 			break;
@@ -318,7 +323,7 @@ stringer_t * st_copy_in(stringer_t *s, void *buf, size_t len) {
  */
 stringer_t * st_dupe_opts(uint32_t opts, stringer_t *s) {
 
-	void *src_data;
+	void *src_data, *dst_data;
 	stringer_t *result = NULL;
 	size_t dst_length = 0, src_length = 0;
 	uint32_t src_opts = *((uint32_t *)s);
@@ -353,6 +358,11 @@ stringer_t * st_dupe_opts(uint32_t opts, stringer_t *s) {
 			}
 			break;
 
+		// Chains only reference the data held by other strings, so they can't be used as the destination of a copy.
+		case (CHAIN_T):
+			log_pedantic("Managed strings can't be duplicated into a chain. { opt = %u = %s }", opts, st_info_opts(opts, MEMORYBUF(128), 128));
+			return NULL;
+
 		default:
 			log_pedantic("Invalid string options. { opt = %u = %s }", opts, st_info_opts(opts, MEMORYBUF(128), 128));
 			break;
@@ -370,8 +380,13 @@ stringer_t * st_dupe_opts(uint32_t opts, stringer_t *s) {
 	if (opts & PLACER_T) {
 		st_data_set(result, src_data);
 	}
-	else {
-		mm_copy(st_data_get(result), src_data, src_length);
+	else if (src_length && (!src_data || !(dst_data = st_data_get(result)))) {
+		log_pedantic("Unable to copy the string data. { length = %zu }", src_length);
+		st_free(result);
+		return NULL;
+	}
+	else if (src_length) {
+		mm_copy(dst_data, src_data, src_length);
 	}
 
 	// If the length of the data segment is tracked explicitly, set it here. Note that block's presume the length of the buffer is the
@@ -386,7 +401,8 @@ stringer_t * st_dupe_opts(uint32_t opts, stringer_t *s) {
 /**
  * @brief	Duplicate a managed string.
  * @see		st_dupe_opts()
- * @note	The allocation options of the duplicated string will be the same as that of the source string.
+ * @note	The allocation options of the duplicated string will be the same as that of the source string, except for chains,
+ * 			which are duplicated into a contiguous managed string holding the flattened data.
  * @param	s	the managed string to be duplicated.
  * @return	NULL on failure, or a copy of the input managed string on success.
  */
@@ -394,6 +410,10 @@ stringer_t * st_dupe(stringer_t *s) {
 
 	uint32_t opts = *((uint32_t *)s);
 
+	if (opts & CHAIN_T) {
+		opts = MANAGED_T | CONTIGUOUS | HEAP | (opts & SECURE);
+	}
+
 	return st_dupe_opts(opts, s);
 }
 
@@ -480,12 +500,13 @@ int_t st_append_out(size_t align, stringer_t **s, stringer_t *append) {
  * @brief	Allocate a managed string with a specified options mask.
  * @see		st_valid_options()
  * @note	All requested allocation masks should conform to the validation imposed by st_valid_opts().
- * 			The supported types are: placer, nuller, block, managed, and mapped.
+ * 			The supported types are: placer, nuller, block, managed, mapped, and chain.
  * 			The following logic is applied to requested string allocation options:
  * 			1. Any allocation options specified for strings to be allocated on the stack are IGNORED.
  * 			2. All jointed strings allocate memory for the header and data separately and then link them EXCEPT:
  * 				Jointed placers only allocate space for a header.
  * 				Jointed mapped strings allocate the data with an aligned mmap() operation.
+ * 				Jointed chains only allocate space for a header, since segments are added by st_chain_append().
  * 			3. Contiguous strings allocate space for the header and data together in a single contiguous block.
  * 			4. After allocation, the length field is set for block strings.
  * 			5. After allocation, the available field is set for managed strings.
@@ -501,8 +522,8 @@ stringer_t * st_alloc_opts(uint32_t opts, size_t len) {
 	int handle = -1;
 	size_t avail = 0;
 	stringer_t *result = NULL;
-	void (*release)(void *buffer) = opts & SECURE ? &mm_sec_free : &mm_free;
-	void * (*allocate)(size_t len) = opts & SECURE ? &mm_sec_alloc : &mm_alloc;
+	void (*release)(void *buffer) = opts & SECURE ? &mm_sec_free : opts & ARENA ? &mm_arena_release : &mm_free;
+	void * (*allocate)(size_t len) = opts & SECURE ? &mm_sec_alloc : opts & ARENA ? &mm_arena_get : &mm_alloc;
 
 	// The logic below allocates memory off the heap, so if were passed options calling for the stack we silently replace it with instructions to use the heap.
 	opts = (opts & STACK ? (opts ^ STACK) | HEAP : opts);
@@ -514,7 +535,7 @@ stringer_t * st_alloc_opts(uint32_t opts, size_t len) {
 	}
 #endif
 
-	switch (opts & (NULLER_T | PLACER_T | BLOCK_T | MANAGED_T | MAPPED_T | CONTIGUOUS | JOINTED)) {
+	switch (opts & (NULLER_T | PLACER_T | BLOCK_T | MANAGED_T | MAPPED_T | CHAIN_T | CONTIGUOUS | JOINTED)) {
 
 		case (PLACER_T | JOINTED):
 
@@ -611,6 +632,14 @@ stringer_t * st_alloc_opts(uint32_t opts, size_t len) {
 			}
 			break;
 
+		case (CHAIN_T | JOINTED):
+
+			// Chains start out empty, and grow one segment at a time, so the size parameter is ignored.
+			if ((result = allocate(sizeof(chain_t)))) {
+				((chain_t *)result)->opts = opts;
+			}
+			break;
+
 		default:
 			log_pedantic("Invalid string options. { opt = %u = %s }", opts, st_info_opts(opts, MEMORYBUF(128), 128));
 			break;
@@ -659,8 +688,8 @@ stringer_t * st_realloc(stringer_t *s, size_t len) {
 	size_t original, avail;
 	stringer_t *result = NULL;
 	uint32_t opts = *((uint32_t *)s);
-	void (*release)(void *buffer) = opts & SECURE ? &mm_sec_free : &mm_free;
-	void * (*allocate)(size_t len) = opts & SECURE ? &mm_sec_alloc : &mm_alloc;
+	void (*release)(void *buffer) = opts & SECURE ? &mm_sec_free : opts & ARENA ? &mm_arena_release : &mm_free;
+	void * (*allocate)(size_t len) = opts & SECURE ? &mm_sec_alloc : opts & ARENA ? &mm_arena_get : &mm_alloc;
 
 #ifdef MAGMA_PEDANTIC
 	if (!st_valid_opts(opts)) {
@@ -0,0 +1,244 @@
+
+/**
+ * @file /magma/core/strings/chain.c
+ *
+ * @brief	Functions used to assemble chain strings, which reference a list of segments instead of a single buffer.
+ *
+ * @note	Appending to a chain links a segment referencing the appended data, so assembling a large message from hundreds of
+ * 			parts never copies the parts, or the message built so far. The segments are only copied into a contiguous buffer
+ * 			if a caller asks for the chain data, using st_data_get(), and that copy is kept until the next append. Code which
+ * 			can consume the segments directly should use st_chain_iovec() or tcp_writev() instead.
+ *
+ * 			A referenced segment points at the data of another string, so that string must outlive the chain, and must
+ * 			not be reallocated while the chain refers to it. Adopted segments are freed along with the chain.
+ */
+
+#include "magma.h"
+
+struct chain_segment_t {
+	chain_segment_t *next;
+	placer_t place;
+	stringer_t *owned;
+};
+
+/**
+ * @brief	Link a segment onto the end of a chain.
+ * @note	If the chain is NULL, a new heap chain is allocated. Empty strings are skipped, without being linked.
+ * @param	chain	the chain being appended to, or NULL to allocate a new chain.
+ * @param	s		the string holding the segment data.
+ * @param	adopt	if true, the chain takes ownership of the string, and frees it along with the chain.
+ * @return	NULL on failure, or a pointer to the chain.
+ */
+stringer_t * st_chain_link(stringer_t *chain, stringer_t *s, bool_t adopt) {
+
+	size_t len;
+	void *data;
+	uint32_t opts;
+	stringer_t *result = chain;
+	chain_segment_t *segment;
+	void (*release)(void *buffer);
+	void * (*allocate)(size_t len);
+
+	if (!result && !(result = st_alloc_opts(CHAIN_T | JOINTED | HEAP, 0))) {
+		log_pedantic("Unable to allocate a chain.");
+		return NULL;
+	}
+	else if (!((opts = *((uint32_t *)result)) & CHAIN_T)) {
+		log_pedantic("Attempted to append a segment to a string which isn't a chain. { opt = %u = %s }", opts, st_info_opts(opts, MEMORYBUF(128), 128));
+		return NULL;
+	}
+
+	release = opts & SECURE ? &mm_sec_free : opts & ARENA ? &mm_arena_release : &mm_free;
+	allocate = opts & SECURE ? &mm_sec_alloc : opts & ARENA ? &mm_arena_get : &mm_alloc;
+
+	if (!(len = st_length_get(s)) || !(data = st_data_get(s))) {
+		if (adopt && s) st_free(s);
+		return result;
+	}
+	else if (!(segment = allocate(sizeof(chain_segment_t)))) {
+		log_pedantic("Unable to allocate a chain segment.");
+		if (!chain) st_free(result);
+		return NULL;
+	}
+
+	segment->place = pl_init(data, len);
+	segment->owned = adopt ? s : NULL;
+
+	if (((chain_t *)result)->tail) ((chain_t *)result)->tail->next = segment;
+	else ((chain_t *)result)->head = segment;
+
+	((chain_t *)result)->tail = segment;
+	((chain_t *)result)->length += len;
+	((chain_t *)result)->count++;
+
+	// The flattened copy no longer matches the chain.
+	if (((chain_t *)result)->data) {
+		release(((chain_t *)result)->data);
+		((chain_t *)result)->data = NULL;
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Append a reference to the data of another string onto the end of a chain.
+ * @see		st_chain_link()
+ * @param	chain	the chain being appended to, or NULL to allocate a new chain.
+ * @param	s		the string being referenced, which must outlive the chain.
+ * @return	NULL on failure, or a pointer to the chain.
+ */
+stringer_t * st_chain_append(stringer_t *chain, stringer_t *s) {
+
+	return st_chain_link(chain, s, false);
+}
+
+/**
+ * @brief	Append a string onto the end of a chain, and hand ownership of the string to the chain.
+ * @see		st_chain_link()
+ * @note	If the append fails, the caller still owns the string.
+ * @param	chain	the chain being appended to, or NULL to allocate a new chain.
+ * @param	s		the string being adopted, which will be freed along with the chain.
+ * @return	NULL on failure, or a pointer to the chain.
+ */
+stringer_t * st_chain_adopt(stringer_t *chain, stringer_t *s) {
+
+	return st_chain_link(chain, s, true);
+}
+
+/**
+ * @brief	Release every segment linked to a chain, along with any adopted strings and the flattened copy.
+ * @param	chain	the chain being reset.
+ * @return	This function returns no value.
+ */
+void st_chain_reset(stringer_t *chain) {
+
+	uint32_t opts;
+	chain_segment_t *segment;
+	void (*release)(void *buffer);
+
+	if (!chain || !((opts = *((uint32_t *)chain)) & CHAIN_T)) {
+		log_pedantic("Attempted to reset a string which isn't a chain.");
+		return;
+	}
+
+	release = opts & SECURE ? &mm_sec_free : opts & ARENA ? &mm_arena_release : &mm_free;
+
+	while ((segment = ((chain_t *)chain)->head)) {
+		((chain_t *)chain)->head = segment->next;
+		if (segment->owned) st_free(segment->owned);
+		release(segment);
+	}
+
+	if (((chain_t *)chain)->data) {
+		release(((chain_t *)chain)->data);
+	}
+
+	((chain_t *)chain)->data = NULL;
+	((chain_t *)chain)->tail = NULL;
+	((chain_t *)chain)->length = ((chain_t *)chain)->count = 0;
+
+	return;
+}
+
+/**
+ * @brief	Copy the segments of a chain into a contiguous buffer.
+ * @note	The buffer is kept until the chain is reset, freed or appended to, so repeated calls only copy the data once.
+ * 			The buffer is null terminated, though the terminator isn't included in the chain length.
+ * @param	chain	the chain being flattened.
+ * @return	NULL on failure, or if the chain is empty, otherwise a pointer to the flattened data.
+ */
+void * st_chain_flatten(stringer_t *chain) {
+
+	uint32_t opts;
+	uchr_t *cursor;
+	chain_segment_t *segment;
+	void * (*allocate)(size_t len);
+
+	if (!chain || !((opts = *((uint32_t *)chain)) & CHAIN_T)) {
+		log_pedantic("Attempted to flatten a string which isn't a chain.");
+		return NULL;
+	}
+	else if (((chain_t *)chain)->data || !((chain_t *)chain)->length) {
+		return ((chain_t *)chain)->data;
+	}
+
+	allocate = opts & SECURE ? &mm_sec_alloc : opts & ARENA ? &mm_arena_get : &mm_alloc;
+
+	if (!(cursor = allocate(((chain_t *)chain)->length + 1))) {
+		log_pedantic("Unable to allocate a buffer for the flattened chain. { length = %zu }", ((chain_t *)chain)->length);
+		return NULL;
+	}
+
+	((chain_t *)chain)->data = cursor;
+
+	for (segment = ((chain_t *)chain)->head; segment; segment = segment->next) {
+		mm_copy(cursor, pl_data_get(segment->place), pl_length_get(segment->place));
+		cursor += pl_length_get(segment->place);
+	}
+
+	return ((chain_t *)chain)->data;
+}
+
+/**
+ * @brief	Get a placer referencing part of a chain.
+ * @note	If the range falls inside a single segment, the placer references the segment data directly, otherwise the chain
+ * 			is flattened, and the placer references the flattened copy.
+ * @param	chain	the chain being referenced.
+ * @param	offset	the offset, in bytes, of the start of the range.
+ * @param	len		the length, in bytes, of the range.
+ * @return	a placer referencing the range, or a null placer if the range is invalid, or the chain couldn't be flattened.
+ */
+placer_t st_chain_placer(stringer_t *chain, size_t offset, size_t len) {
+
+	uchr_t *data;
+	size_t skipped = offset;
+	chain_segment_t *segment;
+
+	if (!chain || !(*((uint32_t *)chain) & CHAIN_T) || !len || offset + len > ((chain_t *)chain)->length) {
+		log_pedantic("Invalid chain range. { offset = %zu / len = %zu }", offset, len);
+		return pl_null();
+	}
+
+	for (segment = ((chain_t *)chain)->head; segment && skipped >= pl_length_get(segment->place); segment = segment->next) {
+		skipped -= pl_length_get(segment->place);
+	}
+
+	if (segment && skipped + len <= pl_length_get(segment->place)) {
+		return pl_init(pl_char_get(segment->place) + skipped, len);
+	}
+	else if (!(data = st_chain_flatten(chain))) {
+		return pl_null();
+	}
+
+	return pl_init(data + offset, len);
+}
+
+/**
+ * @brief	Describe the segments of a chain using an I/O vector, so the chain can be written without flattening it.
+ * @param	chain	the chain being described.
+ * @param	offset	the number of bytes at the start of the chain which should be skipped, usually because they've already been written.
+ * @param	vec		a pointer to the I/O vector array which will receive the segments.
+ * @param	count	the number of entries in the I/O vector array.
+ * @return	-1 on error, or the number of I/O vector entries which were filled.
+ */
+int_t st_chain_iovec(stringer_t *chain, size_t offset, struct iovec *vec, int_t count) {
+
+	int_t result = 0;
+	chain_segment_t *segment;
+
+	if (!chain || !(*((uint32_t *)chain) & CHAIN_T) || !vec || count <= 0) {
+		log_pedantic("Invalid parameters were provided to the chain I/O vector function.");
+		return -1;
+	}
+
+	for (segment = ((chain_t *)chain)->head; segment && offset >= pl_length_get(segment->place); segment = segment->next) {
+		offset -= pl_length_get(segment->place);
+	}
+
+	for (; segment && result < count; segment = segment->next, result++, offset = 0) {
+		vec[result].iov_base = pl_char_get(segment->place) + offset;
+		vec[result].iov_len = pl_length_get(segment->place) - offset;
+	}
+
+	return result;
+}
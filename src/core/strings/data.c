@@ -94,7 +94,7 @@ void st_data_set(stringer_t *s, void *data) {
 	uint32_t opts;
 	void (*release)(void *buffer);
 
-	if (!s || !(opts = *((uint32_t *)s)) || !(release = opts & SECURE ? &mm_sec_free : &mm_free)) {
+	if (!s || !(opts = *((uint32_t *)s)) || !(release = opts & SECURE ? &mm_sec_free : opts & ARENA ? &mm_arena_release : &mm_free)) {
 		return;
 	}
 
@@ -143,6 +143,7 @@ void st_data_set(stringer_t *s, void *data) {
 
 /**
  * @brief	Retrieve the data associated with a managed string.
+ * @note	Chains are flattened into a contiguous buffer the first time their data is requested after an append.
  * @param	s	the input managed string.
  * @return	NULL on failure or for an improperly constructed string; otherwise, a pointer to the string's data.
  */
@@ -162,7 +163,7 @@ void * st_data_get(stringer_t *s) {
 	}
 #endif
 
-	switch (opts & (CONSTANT_T | NULLER_T | BLOCK_T | PLACER_T | MANAGED_T | MAPPED_T)) {
+	switch (opts & (CONSTANT_T | NULLER_T | BLOCK_T | PLACER_T | MANAGED_T | MAPPED_T | CHAIN_T)) {
 
 		case (CONSTANT_T):
 			result = ((constant_t *)s)->data;
@@ -182,6 +183,9 @@ void * st_data_get(stringer_t *s) {
 		case (MAPPED_T):
 			result = ((mapped_t *)s)->data;
 			break;
+		case (CHAIN_T):
+			result = st_chain_flatten(s);
+			break;
 	}
 
 	return result;
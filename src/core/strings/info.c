@@ -18,7 +18,8 @@ chr_t *st_option_types[] = {
 	"NULLER",
 	"BLOCK",
 	"MANAGED",
-	"MAPPED"
+	"MAPPED",
+	"CHAIN"
 };
 
 chr_t *st_option_layouts[] = {
@@ -31,7 +32,8 @@ chr_t *st_option_allocators[] = {
 	"UNKNOWN",
 	"STACK",
 	"HEAP",
-	"SECURE"
+	"SECURE",
+	"ARENA"
 };
 
 /**
@@ -43,7 +45,7 @@ const chr_t * st_info_type(uint32_t opts) {
 
 	chr_t *result = st_option_types[0];
 
-	switch (opts & (CONSTANT_T | NULLER_T | PLACER_T | BLOCK_T | MANAGED_T | MAPPED_T)) {
+	switch (opts & (CONSTANT_T | NULLER_T | PLACER_T | BLOCK_T | MANAGED_T | MAPPED_T | CHAIN_T)) {
 		case (CONSTANT_T):
 			result = st_option_types[1];
 			break;
@@ -62,6 +64,9 @@ const chr_t * st_info_type(uint32_t opts) {
 		case (MAPPED_T):
 			result = st_option_types[6];
 			break;
+		case (CHAIN_T):
+			result = st_option_types[7];
+			break;
 	}
 
 	return result;
@@ -97,7 +102,7 @@ const chr_t * st_info_allocator(uint32_t opts) {
 
 	chr_t *result = st_option_allocators[0];
 
-	switch (opts & (STACK | HEAP | SECURE)) {
+	switch (opts & (STACK | HEAP | SECURE | ARENA)) {
 		case (STACK):
 			result = st_option_allocators[1];
 			break;
@@ -107,6 +112,9 @@ const chr_t * st_info_allocator(uint32_t opts) {
 		case (SECURE):
 			result = st_option_allocators[3];
 			break;
+		case (ARENA):
+			result = st_option_allocators[4];
+			break;
 	}
 
 	return result;
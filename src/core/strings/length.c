@@ -29,7 +29,7 @@ size_t st_length_get(stringer_t *s) {
 	}
 #endif
 
-	switch (opts & (CONSTANT_T | NULLER_T | BLOCK_T | PLACER_T | MANAGED_T | MAPPED_T)) {
+	switch (opts & (CONSTANT_T | NULLER_T | BLOCK_T | PLACER_T | MANAGED_T | MAPPED_T | CHAIN_T)) {
 		case (CONSTANT_T):
 			data = ((constant_t *)s)->data;
 			while (*data++) {
@@ -54,6 +54,9 @@ size_t st_length_get(stringer_t *s) {
 		case (MAPPED_T):
 			result = ((mapped_t *)s)->length;
 			break;
+		case (CHAIN_T):
+			result = ((chain_t *)s)->length;
+			break;
 		default:
 			log_pedantic("Invalid string type.");
 			break;
@@ -7,19 +7,37 @@
 
 #include "magma.h"
 
-/*
+/**
+ * The compiled form of a substitution table, which is a deterministic Aho-Corasick automaton. Bytes which don't appear in
+ * any pattern share a single class, so the transition table only needs a column for each distinct pattern byte.
+ */
+struct replacer_t {
+	uint32_t count, states, width;
+	uchr_t classes[256];
+	uint32_t *transitions; /* The next state, indexed by state * width + class. */
+	uint32_t *depths; /* The length of the prefix which leads to each state. */
+	int32_t *outputs; /* The longest pattern which ends at each state, or -1 if there isn't one. */
+	placer_t *patterns, *replacements; /* Placers referencing the table entries, which are cheaper to query in the search loop. */
+	bool_t shrinks; /* Set if no replacement is longer than its pattern, so targets can be rewritten in place. */
+};
+
+/**
  * @brief	Replace all instances of a substring inside another string.
+ * @note	The target is searched using memmem(), which skips ahead using the first byte of the pattern, instead of comparing
+ * 			the pattern at every offset. If the replacement isn't longer than the pattern, and the target is a managed or mapped
+ * 			string, the target is rewritten in place with a single pass. Otherwise the matches are counted, and a new managed
+ * 			string of exactly the right length is assembled, and the original target is freed if possible.
  * @param	target			a pointer to the address of a managed string containing the haystack string, which will be overwritten with the
  * 			address of the transformed string on success.
  * @param	pattern			a managed string containing the search pattern.
  * @param	replacement		a managed string containing the data that will replace all found instances of the search pattern.
  * @return	-1 on error, or the number of times the pattern string was found in the input string.
  */
- // LOW: Function could use some serious cleanup; NEED TO TEST THIS IN UNIT TESTS
 int_t st_replace(stringer_t **target, stringer_t *pattern, stringer_t *replacement) {
 
+	uint32_t opts;
 	stringer_t *output;
-	uchr_t *tptr, *optr, *rptr, *pptr;
+	uchr_t *tptr, *optr, *rptr, *pptr, *cursor, *match, *end;
 	size_t hits = 0, tlen, plen, rlen, olen;
 
 	// replacement can be blank but it can't be null
@@ -31,26 +49,35 @@ int_t st_replace(stringer_t **target, stringer_t *pattern, stringer_t *replaceme
 
 	// Check to make sure the target is big enough to hold the pattern.
 	if (tlen < plen) {
-//		log_pedantic("The target isn't long enough to contain the pattern.");
 		return 0;
 	}
 
-	// Increment through the entire target and find out how many times the pattern is present.
-	for (size_t i = 0; i <= (tlen - plen); i++) {
-		if (!st_cmp_cs_starts(PLACER(tptr++, tlen - i), pattern)) {
-			hits++;
-			i += plen - 1;
-			tptr += plen - 1;
+	opts = *((uint32_t *)*target);
+	end = tptr + tlen;
+
+	// If the target can't grow, slide the unmatched data down over the space freed up by each replacement as we go.
+	if (rlen <= plen && (opts & (MANAGED_T | MAPPED_T))) {
+
+		for (optr = cursor = tptr; (match = memmem(cursor, end - cursor, pptr, plen)); cursor = match + plen, hits++) {
+			if (optr != cursor) mm_move(optr, cursor, match - cursor);
+			optr += match - cursor;
+			mm_copy(optr, rptr, rlen);
+			optr += rlen;
+		}
+
+		if (hits && optr != cursor) {
+			mm_move(optr, cursor, end - cursor);
+			optr += end - cursor;
+			*optr = 0;
+			st_length_set(*target, optr - tptr);
 		}
-	}
 
-	//  Did we get any hits? Or if the output length would be zero, return.
-	// QUESTION: Should 2nd part of conditional ever be necessary? tlen - (plen * hits) can't be less than zero,
-	//           and hits has to be positive. So the expression will always evaluate positive.
-	// QUESTION: Shouldn't we allow the output length to be zero?
-	/*if (!hits || !(olen = tlen - (plen * hits) + (rlen * hits))) {
 		return hits;
-	}*/
+	}
+
+	for (cursor = tptr; (match = memmem(cursor, end - cursor, pptr, plen)); cursor = match + plen) {
+		hits++;
+	}
 
 	if (!hits) {
 		return 0;
@@ -65,32 +92,290 @@ int_t st_replace(stringer_t **target, stringer_t *pattern, stringer_t *replaceme
 		return hits;
 	}
 
-	// Allocate a new stringer.
-	if (!(output = st_alloc(olen))) {
+	// Allocate a new stringer, keeping sensitive data inside the secure memory region.
+	if (!(output = st_alloc_opts(MANAGED_T | CONTIGUOUS | (opts & SECURE ? SECURE : HEAP), olen))) {
 		log_pedantic("Could not allocate %zu bytes for the new string.", olen);
-		// QUESTION: -3?
 		return -3;
 	}
 
-	// Setup.
-	tptr = st_data_get(*target);
 	optr = st_data_get(output);
 
-	// Increment through the entire target and copy the bytes.
+	for (cursor = tptr; (match = memmem(cursor, end - cursor, pptr, plen)); cursor = match + plen) {
+		mm_copy(optr, cursor, match - cursor);
+		optr += match - cursor;
+		mm_copy(optr, rptr, rlen);
+		optr += rlen;
+	}
+
+	mm_copy(optr, cursor, end - cursor);
+
+	if (st_valid_free(opts)) {
+		st_free(*target);
+	}
+
+	st_length_set(output, olen);
+	*target = output;
+	return hits;
+}
+
+/**
+ * @brief	Free a compiled substitution table.
+ * @param	replacer	the substitution table to be freed.
+ * @return	This function returns no value.
+ */
+void st_replacer_free(replacer_t *replacer) {
+
+	if (!replacer) {
+		log_pedantic("Attempted to free a NULL substitution table.");
+		return;
+	}
+
+	if (replacer->transitions) mm_free(replacer->transitions);
+	if (replacer->depths) mm_free(replacer->depths);
+	if (replacer->outputs) mm_free(replacer->outputs);
+	if (replacer->patterns) mm_free(replacer->patterns);
+
+	mm_free(replacer);
+	return;
+}
+
+/**
+ * @brief	Compile a substitution table, so every pattern in the table can be replaced with a single pass over a target.
+ * @note	The patterns and replacements are referenced, not copied, so they must outlive the compiled table. If the same
+ * 			pattern appears more than once, the first replacement is used.
+ * @param	count			the number of entries in the substitution table.
+ * @param	patterns		an array of managed strings holding the search patterns, none of which may be empty.
+ * @param	replacements	an array of managed strings holding the data which will replace each pattern, which may be empty.
+ * @return	NULL on failure, or a pointer to the compiled substitution table.
+ */
+replacer_t * st_replacer_alloc(size_t count, stringer_t **patterns, stringer_t **replacements) {
+
+	uchr_t *data;
+	replacer_t *replacer;
+	uint32_t state, next, *queue = NULL, *failures = NULL, head = 0, tail = 0;
+	size_t total = 1, len;
+
+	if (!count || !patterns || !replacements || count > INT32_MAX) {
+		log_pedantic("Invalid substitution table.");
+		return NULL;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (st_empty_out(patterns[i], &data, &len) || !replacements[i] || !*((uint32_t *)replacements[i])) {
+			log_pedantic("Substitution tables can't contain empty patterns, or NULL replacements.");
+			return NULL;
+		}
+		total += len;
+	}
+
+	if (total > UINT32_MAX || !(replacer = mm_alloc(sizeof(replacer_t)))) {
+		log_pedantic("Unable to allocate a substitution table.");
+		return NULL;
+	}
+
+	replacer->count = count;
+	replacer->shrinks = true;
+	replacer->width = 1;
+
+	// Assign a class to every byte which appears in a pattern. Class zero is shared by the bytes which don't.
+	for (size_t i = 0; i < count; i++) {
+		data = st_data_get(patterns[i]);
+		for (size_t j = 0; j < st_length_get(patterns[i]); j++) {
+			if (!replacer->classes[data[j]]) replacer->classes[data[j]] = replacer->width++;
+		}
+		if (st_length_get(replacements[i]) > st_length_get(patterns[i])) {
+			replacer->shrinks = false;
+		}
+	}
+
+	// The pattern and replacement arrays share a single block.
+	if (!(replacer->transitions = mm_alloc(total * replacer->width * sizeof(uint32_t))) ||
+		!(replacer->depths = mm_alloc(total * sizeof(uint32_t))) || !(replacer->outputs = mm_alloc(total * sizeof(int32_t))) ||
+		!(replacer->patterns = mm_alloc(count * 2 * sizeof(placer_t)))) {
+		log_pedantic("Unable to allocate a substitution table.");
+		st_replacer_free(replacer);
+		return NULL;
+	}
+
+	replacer->replacements = replacer->patterns + count;
+	replacer->states = 1;
+	replacer->outputs[0] = -1;
+
+	// Build a trie from the patterns. Since the root is never a child, a zero transition means there isn't a child yet.
+	for (size_t i = 0; i < count; i++) {
+
+		replacer->patterns[i] = pl_init(st_data_get(patterns[i]), st_length_get(patterns[i]));
+		replacer->replacements[i] = pl_init(st_data_get(replacements[i]), st_length_get(replacements[i]));
+
+		data = st_data_get(patterns[i]);
+		len = st_length_get(patterns[i]);
+		state = 0;
+
+		for (size_t j = 0; j < len; j++) {
+			if (!(next = replacer->transitions[(state * replacer->width) + replacer->classes[data[j]]])) {
+				next = replacer->states++;
+				replacer->depths[next] = j + 1;
+				replacer->outputs[next] = -1;
+				replacer->transitions[(state * replacer->width) + replacer->classes[data[j]]] = next;
+			}
+			state = next;
+		}
+
+		if (replacer->outputs[state] == -1) {
+			replacer->outputs[state] = i;
+		}
+	}
+
+	// Walk the trie breadth first, and turn it into a complete state machine by filling in every missing transition using
+	// the failure link. The failure links are only needed while the table is being compiled.
+	if (!(queue = mm_alloc(replacer->states * sizeof(uint32_t))) || !(failures = mm_alloc(replacer->states * sizeof(uint32_t)))) {
+		log_pedantic("Unable to allocate a substitution table.");
+		if (queue) mm_free(queue);
+		st_replacer_free(replacer);
+		return NULL;
+	}
+
+	for (uint32_t c = 0; c < replacer->width; c++) {
+		if ((next = replacer->transitions[c])) {
+			queue[tail++] = next;
+		}
+	}
+
+	while (head < tail) {
+
+		state = queue[head++];
+
+		// A state inherits the output of its failure state, unless a longer pattern ends here.
+		if (replacer->outputs[state] == -1) {
+			replacer->outputs[state] = replacer->outputs[failures[state]];
+		}
+
+		for (uint32_t c = 0; c < replacer->width; c++) {
+			if ((next = replacer->transitions[(state * replacer->width) + c])) {
+				failures[next] = replacer->transitions[(failures[state] * replacer->width) + c];
+				queue[tail++] = next;
+			}
+			else {
+				replacer->transitions[(state * replacer->width) + c] = replacer->transitions[(failures[state] * replacer->width) + c];
+			}
+		}
+	}
+
+	mm_free(failures);
+	mm_free(queue);
+
+	return replacer;
+}
+
+/**
+ * @brief	Replace every instance of the patterns in a substitution table with a single pass over the target.
+ * @note	Matches are leftmost longest, and never overlap, so when two patterns match at the same offset the longer pattern
+ * 			wins, and a match which starts earlier always wins over one which starts later. If no replacement in the table is
+ * 			longer than its pattern, and the target is a managed or mapped string, the target is rewritten in place. Otherwise
+ * 			the output is assembled in a new managed string, and the original target is freed if possible.
+ * @param	target		a pointer to the address of a managed string containing the haystack string, which will be overwritten with the
+ * 			address of the transformed string on success.
+ * @param	replacer	the compiled substitution table.
+ * @return	-1 on error, or the number of replacements made.
+ */
+int_t st_replace_multi(stringer_t **target, replacer_t *replacer) {
+
+	int32_t found = -1;
+	uint32_t opts, state = 0;
+	stringer_t *output = NULL;
+	uchr_t *tptr, *optr, *rptr;
+	size_t hits = 0, tlen, olen = 0, avail, copied = 0, start = 0, plen, rlen;
+	bool_t inplace;
+
+	if (!target || !replacer || st_empty_out(*target, &tptr, &tlen)) {
+		log_pedantic("Sanity check failed. Passed a NULL pointer.");
+		return -1;
+	}
+
+	opts = *((uint32_t *)*target);
+	inplace = replacer->shrinks && (opts & (MANAGED_T | MAPPED_T));
+	optr = tptr;
+	avail = tlen;
+
 	for (size_t i = 0; i <= tlen; i++) {
-		if (i <= (tlen - plen) && !st_cmp_cs_starts(PLACER(tptr, tlen - i), pattern)) {
-			i += plen - 1;
-			tptr += plen;
-			for (size_t j = 0; j < rlen; j++) {
-				*optr++ = *(rptr + j);
+
+		// Note the leftmost match, and if the matches are the same distance from the left, the longest match.
+		if (i) {
+			state = replacer->transitions[(state * replacer->width) + replacer->classes[tptr[i - 1]]];
+			if (replacer->outputs[state] != -1 && (found == -1 || i - replacer->patterns[replacer->outputs[state]].length <= start)) {
+				found = replacer->outputs[state];
+				start = i - replacer->patterns[found].length;
+			}
+		}
+
+		// Once the longest partial match starts after the pending match, nothing can displace it, so the replacement can be
+		// written out, and the search restarts where the pending match ends.
+		if (found == -1 || (i != tlen && i - replacer->depths[state] <= start)) {
+			continue;
+		}
+
+		plen = replacer->patterns[found].length;
+		rlen = replacer->replacements[found].length;
+		rptr = replacer->replacements[found].data;
+
+		if (!inplace && !output) {
+			avail = tlen + (rlen * 4) + 64;
+			if (!(output = st_alloc_opts(MANAGED_T | JOINTED | (opts & SECURE ? SECURE : HEAP), avail))) {
+				log_pedantic("Could not allocate %zu bytes for the new string.", avail);
+				return -3;
+			}
+			optr = st_data_get(output);
+		}
+		else if (!inplace && olen + (start - copied) + rlen > avail) {
+			avail = (olen + (start - copied) + rlen + tlen - copied) * 2;
+			st_length_set(output, olen);
+			if (!st_realloc(output, avail)) {
+				log_pedantic("Could not allocate %zu bytes for the new string.", avail);
+				st_free(output);
+				return -3;
 			}
+			optr = st_data_get(output);
 		}
-		else {
-			*optr++ = *tptr++;
+
+		if (optr + olen != tptr + copied) mm_move(optr + olen, tptr + copied, start - copied);
+		olen += start - copied;
+		mm_copy(optr + olen, rptr, rlen);
+		olen += rlen;
+		copied = start + plen;
+		hits++;
+
+		// Rewind to the end of the match, since the search may have looked past it. The next pass through the loop consumes
+		// the byte which follows the match.
+		i = copied;
+		state = 0;
+		found = -1;
+	}
+
+	if (!hits) {
+		return 0;
+	}
+
+	// Copy whatever follows the last match.
+	if (!inplace && olen + (tlen - copied) > avail) {
+		st_length_set(output, olen);
+		if (!st_realloc(output, olen + (tlen - copied))) {
+			log_pedantic("Could not allocate %zu bytes for the new string.", olen + (tlen - copied));
+			st_free(output);
+			return -3;
 		}
+		optr = st_data_get(output);
+	}
+
+	if (optr + olen != tptr + copied) mm_move(optr + olen, tptr + copied, tlen - copied);
+	olen += tlen - copied;
+
+	if (inplace) {
+		if (olen < tlen) optr[olen] = 0;
+		st_length_set(*target, olen);
+		return hits;
 	}
 
-	if (st_valid_free(*((uint32_t *)(*target)))) {
+	if (st_valid_free(opts)) {
 		st_free(*target);
 	}
 
@@ -29,9 +29,14 @@ enum {
 	STACK = 256,				// More properly, data is not on the heap (stack or static initialization)
 	HEAP = 512,
 	SECURE = 1024,				// Must be on the heap
+	ARENA = 2048,				// Carved from the arena bound to the thread, and released along with the arena
 
 	// Flags
-	FOREIGNDATA = 4096			// Do not free data upon deallocation - this is somebody else's job!
+	FOREIGNDATA = 4096,			// Do not free data upon deallocation - this is somebody else's job!
+
+	// Type (continued)
+	CHAIN_T = 8192				/* A list of segments referencing other buffers; must be jointed, and the segments are
+								   only copied into a contiguous buffer when the data is requested */
 
 	// If you add any new flags, make sure you update the info.c arrays!
 };
@@ -73,8 +78,20 @@ typedef struct __attribute__ ((packed)) {
 	void *data;
 } mapped_t;
 
+typedef struct chain_segment_t chain_segment_t;
+
+typedef struct __attribute__ ((packed)) {
+	uint32_t opts;
+	size_t length; /* The combined length of the segments. */
+	void *data; /* The flattened copy of the segments, or NULL if the chain hasn't been flattened since the last append. */
+	size_t count; /* The number of segments. */
+	chain_segment_t *head, *tail;
+} chain_t;
+
 typedef void stringer_t;
 
+typedef struct replacer_t replacer_t;
+
 /// nuller.c
 chr_t *  ns_alloc(size_t len);
 chr_t *  ns_append(chr_t *s, chr_t *append);
@@ -113,6 +130,15 @@ size_t st_length_get(stringer_t *s);
 size_t st_avail_set(stringer_t *s, size_t avail);
 size_t st_length_set(stringer_t *s, size_t len);
 
+/// chain.c
+stringer_t *  st_chain_adopt(stringer_t *chain, stringer_t *s);
+stringer_t *  st_chain_append(stringer_t *chain, stringer_t *s);
+void *        st_chain_flatten(stringer_t *chain);
+int_t         st_chain_iovec(stringer_t *chain, size_t offset, struct iovec *vec, int_t count);
+stringer_t *  st_chain_link(stringer_t *chain, stringer_t *s, bool_t adopt);
+placer_t      st_chain_placer(stringer_t *chain, size_t offset, size_t len);
+void          st_chain_reset(stringer_t *chain);
+
 /// data.c
 chr_t *   st_char_get(stringer_t *s);
 void *    st_data_get(stringer_t *s);
@@ -176,6 +202,9 @@ int_t st_write_variadic(stringer_t *output, ssize_t count, ...);
 
 /// replace.c
 int_t         st_replace(stringer_t **target, stringer_t *pattern, stringer_t *replacement);
+int_t         st_replace_multi(stringer_t **target, replacer_t *replacer);
+replacer_t *  st_replacer_alloc(size_t count, stringer_t **patterns, stringer_t **replacements);
+void          st_replacer_free(replacer_t *replacer);
 stringer_t *  st_swap(stringer_t *target, uchr_t pattern, uchr_t replacement);
 
 // Usage: constant_t *constant = CONSTANT("Hello world.");
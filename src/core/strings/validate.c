@@ -9,7 +9,7 @@
 
 /**
  * @brief	A sanity check to determine whether the managed string is a valid placer.
- * @note	The following criteria must be satisfied: placer bit set, jointed bit set, either stack, heap, or secure set,
+ * @note	The following criteria must be satisfied: placer bit set, jointed bit set, either stack, heap, secure, or arena set,
  * 			and no other bits other than these mentioned should be set.
  * @param opts	the managed string options value to be evaluated.
  * @return	true if the option value reflects a valid placer, or false otherwise.
@@ -19,8 +19,8 @@ bool_t st_valid_placer(uint32_t opts) {
 	if (!st_valid_opts(opts)) {
 		return false;
 	}
-	else if (!(opts & PLACER_T) && !(opts & JOINTED) && !(opts & (STACK | HEAP | SECURE)) &&
-			(opts & ~(PLACER_T | JOINTED | STACK | HEAP | SECURE))) {
+	else if (!(opts & PLACER_T) && !(opts & JOINTED) && !(opts & (STACK | HEAP | SECURE | ARENA)) &&
+			(opts & ~(PLACER_T | JOINTED | STACK | HEAP | SECURE | ARENA))) {
 		return false;
 	}
 
@@ -136,12 +136,13 @@ bool_t st_valid_avail(uint32_t opts) {
  * @brief	Check to see that a managed string has a valid combination of allocation options.
  * @note	The following rules are enforced:
  * 			1. Each managed string must only be one of the following:
- * 				a. constant, nuller, block, placer, managed, or mapped.
+ * 				a. constant, nuller, block, placer, managed, mapped, or chain.
  *				b. jointed or contiguous.
- *				c. allocated on the stack, heap, or secure.
+ *				c. allocated on the stack, heap, secure, or arena.
  *			2. A placer cannot be contiguous.
  *			3. A constant must be contiguous and be allocated on the stack.
- *			4. Mapped strings must be contiguous and on the heap.
+ *			4. Mapped strings must be jointed, and can't be allocated on the stack or from an arena.
+ *			5. Chains must be jointed, and can't be allocated on the stack, or use foreign data.
  *
  * @param	opts	the managed string option mask to be validated.
  * @return	true if the options represent valid managed string allocation options, or false if they do not.
@@ -151,7 +152,7 @@ bool_t st_valid_opts(uint32_t opts) {
 	bool_t result = true;
 
 	// Type
-	if (bitwise_count(opts & (CONSTANT_T | NULLER_T | BLOCK_T | PLACER_T | MANAGED_T | MAPPED_T)) != 1) {
+	if (bitwise_count(opts & (CONSTANT_T | NULLER_T | BLOCK_T | PLACER_T | MANAGED_T | MAPPED_T | CHAIN_T)) != 1) {
 		result = false;
 	}
 	// Layout
@@ -159,11 +160,11 @@ bool_t st_valid_opts(uint32_t opts) {
 		result = false;
 	}
 	// Allocation
-	else if (bitwise_count(opts & (STACK | HEAP | SECURE)) != 1) {
+	else if (bitwise_count(opts & (STACK | HEAP | SECURE | ARENA)) != 1) {
 		result = false;
 	}
 
-	switch (opts & (CONSTANT_T | NULLER_T | BLOCK_T | PLACER_T | MANAGED_T | MAPPED_T)) {
+	switch (opts & (CONSTANT_T | NULLER_T | BLOCK_T | PLACER_T | MANAGED_T | MAPPED_T | CHAIN_T)) {
 
 		// Constants must use the stack allocator, and specify a contiguous layout.
 		case (CONSTANT_T):
@@ -183,7 +184,12 @@ bool_t st_valid_opts(uint32_t opts) {
 		// Mapped containers must specify a jointed layout and use the heap allocator.
 		case (MAPPED_T):
 			if (opts & CONTIGUOUS) result = false;
-			else if (opts & STACK) result = false;
+			else if (opts & (STACK | ARENA)) result = false;
+			break;
+
+		// Chains must specify a jointed layout, and own the segment list, so they can't live on the stack.
+		case (CHAIN_T):
+			if (opts & (CONTIGUOUS | STACK | FOREIGNDATA)) result = false;
 			break;
 
 	}
@@ -0,0 +1,291 @@
+
+/**
+ * @file /magma/core/thread/contention.c
+ *
+ * @brief	Adaptive spinning and contention statistics for the mutex and read/write lock wrappers.
+ *
+ * @note	A lock which can't be acquired right away is retried while spinning with exponential backoff, on the assumption
+ * 			that most critical sections are short, and the holder will release the lock before parking in the kernel would
+ * 			pay off. Each thread adapts the number of backoff rounds it is willing to spin to how often spinning worked for it
+ * 			in the past, and on a single processor system the spin phase is skipped entirely, since the holder can't make any
+ * 			progress while we spin.
+ *
+ * 			When statistics are enabled, every contended acquisition is recorded against the site which requested the lock,
+ * 			using the return address of the lock wrapper as the key. The sites live in a fixed size, lock free table, so the
+ * 			recording logic never takes a lock of its own. Uncontended acquisitions are never recorded, and never pay for
+ * 			anything beyond a single trylock call.
+ */
+
+#include "magma.h"
+
+/**
+ * The number of distinct lock sites which can be tracked. Must be a power of two.
+ */
+#define MAGMA_CONTENTION_SITES 1024
+
+/**
+ * The maximum number of backoff rounds a thread will spin before parking. Each round pauses twice as long as the one before
+ * it, up to the limit below.
+ */
+#define MAGMA_CONTENTION_SPINS 10
+
+/**
+ * The base two logarithm of the longest backoff round, measured in pause instructions.
+ */
+#define MAGMA_CONTENTION_BACKOFF 6
+
+typedef struct {
+	void *site;
+	uint32_t kind;
+	uint64_t contended, spun, parked, nanoseconds, longest;
+} contention_slot_t;
+
+static bool_t contention_active = false;
+static int64_t contention_processors = 0;
+static uint64_t contention_overflow = 0;
+static contention_slot_t contention_sites[MAGMA_CONTENTION_SITES];
+static __thread uint32_t contention_limit = MAGMA_CONTENTION_SPINS;
+
+/**
+ * @brief	Enable or disable the recording of lock contention statistics.
+ * @note	Statistics which were already recorded are kept until contention_reset() is called.
+ * @param	enable	true to start recording contended lock acquisitions, or false to stop.
+ * @return	This function returns no value.
+ */
+void contention_enable(bool_t enable) {
+	__atomic_store_n(&contention_active, enable, __ATOMIC_RELAXED);
+	return;
+}
+
+/**
+ * @brief	Determine whether lock contention statistics are being recorded.
+ * @return	true if contended lock acquisitions are being recorded, or false if they aren't.
+ */
+bool_t contention_enabled(void) {
+	return __atomic_load_n(&contention_active, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief	Determine whether a thread waiting on a lock should keep spinning, and if so, pause for the given backoff round.
+ * @param	round	the zero based number of backoff rounds the caller has already spun through.
+ * @return	true if the caller should try to acquire the lock again, or false if it should park instead.
+ */
+bool_t contention_backoff(uint32_t round) {
+
+	int64_t processors;
+
+	if (!(processors = __atomic_load_n(&contention_processors, __ATOMIC_RELAXED))) {
+		processors = sysconf(_SC_NPROCESSORS_ONLN);
+		__atomic_store_n(&contention_processors, (processors > 0 ? processors : 1), __ATOMIC_RELAXED);
+	}
+
+	// Spinning on a single processor only delays the thread holding the lock.
+	if (processors <= 1 || round >= contention_limit) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < (1U << (round < MAGMA_CONTENTION_BACKOFF ? round : MAGMA_CONTENTION_BACKOFF)); i++) {
+#ifdef __SSE2__
+		_mm_pause();
+#else
+		__asm__ __volatile__ ("" ::: "memory");
+#endif
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Get the time a contended lock acquisition started, if statistics are being recorded.
+ * @return	the current monotonic time in nanoseconds, or 0 if statistics are disabled.
+ */
+uint64_t contention_begin(void) {
+
+	struct timespec now;
+
+	if (!contention_enabled() || clock_gettime(CLOCK_MONOTONIC, &now)) {
+		return 0;
+	}
+
+	return ((uint64_t)now.tv_sec * 1000000000) + now.tv_nsec;
+}
+
+/**
+ * @brief	Find the table slot for a lock site, claiming an empty slot if the site hasn't been seen before.
+ * @param	site	the address which requested the lock.
+ * @param	kind	the type of lock acquisition being recorded.
+ * @return	NULL if the table is full, or a pointer to the slot for the site.
+ */
+contention_slot_t * contention_slot(void *site, M_CONTENTION kind) {
+
+	void *current;
+	contention_slot_t *slot;
+	uint64_t position = (((uintptr_t)site >> 2) * 0x9E3779B97F4A7C15ULL) >> 54;
+
+	for (uint64_t i = 0; i < MAGMA_CONTENTION_SITES; i++) {
+
+		slot = &(contention_sites[(position + i) & (MAGMA_CONTENTION_SITES - 1)]);
+
+		if (!(current = __atomic_load_n(&(slot->site), __ATOMIC_ACQUIRE))) {
+			current = NULL;
+			if (__atomic_compare_exchange_n(&(slot->site), &current, site, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+				__atomic_store_n(&(slot->kind), kind, __ATOMIC_RELAXED);
+				return slot;
+			}
+		}
+
+		if (current == site) {
+			return slot;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Finish a contended lock acquisition, adapting the spin limit for the calling thread and recording the wait.
+ * @param	site		the address which requested the lock, normally the return address of the lock wrapper.
+ * @param	kind		the type of lock acquisition being recorded.
+ * @param	started		the value returned by contention_begin() before the caller started waiting.
+ * @param	parked		true if spinning failed and the caller blocked in the kernel, or false if spinning succeeded.
+ * @return	This function returns no value.
+ */
+void contention_end(void *site, M_CONTENTION kind, uint64_t started, bool_t parked) {
+
+	uint64_t waited, longest;
+	contention_slot_t *slot;
+	struct timespec now;
+
+	// Spin a little longer next time if spinning paid off, and a little less if it didn't.
+	if (!parked && contention_limit < MAGMA_CONTENTION_SPINS) {
+		contention_limit++;
+	}
+	else if (parked && contention_limit > 1) {
+		contention_limit--;
+	}
+
+	if (!started || clock_gettime(CLOCK_MONOTONIC, &now)) {
+		return;
+	}
+	else if (!(slot = contention_slot(site, kind))) {
+		__atomic_add_fetch(&contention_overflow, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	waited = ((uint64_t)now.tv_sec * 1000000000) + now.tv_nsec - started;
+
+	__atomic_add_fetch(&(slot->contended), 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(parked ? &(slot->parked) : &(slot->spun), 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&(slot->nanoseconds), waited, __ATOMIC_RELAXED);
+
+	longest = __atomic_load_n(&(slot->longest), __ATOMIC_RELAXED);
+	while (waited > longest && !__atomic_compare_exchange_n(&(slot->longest), &longest, waited, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	return;
+}
+
+/**
+ * @brief	Get the lock sites which spent the most time waiting for a lock, ordered from the worst down.
+ * @param	sites	an array which will be filled with the recorded statistics.
+ * @param	limit	the number of entries the sites array can hold.
+ * @return	the number of entries stored in the sites array.
+ */
+uint64_t contention_report(contention_site_t *sites, uint64_t limit) {
+
+	uint64_t count = 0, position;
+	contention_site_t current;
+	contention_slot_t *slot;
+
+	if (!sites || !limit) {
+		log_pedantic("Invalid parameters passed to the contention report function.");
+		return 0;
+	}
+
+	for (uint64_t i = 0; i < MAGMA_CONTENTION_SITES; i++) {
+
+		slot = &(contention_sites[i]);
+
+		if (!(current.site = __atomic_load_n(&(slot->site), __ATOMIC_ACQUIRE)) ||
+			!(current.contended = __atomic_load_n(&(slot->contended), __ATOMIC_RELAXED))) {
+			continue;
+		}
+
+		current.kind = __atomic_load_n(&(slot->kind), __ATOMIC_RELAXED);
+		current.spun = __atomic_load_n(&(slot->spun), __ATOMIC_RELAXED);
+		current.parked = __atomic_load_n(&(slot->parked), __ATOMIC_RELAXED);
+		current.nanoseconds = __atomic_load_n(&(slot->nanoseconds), __ATOMIC_RELAXED);
+		current.longest = __atomic_load_n(&(slot->longest), __ATOMIC_RELAXED);
+
+		// Insert the site into the sorted output, dropping the least contended entry once the array is full.
+		for (position = count; position && sites[position - 1].nanoseconds < current.nanoseconds; position--) {
+			if (position < limit) {
+				sites[position] = sites[position - 1];
+			}
+		}
+
+		if (position < limit) {
+			sites[position] = current;
+			if (count < limit) count++;
+		}
+	}
+
+	return count;
+}
+
+/**
+ * @brief	Log the lock sites which spent the most time waiting for a lock.
+ * @param	limit	the maximum number of lock sites to include.
+ * @return	This function returns no value.
+ */
+void contention_log(uint64_t limit) {
+
+	Dl_info info;
+	uint64_t count;
+	contention_site_t *sites;
+	chr_t *kinds[] = { "unknown", "mutex", "read", "write" };
+
+	if (!limit) {
+		return;
+	}
+	else if (!(sites = mm_alloc(sizeof(contention_site_t) * limit))) {
+		log_pedantic("Unable to allocate memory for the contention report. { limit = %lu }", limit);
+		return;
+	}
+
+	count = contention_report(sites, limit);
+	log_info("Lock contention report. { sites = %lu / overflow = %lu }\n", count, __atomic_load_n(&contention_overflow, __ATOMIC_RELAXED));
+
+	for (uint64_t i = 0; i < count; i++) {
+
+		if (!dladdr(sites[i].site, &info) || !info.dli_sname) {
+			info.dli_sname = "unknown";
+			info.dli_saddr = sites[i].site;
+		}
+
+		log_info("%s+0x%lx [%p] { lock = %s / contended = %lu / spun = %lu / parked = %lu / waited = %lu ns / longest = %lu ns }\n",
+			info.dli_sname, (uintptr_t)sites[i].site - (uintptr_t)info.dli_saddr, sites[i].site, kinds[sites[i].kind <= M_CONTENTION_WRITE ? sites[i].kind : 0],
+			sites[i].contended, sites[i].spun, sites[i].parked, sites[i].nanoseconds, sites[i].longest);
+	}
+
+	mm_free(sites);
+	return;
+}
+
+/**
+ * @brief	Discard the recorded lock contention statistics.
+ * @note	The lock sites themselves stay in the table, so a site which becomes contended again keeps its old slot.
+ * @return	This function returns no value.
+ */
+void contention_reset(void) {
+
+	for (uint64_t i = 0; i < MAGMA_CONTENTION_SITES; i++) {
+		__atomic_store_n(&(contention_sites[i].contended), 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&(contention_sites[i].spun), 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&(contention_sites[i].parked), 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&(contention_sites[i].nanoseconds), 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&(contention_sites[i].longest), 0, __ATOMIC_RELAXED);
+	}
+
+	__atomic_store_n(&contention_overflow, 0, __ATOMIC_RELAXED);
+	return;
+}
@@ -0,0 +1,277 @@
+/**
+ * @file /magma/core/thread/epoch.c
+ *
+ * @brief	Epoch based memory reclamation, which allows readers to traverse shared structures without acquiring a lock.
+ *
+ * @note	Readers announce the global epoch they observed when entering a read side critical section. Writers unlink memory
+ * 			from a shared structure, queue it using epoch_retire(), and then call epoch_advance() once the new version of the
+ * 			structure has been published. Advancing stamps the queued memory with the current epoch and increments the global
+ * 			counter. Memory is only released once every active reader has announced a later epoch, at which point no reader
+ * 			can still be holding a reference to it. Reader records are recycled when a thread exits.
+ */
+
+#include "magma.h"
+
+typedef struct epoch_reader_t {
+	uint64_t epoch, depth;
+	uint32_t used;
+	struct epoch_reader_t *next;
+} epoch_reader_t;
+
+typedef struct epoch_retired_t {
+	void *data;
+	uint64_t epoch;
+	void (*release)(void *);
+	struct epoch_retired_t *next;
+} epoch_retired_t;
+
+static uint64_t epoch_global = 1;
+static pthread_key_t epoch_key;
+static pthread_once_t epoch_once = PTHREAD_ONCE_INIT;
+static epoch_reader_t *epoch_readers = NULL;
+static epoch_retired_t *epoch_retired = NULL;
+static pthread_mutex_t epoch_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread epoch_reader_t *epoch_local = NULL;
+static __thread epoch_retired_t *epoch_pending = NULL;
+
+/**
+ * @brief	Mark a reader record as available when the thread which owned it exits.
+ * @param	record	a pointer to the reader record of the exiting thread.
+ * @return	This function returns no value.
+ */
+void epoch_reader_release(void *record) {
+
+	epoch_reader_t *reader = record;
+
+	if (reader) {
+		reader->depth = 0;
+		__atomic_store_n(&(reader->epoch), 0, __ATOMIC_RELEASE);
+		__atomic_store_n(&(reader->used), 0, __ATOMIC_RELEASE);
+	}
+
+	return;
+}
+
+void epoch_init(void) {
+	tkey_init(&epoch_key, &epoch_reader_release);
+	return;
+}
+
+/**
+ * @brief	Get the reader record for the calling thread, claiming an unused record or allocating a new one if necessary.
+ * @note	Records are never freed, since a writer may be scanning the list at any time. Instead the record is marked unused
+ * 			when its thread exits, so the list never grows beyond the peak number of concurrent reader threads.
+ * @return	NULL on failure, or a pointer to the reader record belonging to the calling thread.
+ */
+epoch_reader_t * epoch_reader(void) {
+
+	epoch_reader_t *reader;
+
+	if (epoch_local) {
+		return epoch_local;
+	}
+
+	pthread_once(&epoch_once, &epoch_init);
+
+	for (reader = __atomic_load_n(&epoch_readers, __ATOMIC_ACQUIRE); reader; reader = reader->next) {
+		if (!__atomic_load_n(&(reader->used), __ATOMIC_RELAXED) && __sync_bool_compare_and_swap(&(reader->used), 0, 1)) {
+			break;
+		}
+	}
+
+	if (!reader) {
+
+		if (!(reader = mm_alloc(sizeof(epoch_reader_t)))) {
+			log_pedantic("Unable to allocate %zu bytes for an epoch reader record.", sizeof(epoch_reader_t));
+			return NULL;
+		}
+
+		reader->used = 1;
+		reader->next = __atomic_load_n(&epoch_readers, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&epoch_readers, &(reader->next), reader, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	}
+
+	tkey_set(epoch_key, reader);
+	epoch_local = reader;
+
+	return reader;
+}
+
+/**
+ * @brief	Enter a read side critical section.
+ * @note	Critical sections may be nested. Memory retired after the outermost call will not be released until the matching
+ * 			call to epoch_exit().
+ * @return	false if a reader record couldn't be allocated for the calling thread, or true on success.
+ */
+bool_t epoch_enter(void) {
+
+	epoch_reader_t *reader;
+
+	if (!(reader = epoch_reader())) {
+		return false;
+	}
+
+	if (!reader->depth++) {
+		__atomic_store_n(&(reader->epoch), __atomic_load_n(&epoch_global, __ATOMIC_ACQUIRE), __ATOMIC_RELAXED);
+		// The announcement must be visible before any shared pointers are loaded, or a writer could miss this reader.
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Leave a read side critical section.
+ * @return	This function returns no value.
+ */
+void epoch_exit(void) {
+
+	epoch_reader_t *reader = epoch_local;
+
+	if (reader && reader->depth && !--reader->depth) {
+		__atomic_store_n(&(reader->epoch), 0, __ATOMIC_RELEASE);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Find the oldest epoch announced by an active reader.
+ * @param	ignore	a reader record to be skipped, or NULL to consider every reader.
+ * @return	the oldest active reader epoch, or UINT64_MAX if no readers are active.
+ */
+uint64_t epoch_oldest(epoch_reader_t *ignore) {
+
+	uint64_t epoch, result = UINT64_MAX;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	for (epoch_reader_t *reader = __atomic_load_n(&epoch_readers, __ATOMIC_ACQUIRE); reader; reader = reader->next) {
+		if (reader != ignore && (epoch = __atomic_load_n(&(reader->epoch), __ATOMIC_ACQUIRE)) && epoch < result) {
+			result = epoch;
+		}
+	}
+
+	return result;
+}
+
+/**
+ * @brief	Queue a block of memory which has been unlinked from a shared structure for release.
+ * @note	The memory isn't eligible for release until the calling thread publishes the updated structure and calls
+ * 			epoch_advance(). If the queue entry can't be allocated the memory is leaked, since releasing it immediately
+ * 			could pull it out from underneath a reader.
+ * @param	data	a pointer to the memory being retired.
+ * @param	release	the function used to release the memory.
+ * @return	This function returns no value.
+ */
+void epoch_retire(void *data, void (*release)(void *)) {
+
+	epoch_retired_t *retired;
+
+	if (!data || !release) {
+		return;
+	}
+	else if (!(retired = mm_alloc(sizeof(epoch_retired_t)))) {
+		log_pedantic("Unable to allocate %zu bytes for an epoch retirement record. The memory will be leaked.", sizeof(epoch_retired_t));
+		return;
+	}
+
+	retired->data = data;
+	retired->release = release;
+	retired->next = epoch_pending;
+	epoch_pending = retired;
+
+	return;
+}
+
+/**
+ * @brief	Release any retired memory which is no longer visible to an active reader.
+ * @return	This function returns no value.
+ */
+void epoch_reclaim(void) {
+
+	uint64_t oldest;
+	epoch_retired_t *retired, *holder, *released = NULL, **link;
+
+	if (!__atomic_load_n(&epoch_retired, __ATOMIC_RELAXED)) {
+		return;
+	}
+
+	oldest = epoch_oldest(NULL);
+
+	mutex_lock(&epoch_lock);
+
+	link = &epoch_retired;
+	while ((retired = *link)) {
+		if (retired->epoch < oldest) {
+			*link = retired->next;
+			retired->next = released;
+			released = retired;
+		}
+		else {
+			link = &(retired->next);
+		}
+	}
+
+	mutex_unlock(&epoch_lock);
+
+	while ((holder = released)) {
+		released = holder->next;
+		holder->release(holder->data);
+		mm_free(holder);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Stamp the memory retired by the calling thread with the current epoch, then try to release retired memory.
+ * @note	This must be called after the structure which referenced the retired memory has been republished.
+ * @return	This function returns no value.
+ */
+void epoch_advance(void) {
+
+	uint64_t epoch;
+	epoch_retired_t *retired, *last = NULL;
+
+	if (epoch_pending) {
+
+		// Readers which announce an epoch later than this one entered after the new version was published.
+		epoch = __atomic_fetch_add(&epoch_global, 1, __ATOMIC_SEQ_CST);
+
+		for (retired = epoch_pending; retired; retired = retired->next) {
+			retired->epoch = epoch;
+			last = retired;
+		}
+
+		mutex_lock(&epoch_lock);
+		last->next = epoch_retired;
+		epoch_retired = epoch_pending;
+		mutex_unlock(&epoch_lock);
+
+		epoch_pending = NULL;
+	}
+
+	epoch_reclaim();
+
+	return;
+}
+
+/**
+ * @brief	Wait until every reader that was active when this function was called has left its critical section.
+ * @note	A critical section held by the calling thread is ignored, since waiting on it would never finish.
+ * @return	This function returns no value.
+ */
+void epoch_synchronize(void) {
+
+	uint64_t epoch = __atomic_fetch_add(&epoch_global, 1, __ATOMIC_SEQ_CST);
+
+	while (epoch_oldest(epoch_local) <= epoch) {
+		sched_yield();
+	}
+
+	epoch_reclaim();
+
+	return;
+}
@@ -0,0 +1,756 @@
+
+/**
+ * @file /magma/core/thread/executor.c
+ *
+ * @brief	A fixed size pool of worker threads which execute tasks, balancing the load between themselves by stealing work.
+ *
+ * @note	Every worker owns a deque of tasks. Tasks submitted by a worker are pushed onto the bottom of its own deque, and the
+ * 			worker pops from the bottom as well, so nested work is executed in depth first order, while the data it touches is
+ * 			still in cache. Tasks submitted from outside the executor go into a shared stacked list. A worker that runs out of
+ * 			work checks the shared list, and then steals from the top of the deques belonging to the other workers, starting
+ * 			with a random victim. Workers which can't find any work spin briefly, and then sleep on a condition until a task
+ * 			is submitted. The number of threads never changes after the executor is created, so heavy load only grows the
+ * 			queues, never the thread count.
+ *
+ * 			A thread which waits on a future belonging to its own executor executes other tasks while it waits, so tasks can
+ * 			safely submit subtasks and wait for their results without exhausting the worker threads.
+ */
+
+#include "magma.h"
+
+/**
+ * The number of tasks each worker deque can hold. Tasks which don't fit are placed on the shared list instead.
+ */
+#define MAGMA_EXECUTOR_DEQUE 4096
+
+/**
+ * The number of times an idle worker looks for work, yielding between attempts, before it goes to sleep.
+ */
+#define MAGMA_EXECUTOR_SPINS 64
+
+/**
+ * The number of chunks each worker should receive when a parallel loop is split up automatically.
+ */
+#define MAGMA_EXECUTOR_CHUNKS 4
+
+struct future_t {
+	executor_task_t function;
+	void *data, *result;
+	executor_t *executor;
+	uint32_t done;
+	bool_t detached;
+};
+
+// The ends of the deque are padded onto separate cache lines, so the owner and the thieves don't contend for the same line.
+typedef struct executor_deque_t {
+	int64_t top;
+	chr_t padding_top[56];
+	int64_t bottom;
+	chr_t padding_bottom[56];
+	future_t *tasks[MAGMA_EXECUTOR_DEQUE];
+} executor_deque_t;
+
+typedef struct executor_worker_t {
+	executor_t *executor;
+	pthread_t thread;
+	uint32_t number;
+	uint64_t seed;
+	executor_deque_t deque;
+} executor_worker_t;
+
+struct executor_t {
+	uint64_t options;
+	uint32_t count, launched, sleepers, waiters;
+	uint64_t pending;
+	bool_t stopping;
+	stacker_t *queue;
+	pthread_mutex_t mutex;
+	pthread_cond_t wake, done;
+	executor_worker_t **workers;
+};
+
+typedef struct executor_loop_t {
+	executor_range_t function;
+	void *data;
+	uint64_t start, end, grain, next, chunks;
+} executor_loop_t;
+
+static __thread executor_worker_t *executor_local = NULL;
+
+/**
+ * @brief	Push a task onto the bottom of a worker deque.
+ * @note	Only the worker which owns the deque may push onto it.
+ * @param	deque	a pointer to the deque being updated.
+ * @param	task	a pointer to the task being added.
+ * @return	false if the deque is full, or true on success.
+ */
+bool_t executor_deque_push(executor_deque_t *deque, future_t *task) {
+
+	int64_t bottom = __atomic_load_n(&(deque->bottom), __ATOMIC_RELAXED), top = __atomic_load_n(&(deque->top), __ATOMIC_ACQUIRE);
+
+	if (bottom - top >= MAGMA_EXECUTOR_DEQUE) {
+		return false;
+	}
+
+	__atomic_store_n(&(deque->tasks[bottom % MAGMA_EXECUTOR_DEQUE]), task, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&(deque->bottom), bottom + 1, __ATOMIC_RELAXED);
+
+	return true;
+}
+
+/**
+ * @brief	Pop a task off the bottom of a worker deque.
+ * @note	Only the worker which owns the deque may pop from it. When a single task remains, the owner races the thieves for
+ * 			it using the same compare and swap they use.
+ * @param	deque	a pointer to the deque being updated.
+ * @return	NULL if the deque is empty, or a pointer to the task.
+ */
+future_t * executor_deque_pop(executor_deque_t *deque) {
+
+	future_t *task = NULL;
+	int64_t bottom = __atomic_load_n(&(deque->bottom), __ATOMIC_RELAXED) - 1, top;
+
+	__atomic_store_n(&(deque->bottom), bottom, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	top = __atomic_load_n(&(deque->top), __ATOMIC_RELAXED);
+
+	if (top <= bottom) {
+		task = __atomic_load_n(&(deque->tasks[bottom % MAGMA_EXECUTOR_DEQUE]), __ATOMIC_RELAXED);
+		if (top == bottom) {
+			if (!__atomic_compare_exchange_n(&(deque->top), &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+				task = NULL;
+			}
+			__atomic_store_n(&(deque->bottom), bottom + 1, __ATOMIC_RELAXED);
+		}
+	}
+	else {
+		__atomic_store_n(&(deque->bottom), bottom + 1, __ATOMIC_RELAXED);
+	}
+
+	return task;
+}
+
+/**
+ * @brief	Steal a task from the top of a worker deque.
+ * @param	deque	a pointer to the deque being robbed.
+ * @return	NULL if the deque is empty, or another thread took the task first, or a pointer to the stolen task.
+ */
+future_t * executor_deque_steal(executor_deque_t *deque) {
+
+	future_t *task;
+	int64_t top = __atomic_load_n(&(deque->top), __ATOMIC_ACQUIRE), bottom;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	bottom = __atomic_load_n(&(deque->bottom), __ATOMIC_ACQUIRE);
+
+	if (top >= bottom) {
+		return NULL;
+	}
+
+	task = __atomic_load_n(&(deque->tasks[top % MAGMA_EXECUTOR_DEQUE]), __ATOMIC_RELAXED);
+
+	if (!__atomic_compare_exchange_n(&(deque->top), &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+		return NULL;
+	}
+
+	return task;
+}
+
+/**
+ * @brief	Determine whether an executor has any queued tasks.
+ * @param	executor	a pointer to the executor being checked.
+ * @return	true if a task is waiting to be executed, or false if the shared list and every worker deque are empty.
+ */
+bool_t executor_available(executor_t *executor) {
+
+	executor_deque_t *deque;
+	uint32_t launched = __atomic_load_n(&(executor->launched), __ATOMIC_ACQUIRE);
+
+	if (stacker_nodes(executor->queue)) {
+		return true;
+	}
+
+	for (uint32_t i = 0; i < launched; i++) {
+		deque = &(executor->workers[i]->deque);
+		if (__atomic_load_n(&(deque->bottom), __ATOMIC_ACQUIRE) > __atomic_load_n(&(deque->top), __ATOMIC_ACQUIRE)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief	Find a task to execute.
+ * @param	executor	a pointer to the executor being searched.
+ * @param	worker		the worker looking for a task, or NULL if the calling thread isn't one of the executor's workers.
+ * @return	NULL if no task could be found, or a pointer to the task.
+ */
+future_t * executor_find(executor_t *executor, executor_worker_t *worker) {
+
+	future_t *task;
+	uint64_t seed;
+	uint32_t victim, launched;
+
+	if ((worker && (task = executor_deque_pop(&(worker->deque)))) || (task = stacker_pop(executor->queue))) {
+		return task;
+	}
+	else if (!(launched = __atomic_load_n(&(executor->launched), __ATOMIC_ACQUIRE))) {
+		return NULL;
+	}
+
+	// Pick a random victim, so thieves spread themselves out instead of all raiding the first worker.
+	if (worker) {
+		seed = worker->seed;
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		worker->seed = seed;
+	}
+	else {
+		seed = (uint64_t)pthread_self();
+	}
+
+	victim = seed % launched;
+
+	for (uint32_t i = 0; i < launched; i++, victim = (victim + 1) % launched) {
+		if (executor->workers[victim] != worker && (task = executor_deque_steal(&(executor->workers[victim]->deque)))) {
+			return task;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Wake a sleeping worker, if there are any, after a task has been queued.
+ * @note	The sleeper count is read after a full fence, and sleeping workers check for tasks after announcing themselves,
+ * 			so either the worker sees the task, or the task submitter sees the worker.
+ * @param	executor	a pointer to the executor which received the task.
+ * @return	This function returns no value.
+ */
+void executor_notify(executor_t *executor) {
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&(executor->sleepers), __ATOMIC_RELAXED)) {
+		mutex_lock(&(executor->mutex));
+		pthread_cond_signal(&(executor->wake));
+		mutex_unlock(&(executor->mutex));
+	}
+
+	return;
+}
+
+/**
+ * @brief	Execute a task, and publish its result.
+ * @param	task	a pointer to the task being executed.
+ * @return	This function returns no value.
+ */
+void executor_run(future_t *task) {
+
+	void *result;
+	executor_t *executor = task->executor;
+
+	result = task->function(task->data);
+
+	// Once the task is marked done the waiting thread may free it, so nothing in the task can be touched afterward.
+	if (task->detached) {
+		mm_free(task);
+	}
+	else {
+		task->result = result;
+		__atomic_store_n(&(task->done), 1, __ATOMIC_RELEASE);
+	}
+
+	__atomic_sub_fetch(&(executor->pending), 1, __ATOMIC_RELEASE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&(executor->waiters), __ATOMIC_RELAXED)) {
+		mutex_lock(&(executor->mutex));
+		pthread_cond_broadcast(&(executor->done));
+		mutex_unlock(&(executor->mutex));
+	}
+
+	return;
+}
+
+/**
+ * @brief	Pin the calling worker thread to a processor.
+ * @param	worker	a pointer to the worker being pinned; workers are assigned to processors in order.
+ * @return	This function returns no value.
+ */
+void executor_affinity(executor_worker_t *worker) {
+
+	int_t result;
+	long processors;
+	cpu_set_t set;
+
+	if ((processors = sysconf(_SC_NPROCESSORS_ONLN)) <= 0) {
+		return;
+	}
+
+	CPU_ZERO(&set);
+	CPU_SET(worker->number % processors, &set);
+
+	if ((result = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set))) {
+		log_pedantic("Unable to pin the worker thread to a processor. { worker = %u / pthread_setaffinity_np = %i }", worker->number, result);
+	}
+
+	return;
+}
+
+/**
+ * @brief	The main loop for an executor worker thread.
+ * @note	Workers only exit once the executor is stopping and every pending task has been executed.
+ * @param	worker	a pointer to the worker being run.
+ * @return	This function always returns NULL.
+ */
+void * executor_worker(executor_worker_t *worker) {
+
+	future_t *task;
+	uint32_t idle = 0;
+	struct timespec deadline;
+	executor_t *executor = worker->executor;
+
+	executor_local = worker;
+
+	if (executor->options & M_EXECUTOR_AFFINITY) {
+		executor_affinity(worker);
+	}
+
+	while (true) {
+
+		if ((task = executor_find(executor, worker))) {
+			executor_run(task);
+			idle = 0;
+			continue;
+		}
+		else if (__atomic_load_n(&(executor->stopping), __ATOMIC_ACQUIRE) && !__atomic_load_n(&(executor->pending), __ATOMIC_ACQUIRE)) {
+			break;
+		}
+		else if (++idle < MAGMA_EXECUTOR_SPINS) {
+			sched_yield();
+			continue;
+		}
+
+		// The timeout is only a safety net, since submitting a task wakes a sleeping worker.
+		__atomic_add_fetch(&(executor->sleepers), 1, __ATOMIC_SEQ_CST);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		mutex_lock(&(executor->mutex));
+
+		if (!__atomic_load_n(&(executor->stopping), __ATOMIC_ACQUIRE) && !executor_available(executor) &&
+			!clock_gettime(CLOCK_MONOTONIC, &deadline)) {
+			deadline.tv_sec++;
+			pthread_cond_timedwait(&(executor->wake), &(executor->mutex), &deadline);
+		}
+
+		mutex_unlock(&(executor->mutex));
+		__atomic_sub_fetch(&(executor->sleepers), 1, __ATOMIC_RELAXED);
+		idle = 0;
+	}
+
+	executor_local = NULL;
+
+	return NULL;
+}
+
+/**
+ * @brief	Queue a task for execution.
+ * @param	executor	a pointer to the executor which will run the task.
+ * @param	task		a pointer to the task being queued.
+ * @return	true on success, or false if the task couldn't be queued.
+ */
+bool_t executor_queue(executor_t *executor, future_t *task) {
+
+	executor_worker_t *worker = executor_local;
+
+	__atomic_add_fetch(&(executor->pending), 1, __ATOMIC_RELAXED);
+
+	// Tasks submitted by a worker go onto its own deque, unless the deque is full.
+	if ((!worker || worker->executor != executor || !executor_deque_push(&(worker->deque), task)) && !stacker_push(executor->queue, task)) {
+		__atomic_sub_fetch(&(executor->pending), 1, __ATOMIC_RELAXED);
+		return false;
+	}
+
+	executor_notify(executor);
+
+	return true;
+}
+
+/**
+ * @brief	Allocate a task.
+ * @param	executor	a pointer to the executor which will run the task.
+ * @param	function	the function to be executed.
+ * @param	data		the value to be passed to the function.
+ * @param	detached	if true, the task is freed as soon as it finishes, and its result is discarded.
+ * @return	NULL on failure, or a pointer to the newly allocated task.
+ */
+future_t * executor_task(executor_t *executor, executor_task_t function, void *data, bool_t detached) {
+
+	future_t *task;
+
+	if (!executor || !function) {
+		log_pedantic("Passed a NULL pointer.");
+		return NULL;
+	}
+	// Workers may keep queuing subtasks while the executor is stopping, since the pending tasks may depend on them.
+	else if (__atomic_load_n(&(executor->stopping), __ATOMIC_ACQUIRE) && (!executor_local || executor_local->executor != executor)) {
+		log_pedantic("Unable to submit a task to an executor which is being freed.");
+		return NULL;
+	}
+	else if (!(task = mm_alloc(sizeof(future_t)))) {
+		log_pedantic("Unable to allocate %zu bytes for an executor task.", sizeof(future_t));
+		return NULL;
+	}
+
+	task->function = function;
+	task->data = data;
+	task->executor = executor;
+	task->detached = detached;
+
+	return task;
+}
+
+/**
+ * @brief	Submit a task to an executor, and get a future which will hold its result.
+ * @param	executor	a pointer to the executor which will run the task.
+ * @param	function	the function to be executed.
+ * @param	data		the value to be passed to the function.
+ * @return	NULL on failure, or a pointer to a future which must be released using future_free().
+ */
+future_t * executor_submit(executor_t *executor, executor_task_t function, void *data) {
+
+	future_t *task;
+
+	if (!(task = executor_task(executor, function, data, false))) {
+		return NULL;
+	}
+	else if (!executor_queue(executor, task)) {
+		mm_free(task);
+		return NULL;
+	}
+
+	return task;
+}
+
+/**
+ * @brief	Submit a task to an executor without tracking its result.
+ * @param	executor	a pointer to the executor which will run the task.
+ * @param	function	the function to be executed.
+ * @param	data		the value to be passed to the function.
+ * @return	true if the task was queued, or false on failure.
+ */
+bool_t executor_spawn(executor_t *executor, executor_task_t function, void *data) {
+
+	future_t *task;
+
+	if (!(task = executor_task(executor, function, data, true))) {
+		return false;
+	}
+	else if (!executor_queue(executor, task)) {
+		mm_free(task);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Determine whether the task behind a future has finished.
+ * @param	future	a pointer to the future being checked.
+ * @return	true if the task has finished, or false if it hasn't.
+ */
+bool_t future_done(future_t *future) {
+
+	if (!future) {
+		return false;
+	}
+
+	return __atomic_load_n(&(future->done), __ATOMIC_ACQUIRE) ? true : false;
+}
+
+/**
+ * @brief	Wait for the task behind a future to finish.
+ * @note	If the calling thread is one of the executor's workers, it executes other tasks while it waits.
+ * @param	future	a pointer to the future being waited on.
+ * @return	the value returned by the task, or NULL if the future is NULL.
+ */
+void * future_wait(future_t *future) {
+
+	future_t *task;
+	struct timespec deadline;
+	executor_t *executor;
+	executor_worker_t *worker = executor_local;
+
+	if (!future) {
+		return NULL;
+	}
+
+	executor = future->executor;
+	worker = worker && worker->executor == executor ? worker : NULL;
+
+	while (!future_done(future)) {
+
+		if (worker && (task = executor_find(executor, worker))) {
+			executor_run(task);
+			continue;
+		}
+
+		// Workers only sleep briefly, so they can go back to helping as soon as more tasks are queued.
+		__atomic_add_fetch(&(executor->waiters), 1, __ATOMIC_SEQ_CST);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		mutex_lock(&(executor->mutex));
+
+		if (!future_done(future) && !clock_gettime(CLOCK_MONOTONIC, &deadline)) {
+			if (worker) {
+				deadline.tv_nsec += 1000000;
+				if (deadline.tv_nsec >= 1000000000) {
+					deadline.tv_sec++;
+					deadline.tv_nsec -= 1000000000;
+				}
+			}
+			else {
+				deadline.tv_sec++;
+			}
+			pthread_cond_timedwait(&(executor->done), &(executor->mutex), &deadline);
+		}
+
+		mutex_unlock(&(executor->mutex));
+		__atomic_sub_fetch(&(executor->waiters), 1, __ATOMIC_RELAXED);
+	}
+
+	return future->result;
+}
+
+/**
+ * @brief	Free a future, waiting for its task to finish first if necessary.
+ * @param	future	a pointer to the future being freed.
+ * @return	This function returns no value.
+ */
+void future_free(future_t *future) {
+
+	if (future) {
+		future_wait(future);
+		mm_free(future);
+	}
+
+	return;
+}
+
+/**
+ * @brief	Execute chunks of a parallel loop until none remain.
+ * @note	Chunks are claimed by index rather than by value, so the counter only overshoots the number of chunks by one for
+ * 			each participating thread, and never wraps around for ranges which end near UINT64_MAX.
+ * @param	loop	a pointer to the shared loop state.
+ * @return	This function always returns NULL.
+ */
+void * executor_loop(executor_loop_t *loop) {
+
+	uint64_t chunk, start;
+
+	while ((chunk = __atomic_fetch_add(&(loop->next), 1, __ATOMIC_RELAXED)) < loop->chunks) {
+		start = loop->start + (chunk * loop->grain);
+		loop->function(start, (loop->end - start) > loop->grain ? start + loop->grain : loop->end, loop->data);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief	Execute a function over a range of values, using every worker in an executor.
+ * @note	The range is split into chunks which the calling thread and the workers claim one at a time, so faster threads end
+ * 			up processing more chunks. The calling thread participates, so the loop completes even if every worker is busy.
+ * @param	executor	a pointer to the executor which will help execute the loop.
+ * @param	start		the first value in the range.
+ * @param	end			the value following the last value in the range.
+ * @param	grain		the number of values in each chunk, or zero to split the range into a few chunks per worker.
+ * @param	function	the function to be executed for each chunk; it receives the start and end of the chunk.
+ * @param	data		the value to be passed to the function.
+ * @return	true once the entire range has been processed, or false if the parameters were invalid.
+ */
+bool_t executor_parallel_for(executor_t *executor, uint64_t start, uint64_t end, uint64_t grain, executor_range_t function, void *data) {
+
+	future_t **helpers;
+	uint64_t chunks, count = 0;
+	executor_loop_t loop;
+
+	if (!executor || !function) {
+		log_pedantic("Passed a NULL pointer.");
+		return false;
+	}
+	else if (end <= start) {
+		return true;
+	}
+
+	if (!grain) {
+		grain = (end - start) / (executor->count * MAGMA_EXECUTOR_CHUNKS);
+		grain = grain ? grain : 1;
+	}
+
+	// Every participant overshoots the chunk counter once before it stops, so the counter needs that much headroom. Only a
+	// grain of one over a range spanning nearly every value could run out of it, and doubling the grain is enough to fix that.
+	if (((end - start) / grain) > UINT64_MAX - executor->count - 2) {
+		grain = 2;
+	}
+
+	chunks = ((end - start) / grain) + (((end - start) % grain) ? 1 : 0);
+	loop.function = function;
+	loop.data = data;
+	loop.start = start;
+	loop.end = end;
+	loop.grain = grain;
+	loop.next = 0;
+	loop.chunks = chunks;
+
+	// The calling thread processes chunks too, so one fewer helper is needed than there are chunks.
+	count = (chunks - 1) < executor->count ? chunks - 1 : executor->count;
+
+	if (count && (helpers = mm_alloc(sizeof(future_t *) * count))) {
+
+		for (uint64_t i = 0; i < count; i++) {
+			helpers[i] = executor_submit(executor, (executor_task_t)&executor_loop, &loop);
+		}
+
+		executor_loop(&loop);
+
+		for (uint64_t i = 0; i < count; i++) {
+			future_free(helpers[i]);
+		}
+
+		mm_free(helpers);
+	}
+	else {
+		executor_loop(&loop);
+	}
+
+	return true;
+}
+
+/**
+ * @brief	Get the number of worker threads belonging to an executor.
+ * @param	executor	a pointer to the executor being queried.
+ * @return	the number of worker threads.
+ */
+uint32_t executor_threads(executor_t *executor) {
+
+	if (!executor) {
+		return 0;
+	}
+
+	return executor->count;
+}
+
+/**
+ * @brief	Free an executor, after every queued task has finished.
+ * @note	The workers continue executing tasks until none remain, including tasks queued by other tasks, and are then joined.
+ * 			No new tasks may be submitted from outside the executor once this function has been called.
+ * @param	executor	a pointer to the executor being freed.
+ * @return	This function returns no value.
+ */
+void executor_free(executor_t *executor) {
+
+	if (!executor) {
+		return;
+	}
+
+	__atomic_store_n(&(executor->stopping), true, __ATOMIC_RELEASE);
+
+	mutex_lock(&(executor->mutex));
+	pthread_cond_broadcast(&(executor->wake));
+	mutex_unlock(&(executor->mutex));
+
+	for (uint32_t i = 0; i < executor->launched; i++) {
+		thread_join(executor->workers[i]->thread);
+	}
+
+	for (uint32_t i = 0; i < executor->count && executor->workers[i]; i++) {
+		mm_free(executor->workers[i]);
+	}
+
+	stacker_free(executor->queue);
+	pthread_cond_destroy(&(executor->done));
+	pthread_cond_destroy(&(executor->wake));
+	mutex_destroy(&(executor->mutex));
+	mm_free(executor->workers);
+	mm_free(executor);
+
+	return;
+}
+
+/**
+ * @brief	Allocate an executor, and launch its worker threads.
+ * @param	threads		the number of worker threads, or zero to launch one for each online processor.
+ * @param	options		M_EXECUTOR_AFFINITY to pin each worker thread to a processor, or zero.
+ * @return	NULL on failure, or a pointer to the newly allocated executor.
+ */
+executor_t * executor_alloc(uint32_t threads, uint64_t options) {
+
+	long processors;
+	executor_t *result;
+	pthread_condattr_t attributes;
+
+	if (!threads) {
+		threads = (processors = sysconf(_SC_NPROCESSORS_ONLN)) > 0 ? processors : 1;
+	}
+
+	if (threads > MAGMA_EXECUTOR_THREADS_LIMIT) {
+		log_pedantic("%u exceeds the maximum number of executor threads allowed.", threads);
+		return NULL;
+	}
+	else if (!(result = mm_alloc(sizeof(executor_t)))) {
+		log_pedantic("Unable to allocate %zu bytes for an executor.", sizeof(executor_t));
+		return NULL;
+	}
+	else if (!(result->workers = mm_alloc(sizeof(executor_worker_t *) * threads))) {
+		log_pedantic("Unable to allocate %zu bytes for the executor workers.", sizeof(executor_worker_t *) * threads);
+		mm_free(result);
+		return NULL;
+	}
+
+	result->count = threads;
+	result->options = options;
+
+	if (!(result->queue = stacker_alloc(NULL))) {
+		mm_free(result->workers);
+		mm_free(result);
+		return NULL;
+	}
+	else if (mutex_init(&(result->mutex), NULL)) {
+		stacker_free(result->queue);
+		mm_free(result->workers);
+		mm_free(result);
+		return NULL;
+	}
+
+	pthread_condattr_init(&attributes);
+	pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+	pthread_cond_init(&(result->wake), &attributes);
+	pthread_cond_init(&(result->done), &attributes);
+	pthread_condattr_destroy(&attributes);
+
+	for (uint32_t i = 0; i < threads; i++) {
+		if (!(result->workers[i] = mm_alloc(sizeof(executor_worker_t)))) {
+			log_pedantic("Unable to allocate %zu bytes for an executor worker.", sizeof(executor_worker_t));
+			executor_free(result);
+			return NULL;
+		}
+
+		result->workers[i]->executor = result;
+		result->workers[i]->number = i;
+		result->workers[i]->seed = hash_wyhash64(&i, sizeof(uint32_t), (uintptr_t)result) | 1;
+	}
+
+	// The launched count is only updated once a worker is running, so the thieves never look at a worker that isn't there.
+	for (uint32_t i = 0; i < threads; i++) {
+		if (thread_launch(&(result->workers[i]->thread), &executor_worker, result->workers[i])) {
+			log_pedantic("Unable to launch an executor worker thread.");
+			executor_free(result);
+			return NULL;
+		}
+		__atomic_store_n(&(result->launched), i + 1, __ATOMIC_RELEASE);
+	}
+
+	return result;
+}
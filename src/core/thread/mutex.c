@@ -29,23 +29,44 @@ int mutex_init(pthread_mutex_t *lock, pthread_mutexattr_t *attr) {
 }
 
 /**
- * @brief	Acquire a pthread mutex, blocking if necessary.
+ * @brief	Acquire a pthread mutex, spinning briefly and then blocking if necessary.
  * @see		pthread_mutex_lock()
+ * @note	If the mutex is held by another thread, the caller spins with exponential backoff before it parks, and when
+ * 			contention statistics are enabled, the wait is recorded against the calling site.
  * @param	lock	a pointer to the mutex to be locked.
  * @return	0 on success, or an error number on failure.
  */
 int mutex_lock(pthread_mutex_t *lock) {
 
+	int result;
+	uint64_t started;
+	uint32_t round = 0;
+
+	if ((result = pthread_mutex_trylock(lock)) == EBUSY) {
+
+		started = contention_begin();
+
+		while (contention_backoff(round++) && (result = pthread_mutex_trylock(lock)) == EBUSY);
+
+		if (result == EBUSY) {
+			result = pthread_mutex_lock(lock);
+			contention_end(__builtin_return_address(0), M_CONTENTION_MUTEX, started, true);
+		}
+		else {
+			contention_end(__builtin_return_address(0), M_CONTENTION_MUTEX, started, false);
+		}
+	}
+	else if (result) {
+		result = pthread_mutex_lock(lock);
+	}
+
 #ifdef MAGMA_PEDANTIC
-	int result = pthread_mutex_lock(lock);
 	if (result) {
 		log_options(M_LOG_PEDANTIC | M_LOG_STACK_TRACE, "Could not lock the mutex. {pthread_mutex_lock = %i / error = %s}", result, errno_string(errno, MEMORYBUF(1024), 1024));
 	}
-	return result;
-#else
-	return pthread_mutex_lock(lock);
 #endif
 
+	return result;
 }
 
 /**
@@ -27,39 +27,81 @@ int rwlock_init(pthread_rwlock_t *lock, pthread_rwlockattr_t *attr) {
 }
 
 /**
- * @brief	Attempt to acquire a pthread read/write lock for writing, blocking if necessary.
+ * @brief	Attempt to acquire a pthread read/write lock for writing, spinning briefly and then blocking if necessary.
  * @see		pthread_rwlock_wrlock()
+ * @note	If the lock can't be acquired right away, the caller spins with exponential backoff before it parks, and when
+ * 			contention statistics are enabled, the wait is recorded against the calling site.
  * @param	lock	a pointer to the read/write lock to be acquired.
  * @return	0 on success or an error number on failure.
  */
 int rwlock_lock_write(pthread_rwlock_t *lock) {
 
+	int result;
+	uint64_t started;
+	uint32_t round = 0;
+
+	if ((result = pthread_rwlock_trywrlock(lock)) == EBUSY) {
+
+		started = contention_begin();
+
+		while (contention_backoff(round++) && (result = pthread_rwlock_trywrlock(lock)) == EBUSY);
+
+		if (result == EBUSY) {
+			result = pthread_rwlock_wrlock(lock);
+			contention_end(__builtin_return_address(0), M_CONTENTION_WRITE, started, true);
+		}
+		else {
+			contention_end(__builtin_return_address(0), M_CONTENTION_WRITE, started, false);
+		}
+	}
+	else if (result) {
+		result = pthread_rwlock_wrlock(lock);
+	}
+
 #ifdef MAGMA_PEDANTIC
-	int result = pthread_rwlock_wrlock(lock);
 	if (result) log_pedantic("Could not obtain a write lock. {pthread_rwlock_wrlock = %i}", result);
-	return result;
-#else
-	return pthread_rwlock_wrlock(lock);
 #endif
 
+	return result;
 }
 
 /**
- * @brief	Attempt to acquire a pthread read/write lock for reading, blocking if necessary.
+ * @brief	Attempt to acquire a pthread read/write lock for reading, spinning briefly and then blocking if necessary.
  * @see		pthread_rwlock_rdlock()
+ * @note	If the lock can't be acquired right away, the caller spins with exponential backoff before it parks, and when
+ * 			contention statistics are enabled, the wait is recorded against the calling site.
  * @param	lock	the read-write lock to be tried.
  * @return	0 on success or an error number on failure.
  */
 int rwlock_lock_read(pthread_rwlock_t *lock) {
 
+	int result;
+	uint64_t started;
+	uint32_t round = 0;
+
+	if ((result = pthread_rwlock_tryrdlock(lock)) == EBUSY) {
+
+		started = contention_begin();
+
+		while (contention_backoff(round++) && (result = pthread_rwlock_tryrdlock(lock)) == EBUSY);
+
+		if (result == EBUSY) {
+			result = pthread_rwlock_rdlock(lock);
+			contention_end(__builtin_return_address(0), M_CONTENTION_READ, started, true);
+		}
+		else {
+			contention_end(__builtin_return_address(0), M_CONTENTION_READ, started, false);
+		}
+	}
+	else if (result) {
+		result = pthread_rwlock_rdlock(lock);
+	}
+
 #ifdef MAGMA_PEDANTIC
-	int result = pthread_rwlock_rdlock(lock);
 	if (result) log_pedantic("Could not obtain a read lock. {pthread_rwlock_rdlock = %i}", result);
-	return result;
-#else
-	return pthread_rwlock_rdlock(lock);
 #endif
 
+	return result;
 }
 
 /**
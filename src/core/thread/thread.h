@@ -8,6 +8,64 @@
 #ifndef MAGMA_CORE_THREAD_H
 #define MAGMA_CORE_THREAD_H
 
+/**
+ * Executor options.
+ */
+typedef enum {
+	M_EXECUTOR_AFFINITY = 1, //!< M_EXECUTOR_AFFINITY
+} MAGMA_EXECUTOR;
+
+/**
+ * The maximum number of worker threads an executor can be configured to use.
+ */
+#define MAGMA_EXECUTOR_THREADS_LIMIT 1024
+
+/**
+ * The types of lock acquisition tracked by the contention statistics.
+ */
+typedef enum {
+	M_CONTENTION_MUTEX = 1, //!< M_CONTENTION_MUTEX
+	M_CONTENTION_READ = 2, //!< M_CONTENTION_READ
+	M_CONTENTION_WRITE = 3 //!< M_CONTENTION_WRITE
+} M_CONTENTION;
+
+typedef struct __attribute__ ((packed)) {
+	void *site; /* The address which requested the lock. */
+	uint32_t kind; /* The type of lock acquisition, using the M_CONTENTION values. */
+	uint64_t contended; /* The number of acquisitions which found the lock already held. */
+	uint64_t spun; /* The number of contended acquisitions which succeeded while spinning. */
+	uint64_t parked; /* The number of contended acquisitions which had to block. */
+	uint64_t nanoseconds; /* The total time spent waiting on the lock. */
+	uint64_t longest; /* The longest single wait on the lock. */
+} contention_site_t;
+
+typedef struct executor_t executor_t;
+typedef struct future_t future_t;
+
+typedef void * (*executor_task_t)(void *data);
+typedef void (*executor_range_t)(uint64_t start, uint64_t end, void *data);
+
+/// contention.c
+bool_t     contention_backoff(uint32_t round);
+uint64_t   contention_begin(void);
+void       contention_enable(bool_t enable);
+bool_t     contention_enabled(void);
+void       contention_end(void *site, M_CONTENTION kind, uint64_t started, bool_t parked);
+void       contention_log(uint64_t limit);
+uint64_t   contention_report(contention_site_t *sites, uint64_t limit);
+void       contention_reset(void);
+
+/// executor.c
+executor_t *  executor_alloc(uint32_t threads, uint64_t options);
+void          executor_free(executor_t *executor);
+bool_t        executor_parallel_for(executor_t *executor, uint64_t start, uint64_t end, uint64_t grain, executor_range_t function, void *data);
+bool_t        executor_spawn(executor_t *executor, executor_task_t function, void *data);
+future_t *    executor_submit(executor_t *executor, executor_task_t function, void *data);
+uint32_t      executor_threads(executor_t *executor);
+bool_t        future_done(future_t *future);
+void          future_free(future_t *future);
+void *        future_wait(future_t *future);
+
 /// thread.c
 pthread_t *  thread_alloc(void *function, void *data);
 int_t        thread_cancel(pthread_t thread);
@@ -35,6 +93,14 @@ void *  tkey_get(pthread_key_t key);
 int     tkey_init(pthread_key_t *key, void(*destructor)(void*));
 int     tkey_set(pthread_key_t key, void *value);
 
+/// epoch.c
+void     epoch_advance(void);
+bool_t   epoch_enter(void);
+void     epoch_exit(void);
+void     epoch_reclaim(void);
+void     epoch_retire(void *data, void (*release)(void *));
+void     epoch_synchronize(void);
+
 /// mutex.c
 int   mutex_destroy(pthread_mutex_t *lock);
 int   mutex_init(pthread_mutex_t *lock, pthread_mutexattr_t *attr);
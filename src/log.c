@@ -16,7 +16,7 @@ pthread_mutex_t log_mutex =	PTHREAD_MUTEX_INITIALIZER;
  */
 void log_disable(void) {
 	mutex_lock(&log_mutex);
-	log_enabled = false;
+	__atomic_store_n(&log_enabled, false, __ATOMIC_RELAXED);
 	mutex_unlock(&log_mutex);
 	return;
 }
@@ -27,7 +27,7 @@ void log_disable(void) {
  */
  void log_enable(void) {
 	mutex_lock(&log_mutex);
-	log_enabled = true;
+	__atomic_store_n(&log_enabled, true, __ATOMIC_RELAXED);
 	mutex_unlock(&log_mutex);
 	return;
 }